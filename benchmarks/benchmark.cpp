@@ -0,0 +1,240 @@
+#include "backends/p4tools/modules/flay/benchmarks/benchmark.h"
+
+#include <exception>
+#include <iomanip>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#include "lib/exceptions.h"
+
+namespace P4::P4Tools::Flay::Benchmark {
+
+namespace {
+
+/// A registered benchmark.
+struct RegisteredBenchmark {
+    std::string name;
+    BenchmarkFunction function;
+    std::vector<int64_t> arguments;
+};
+
+std::vector<RegisteredBenchmark> &registry() {
+    static std::vector<RegisteredBenchmark> REGISTRY;
+    return REGISTRY;
+}
+
+/// Escape @param value for use in a JSON string.
+std::string escapeJson(const std::string &value) {
+    std::stringstream output;
+    for (char character : value) {
+        switch (character) {
+            case '"':
+                output << "\\\"";
+                break;
+            case '\\':
+                output << "\\\\";
+                break;
+            case '\n':
+                output << "\\n";
+                break;
+            case '\t':
+                output << "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(character) < 0x20) {
+                    output << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                           << static_cast<int>(character) << std::dec;
+                } else {
+                    output << character;
+                }
+        }
+    }
+    return output.str();
+}
+
+/// Execute a single run of @param function and convert the state into a result.
+BenchmarkResult runOnce(const std::string &name, const BenchmarkFunction &function,
+                        std::optional<int64_t> argument, std::chrono::nanoseconds minTime) {
+    State state(argument, minTime);
+    try {
+        function(state);
+    } catch (const Util::P4CExceptionBase &e) {
+        state.skipWithError(e.what());
+    } catch (const std::exception &e) {
+        state.skipWithError(e.what());
+    }
+
+    BenchmarkResult result;
+    result.name = argument.has_value() ? name + "/" + std::to_string(argument.value()) : name;
+    result.iterations = state.iterations();
+    result.counters = state.counters();
+    result.errorMessage = state.errorMessage();
+    if (state.iterations() > 0) {
+        auto iterations = static_cast<double>(state.iterations());
+        result.realTime = static_cast<double>(state.realTime().count()) / iterations;
+        result.cpuTime = static_cast<double>(state.cpuTime().count()) / iterations;
+    }
+    return result;
+}
+
+}  // namespace
+
+State::State(std::optional<int64_t> argument, std::chrono::nanoseconds minTime)
+    : _argument(argument), _minTime(minTime) {}
+
+void State::startTimer() {
+    _timing = true;
+    _realStart = std::chrono::steady_clock::now();
+    _cpuStart = std::clock();
+}
+
+void State::stopTimer() {
+    _timing = false;
+    _realTime += std::chrono::steady_clock::now() - _realStart;
+    auto cpuTicks = static_cast<double>(std::clock() - _cpuStart);
+    _cpuTime += std::chrono::nanoseconds(static_cast<int64_t>(cpuTicks * 1e9 / CLOCKS_PER_SEC));
+}
+
+bool State::keepRunning() {
+    if (_errorMessage.has_value()) {
+        if (_timing) {
+            stopTimer();
+        }
+        return false;
+    }
+    if (!_started) {
+        _started = true;
+        startTimer();
+        return true;
+    }
+    _iterations++;
+    auto elapsed = _realTime;
+    if (_timing) {
+        elapsed += std::chrono::steady_clock::now() - _realStart;
+    }
+    if (elapsed < _minTime) {
+        return true;
+    }
+    if (_timing) {
+        stopTimer();
+    }
+    return false;
+}
+
+void State::pauseTiming() {
+    BUG_CHECK(_timing, "Timer is not running.");
+    stopTimer();
+}
+
+void State::resumeTiming() {
+    BUG_CHECK(!_timing, "Timer is already running.");
+    startTimer();
+}
+
+int64_t State::range() const {
+    BUG_CHECK(_argument.has_value(), "Benchmark was registered without arguments.");
+    return _argument.value();
+}
+
+void State::setCounter(const std::string &name, double value) { _counters[name] = value; }
+
+void State::skipWithError(const std::string &message) { _errorMessage = message; }
+
+uint64_t State::iterations() const { return _iterations; }
+
+std::chrono::nanoseconds State::realTime() const { return _realTime; }
+
+std::chrono::nanoseconds State::cpuTime() const { return _cpuTime; }
+
+const std::map<std::string, double> &State::counters() const { return _counters; }
+
+const std::optional<std::string> &State::errorMessage() const { return _errorMessage; }
+
+int registerBenchmark(const std::string &name, BenchmarkFunction function,
+                      std::vector<int64_t> arguments) {
+    registry().push_back({name, std::move(function), std::move(arguments)});
+    return 0;
+}
+
+std::vector<BenchmarkResult> runBenchmarks(const BenchmarkOptions &options) {
+    std::regex filter(options.filter);
+    std::vector<BenchmarkResult> results;
+    for (const auto &benchmark : registry()) {
+        if (!std::regex_search(benchmark.name, filter)) {
+            continue;
+        }
+        if (benchmark.arguments.empty()) {
+            results.push_back(
+                runOnce(benchmark.name, benchmark.function, std::nullopt, options.minTime));
+            continue;
+        }
+        for (auto argument : benchmark.arguments) {
+            results.push_back(
+                runOnce(benchmark.name, benchmark.function, argument, options.minTime));
+        }
+    }
+    return results;
+}
+
+void writeJsonReport(std::ostream &output, const std::vector<BenchmarkResult> &results) {
+    auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    output << "{\n";
+    output << "  \"context\": {\n";
+    output << "    \"date\": \"" << std::put_time(std::localtime(&now), "%FT%T%z") << "\",\n";
+    output << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+    output << "    \"library_build_type\": \"release\"\n";
+#else
+    output << "    \"library_build_type\": \"debug\"\n";
+#endif
+    output << "  },\n";
+    output << "  \"benchmarks\": [";
+    for (size_t idx = 0; idx < results.size(); ++idx) {
+        const auto &result = results[idx];
+        output << (idx == 0 ? "\n" : ",\n");
+        output << "    {\n";
+        output << "      \"name\": \"" << escapeJson(result.name) << "\",\n";
+        output << "      \"run_name\": \"" << escapeJson(result.name) << "\",\n";
+        output << "      \"run_type\": \"iteration\",\n";
+        if (result.errorMessage.has_value()) {
+            output << "      \"error_occurred\": true,\n";
+            output << "      \"error_message\": \"" << escapeJson(result.errorMessage.value())
+                   << "\",\n";
+        }
+        output << "      \"iterations\": " << result.iterations << ",\n";
+        output << "      \"real_time\": " << std::fixed << std::setprecision(3) << result.realTime
+               << ",\n";
+        output << "      \"cpu_time\": " << result.cpuTime << ",\n";
+        for (const auto &[counterName, value] : result.counters) {
+            output << "      \"" << escapeJson(counterName) << "\": " << value << ",\n";
+        }
+        output << "      \"time_unit\": \"ns\"\n";
+        output << "    }";
+        output << std::defaultfloat;
+    }
+    output << "\n  ]\n";
+    output << "}\n";
+}
+
+void writeConsoleReport(std::ostream &output, const std::vector<BenchmarkResult> &results) {
+    output << std::left << std::setw(60) << "Benchmark" << std::right << std::setw(16) << "Time"
+           << std::setw(16) << "CPU" << std::setw(12) << "Iterations" << "\n";
+    output << std::string(104, '-') << "\n";
+    for (const auto &result : results) {
+        output << std::left << std::setw(60) << result.name << std::right;
+        if (result.errorMessage.has_value()) {
+            output << " ERROR: " << result.errorMessage.value() << "\n";
+            continue;
+        }
+        output << std::fixed << std::setprecision(0) << std::setw(13) << result.realTime << " ns"
+               << std::setw(13) << result.cpuTime << " ns" << std::setw(12) << result.iterations;
+        for (const auto &[counterName, value] : result.counters) {
+            output << " " << counterName << "=" << std::setprecision(2) << value;
+        }
+        output << std::defaultfloat << "\n";
+    }
+}
+
+}  // namespace P4::P4Tools::Flay::Benchmark
@@ -0,0 +1,142 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_BENCHMARKS_BENCHMARK_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_BENCHMARKS_BENCHMARK_H_
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace P4::P4Tools::Flay::Benchmark {
+
+/// The state of a single benchmark run. A benchmark function repeatedly calls @ref keepRunning
+/// and executes the measured code in the loop body. Work outside of the measured region can be
+/// excluded with @ref pauseTiming and @ref resumeTiming.
+class State {
+    /// The argument of this run. Benchmarks without arguments have no argument.
+    std::optional<int64_t> _argument;
+
+    /// The minimum time the benchmark loop is executed for.
+    std::chrono::nanoseconds _minTime;
+
+    /// The number of completed iterations.
+    uint64_t _iterations = 0;
+
+    /// Whether the loop has been entered.
+    bool _started = false;
+
+    /// Whether the timer is currently running.
+    bool _timing = false;
+
+    /// The wall clock and processor time at which the timer was last started.
+    std::chrono::steady_clock::time_point _realStart;
+    std::clock_t _cpuStart = 0;
+
+    /// The accumulated wall clock and processor time.
+    std::chrono::nanoseconds _realTime{0};
+    std::chrono::nanoseconds _cpuTime{0};
+
+    /// User-defined counters reported alongside the timings.
+    std::map<std::string, double> _counters;
+
+    /// Set if the benchmark was aborted with @ref skipWithError.
+    std::optional<std::string> _errorMessage;
+
+    void startTimer();
+    void stopTimer();
+
+ public:
+    State(std::optional<int64_t> argument, std::chrono::nanoseconds minTime);
+
+    /// @returns true as long as another iteration should be executed.
+    bool keepRunning();
+
+    /// Stop measuring time until @ref resumeTiming is called.
+    void pauseTiming();
+
+    /// Resume measuring time after @ref pauseTiming.
+    void resumeTiming();
+
+    /// @returns the argument of this run. Must only be called by benchmarks with arguments.
+    [[nodiscard]] int64_t range() const;
+
+    /// Report @param value under @param name in the results of this run.
+    void setCounter(const std::string &name, double value);
+
+    /// Abort the benchmark. The loop is not entered or left on the next call to @ref keepRunning.
+    void skipWithError(const std::string &message);
+
+    [[nodiscard]] uint64_t iterations() const;
+    [[nodiscard]] std::chrono::nanoseconds realTime() const;
+    [[nodiscard]] std::chrono::nanoseconds cpuTime() const;
+    [[nodiscard]] const std::map<std::string, double> &counters() const;
+    [[nodiscard]] const std::optional<std::string> &errorMessage() const;
+};
+
+/// A function which measures code using a benchmark state.
+using BenchmarkFunction = std::function<void(State &)>;
+
+/// The result of a single benchmark run.
+struct BenchmarkResult {
+    /// The name of the benchmark, followed by the argument of the run if there is one.
+    std::string name;
+
+    /// The number of measured iterations.
+    uint64_t iterations = 0;
+
+    /// The average wall clock and processor time of an iteration in nanoseconds.
+    double realTime = 0;
+    double cpuTime = 0;
+
+    /// The counters set by the benchmark.
+    std::map<std::string, double> counters;
+
+    /// Set if the benchmark failed.
+    std::optional<std::string> errorMessage;
+};
+
+/// Options which control how the registered benchmarks are executed.
+struct BenchmarkOptions {
+    /// Only run benchmarks whose name matches this regular expression.
+    std::string filter = ".*";
+
+    /// The minimum time each benchmark run is measured for.
+    std::chrono::nanoseconds minTime = std::chrono::milliseconds(500);
+};
+
+/// Register a benchmark which is run once for every argument in @param arguments, or once
+/// without argument if @param arguments is empty.
+/// @returns a dummy value so registrations can initialize static variables.
+int registerBenchmark(const std::string &name, BenchmarkFunction function,
+                      std::vector<int64_t> arguments = {});
+
+/// Run all registered benchmarks matching the filter in @param options.
+std::vector<BenchmarkResult> runBenchmarks(const BenchmarkOptions &options);
+
+/// Write the results in the JSON format used by Google Benchmark, so existing tooling such as
+/// compare.py can diff two reports.
+void writeJsonReport(std::ostream &output, const std::vector<BenchmarkResult> &results);
+
+/// Print a human-readable table of the results.
+void writeConsoleReport(std::ostream &output, const std::vector<BenchmarkResult> &results);
+
+/// Prevent the compiler from optimizing away the computation of @param value.
+template <typename T>
+inline void doNotOptimize(const T &value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+}  // namespace P4::P4Tools::Flay::Benchmark
+
+/// Register @param function as a benchmark. Additional arguments are passed to the benchmark
+/// function via State::range.
+#define FLAY_BENCHMARK(function, ...)                                        \
+    [[maybe_unused]] static const int FLAY_BENCHMARK_##function =            \
+        ::P4::P4Tools::Flay::Benchmark::registerBenchmark(#function, function, \
+                                                          {__VA_ARGS__})
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_BENCHMARKS_BENCHMARK_H_ */
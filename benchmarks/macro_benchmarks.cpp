@@ -0,0 +1,308 @@
+#include "backends/p4tools/modules/flay/benchmarks/macro_benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "backends/p4tools/common/compiler/compiler_target.h"
+#include "backends/p4tools/modules/flay/benchmarks/benchmark.h"
+#include "backends/p4tools/modules/flay/core/control_plane/protobuf_utils.h"
+#include "backends/p4tools/modules/flay/core/interpreter/partial_evaluator.h"
+#include "backends/p4tools/modules/flay/core/interpreter/target.h"
+#include "backends/p4tools/modules/flay/core/lib/memory_usage.h"
+#include "backends/p4tools/modules/flay/core/specialization/flay_session.h"
+#include "backends/p4tools/modules/flay/core/specialization/service_wrapper.h"
+#include "backends/p4tools/modules/flay/options.h"
+#include "backends/p4tools/modules/flay/toolname.h"
+#include "lib/compile_context.h"
+#include "lib/error.h"
+
+#ifdef FLAY_WITH_GRPC
+#include "backends/p4tools/modules/flay/grpc_service/flay_grpc_service.h"
+#endif
+
+namespace P4::P4Tools::Flay::Benchmark {
+
+namespace {
+
+/// A compiled program and its control plane updates, shared by all benchmarks of the program.
+struct CompiledProgram {
+    /// The compile context holding the options of the program.
+    ICompileContext *compileContext = nullptr;
+
+    const FlayCompilerResult *compilerResult = nullptr;
+
+    const ProgramInfo *programInfo = nullptr;
+
+    /// The parsed write requests. The control plane updates reference these objects.
+    std::deque<p4::v1::WriteRequest> p4RuntimeRequests;
+    std::deque<bfrt_proto::WriteRequest> bfRuntimeRequests;
+
+    /// One batch of control plane updates for every update file.
+    std::vector<std::vector<const ControlPlaneUpdate *>> updates;
+};
+
+/// Parse the update files matching @param pattern and append them to @param program.
+template <typename WriteRequest, typename Update>
+int parseUpdates(std::string_view pattern, std::deque<WriteRequest> &requests,
+                 CompiledProgram &program) {
+    for (const auto &file : FlayServiceWrapper::findFiles(pattern)) {
+        auto requestOpt = Protobuf::deserializeObjectFromFile<WriteRequest>(file);
+        if (!requestOpt.has_value()) {
+            return EXIT_FAILURE;
+        }
+        const auto &request = requests.emplace_back(std::move(requestOpt.value()));
+        std::vector<const ControlPlaneUpdate *> batch;
+        for (const auto &update : request.updates()) {
+            batch.emplace_back(new Update(update));
+        }
+        program.updates.emplace_back(std::move(batch));
+    }
+    return EXIT_SUCCESS;
+}
+
+/// Compile @param program with the options given in its arguments.
+/// @returns std::nullopt and sets @param errorMessage if the program could not be compiled.
+std::optional<std::unique_ptr<CompiledProgram>> compileProgram(
+    const MacroBenchmarkProgram &program, std::string &errorMessage) {
+    std::vector<const char *> args{TOOL_NAME};
+    for (const auto &argument : program.flayArguments) {
+        args.push_back(argument.c_str());
+    }
+    auto compileContext = FlayOptions::get().process(args);
+    if (!compileContext.has_value()) {
+        errorMessage = "Invalid options.";
+        return std::nullopt;
+    }
+    AutoCompileContext autoContext(compileContext.value());
+    const auto &flayOptions = FlayOptions::get();
+
+    auto result = std::make_unique<CompiledProgram>();
+    result->compileContext = compileContext.value();
+    auto compilerResult = P4Tools::CompilerTarget::runCompiler(flayOptions, TOOL_NAME);
+    if (!compilerResult.has_value() || errorCount() > 0) {
+        errorMessage = "Failed to compile the program.";
+        return std::nullopt;
+    }
+    result->compilerResult = compilerResult.value().get().to<FlayCompilerResult>();
+    if (result->compilerResult == nullptr) {
+        errorMessage = "Expected a FlayCompilerResult.";
+        return std::nullopt;
+    }
+    result->programInfo = FlayTarget::produceProgramInfo(*result->compilerResult);
+    if (result->programInfo == nullptr || errorCount() > 0) {
+        errorMessage = "Program not supported by target device and architecture.";
+        return std::nullopt;
+    }
+
+    if (flayOptions.hasConfigurationUpdatePattern()) {
+        auto pattern = flayOptions.configurationUpdatePattern();
+        auto controlPlaneApi = flayOptions.controlPlaneApi();
+        int parseResult = EXIT_FAILURE;
+        if (controlPlaneApi == "P4RUNTIME") {
+            parseResult = parseUpdates<p4::v1::WriteRequest, P4RuntimeControlPlaneUpdate>(
+                pattern, result->p4RuntimeRequests, *result);
+        } else if (controlPlaneApi == "BFRUNTIME") {
+            parseResult = parseUpdates<bfrt_proto::WriteRequest, BfRuntimeControlPlaneUpdate>(
+                pattern, result->bfRuntimeRequests, *result);
+        }
+        if (parseResult != EXIT_SUCCESS) {
+            errorMessage = "Failed to parse the control plane updates.";
+            return std::nullopt;
+        }
+    }
+    return result;
+}
+
+/// Compiles a program on first use and caches the result.
+class ProgramFixture {
+    MacroBenchmarkProgram _program;
+
+    std::optional<std::unique_ptr<CompiledProgram>> _compiledProgram;
+
+    std::string _errorMessage;
+
+    bool _compiled = false;
+
+ public:
+    explicit ProgramFixture(MacroBenchmarkProgram program) : _program(std::move(program)) {}
+
+    /// @returns the compiled program or nullptr if the program could not be compiled. In that
+    /// case, the benchmark is aborted.
+    const CompiledProgram *get(State &state) {
+        if (!_compiled) {
+            _compiled = true;
+            _compiledProgram = compileProgram(_program, _errorMessage);
+        }
+        if (!_compiledProgram.has_value()) {
+            state.skipWithError(_errorMessage);
+            return nullptr;
+        }
+        return _compiledProgram.value().get();
+    }
+};
+
+/// Create and initialize the analysis of @param program.
+/// @returns std::nullopt if the initialization failed.
+std::optional<IncrementalAnalysisMap> initializeAnalysis(
+    const CompiledProgram &program, const PartialEvaluationOptions &partialEvaluationOptions) {
+    IncrementalAnalysisMap incrementalAnalysisMap;
+    auto [result, inserted] = incrementalAnalysisMap.emplace(
+        "partialEvaluation",
+        std::make_unique<PartialEvaluation>(FlayOptions::get(), *program.compilerResult,
+                                            *program.programInfo, partialEvaluationOptions));
+    if (result->second->initialize() != EXIT_SUCCESS) {
+        return std::nullopt;
+    }
+    return incrementalAnalysisMap;
+}
+
+/// Measures the data plane analysis, i.e., PartialEvaluation::initialize.
+void initializePartialEvaluation(ProgramFixture &fixture, State &state) {
+    const auto *program = fixture.get(state);
+    if (program == nullptr) {
+        return;
+    }
+    AutoCompileContext autoContext(program->compileContext);
+    PartialEvaluationOptions partialEvaluationOptions;
+    while (state.keepRunning()) {
+        if (!initializeAnalysis(*program, partialEvaluationOptions).has_value()) {
+            state.skipWithError("Failed to initialize the partial evaluation.");
+        }
+    }
+    auto peakMemory = MemoryUsage::peakResidentSetSize();
+    if (peakMemory.has_value()) {
+        state.setCounter("peak_rss_bytes", static_cast<double>(peakMemory.value()));
+    }
+}
+
+/// Measures the control plane updates of the program. Every iteration starts from a freshly
+/// initialized service, which is excluded from the measurement.
+void processControlPlaneUpdates(ProgramFixture &fixture, State &state) {
+    const auto *program = fixture.get(state);
+    if (program == nullptr) {
+        return;
+    }
+    if (program->updates.empty()) {
+        state.skipWithError("No control plane updates. Use --config-update-pattern.");
+        return;
+    }
+    AutoCompileContext autoContext(program->compileContext);
+    PartialEvaluationOptions partialEvaluationOptions;
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        auto incrementalAnalysisMap = initializeAnalysis(*program, partialEvaluationOptions);
+        if (!incrementalAnalysisMap.has_value()) {
+            state.skipWithError("Failed to initialize the partial evaluation.");
+            continue;
+        }
+        FlaySession session(*program->compilerResult, std::move(incrementalAnalysisMap.value()));
+        state.resumeTiming();
+        for (const auto &batch : program->updates) {
+            if (session.applyUpdates(batch) != EXIT_SUCCESS) {
+                state.skipWithError("Failed to process a control plane update.");
+                break;
+            }
+        }
+    }
+    auto updateCount = static_cast<double>(program->updates.size());
+    state.setCounter("updates", updateCount);
+    if (state.iterations() > 0) {
+        state.setCounter("ns_per_update",
+                         static_cast<double>(state.realTime().count()) /
+                             (static_cast<double>(state.iterations()) * updateCount));
+    }
+}
+
+#ifdef FLAY_WITH_GRPC
+/// Measures the control plane updates of the program end to end. Every write request is sent
+/// to a FlayService over an in-process channel, which acknowledges it once it has been applied.
+/// Every iteration starts from a freshly initialized session, which is excluded from the
+/// measurement.
+void serveWriteRequests(ProgramFixture &fixture, State &state) {
+    const auto *program = fixture.get(state);
+    if (program == nullptr) {
+        return;
+    }
+    if (program->p4RuntimeRequests.empty()) {
+        state.skipWithError("No P4Runtime write requests. Use --config-update-pattern.");
+        return;
+    }
+    AutoCompileContext autoContext(program->compileContext);
+    PartialEvaluationOptions partialEvaluationOptions;
+    std::vector<double> latencies;
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        auto incrementalAnalysisMap = initializeAnalysis(*program, partialEvaluationOptions);
+        if (!incrementalAnalysisMap.has_value()) {
+            state.skipWithError("Failed to initialize the partial evaluation.");
+            continue;
+        }
+        FlaySession session(*program->compilerResult, std::move(incrementalAnalysisMap.value()));
+        FlayService service(session);
+        if (!service.start("")) {
+            state.skipWithError("Failed to start the Flay service.");
+            continue;
+        }
+        auto stub = p4::v1::P4Runtime::NewStub(service.inProcessChannel());
+        state.resumeTiming();
+        // The session must be driven by this thread, which initialized its analyses, so the
+        // client runs on its own thread.
+        bool hasFailed = false;
+        std::thread client([&]() {
+            for (const auto &request : program->p4RuntimeRequests) {
+                grpc::ClientContext context;
+                p4::v1::WriteResponse response;
+                auto start = std::chrono::steady_clock::now();
+                auto status = stub->Write(&context, request, &response);
+                latencies.push_back(std::chrono::duration<double, std::micro>(
+                                        std::chrono::steady_clock::now() - start)
+                                        .count());
+                if (!status.ok()) {
+                    hasFailed = true;
+                    break;
+                }
+            }
+            service.requestExit();
+        });
+        service.run();
+        client.join();
+        if (hasFailed) {
+            state.skipWithError("A write request failed.");
+        }
+    }
+    auto updateCount = static_cast<double>(program->p4RuntimeRequests.size());
+    state.setCounter("updates", updateCount);
+    if (state.iterations() > 0) {
+        state.setCounter("ns_per_update",
+                         static_cast<double>(state.realTime().count()) /
+                             (static_cast<double>(state.iterations()) * updateCount));
+    }
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        state.setCounter("latency_p50_us", latencies.at(latencies.size() / 2));
+        state.setCounter("latency_p99_us", latencies.at(latencies.size() * 99 / 100));
+    }
+}
+#endif
+
+}  // namespace
+
+void registerMacroBenchmarks(const MacroBenchmarkProgram &program) {
+    auto fixture = std::make_shared<ProgramFixture>(program);
+    registerBenchmark("initializePartialEvaluation/" + program.name,
+                      [fixture](State &state) { initializePartialEvaluation(*fixture, state); });
+    registerBenchmark("processControlPlaneUpdates/" + program.name,
+                      [fixture](State &state) { processControlPlaneUpdates(*fixture, state); });
+#ifdef FLAY_WITH_GRPC
+    registerBenchmark("serveWriteRequests/" + program.name,
+                      [fixture](State &state) { serveWriteRequests(*fixture, state); });
+#endif
+}
+
+}  // namespace P4::P4Tools::Flay::Benchmark
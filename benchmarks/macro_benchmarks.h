@@ -0,0 +1,25 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_BENCHMARKS_MACRO_BENCHMARKS_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_BENCHMARKS_MACRO_BENCHMARKS_H_
+
+#include <string>
+#include <vector>
+
+namespace P4::P4Tools::Flay::Benchmark {
+
+/// A P4 program which is benchmarked end to end.
+struct MacroBenchmarkProgram {
+    /// The name under which the results of the program are reported.
+    std::string name;
+
+    /// The arguments which are passed to p4flay to analyze the program, including the program
+    /// itself. The control plane updates are taken from --config-update-pattern.
+    std::vector<std::string> flayArguments;
+};
+
+/// Register the end-to-end benchmarks for @param program. The program is compiled once, when the
+/// first of its benchmarks runs.
+void registerMacroBenchmarks(const MacroBenchmarkProgram &program);
+
+}  // namespace P4::P4Tools::Flay::Benchmark
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_BENCHMARKS_MACRO_BENCHMARKS_H_ */
@@ -0,0 +1,154 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "backends/p4tools/common/compiler/context.h"
+#include "backends/p4tools/modules/flay/benchmarks/benchmark.h"
+#include "backends/p4tools/modules/flay/benchmarks/macro_benchmarks.h"
+#include "backends/p4tools/modules/flay/options.h"
+#include "backends/p4tools/modules/flay/register.h"
+#include "lib/compile_context.h"
+#include "lib/crash.h"
+#include "lib/error.h"
+#include "lib/options.h"
+
+namespace P4::P4Tools::Flay::Benchmark {
+
+namespace {
+
+class BenchmarkRunnerOptions : protected Util::Options {
+    /// The options for running the benchmarks.
+    BenchmarkOptions _benchmarkOptions;
+
+    /// Write the results as JSON to this file.
+    std::optional<std::filesystem::path> _outputFile;
+
+ public:
+    BenchmarkRunnerOptions()
+        : Options(
+              "Benchmarks the hot paths of Flay.\n"
+              "Usage: flay-benchmarks [options] [-- NAME P4FLAY_ARGS...]...\n"
+              "Every group after -- adds the end-to-end benchmarks for one P4 program, analyzed "
+              "with the given p4flay arguments.") {
+        registerOption(
+            "--help", nullptr,
+            [this](const char *) {
+                usage();
+                exit(0);
+                return false;
+            },
+            "Shows this help message and exits");
+        registerOption(
+            "--benchmark-filter", "regex",
+            [this](const char *arg) {
+                _benchmarkOptions.filter = arg;
+                return true;
+            },
+            "Only run the benchmarks whose name matches the regular expression.");
+        registerOption(
+            "--benchmark-min-time", "seconds",
+            [this](const char *arg) {
+                try {
+                    auto seconds = std::chrono::duration<double>(std::stod(arg));
+                    _benchmarkOptions.minTime =
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(seconds);
+                } catch (const std::exception &) {
+                    error("Invalid minimum time %1%.", arg);
+                    return false;
+                }
+                return true;
+            },
+            "The minimum time in seconds each benchmark is measured for. Defaults to 0.5.");
+        registerOption(
+            "--benchmark-out", "file",
+            [this](const char *arg) {
+                _outputFile = arg;
+                return true;
+            },
+            "Write the results in JSON format to the file.");
+    }
+
+    const char *getIncludePath() const override {
+        P4C_UNIMPLEMENTED("getIncludePath not implemented for the benchmarks.");
+    }
+
+    /// Process the options up to the first "--". The remaining arguments describe the programs of
+    /// the end-to-end benchmarks.
+    /// @returns EXIT_FAILURE if an error occurred.
+    int processOptions(int argc, char *argv[], std::vector<MacroBenchmarkProgram> &programs) {
+        int optionCount = 1;
+        while (optionCount < argc && std::string(argv[optionCount]) != "--") {
+            optionCount++;
+        }
+        auto *unprocessedOptions = process(optionCount, argv);
+        if (unprocessedOptions == nullptr) {
+            return EXIT_FAILURE;
+        }
+        if (!unprocessedOptions->empty()) {
+            for (const auto &option : *unprocessedOptions) {
+                error("Unprocessed input: %s", option);
+            }
+            return EXIT_FAILURE;
+        }
+        for (int idx = optionCount; idx < argc; ++idx) {
+            if (std::string(argv[idx]) == "--") {
+                if (idx + 1 >= argc) {
+                    error("Expected a program name after --.");
+                    return EXIT_FAILURE;
+                }
+                programs.push_back({argv[++idx], {}});
+                continue;
+            }
+            programs.back().flayArguments.emplace_back(argv[idx]);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    [[nodiscard]] const BenchmarkOptions &benchmarkOptions() const { return _benchmarkOptions; }
+
+    [[nodiscard]] const std::optional<std::filesystem::path> &outputFile() const {
+        return _outputFile;
+    }
+};
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Flay::Benchmark
+
+int main(int argc, char *argv[]) {
+    P4::setup_signals();
+    P4::P4Tools::Flay::registerFlayTargets();
+    P4::AutoCompileContext autoContext(
+        new P4::P4Tools::CompileContext<P4::P4Tools::Flay::FlayOptions>());
+
+    P4::P4Tools::Flay::Benchmark::BenchmarkRunnerOptions options;
+    std::vector<P4::P4Tools::Flay::Benchmark::MacroBenchmarkProgram> programs;
+    if (options.processOptions(argc, argv, programs) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    for (const auto &program : programs) {
+        P4::P4Tools::Flay::Benchmark::registerMacroBenchmarks(program);
+    }
+
+    auto results = P4::P4Tools::Flay::Benchmark::runBenchmarks(options.benchmarkOptions());
+    P4::P4Tools::Flay::Benchmark::writeConsoleReport(std::cout, results);
+    if (options.outputFile().has_value()) {
+        std::ofstream output(options.outputFile().value());
+        if (!output.is_open()) {
+            P4::error("Could not open file %1% for writing.", options.outputFile().value().c_str());
+            return EXIT_FAILURE;
+        }
+        P4::P4Tools::Flay::Benchmark::writeJsonReport(output, results);
+    }
+    for (const auto &result : results) {
+        if (result.errorMessage.has_value()) {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+#include <z3++.h>
+
+#include <string>
+
+#include "backends/p4tools/common/control_plane/symbolic_variables.h"
+#include "backends/p4tools/common/lib/variables.h"
+#include "backends/p4tools/modules/flay/benchmarks/benchmark.h"
+#include "backends/p4tools/modules/flay/core/control_plane/control_plane_objects.h"
+#include "backends/p4tools/modules/flay/core/control_plane/z3_control_plane_assignment.h"
+#include "backends/p4tools/modules/flay/core/interpreter/execution_state.h"
+#include "backends/p4tools/modules/flay/core/lib/simplify_expression.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
+#include "ir/ir.h"
+#include "ir/irutils.h"
+
+namespace P4::P4Tools::Flay::Benchmark {
+
+namespace {
+
+using namespace P4::literals;
+
+const auto *const FIELD_TYPE = IR::Type_Bits::get(32);
+
+/// @returns a boolean data plane variable with the given index.
+const IR::SymbolicVariable *getCondition(int64_t idx) {
+    return ToolsVariables::getSymbolicVariable(IR::Type_Boolean::get(),
+                                               cstring("cond" + std::to_string(idx)));
+}
+
+/// @returns a bit<32> data plane variable with the given index.
+const IR::SymbolicVariable *getValue(int64_t idx) {
+    return ToolsVariables::getSymbolicVariable(FIELD_TYPE, cstring("val" + std::to_string(idx)));
+}
+
+/// Builds a chain of @param depth nested Mux expressions. Every second condition repeats the
+/// outermost condition, which gives the simplifier redundant branches to remove.
+const IR::Expression *buildMuxChain(int64_t depth) {
+    const IR::Expression *expression = getValue(depth);
+    for (int64_t idx = depth - 1; idx >= 0; --idx) {
+        const auto *cond = idx % 2 == 0 ? getCondition(0) : getCondition(idx);
+        expression = new IR::Mux(FIELD_TYPE, cond, getValue(idx), expression);
+    }
+    return expression;
+}
+
+/// @returns the state variable for field @param idx of a synthetic header.
+IR::StateVariable getField(int64_t idx) {
+    return IR::StateVariable(new IR::Member(FIELD_TYPE, new IR::PathExpression("hdr"),
+                                            cstring("f" + std::to_string(idx))));
+}
+
+/// Creates an execution state with @param fieldCount initialized fields.
+ExecutionState &createExecutionState(int64_t fieldCount) {
+    auto &state = ExecutionState::create(new IR::P4Program());
+    for (int64_t idx = 0; idx < fieldCount; ++idx) {
+        state.set(getField(idx), getValue(idx));
+    }
+    return state;
+}
+
+/// Creates a table "t" with an exact key and @param entryCount entries.
+const TableConfiguration &createTable(int64_t entryCount) {
+    const auto *keyExpression = ToolsVariables::getSymbolicVariable(FIELD_TYPE, "exact_key"_cs);
+    const auto *keySymbol = ControlPlaneState::getTableKey("t"_cs, "k"_cs, FIELD_TYPE);
+    const auto *actionChoice = ControlPlaneState::getTableActionChoice("t"_cs);
+    ControlPlaneAssignmentSet defaultAction;
+    defaultAction.emplace(*actionChoice, *IR::StringLiteral::get("*NONE*"_cs));
+    auto *table = new TableConfiguration("t"_cs, TableDefaultAction(defaultAction), {});
+    table->setTableKeyMatch({new ExactTableMatchKey("t"_cs, "k"_cs, keyExpression)});
+    for (int64_t idx = 0; idx < entryCount; ++idx) {
+        auto action = idx % 2 == 0 ? "a1"_cs : "a2"_cs;
+        ControlPlaneAssignmentSet actionAssignment;
+        actionAssignment.emplace(*actionChoice, *IR::StringLiteral::get(action));
+        actionAssignment.emplace(
+            *ControlPlaneState::getTableActionArgument("t"_cs, action, "p"_cs, FIELD_TYPE),
+            *IR::Constant::get(FIELD_TYPE, idx % 7));
+        ControlPlaneAssignmentSet matches;
+        matches.emplace(*keySymbol, *IR::Constant::get(FIELD_TYPE, idx));
+        table->addTableEntry(*new TableMatchEntry(actionAssignment, 0, matches), false);
+    }
+    return *table;
+}
+
+/// Creates an assignment set for @param variableCount control plane variables and an expression
+/// which references all of them.
+z3::expr createAssignments(int64_t variableCount, Z3ControlPlaneAssignmentSet &assignments) {
+    z3::expr expression = Z3Cache::context().bv_val(0, FIELD_TYPE->width_bits());
+    for (int64_t idx = 0; idx < variableCount; ++idx) {
+        const auto *variable = ToolsVariables::getSymbolicVariable(
+            FIELD_TYPE, cstring("control_plane" + std::to_string(idx)));
+        assignments.set(*variable, Z3Cache::set(IR::Constant::get(FIELD_TYPE, idx)));
+        expression = expression + Z3Cache::set(variable);
+    }
+    return expression;
+}
+
+void simplifyMuxChain(State &state) {
+    const auto *expression = buildMuxChain(state.range());
+    while (state.keepRunning()) {
+        doNotOptimize(SimplifyExpression::simplify(expression));
+    }
+}
+FLAY_BENCHMARK(simplifyMuxChain, 4, 16, 64);
+
+void produceSimplifiedMux(State &state) {
+    const auto *cond = getCondition(0);
+    const auto *trueExpression = buildMuxChain(state.range());
+    const auto *falseExpression = buildMuxChain(state.range() / 2);
+    while (state.keepRunning()) {
+        doNotOptimize(
+            SimplifyExpression::produceSimplifiedMux(cond, trueExpression, falseExpression));
+    }
+}
+FLAY_BENCHMARK(produceSimplifiedMux, 4, 16, 64);
+
+void executionStateClone(State &state) {
+    const auto &executionState = createExecutionState(state.range());
+    while (state.keepRunning()) {
+        doNotOptimize(&executionState.clone());
+    }
+}
+FLAY_BENCHMARK(executionStateClone, 16, 256, 4096);
+
+void executionStateMerge(State &state) {
+    const auto &executionState = createExecutionState(state.range());
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        // Merge a branch back into the state it was cloned from, like the interpreter does.
+        auto &mergedState = executionState.clone();
+        auto &branchState = mergedState.clone();
+        branchState.pushExecutionCondition(getCondition(1));
+        // Assign new values to a few fields so that the merge produces Mux expressions.
+        for (int64_t idx = 0; idx < state.range(); idx += 16) {
+            branchState.set(getField(idx), getValue(idx + 1));
+        }
+        state.resumeTiming();
+        mergedState.merge(branchState);
+    }
+}
+FLAY_BENCHMARK(executionStateMerge, 16, 256, 4096);
+
+void computeTableAssignments(State &state) {
+    const auto &table = createTable(state.range());
+    while (state.keepRunning()) {
+        doNotOptimize(table.computeZ3ControlPlaneAssignments());
+    }
+    state.setCounter("entries", static_cast<double>(state.range()));
+}
+FLAY_BENCHMARK(computeTableAssignments, 16, 256, 4096);
+
+void substituteAssignments(State &state) {
+    Z3ControlPlaneAssignmentSet assignments;
+    auto expression = createAssignments(state.range(), assignments);
+    while (state.keepRunning()) {
+        doNotOptimize(assignments.substitute(expression));
+    }
+}
+FLAY_BENCHMARK(substituteAssignments, 16, 256, 4096);
+
+void substituteAssignmentsAfterUpdate(State &state) {
+    Z3ControlPlaneAssignmentSet assignments;
+    auto expression = createAssignments(state.range(), assignments);
+    const auto *variable = ToolsVariables::getSymbolicVariable(FIELD_TYPE, "control_plane0"_cs);
+    int64_t value = 0;
+    while (state.keepRunning()) {
+        // Every update overwrites one assignment of the substitution vectors in place.
+        assignments.set(*variable, Z3Cache::set(IR::Constant::get(FIELD_TYPE, ++value)));
+        doNotOptimize(assignments.substitute(expression));
+    }
+}
+FLAY_BENCHMARK(substituteAssignmentsAfterUpdate, 16, 256, 4096);
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Flay::Benchmark
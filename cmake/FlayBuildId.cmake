@@ -0,0 +1,17 @@
+# Writes the header which identifies the build of P4Flay to OUTPUT. Runs at build time, so the
+# identifier follows the source tree in SOURCE_DIR without reconfiguring. The header is only
+# replaced if the identifier changed, which avoids needless recompilation.
+execute_process(
+  COMMAND git describe --always --dirty
+  WORKING_DIRECTORY ${SOURCE_DIR}
+  OUTPUT_VARIABLE FLAY_BUILD_ID
+  OUTPUT_STRIP_TRAILING_WHITESPACE
+  ERROR_QUIET
+)
+if(NOT FLAY_BUILD_ID)
+  set(FLAY_BUILD_ID "unknown")
+endif()
+
+file(WRITE ${OUTPUT}.tmp "#define FLAY_BUILD_ID \"${FLAY_BUILD_ID}\"\n")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT}.tmp ${OUTPUT})
+file(REMOVE ${OUTPUT}.tmp)
@@ -4,15 +4,17 @@
 
 #include <cerrno>
 #include <cstdio>
+#include <cstdint>
 #include <cstdlib>
+#include <map>
 #include <optional>
+#include <set>
+#include <vector>
 
 #include "backends/p4tools/common/control_plane/symbolic_variables.h"
 #include "backends/p4tools/modules/flay/core/control_plane/control_plane_item.h"
 #include "backends/p4tools/modules/flay/core/control_plane/control_plane_objects.h"
 #include "backends/p4tools/modules/flay/core/control_plane/protobuf_utils.h"
-#include "control-plane/p4RuntimeArchHandler.h"
-#include "control-plane/p4infoApi.h"
 #include "ir/irutils.h"
 
 namespace P4::P4Tools::Flay::BfRuntime {
@@ -23,11 +25,10 @@ namespace {
 /// assignments.
 /// @param symbolSet tracks the symbols used in this conversion.
 std::optional<ControlPlaneAssignmentSet> produceTableMatch(
-    const bfrt_proto::KeyField &field, cstring tableName,
-    const p4::config::v1::MatchField &matchField, SymbolSet &symbolSet) {
+    const bfrt_proto::KeyField &field, const P4InfoMatchField &matchField, SymbolSet &symbolSet) {
     ControlPlaneAssignmentSet tableKeySet;
-    const auto *keyType = IR::Type_Bits::get(matchField.bitwidth());
-    const auto *keySymbol = ControlPlaneState::getTableKey(tableName, matchField.name(), keyType);
+    const auto *keyType = matchField.type;
+    const auto *keySymbol = matchField.keySymbol;
     symbolSet.emplace(*keySymbol);
     switch (field.match_type_case()) {
         case bfrt_proto::KeyField::kExact: {
@@ -36,8 +37,7 @@ std::optional<ControlPlaneAssignmentSet> produceTableMatch(
             return tableKeySet;
         }
         case bfrt_proto::KeyField::kLpm: {
-            const auto *lpmPrefixSymbol =
-                ControlPlaneState::getTableMatchLpmPrefix(tableName, matchField.name(), keyType);
+            const auto *lpmPrefixSymbol = matchField.lpmPrefixSymbol;
             symbolSet.emplace(*lpmPrefixSymbol);
             auto value = Protobuf::stringToBigInt(field.lpm().value());
             int prefix = field.lpm().prefix_len();
@@ -46,8 +46,7 @@ std::optional<ControlPlaneAssignmentSet> produceTableMatch(
             return tableKeySet;
         }
         case bfrt_proto::KeyField::kTernary: {
-            const auto *maskSymbol =
-                ControlPlaneState::getTableTernaryMask(tableName, matchField.name(), keyType);
+            const auto *maskSymbol = matchField.maskSymbol;
             symbolSet.emplace(*maskSymbol);
             auto value = Protobuf::stringToBigInt(field.ternary().value());
             auto mask = Protobuf::stringToBigInt(field.ternary().mask());
@@ -56,8 +55,7 @@ std::optional<ControlPlaneAssignmentSet> produceTableMatch(
             return tableKeySet;
         }
         case bfrt_proto::KeyField::kRange: {
-            const auto &[rangeMinSymbol, rangeMaxSymbol] =
-                Bmv2ControlPlaneState::getTableRange(tableName, matchField.name(), keyType);
+            const auto &[rangeMinSymbol, rangeMaxSymbol] = matchField.rangeSymbols;
             symbolSet.emplace(*rangeMinSymbol);
             symbolSet.emplace(*rangeMaxSymbol);
             auto low = Protobuf::stringToBigInt(field.range().low());
@@ -81,27 +79,23 @@ std::optional<ControlPlaneAssignmentSet> produceTableMatch(
 /// message.
 /// @param symbolSet tracks the symbols used in this conversion.
 std::optional<ControlPlaneAssignmentSet> produceTableMatchForMissingField(
-    cstring tableName, const p4::config::v1::MatchField &matchField, SymbolSet &symbolSet) {
+    const P4InfoMatchField &matchField, SymbolSet &symbolSet) {
     ControlPlaneAssignmentSet tableKeySet;
-    const auto *keyType = IR::Type_Bits::get(matchField.bitwidth());
-    const auto *keySymbol = ControlPlaneState::getTableKey(tableName, matchField.name(), keyType);
+    const auto *keyType = matchField.type;
+    const auto *keySymbol = matchField.keySymbol;
     symbolSet.emplace(*keySymbol);
-    switch (matchField.match_type()) {
+    switch (matchField.matchType) {
         /// We can convert missing ternary and optional fields to 0.
         case p4::config::v1::MatchField::TERNARY:
         case p4::config::v1::MatchField::OPTIONAL: {
-            const auto *keySymbol =
-                ControlPlaneState::getTableKey(tableName, matchField.name(), keyType);
-            const auto *maskSymbol =
-                ControlPlaneState::getTableTernaryMask(tableName, matchField.name(), keyType);
-            symbolSet.emplace(*keySymbol);
+            const auto *maskSymbol = matchField.maskSymbol;
             symbolSet.emplace(*maskSymbol);
             tableKeySet.emplace(*keySymbol, *IR::Constant::get(keyType, 0));
             tableKeySet.emplace(*maskSymbol, *IR::Constant::get(keyType, 0));
             return tableKeySet;
         }
         default:
-            error("Unsupported match type %1%.", matchField.DebugString());
+            error("Unsupported match type %1%.", matchField.matchField.get().DebugString());
     }
     return std::nullopt;
 }
@@ -111,138 +105,219 @@ std::optional<ControlPlaneAssignmentSet> produceTableMatchForMissingField(
 /// specialized towards overriding a default action in a table.
 std::optional<ControlPlaneAssignmentSet> convertTableAction(const bfrt_proto::TableData &tblAction,
                                                             cstring tableName,
-                                                            const p4::config::v1::Action &p4Action,
+                                                            const P4InfoAction &p4Action,
                                                             SymbolSet &symbolSet,
                                                             bool isDefaultAction) {
     const IR::SymbolicVariable *tableActionID =
         isDefaultAction ? ControlPlaneState::getDefaultActionVariable(tableName)
                         : ControlPlaneState::getTableActionChoice(tableName);
     symbolSet.emplace(*tableActionID);
-    auto actionName = p4Action.preamble().name();
-    const auto *actionAssignment = IR::StringLiteral::get(actionName);
+    auto actionName = p4Action.name;
     ControlPlaneAssignmentSet tableActionAssignmentSet;
-    tableActionAssignmentSet.emplace(*tableActionID, *actionAssignment);
-    if (tblAction.fields().size() != p4Action.params().size()) {
+    tableActionAssignmentSet.emplace(*tableActionID, *p4Action.nameLiteral);
+    if (static_cast<size_t>(tblAction.fields().size()) != p4Action.params.size()) {
         return tableActionAssignmentSet;
     }
-    RETURN_IF_FALSE_WITH_MESSAGE(tblAction.fields().size() == p4Action.params().size(),
-                                 std::nullopt,
-                                 error("Action configuration \"%1%\" and target action \"%2%\" "
-                                       "have parameters of different number.",
-                                       p4Action.ShortDebugString(), tblAction.ShortDebugString()));
-    std::map<uint32_t, const p4::config::v1::Action_Param *> paramMap;
-    for (const auto &param : p4Action.params()) {
-        paramMap.emplace(param.id(), &param);
-    }
     for (const auto &paramConfig : tblAction.fields()) {
-        auto paramIt = paramMap.find(paramConfig.field_id());
-        RETURN_IF_FALSE_WITH_MESSAGE(
-            paramIt != paramMap.end(), std::nullopt,
+        ASSIGN_OR_RETURN_WITH_MESSAGE(
+            const auto &param, p4Action.findParam(paramConfig.field_id()), std::nullopt,
             error("Parameter %1% of action %2% not found.", paramConfig.DebugString(), actionName));
-        const auto *paramType = IR::Type_Bits::get(paramIt->second->bitwidth());
-        auto paramName = paramIt->second->name();
-        const auto *actionArg =
-            ControlPlaneState::getTableActionArgument(tableName, actionName, paramName, paramType);
+        const auto *actionArg = ControlPlaneState::getTableActionArgument(
+            tableName, actionName, param.name, param.type);
         symbolSet.emplace(*actionArg);
         RETURN_IF_FALSE_WITH_MESSAGE(paramConfig.has_stream(), std::nullopt,
                                      error("Parameter %1% of action %2% is not a stream value.",
                                            paramConfig.DebugString(), actionName));
         const auto *actionVal =
-            IR::Constant::get(paramType, Protobuf::stringToBigInt(paramConfig.stream()));
+            IR::Constant::get(param.type, Protobuf::stringToBigInt(paramConfig.stream()));
         tableActionAssignmentSet.emplace(*actionArg, *actionVal);
     }
     return tableActionAssignmentSet;
 }
 
-/// Convert a BFRuntime TableEntry into a TableMatchEntry.
-/// Returns std::nullopt if the conversion fails.
-/// @param symbolSet tracks the symbols used in this conversion.
-std::optional<TableMatchEntry *> produceTableEntry(cstring tableName,
-                                                   P4::ControlPlaneAPI::p4rt_id_t tblId,
-                                                   const p4::config::v1::P4Info &p4Info,
-                                                   const bfrt_proto::TableEntry &tableEntry,
-                                                   SymbolSet &symbolSet) {
-    RETURN_IF_FALSE_WITH_MESSAGE(tableEntry.has_data(), std::nullopt,
-                                 error("Table entry %1% has no action.", tableEntry.DebugString()));
+/// The BfRuntime field ids of the fixed fields of action profile and action selector tables.
+/// The member id is the key of action profile tables and the group id the key of action selector
+/// tables. Entries of the associated match tables refer to either of them as data field.
+constexpr uint32_t kActionMemberIdField = 65539;
+constexpr uint32_t kSelectorGroupIdField = 65540;
+constexpr uint32_t kActionMemberStatusField = 65564;
+
+/// @returns the value of the exact key field @param fieldId of @param tableEntry or std::nullopt
+/// if the entry has no such field.
+std::optional<uint32_t> findExactKeyValue(const bfrt_proto::TableEntry &tableEntry,
+                                          uint32_t fieldId) {
+    for (const auto &field : tableEntry.key().fields()) {
+        if (field.field_id() == fieldId && field.has_exact()) {
+            return static_cast<uint32_t>(Protobuf::stringToBigInt(field.exact().value()));
+        }
+    }
+    return std::nullopt;
+}
 
-    const auto &tableAction = tableEntry.data();
-    auto actionId = tableAction.action_id();
-    ASSIGN_OR_RETURN_WITH_MESSAGE(
-        auto &p4Action, P4::ControlPlaneAPI::findP4RuntimeAction(p4Info, actionId), std::nullopt,
-        error("Action ID %1% from table entry `%2%` not found in the P4Info.", actionId,
-              tableEntry.ShortDebugString()));
-    ASSIGN_OR_RETURN(const auto &tableActionAssignmentSet,
-                     convertTableAction(tableAction, tableName, p4Action, symbolSet, false),
-                     std::nullopt);
-    ASSIGN_OR_RETURN_WITH_MESSAGE(
-        auto &p4InfoTable, P4::ControlPlaneAPI::findP4RuntimeTable(p4Info, tblId), std::nullopt,
-        error("Table ID %1% not found in the P4Info.", actionId));
+/// Convert the data of a BFRuntime action profile entry into a member of the action profile.
+std::optional<ActionProfileMember> convertActionProfileMember(const P4InfoIndex &p4InfoIndex,
+                                                              const bfrt_proto::TableData &data) {
+    auto actionId = data.action_id();
+    ASSIGN_OR_RETURN_WITH_MESSAGE(auto &p4Action, p4InfoIndex.findAction(actionId), std::nullopt,
+                                  error("Action ID %1% not found in the P4Info.", actionId));
+    std::map<cstring, const IR::Literal *> arguments;
+    // Like table actions, actions with missing parameters leave the arguments unconstrained.
+    if (static_cast<size_t>(data.fields().size()) != p4Action.params.size()) {
+        return ActionProfileMember(p4Action.nameLiteral, arguments);
+    }
+    for (const auto &paramConfig : data.fields()) {
+        ASSIGN_OR_RETURN_WITH_MESSAGE(
+            const auto &param, p4Action.findParam(paramConfig.field_id()), std::nullopt,
+            error("Parameter %1% of action %2% not found.", paramConfig.DebugString(),
+                  p4Action.name));
+        RETURN_IF_FALSE_WITH_MESSAGE(paramConfig.has_stream(), std::nullopt,
+                                     error("Parameter %1% of action %2% is not a stream value.",
+                                           paramConfig.DebugString(), p4Action.name));
+        arguments.emplace(param.name, IR::Constant::get(param.type, Protobuf::stringToBigInt(
+                                                                        paramConfig.stream())));
+    }
+    return ActionProfileMember(p4Action.nameLiteral, arguments);
+}
+
+/// Convert the data of a BFRuntime entry of a table with an action profile or action selector
+/// into a reference to the member or group the entry executes.
+std::optional<ActionProfileReference> convertActionProfileReference(
+    const bfrt_proto::TableData &data) {
+    for (const auto &field : data.fields()) {
+        if (!field.has_stream()) {
+            continue;
+        }
+        auto id = static_cast<uint32_t>(Protobuf::stringToBigInt(field.stream()));
+        if (field.field_id() == kActionMemberIdField) {
+            return ActionProfileReference{ActionProfileReference::Kind::kMember, id};
+        }
+        if (field.field_id() == kSelectorGroupIdField) {
+            return ActionProfileReference{ActionProfileReference::Kind::kGroup, id};
+        }
+    }
+    return std::nullopt;
+}
 
+/// Convert the key of a BFRuntime TableEntry into the appropriate symbolic constraint
+/// assignments.
+/// @param symbolSet tracks the symbols used in this conversion.
+std::optional<ControlPlaneAssignmentSet> produceTableKeySet(
+    const P4InfoTable &p4InfoTable, const bfrt_proto::TableEntry &tableEntry,
+    SymbolSet &symbolSet) {
+    const auto &keyLayout = p4InfoTable.keyLayout;
     RETURN_IF_FALSE_WITH_MESSAGE(
-        tableEntry.key().fields_size() <= p4InfoTable.match_fields().size(), std::nullopt,
+        static_cast<size_t>(tableEntry.key().fields_size()) <= keyLayout.size(), std::nullopt,
         error("Table entry %1% has %2% matches, but P4Info has %3%.", tableEntry.DebugString(),
-              tableEntry.key().fields_size(), p4InfoTable.match_fields().size()));
-    // Use this map to look up which match fields are present in the control plane entry.
-    // TODO: Cache this somehow?
-    auto matchMap = std::map<uint32_t, bfrt_proto::KeyField>();
+              tableEntry.key().fields_size(), keyLayout.size()));
+    // Look up which match fields of the key layout are present in the control plane entry.
+    std::vector<const bfrt_proto::KeyField *> entryMatches(keyLayout.size(), nullptr);
     for (const auto &matchField : tableEntry.key().fields()) {
-        matchMap.emplace(matchField.field_id(), matchField);
+        auto position = p4InfoTable.findMatchFieldPosition(matchField.field_id());
+        if (position.has_value()) {
+            entryMatches[position.value()] = &matchField;
+        }
     }
 
     ControlPlaneAssignmentSet tableKeySet;
-    for (const auto &p4InfoMatchField : p4InfoTable.match_fields()) {
-        auto matchFieldIt = matchMap.find(p4InfoMatchField.id());
+    for (size_t position = 0; position < keyLayout.size(); ++position) {
+        const auto &p4InfoMatchField = keyLayout[position];
         std::optional<ControlPlaneAssignmentSet> matchSetOpt;
         // If we are missing a match entry, create the dummy entry for supported fields.
-        if (matchFieldIt == matchMap.end()) {
-            matchSetOpt = produceTableMatchForMissingField(tableName, p4InfoMatchField, symbolSet);
+        if (entryMatches[position] == nullptr) {
+            matchSetOpt = produceTableMatchForMissingField(p4InfoMatchField, symbolSet);
         } else {
-            matchSetOpt =
-                produceTableMatch(matchFieldIt->second, tableName, p4InfoMatchField, symbolSet);
+            matchSetOpt = produceTableMatch(*entryMatches[position], p4InfoMatchField, symbolSet);
         }
         ASSIGN_OR_RETURN(auto matchSet, matchSetOpt, std::nullopt);
         tableKeySet.insert(matchSet.begin(), matchSet.end());
     }
+    return tableKeySet;
+}
+
+/// Convert a BFRuntime TableEntry into a TableMatchEntry. If @param actionProfile is not null, the
+/// entry refers to a member or group of the action profile instead of specifying an action.
+/// Returns std::nullopt if the conversion fails.
+/// @param symbolSet tracks the symbols used in this conversion.
+std::optional<TableMatchEntry *> produceTableEntry(const P4InfoIndex &p4InfoIndex,
+                                                   const P4InfoTable &p4InfoTable,
+                                                   const bfrt_proto::TableEntry &tableEntry,
+                                                   const ActionProfile *actionProfile,
+                                                   SymbolSet &symbolSet) {
+    RETURN_IF_FALSE_WITH_MESSAGE(tableEntry.has_data(), std::nullopt,
+                                 error("Table entry %1% has no action.", tableEntry.DebugString()));
+    ASSIGN_OR_RETURN(auto tableKeySet, produceTableKeySet(p4InfoTable, tableEntry, symbolSet),
+                     std::nullopt);
+
+    const auto &tableAction = tableEntry.data();
+    if (actionProfile != nullptr) {
+        ASSIGN_OR_RETURN_WITH_MESSAGE(
+            auto reference, convertActionProfileReference(tableAction), std::nullopt,
+            error("Table entry %1% refers to neither a member nor a group.",
+                  tableEntry.ShortDebugString()));
+        ASSIGN_OR_RETURN_WITH_MESSAGE(
+            auto actionAssignment,
+            actionProfile->computeActionAssignment(p4InfoTable.name, reference), std::nullopt,
+            error("Table entry %1% refers to a member or group which does not exist.",
+                  tableEntry.ShortDebugString()));
+        for (const auto &assignment : actionAssignment) {
+            symbolSet.emplace(assignment.first);
+        }
+        return new ActionProfileTableMatchEntry(reference, actionAssignment, 0, tableKeySet);
+    }
+
+    auto actionId = tableAction.action_id();
+    ASSIGN_OR_RETURN_WITH_MESSAGE(
+        auto &p4Action, p4InfoIndex.findAction(actionId), std::nullopt,
+        error("Action ID %1% from table entry `%2%` not found in the P4Info.", actionId,
+              tableEntry.ShortDebugString()));
+    ASSIGN_OR_RETURN(
+        const auto &tableActionAssignmentSet,
+        convertTableAction(tableAction, p4InfoTable.name, p4Action, symbolSet, false),
+        std::nullopt);
     return new TableMatchEntry(tableActionAssignmentSet, 0, tableKeySet);
 }
 
 /// Convert a BFRuntime TableEntry into the appropriate symbolic constraint
 /// assignments.
 /// @param symbolSet tracks the symbols used in this conversion.
-int updateTableEntry(const p4::config::v1::P4Info &p4Info, const p4::config::v1::Table &p4Table,
+int updateTableEntry(const P4InfoIndex &p4InfoIndex, const P4InfoTable &p4InfoTable,
                      const bfrt_proto::TableEntry &tableEntry,
-                     TableConfiguration &tableConfiguration,
+                     TableConfiguration &tableConfiguration, const ActionProfile *actionProfile,
                      const ::bfrt_proto::Update_Type &updateType, SymbolSet &symbolSet) {
+    // The table configuration is only changed once the whole entry has been converted, so a
+    // rejected entry leaves the control plane constraints unchanged.
+    std::optional<TableDefaultAction> defaultTableAction;
     if (tableEntry.is_default_entry()) {
         const auto &defaultAction = tableEntry.data();
         ASSIGN_OR_RETURN_WITH_MESSAGE(
-            auto &p4Action,
-            P4::ControlPlaneAPI::findP4RuntimeAction(p4Info, defaultAction.action_id()),
-            EXIT_FAILURE,
+            auto &p4Action, p4InfoIndex.findAction(defaultAction.action_id()), EXIT_FAILURE,
             error("Action ID %1% from default table entry `%2%` not found in the P4Info.",
                   defaultAction.action_id(), tableEntry.ShortDebugString()));
         ASSIGN_OR_RETURN(
             auto defaultActionExpr,
-            convertTableAction(defaultAction, p4Table.preamble().name(), p4Action, symbolSet, true),
+            convertTableAction(defaultAction, p4InfoTable.name, p4Action, symbolSet, true),
             EXIT_FAILURE);
-        tableConfiguration.setDefaultTableAction(TableDefaultAction(defaultActionExpr));
+        defaultTableAction = TableDefaultAction(defaultActionExpr);
     }
 
     RETURN_IF_FALSE_WITH_MESSAGE(
-        !p4Table.is_const_table(), EXIT_FAILURE,
+        !p4InfoTable.table.get().is_const_table(), EXIT_FAILURE,
         error("Trying to insert an entry into table '%1%', which is a const table.",
-              p4Table.preamble().name()));
+              p4InfoTable.name));
 
     // Consider a delete message without an action a wild card delete.
     if (updateType == bfrt_proto::Update::DELETE && !tableEntry.has_data()) {
         tableConfiguration.clearTableEntries();
+        if (defaultTableAction.has_value()) {
+            tableConfiguration.setDefaultTableAction(defaultTableAction.value());
+        }
         return EXIT_SUCCESS;
     }
 
-    ASSIGN_OR_RETURN(auto *tableMatchEntry,
-                     produceTableEntry(p4Table.preamble().name(), p4Table.preamble().id(), p4Info,
-                                       tableEntry, symbolSet),
-                     EXIT_FAILURE);
+    ASSIGN_OR_RETURN(
+        auto *tableMatchEntry,
+        produceTableEntry(p4InfoIndex, p4InfoTable, tableEntry, actionProfile, symbolSet),
+        EXIT_FAILURE);
 
     if (updateType == bfrt_proto::Update::MODIFY) {
         tableConfiguration.addTableEntry(*tableMatchEntry, true);
@@ -259,14 +334,48 @@ int updateTableEntry(const p4::config::v1::P4Info &p4Info, const p4::config::v1:
         error("Unsupported update type %1%.", updateType);
         return EXIT_FAILURE;
     }
+    if (defaultTableAction.has_value()) {
+        tableConfiguration.setDefaultTableAction(defaultTableAction.value());
+    }
     return EXIT_SUCCESS;
 }
 
-int updateTableEntry(const p4::config::v1::P4Info &p4Info, const p4::config::v1::Table &p4Table,
+/// @returns the action profile which implements the table @param p4InfoTable. The action profile
+/// of an action selector is kept by the selector.
+std::optional<ActionProfile *> findTableImplementation(
+    const P4InfoIndex &p4InfoIndex, const P4InfoTable &p4InfoTable,
+    ControlPlaneConstraints &controlPlaneConstraints) {
+    auto implementationId = p4InfoTable.table.get().implementation_id();
+    auto implementationNameOpt = p4InfoIndex.findActionProfileName(implementationId);
+    if (!implementationNameOpt.has_value()) {
+        implementationNameOpt = p4InfoIndex.findActionSelectorName(implementationId);
+    }
+    ASSIGN_OR_RETURN_WITH_MESSAGE(
+        auto implementationName, implementationNameOpt, std::nullopt,
+        error("Implementation ID %1% of table %2% not found in the P4Info.", implementationId,
+              p4InfoTable.name));
+    auto it = controlPlaneConstraints.find(implementationName);
+    RETURN_IF_FALSE_WITH_MESSAGE(
+        it != controlPlaneConstraints.end(), std::nullopt,
+        error("Implementation %1% not found in the control plane constraints. It should have "
+              "already been initialized at this point.",
+              implementationName));
+    if (auto *actionProfile = it->second.get().to<ActionProfile>()) {
+        return actionProfile;
+    }
+    if (auto *actionSelector = it->second.get().to<ActionSelector>()) {
+        return &actionSelector->actionProfile();
+    }
+    error("Configuration result %1% is not an action profile or action selector.",
+          implementationName);
+    return std::nullopt;
+}
+
+int updateTableEntry(const P4InfoIndex &p4InfoIndex, const P4InfoTable &p4InfoTable,
                      const bfrt_proto::TableEntry &tableEntry,
                      ControlPlaneConstraints &controlPlaneConstraints,
                      const ::bfrt_proto::Update_Type &updateType, SymbolSet &symbolSet) {
-    cstring tableName = p4Table.preamble().name();
+    cstring tableName = p4InfoTable.name;
 
     auto it = controlPlaneConstraints.find(tableName);
     RETURN_IF_FALSE_WITH_MESSAGE(
@@ -279,113 +388,287 @@ int updateTableEntry(const p4::config::v1::P4Info &p4Info, const p4::config::v1:
         auto &tableResult, it->second.get().to<TableConfiguration>(), EXIT_FAILURE,
         error("Configuration result is not a TableConfiguration.", tableName));
 
-    if (p4Table.implementation_id() != 0) {
-        warning(
-            "Insertions of entries into tables with custom implementation is not supported yet "
-            "(Table '%1%') is not implemented.",
-            p4Table.preamble().name());
-        return EXIT_SUCCESS;
+    const ActionProfile *actionProfile = nullptr;
+    if (p4InfoTable.table.get().implementation_id() != 0) {
+        ASSIGN_OR_RETURN(actionProfile,
+                         findTableImplementation(p4InfoIndex, p4InfoTable, controlPlaneConstraints),
+                         EXIT_FAILURE);
     }
 
-    return updateTableEntry(p4Info, p4Table, tableEntry, tableResult, updateType, symbolSet);
+    return updateTableEntry(p4InfoIndex, p4InfoTable, tableEntry, tableResult, actionProfile,
+                            updateType, symbolSet);
 }
 
-std::optional<cstring> getActionProfileName(const p4::config::v1::P4Info &p4Info,
-                                            const bfrt_proto::TableEntry &tableEntry) {
-    const auto *actionProfile =
-        P4::ControlPlaneAPI::findP4RuntimeActionProfile(p4Info, tableEntry.table_id());
-    if (actionProfile != nullptr) {
-        return actionProfile->preamble().name();
+/// Entries of action profile tables configure the members of the action profile. All entries of
+/// the associated tables which refer to a changed member are updated.
+int configureActionProfile(const bfrt_proto::TableEntry &tableEntry, ActionProfile &actionProfile,
+                           const P4InfoIndex &p4InfoIndex,
+                           ControlPlaneConstraints &controlPlaneConstraints,
+                           const ::bfrt_proto::Update_Type &updateType, SymbolSet &symbolSet) {
+    // Consider a delete message without a key a wild card delete.
+    if (updateType == bfrt_proto::Update::DELETE && tableEntry.key().fields().empty()) {
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            !actionProfile.isReferenced(controlPlaneConstraints, actionProfile.references()),
+            EXIT_FAILURE,
+            error("Action profile %1% is still in use and can not be cleared.",
+                  actionProfile.name()));
+        actionProfile.clear();
+        return EXIT_SUCCESS;
+    }
+
+    ASSIGN_OR_RETURN_WITH_MESSAGE(auto memberId,
+                                  findExactKeyValue(tableEntry, kActionMemberIdField), EXIT_FAILURE,
+                                  error("Action profile entry %1% has no member id.",
+                                        tableEntry.ShortDebugString()));
+    auto references = actionProfile.referencesToMember(memberId);
+
+    if (updateType == bfrt_proto::Update::DELETE) {
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            !actionProfile.isReferenced(controlPlaneConstraints, references) &&
+                references.size() == 1,
+            EXIT_FAILURE,
+            error("Member %1% of action profile %2% is still in use and can not be deleted.",
+                  memberId, actionProfile.name()));
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            actionProfile.deleteMember(memberId) != 0, EXIT_FAILURE,
+            error("Member %1% of action profile %2% not found and can not be deleted.", memberId,
+                  actionProfile.name()));
+        return EXIT_SUCCESS;
+    }
+
+    ASSIGN_OR_RETURN(auto member, convertActionProfileMember(p4InfoIndex, tableEntry.data()),
+                     EXIT_FAILURE);
+    std::optional<ActionProfileMember> previousMember;
+    if (const auto *currentMember = actionProfile.findMember(memberId)) {
+        previousMember = *currentMember;
+    }
+    if (updateType == bfrt_proto::Update::MODIFY) {
+        actionProfile.addMember(memberId, member, true);
+    } else if (updateType == bfrt_proto::Update::INSERT) {
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            actionProfile.addMember(memberId, member, false) == EXIT_SUCCESS, EXIT_FAILURE,
+            error("Member %1% of action profile %2% already exists.", memberId,
+                  actionProfile.name()));
+    } else {
+        error("Unsupported update type %1%.", updateType);
+        return EXIT_FAILURE;
     }
-    const auto *actionProfileExtern =
-        P4::ControlPlaneAPI::findP4RuntimeExtern(p4Info, cstring("ActionProfile"));
-    if (actionProfileExtern == nullptr) {
-        return std::nullopt;
+    if (actionProfile.updateAssociatedTables(controlPlaneConstraints, references, symbolSet) !=
+        EXIT_SUCCESS) {
+        actionProfile.restoreMember(controlPlaneConstraints, memberId, previousMember);
+        return EXIT_FAILURE;
     }
-    std::optional<cstring> actionProfileNameOpt;
-    for (const auto &actionProfileInstance : actionProfileExtern->instances()) {
-        if (actionProfileInstance.preamble().id() == tableEntry.table_id()) {
-            actionProfileNameOpt = actionProfileInstance.preamble().name();
+    return EXIT_SUCCESS;
+}
+
+/// Entries of action selector tables configure the groups of the action profile of the selector.
+/// All entries of the associated tables which refer to a changed group are updated.
+int configureActionSelector(const bfrt_proto::TableEntry &tableEntry, ActionSelector &selector,
+                            const P4InfoIndex & /*p4InfoIndex*/,
+                            ControlPlaneConstraints &controlPlaneConstraints,
+                            const ::bfrt_proto::Update_Type &updateType, SymbolSet &symbolSet) {
+    auto &actionProfile = selector.actionProfile();
+    // Consider a delete message without a key a wild card delete.
+    if (updateType == bfrt_proto::Update::DELETE && tableEntry.key().fields().empty()) {
+        // Check every group before deleting any, so a rejected delete removes nothing.
+        std::vector<uint32_t> groupIds;
+        for (const auto &reference : actionProfile.references()) {
+            if (reference.kind != ActionProfileReference::Kind::kGroup) {
+                continue;
+            }
+            RETURN_IF_FALSE_WITH_MESSAGE(
+                !actionProfile.isReferenced(controlPlaneConstraints, {reference}), EXIT_FAILURE,
+                error("Group %1% of action selector %2% is still in use and can not be deleted.",
+                      reference.id, actionProfile.name()));
+            groupIds.push_back(reference.id);
         }
+        for (auto groupId : groupIds) {
+            actionProfile.deleteGroup(groupId);
+        }
+        return EXIT_SUCCESS;
     }
 
-    return actionProfileNameOpt;
-}
+    ASSIGN_OR_RETURN_WITH_MESSAGE(auto groupId,
+                                  findExactKeyValue(tableEntry, kSelectorGroupIdField),
+                                  EXIT_FAILURE,
+                                  error("Action selector entry %1% has no group id.",
+                                        tableEntry.ShortDebugString()));
+    std::set<ActionProfileReference> references{{ActionProfileReference::Kind::kGroup, groupId}};
 
-std::optional<cstring> getActionSelectorName(const p4::config::v1::P4Info &p4Info,
-                                             const bfrt_proto::TableEntry &tableEntry) {
-    const auto *actionSelectorExtern =
-        P4::ControlPlaneAPI::findP4RuntimeExtern(p4Info, cstring("ActionSelector"));
-    if (actionSelectorExtern == nullptr) {
-        return std::nullopt;
+    if (updateType == bfrt_proto::Update::DELETE) {
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            !actionProfile.isReferenced(controlPlaneConstraints, references), EXIT_FAILURE,
+            error("Group %1% of action selector %2% is still in use and can not be deleted.",
+                  groupId, actionProfile.name()));
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            actionProfile.deleteGroup(groupId) != 0, EXIT_FAILURE,
+            error("Group %1% of action selector %2% not found and can not be deleted.", groupId,
+                  actionProfile.name()));
+        return EXIT_SUCCESS;
     }
 
-    std::optional<cstring> actionSelectorNameOpt;
-    for (const auto &actionSelectorInstance : actionSelectorExtern->instances()) {
-        if (actionSelectorInstance.preamble().id() == tableEntry.table_id()) {
-            actionSelectorNameOpt = actionSelectorInstance.preamble().name();
+    // Members which are marked as inactive are not part of the group.
+    const bfrt_proto::DataField *memberIdField = nullptr;
+    const bfrt_proto::DataField *memberStatusField = nullptr;
+    for (const auto &field : tableEntry.data().fields()) {
+        if (field.field_id() == kActionMemberIdField && field.has_int_arr_val()) {
+            memberIdField = &field;
+        } else if (field.field_id() == kActionMemberStatusField && field.has_bool_arr_val()) {
+            memberStatusField = &field;
+        }
+    }
+    std::set<uint32_t> memberIds;
+    if (memberIdField != nullptr) {
+        const auto &ids = memberIdField->int_arr_val().val();
+        for (int idx = 0; idx < ids.size(); ++idx) {
+            bool isActive = memberStatusField == nullptr ||
+                            idx >= memberStatusField->bool_arr_val().val_size() ||
+                            memberStatusField->bool_arr_val().val(idx);
+            if (isActive) {
+                memberIds.insert(ids.Get(idx));
+            }
         }
     }
-    return actionSelectorNameOpt;
-}
 
-int configureActionProfile(const bfrt_proto::TableEntry &tableEntry,
-                           const ActionProfile &actionProfile, const p4::config::v1::P4Info &p4Info,
-                           ControlPlaneConstraints &controlPlaneConstraints,
-                           const ::bfrt_proto::Update_Type &updateType, SymbolSet &symbolSet) {
-    // Iterate over each associated table and insert the respective action into the table.
-    for (auto associatedTableReference : actionProfile.associatedTables()) {
-        auto it = controlPlaneConstraints.find(associatedTableReference);
-        RETURN_IF_FALSE_WITH_MESSAGE(it != controlPlaneConstraints.end(), EXIT_FAILURE,
-                                     error("Configuration for table %1% not found in the "
-                                           "control plane constraints. It should "
-                                           "have already been initialized at this point.",
-                                           associatedTableReference));
-
-        ASSIGN_OR_RETURN_WITH_MESSAGE(auto &tableResult, it->second.get().to<TableConfiguration>(),
-                                      EXIT_FAILURE,
-                                      error("Configuration result %1% is not a TableConfiguration.",
-                                            associatedTableReference));
-        ASSIGN_OR_RETURN_WITH_MESSAGE(
-            auto &p4InfoTable,
-            P4::ControlPlaneAPI::findP4RuntimeTable(p4Info, associatedTableReference), EXIT_FAILURE,
-            error("Table name %1% not found in the P4Info.", associatedTableReference));
-        RETURN_IF_FALSE(updateTableEntry(p4Info, p4InfoTable, tableEntry, tableResult, updateType,
-                                         symbolSet) == EXIT_SUCCESS,
-                        EXIT_FAILURE);
+    RETURN_IF_FALSE_WITH_MESSAGE(
+        updateType == bfrt_proto::Update::MODIFY || updateType == bfrt_proto::Update::INSERT,
+        EXIT_FAILURE, error("Unsupported update type %1%.", updateType));
+    std::optional<std::set<uint32_t>> previousGroup;
+    if (const auto *currentGroup = actionProfile.findGroup(groupId)) {
+        previousGroup = *currentGroup;
+    }
+    RETURN_IF_FALSE_WITH_MESSAGE(
+        actionProfile.addGroup(groupId, memberIds, updateType == bfrt_proto::Update::MODIFY) ==
+            EXIT_SUCCESS,
+        EXIT_FAILURE,
+        error("Group %1% of action selector %2% already exists or refers to an unknown member.",
+              groupId, actionProfile.name()));
+    if (actionProfile.updateAssociatedTables(controlPlaneConstraints, references, symbolSet) !=
+        EXIT_SUCCESS) {
+        actionProfile.restoreGroup(controlPlaneConstraints, groupId, previousGroup);
+        return EXIT_FAILURE;
     }
     return EXIT_SUCCESS;
 }
 
-int configureActionSelector(const bfrt_proto::TableEntry & /*tableEntry*/,
-                            ActionSelector & /*selector*/,
-                            const p4::config::v1::P4Info & /*p4Info*/,
-                            ControlPlaneConstraints & /*controlPlaneConstraints*/,
-                            const ::bfrt_proto::Update_Type & /*updateType*/,
-                            SymbolSet & /*symbolSet*/) {
-    // Currently a no-op.
+/// Convert a BFRuntime KeyField of a parser value set entry into ternary matches of the field.
+std::optional<std::vector<ParserValueSetMember>> convertValueSetFieldMatch(
+    const bfrt_proto::KeyField &field, const IR::Type_Bits *fieldType) {
+    auto width = fieldType->width_bits();
+    auto maxValue = IR::getMaxBvVal(width);
+    switch (field.match_type_case()) {
+        case bfrt_proto::KeyField::kExact: {
+            auto value = Protobuf::stringToBigInt(field.exact().value());
+            return std::vector<ParserValueSetMember>{{value & maxValue, maxValue}};
+        }
+        case bfrt_proto::KeyField::kTernary: {
+            auto value = Protobuf::stringToBigInt(field.ternary().value());
+            auto mask = Protobuf::stringToBigInt(field.ternary().mask()) & maxValue;
+            return std::vector<ParserValueSetMember>{{value & mask, mask}};
+        }
+        case bfrt_proto::KeyField::kLpm: {
+            auto value = Protobuf::stringToBigInt(field.lpm().value());
+            auto mask = maxValue ^ IR::getMaxBvVal(width - field.lpm().prefix_len());
+            return std::vector<ParserValueSetMember>{{value & mask, mask}};
+        }
+        case bfrt_proto::KeyField::kRange: {
+            auto low = Protobuf::stringToBigInt(field.range().low());
+            auto high = Protobuf::stringToBigInt(field.range().high());
+            return ParserValueSet::convertRange(low, high, width);
+        }
+        case bfrt_proto::KeyField::kOptional: {
+            auto value = Protobuf::stringToBigInt(field.optional().value());
+            return std::vector<ParserValueSetMember>{{value & maxValue, maxValue}};
+        }
+        default:
+            error("Unsupported parser value set match %1%.", field.DebugString().c_str());
+    }
+    return std::nullopt;
+}
+
+/// In BFRuntime, parser value sets are programmed like a table whose keys are the members.
+/// @param symbolSet tracks the symbols used in this conversion.
+int configureParserValueSet(const bfrt_proto::TableEntry &tableEntry,
+                            const P4InfoValueSet &p4InfoValueSet,
+                            ControlPlaneConstraints &controlPlaneConstraints,
+                            const ::bfrt_proto::Update_Type &updateType, SymbolSet &symbolSet) {
+    auto it = controlPlaneConstraints.find(p4InfoValueSet.name);
+    RETURN_IF_FALSE_WITH_MESSAGE(
+        it != controlPlaneConstraints.end(), EXIT_FAILURE,
+        error("Parser value set %1% not found in the control plane constraints. It should "
+              "have already been initialized at this point.",
+              p4InfoValueSet.name));
+    ASSIGN_OR_RETURN_WITH_MESSAGE(
+        auto &parserValueSet, it->second.get().to<ParserValueSet>(), EXIT_FAILURE,
+        error("Configuration result %1% is not a parser value set.", p4InfoValueSet.name));
+    parserValueSet.collectSymbols(symbolSet);
+
+    // Consider a delete message without a key a wild card delete.
+    if (updateType == bfrt_proto::Update::DELETE && tableEntry.key().fields().empty()) {
+        parserValueSet.clear();
+        return EXIT_SUCCESS;
+    }
+
+    const auto &fieldTypes = p4InfoValueSet.fieldTypes;
+    std::vector<int> widths;
+    for (const auto *fieldType : fieldTypes) {
+        widths.push_back(fieldType->width_bits());
+    }
+    // Fields which are not set match any value.
+    std::vector<std::vector<ParserValueSetMember>> fields(fieldTypes.size(), {{0, 0}});
+    for (const auto &field : tableEntry.key().fields()) {
+        ASSIGN_OR_RETURN_WITH_MESSAGE(
+            auto position, p4InfoValueSet.findFieldPosition(field.field_id()), EXIT_FAILURE,
+            error("Field %1% of parser value set %2% not found in the P4Info.", field.field_id(),
+                  p4InfoValueSet.name));
+        ASSIGN_OR_RETURN(fields[position], convertValueSetFieldMatch(field, fieldTypes[position]),
+                         EXIT_FAILURE);
+    }
+    auto members = ParserValueSet::concatenate(fields, widths);
+
+    if (updateType == bfrt_proto::Update::MODIFY) {
+        // The key is the member, so a modification re-inserts the same member.
+        parserValueSet.deleteMembers(members);
+        parserValueSet.addMembers(members);
+    } else if (updateType == bfrt_proto::Update::INSERT) {
+        parserValueSet.addMembers(members);
+    } else if (updateType == bfrt_proto::Update::DELETE) {
+        RETURN_IF_FALSE_WITH_MESSAGE(parserValueSet.deleteMembers(members) == EXIT_SUCCESS,
+                                     EXIT_FAILURE,
+                                     error("Parser value set entry %1% not found and can not be "
+                                           "deleted.",
+                                           tableEntry.ShortDebugString()));
+    } else {
+        error("Unsupported update type %1%.", updateType);
+        return EXIT_FAILURE;
+    }
     return EXIT_SUCCESS;
 }
 
 }  // namespace
 
 int updateControlPlaneConstraintsWithEntityMessage(const bfrt_proto::Entity &entity,
-                                                   const p4::config::v1::P4Info &p4Info,
+                                                   const P4InfoIndex &p4InfoIndex,
                                                    ControlPlaneConstraints &controlPlaneConstraints,
                                                    const ::bfrt_proto::Update_Type &updateType,
                                                    SymbolSet &symbolSet) {
     if (entity.has_table_entry()) {
         auto tableId = entity.table_entry().table_id();
-        const auto *p4Table = P4::ControlPlaneAPI::findP4RuntimeTable(p4Info, tableId);
-        if (p4Table != nullptr) {
-            RETURN_IF_FALSE(
-                updateTableEntry(p4Info, *p4Table, entity.table_entry(), controlPlaneConstraints,
-                                 updateType, symbolSet) == EXIT_SUCCESS,
-                EXIT_FAILURE)
+        const auto *p4InfoTable = p4InfoIndex.findTable(tableId);
+        if (p4InfoTable != nullptr) {
+            RETURN_IF_FALSE(updateTableEntry(p4InfoIndex, *p4InfoTable, entity.table_entry(),
+                                             controlPlaneConstraints, updateType,
+                                             symbolSet) == EXIT_SUCCESS,
+                            EXIT_FAILURE)
             return EXIT_SUCCESS;
         }
+        const auto *p4InfoValueSet = p4InfoIndex.findValueSet(tableId);
+        if (p4InfoValueSet != nullptr) {
+            return configureParserValueSet(entity.table_entry(), *p4InfoValueSet,
+                                           controlPlaneConstraints, updateType, symbolSet);
+        }
         // In BFRuntime, table entries could also configure an action profile or selector.
-        auto actionProfileNameOpt = getActionProfileName(p4Info, entity.table_entry());
+        auto actionProfileNameOpt = p4InfoIndex.findActionProfileName(tableId);
         if (actionProfileNameOpt.has_value()) {
             auto it = controlPlaneConstraints.find(actionProfileNameOpt.value());
             RETURN_IF_FALSE_WITH_MESSAGE(
@@ -399,10 +682,10 @@ int updateControlPlaneConstraintsWithEntityMessage(const bfrt_proto::Entity &ent
                 error("Configuration result %1% is not an action profile.",
                       actionProfileNameOpt.value()));
 
-            return configureActionProfile(entity.table_entry(), actionProfile, p4Info,
+            return configureActionProfile(entity.table_entry(), actionProfile, p4InfoIndex,
                                           controlPlaneConstraints, updateType, symbolSet);
         }
-        auto actionSelectorNameOpt = getActionSelectorName(p4Info, entity.table_entry());
+        auto actionSelectorNameOpt = p4InfoIndex.findActionSelectorName(tableId);
         if (actionSelectorNameOpt.has_value()) {
             auto it = controlPlaneConstraints.find(actionSelectorNameOpt.value());
             RETURN_IF_FALSE_WITH_MESSAGE(
@@ -416,7 +699,7 @@ int updateControlPlaneConstraintsWithEntityMessage(const bfrt_proto::Entity &ent
                 error("Configuration result %1% is not an action selector.",
                       actionSelectorNameOpt.value()));
 
-            return configureActionSelector(entity.table_entry(), actionSelector, p4Info,
+            return configureActionSelector(entity.table_entry(), actionSelector, p4InfoIndex,
                                            controlPlaneConstraints, updateType, symbolSet);
         }
     }
@@ -425,11 +708,12 @@ int updateControlPlaneConstraintsWithEntityMessage(const bfrt_proto::Entity &ent
 }
 
 int updateControlPlaneConstraints(const bfruntime::flaytests::Config &protoControlPlaneConfig,
-                                  const p4::config::v1::P4Info &p4Info,
+                                  const P4InfoIndex &p4InfoIndex,
                                   ControlPlaneConstraints &controlPlaneConstraints,
                                   SymbolSet &symbolSet) {
     for (const auto &entity : protoControlPlaneConfig.entities()) {
-        if (updateControlPlaneConstraintsWithEntityMessage(entity, p4Info, controlPlaneConstraints,
+        if (updateControlPlaneConstraintsWithEntityMessage(entity, p4InfoIndex,
+                                                           controlPlaneConstraints,
                                                            bfrt_proto::Update::MODIFY,
                                                            symbolSet) != EXIT_SUCCESS) {
             return EXIT_FAILURE;
@@ -18,6 +18,7 @@
 #pragma GCC diagnostic pop
 
 #include "backends/p4tools/modules/flay/core/control_plane/control_plane_item.h"
+#include "backends/p4tools/modules/flay/core/control_plane/p4info_index.h"
 #include "backends/p4tools/modules/flay/core/control_plane/symbols.h"
 
 /// Converts a Protobuf object and the instructions contained
@@ -31,7 +32,7 @@ namespace P4::P4Tools::Flay::BfRuntime {
 /// @param irToIdMap to lookup the nodes associated with BFRuntime Ids.
 /// @param symbolSet tracks the symbols used in this conversion.
 [[nodiscard]] int updateControlPlaneConstraintsWithEntityMessage(
-    const bfrt_proto::Entity &entity, const p4::config::v1::P4Info &p4Info,
+    const bfrt_proto::Entity &entity, const P4InfoIndex &p4InfoIndex,
     ControlPlaneConstraints &controlPlaneConstraints, const ::bfrt_proto::Update_Type &updateType,
     SymbolSet &symbolSet);
 
@@ -40,9 +41,8 @@ namespace P4::P4Tools::Flay::BfRuntime {
 /// @param irToIdMap to lookup the nodes associated with BFRuntime Ids.
 /// @param symbolSet tracks the symbols used in this conversion.
 [[nodiscard]] int updateControlPlaneConstraints(
-    const bfruntime::flaytests::Config &protoControlPlaneConfig,
-    const p4::config::v1::P4Info &p4Info, ControlPlaneConstraints &controlPlaneConstraints,
-    SymbolSet &symbolSet);
+    const bfruntime::flaytests::Config &protoControlPlaneConfig, const P4InfoIndex &p4InfoIndex,
+    ControlPlaneConstraints &controlPlaneConstraints, SymbolSet &symbolSet);
 
 }  // namespace P4::P4Tools::Flay::BfRuntime
 
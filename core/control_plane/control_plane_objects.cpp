@@ -1,14 +1,24 @@
 #include "backends/p4tools/modules/flay/core/control_plane/control_plane_objects.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <map>
+#include <set>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "backends/p4tools/common/control_plane/symbolic_variables.h"
 #include "backends/p4tools/common/lib/variables.h"
 #include "backends/p4tools/modules/flay/core/control_plane/substitute_variable.h"
+#include "backends/p4tools/modules/flay/core/control_plane/table_encoding.h"
 #include "backends/p4tools/modules/flay/core/lib/simplify_expression.h"
 #include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
 #include "ir/irutils.h"
+#include "lib/error.h"
+#include "lib/exceptions.h"
 #include "lib/timer.h"
 
 namespace P4::P4Tools::ControlPlaneState {
@@ -18,10 +28,20 @@ const IR::SymbolicVariable *getParserValueSetConfigured(cstring parserValueSetNa
                                                "pvs_configured_" + parserValueSetName);
 }
 
+const IR::SymbolicVariable *getParserValueSetMatch(cstring parserValueSetName, size_t keyIndex) {
+    auto label = "pvs_match_" + parserValueSetName + "_" + std::to_string(keyIndex);
+    return ToolsVariables::getSymbolicVariable(IR::Type_Boolean::get(), label);
+}
+
 const IR::SymbolicVariable *getDefaultActionVariable(cstring tableName) {
     return new IR::SymbolicVariable(IR::Type_String::get(), tableName + "_default_action");
 }
 
+const IR::SymbolicVariable *getActionSelectorChoice(cstring tableName) {
+    return ToolsVariables::getSymbolicVariable(IR::Type_Bits::get(32),
+                                               tableName + "_action_selector_choice");
+}
+
 }  // namespace P4::P4Tools::ControlPlaneState
 
 namespace P4::P4Tools::Flay {
@@ -66,7 +86,7 @@ const IR::Expression *ExactTableMatchKey::computeControlPlaneConstraint() const
 }
 
 std::optional<z3::expr> ExactTableMatchKey::computeZ3ControlPlaneConstraint() const {
-    return Z3Cache::get(computedKey());
+    return Z3Cache::set(computedKey());
 }
 
 namespace {
@@ -99,7 +119,7 @@ const IR::Expression *TernaryTableMatchKey::computeControlPlaneConstraint() cons
 }
 
 std::optional<z3::expr> TernaryTableMatchKey::computeZ3ControlPlaneConstraint() const {
-    return Z3Cache::get(computedKey());
+    return Z3Cache::set(computedKey());
 }
 
 namespace {
@@ -138,7 +158,7 @@ const IR::Expression *LpmTableMatchKey::computeControlPlaneConstraint() const {
 }
 
 std::optional<z3::expr> LpmTableMatchKey::computeZ3ControlPlaneConstraint() const {
-    return Z3Cache::get(computedKey());
+    return Z3Cache::set(computedKey());
 }
 
 OptionalMatchKey::OptionalMatchKey(cstring tableName, cstring name, const IR::Expression *value)
@@ -157,7 +177,7 @@ const IR::Expression *OptionalMatchKey::computeControlPlaneConstraint() const {
 }
 
 std::optional<z3::expr> OptionalMatchKey::computeZ3ControlPlaneConstraint() const {
-    return Z3Cache::get(computedKey());
+    return Z3Cache::set(computedKey());
 }
 
 SelectorMatchKey::SelectorMatchKey(cstring tableName, cstring name,
@@ -177,7 +197,7 @@ const IR::Expression *SelectorMatchKey::computeControlPlaneConstraint() const {
 }
 
 std::optional<z3::expr> SelectorMatchKey::computeZ3ControlPlaneConstraint() const {
-    return Z3Cache::get(computedKey());
+    return Z3Cache::set(computedKey());
 }
 
 namespace {
@@ -212,7 +232,7 @@ const IR::Expression *RangeTableMatchKey::computeControlPlaneConstraint() const
 }
 
 std::optional<z3::expr> RangeTableMatchKey::computeZ3ControlPlaneConstraint() const {
-    return Z3Cache::get(computedKey());
+    return Z3Cache::set(computedKey());
 }
 
 /**************************************************************************************************
@@ -236,16 +256,26 @@ int32_t TableMatchEntry::priority() const { return _priority; }
 
 ControlPlaneAssignmentSet TableMatchEntry::actionAssignment() const { return _actionAssignment; }
 
-Z3ControlPlaneAssignmentSet TableMatchEntry::z3ActionAssignment() const {
+const Z3ControlPlaneAssignmentSet &TableMatchEntry::z3ActionAssignment() const {
     return _z3ActionAssignment;
 }
 
+const ControlPlaneAssignmentSet &TableMatchEntry::matches() const { return _matches; }
+
 bool TableMatchEntry::operator<(const ControlPlaneItem &other) const {
     // Table match entries are only compared based on the match expression.
     return typeid(*this) == typeid(other) ? compare(_matches, other.as<TableMatchEntry>()._matches)
                                           : typeid(*this).hash_code() < typeid(other).hash_code();
 }
 
+void TableMatchEntry::setActionAssignment(ControlPlaneAssignmentSet actionAssignment) {
+    _actionAssignment = std::move(actionAssignment);
+    _z3ActionAssignment.clear();
+    for (const auto &assignment : _actionAssignment) {
+        _z3ActionAssignment.add(assignment.first, Z3Cache::set(&assignment.second.get()));
+    }
+}
+
 ControlPlaneAssignmentSet TableMatchEntry::computeControlPlaneAssignments() const {
     return _matches;
 }
@@ -293,6 +323,20 @@ Z3ControlPlaneAssignmentSet WildCardMatchEntry::computeZ3ControlPlaneAssignments
     return {};
 }
 
+/**************************************************************************************************
+ActionProfileTableMatchEntry
+**************************************************************************************************/
+
+ActionProfileTableMatchEntry::ActionProfileTableMatchEntry(
+    ActionProfileReference reference, ControlPlaneAssignmentSet actionAssignment,
+    int32_t priority, ControlPlaneAssignmentSet matches)
+    : TableMatchEntry(std::move(actionAssignment), priority, std::move(matches)),
+      _reference(reference) {}
+
+const ActionProfileReference &ActionProfileTableMatchEntry::reference() const {
+    return _reference;
+}
+
 /**************************************************************************************************
 TableConfiguration
 **************************************************************************************************/
@@ -333,32 +377,97 @@ bool TableConfiguration::operator<(const ControlPlaneItem &other) const {
 }
 
 void TableConfiguration::setTableKeyMatch(const KeyMap &tableKeyMap) {
+    _tableKeyMap = tableKeyMap;
     _tableKeyMatch = SimplifyExpression::simplify(buildKeyMatches(tableKeyMap));
     // When we set the table key match, we also need to recompute the match of all table entries.
     auto z3TableKeyMatch = Z3Cache::set(_tableKeyMatch);
     for (const auto &tableMatchEntry : _tableEntries) {
         tableMatchEntry.get().setZ3Condition(z3TableKeyMatch);
     }
+    _lpmTrie = std::nullopt;
+    if (tableKeyMap.size() == 1) {
+        if (const auto *lpmKey = tableKeyMap.front()->to<LpmTableMatchKey>()) {
+            _lpmTrie.emplace(lpmKey->variable(), lpmKey->prefix());
+            for (const auto &tableMatchEntry : _tableEntries) {
+                _lpmTrie->insert(tableMatchEntry.get());
+            }
+        }
+    }
 }
 
+const KeyMap &TableConfiguration::tableKeyMap() const { return _tableKeyMap; }
+
 int TableConfiguration::addTableEntry(TableMatchEntry &tableMatchEntry, bool replace) {
     if (replace) {
-        _tableEntries.erase(tableMatchEntry);
+        deleteTableEntry(tableMatchEntry);
     }
     tableMatchEntry.setZ3Condition(Z3Cache::set(_tableKeyMatch));
-    return _tableEntries.emplace(tableMatchEntry).second ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (!_tableEntries.emplace(tableMatchEntry).second) {
+        return EXIT_FAILURE;
+    }
+    if (_lpmTrie.has_value()) {
+        _lpmTrie->insert(tableMatchEntry);
+    }
+    return EXIT_SUCCESS;
 }
 
 size_t TableConfiguration::deleteTableEntry(TableMatchEntry &tableMatchEntry) {
+    // Remove the entry from the trie first, the trie may still refer to the stored entry.
+    if (_lpmTrie.has_value() && _tableEntries.find(tableMatchEntry) != _tableEntries.end()) {
+        _lpmTrie->remove(tableMatchEntry);
+    }
     return _tableEntries.erase(tableMatchEntry);
 }
 
-void TableConfiguration::clearTableEntries() { _tableEntries.clear(); }
+void TableConfiguration::clearTableEntries() {
+    _tableEntries.clear();
+    if (_lpmTrie.has_value()) {
+        _lpmTrie->clear();
+    }
+}
 
 void TableConfiguration::setDefaultTableAction(TableDefaultAction defaultTableAction) {
     _defaultTableAction = std::move(defaultTableAction);
 }
 
+bool TableConfiguration::refersTo(const std::set<ActionProfileReference> &references) const {
+    for (const auto &tableEntry : _tableEntries) {
+        const auto *profileEntry = tableEntry.get().to<ActionProfileTableMatchEntry>();
+        if (profileEntry != nullptr && references.count(profileEntry->reference()) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int TableConfiguration::updateActionProfileEntries(
+    const ActionProfile &actionProfile, const std::set<ActionProfileReference> &references,
+    SymbolSet &symbolSet) {
+    // Only the action of the entries changes. The match and hence the position of the entries in
+    // the entry set and the LPM trie stays the same.
+    for (auto &tableEntry : _tableEntries) {
+        auto *profileEntry = tableEntry.get().to<ActionProfileTableMatchEntry>();
+        if (profileEntry == nullptr || references.count(profileEntry->reference()) == 0) {
+            continue;
+        }
+        auto actionAssignment =
+            actionProfile.computeActionAssignment(_tableName, profileEntry->reference());
+        if (!actionAssignment.has_value()) {
+            return EXIT_FAILURE;
+        }
+        // Nodes may depend on the action choice or on any argument of the previous or the new
+        // action.
+        for (const auto &[symbol, value] : profileEntry->actionAssignment()) {
+            symbolSet.emplace(symbol);
+        }
+        for (const auto &[symbol, value] : actionAssignment.value()) {
+            symbolSet.emplace(symbol);
+        }
+        profileEntry->setActionAssignment(actionAssignment.value());
+    }
+    return EXIT_SUCCESS;
+}
+
 ControlPlaneAssignmentSet TableConfiguration::computeControlPlaneAssignments() const {
     auto assignments = _defaultTableAction.computeControlPlaneAssignments();
     assignments.emplace(*ControlPlaneState::getTableActive(_tableName),
@@ -400,7 +509,8 @@ ControlPlaneAssignmentSet TableConfiguration::computeControlPlaneAssignments() c
     return assignments;
 }
 
-Z3ControlPlaneAssignmentSet TableConfiguration::computeZ3ControlPlaneAssignments() const {
+Z3ControlPlaneAssignmentSet TableConfiguration::encodeZ3ControlPlaneAssignments(
+    TableEncodingStrategy strategy) const {
     auto assignments = _defaultTableAction.computeZ3ControlPlaneAssignments();
     assignments.add(*ControlPlaneState::getTableActive(_tableName),
                     Z3Cache::set(IR::BoolLiteral::get(_tableEntries.size() > 0)));
@@ -408,35 +518,105 @@ Z3ControlPlaneAssignmentSet TableConfiguration::computeZ3ControlPlaneAssignments
         return assignments;
     }
 
-    // If we have more than kMaxEntriesPerTable entries we give up.
-    // Set the entries symbolic and assume they can be executed freely.
-    if (_tableEntries.size() > kMaxEntriesPerTable) {
-        assignments.setAllSymbolic();
-        return assignments;
-    }
-
     Util::ScopedTimer timer("computeZ3ControlPlaneAssignments");
-    auto z3TableKeyMatchOpt = Z3Cache::get(_tableKeyMatch);
-    if (!z3TableKeyMatchOpt.has_value()) {
-        error("Failed to get Z3 table key match");
-        return assignments;
-    }
-    for (const auto &tableEntry : _tableEntries) {
-        auto constraint = tableEntry.get()._z3Condition();
-        if (!constraint.has_value()) {
-            return assignments;
-        }
-        assignments.mergeConditionally(
-            tableEntry.get().computeZ3ControlPlaneAssignments().substitute(constraint.value()),
-            tableEntry.get().z3ActionAssignment());
-    }
+    TableEntryEncoder::encode(strategy, _tableKeyMap, _tableEntries, assignments,
+                              _lpmTrie.has_value() ? &_lpmTrie.value() : nullptr);
     return assignments;
 }
 
+Z3ControlPlaneAssignmentSet TableConfiguration::computeZ3ControlPlaneAssignments() const {
+    return encodeZ3ControlPlaneAssignments(TableEntryEncoder::selectStrategy(_tableKeyMap));
+}
+
 /**************************************************************************************************
 ParserValueSet
 **************************************************************************************************/
 
+namespace {
+
+/// Hashes a big_int by folding its 64-bit words.
+struct BigIntHash {
+    size_t operator()(const big_int &value) const {
+        static const big_int kWordMask = IR::getMaxBvVal(64);
+        uint64_t hash = 0;
+        for (big_int rest = value; rest != 0; rest >>= 64) {
+            hash = hash * 0x100000001B3ULL ^ static_cast<uint64_t>(rest & kWordMask);
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+/// The values of parser value set members, grouped by mask.
+using MembersByMask = std::map<big_int, absl::flat_hash_set<big_int, BigIntHash>>;
+
+/// @returns the values of @param values in ascending order. Members are visited in this order,
+/// so the canonical form does not depend on the layout of the hash set.
+std::vector<big_int> sortValues(const absl::flat_hash_set<big_int, BigIntHash> &values) {
+    std::vector<big_int> sortedValues(values.begin(), values.end());
+    std::sort(sortedValues.begin(), sortedValues.end());
+    return sortedValues;
+}
+
+/// Remove every member of @param members which is covered by a member with fewer mask bits.
+/// Only the masks which are a subset of the mask of a member can cover it, and for each such mask
+/// there is a single value to look up.
+void removeCoveredMembers(MembersByMask &members) {
+    for (auto &group : members) {
+        const auto &mask = group.first;
+        auto &values = group.second;
+        for (const auto &value : sortValues(values)) {
+            bool isCovered = std::any_of(members.begin(), members.end(), [&](const auto &other) {
+                const auto &[otherMask, otherValues] = other;
+                return otherMask != mask && (otherMask & mask) == otherMask &&
+                       otherValues.contains(value & otherMask);
+            });
+            if (isCovered) {
+                values.erase(value);
+            }
+        }
+    }
+}
+
+/// Merge pairs of members with the same mask whose values differ in a single mask bit into one
+/// member without that bit, like a step of the Quine-McCluskey method. Each member is merged at
+/// most once per step. The partner of a member is found by flipping each of its mask bits.
+/// @returns true if any members were merged.
+bool mergeMembers(MembersByMask &members) {
+    MembersByMask mergedMembers;
+    for (auto &[mask, values] : members) {
+        absl::flat_hash_set<big_int, BigIntHash> consumed;
+        for (const auto &value : sortValues(values)) {
+            if (consumed.contains(value)) {
+                continue;
+            }
+            for (big_int bit = 1; bit <= mask; bit <<= 1) {
+                if ((mask & bit) == 0) {
+                    continue;
+                }
+                big_int partner = value ^ bit;
+                if (values.contains(partner) && !consumed.contains(partner)) {
+                    consumed.insert(value);
+                    consumed.insert(partner);
+                    mergedMembers[mask ^ bit].insert(value & (mask ^ bit));
+                    break;
+                }
+            }
+        }
+        for (const auto &value : consumed) {
+            values.erase(value);
+        }
+    }
+    if (mergedMembers.empty()) {
+        return false;
+    }
+    for (auto &[mask, values] : mergedMembers) {
+        members[mask].insert(values.begin(), values.end());
+    }
+    return true;
+}
+
+}  // namespace
+
 ParserValueSet::ParserValueSet(cstring name) : _name(name) {}
 
 bool ParserValueSet::operator<(const ControlPlaneItem &other) const {
@@ -444,14 +624,164 @@ bool ParserValueSet::operator<(const ControlPlaneItem &other) const {
                                           : typeid(*this).hash_code() < typeid(other).hash_code();
 }
 
+const IR::SymbolicVariable *ParserValueSet::addSelectKey(const IR::Expression *selectKey) {
+    for (size_t keyIndex = 0; keyIndex < _selectKeys.size(); ++keyIndex) {
+        if (_selectKeys[keyIndex]->equiv(*selectKey)) {
+            return ControlPlaneState::getParserValueSetMatch(_name, keyIndex);
+        }
+    }
+    _selectKeys.push_back(selectKey);
+    return ControlPlaneState::getParserValueSetMatch(_name, _selectKeys.size() - 1);
+}
+
+const std::vector<const IR::Expression *> &ParserValueSet::selectKeys() const {
+    return _selectKeys;
+}
+
+void ParserValueSet::addMembers(const std::vector<ParserValueSetMember> &members) {
+    for (const auto &member : members) {
+        _members[member]++;
+    }
+    _canonicalMembers.reset();
+}
+
+int ParserValueSet::deleteMembers(const std::vector<ParserValueSetMember> &members) {
+    std::map<ParserValueSetMember, size_t> deletions;
+    for (const auto &member : members) {
+        deletions[member]++;
+    }
+    for (const auto &[member, count] : deletions) {
+        auto it = _members.find(member);
+        if (it == _members.end() || it->second < count) {
+            return EXIT_FAILURE;
+        }
+    }
+    for (const auto &[member, count] : deletions) {
+        auto it = _members.find(member);
+        it->second -= count;
+        if (it->second == 0) {
+            _members.erase(it);
+        }
+    }
+    _canonicalMembers.reset();
+    return EXIT_SUCCESS;
+}
+
+void ParserValueSet::clear() {
+    _members.clear();
+    _canonicalMembers.reset();
+}
+
+const std::vector<ParserValueSetMember> &ParserValueSet::computeCanonicalMembers() const {
+    if (_canonicalMembers.has_value()) {
+        return _canonicalMembers.value();
+    }
+    MembersByMask members;
+    for (const auto &member : _members) {
+        members[member.first.mask].insert(member.first.value);
+    }
+    do {
+        removeCoveredMembers(members);
+    } while (mergeMembers(members));
+
+    std::set<ParserValueSetMember> canonicalMembers;
+    for (const auto &[mask, values] : members) {
+        for (const auto &value : values) {
+            canonicalMembers.insert({value, mask});
+        }
+    }
+    _canonicalMembers.emplace(canonicalMembers.begin(), canonicalMembers.end());
+    return _canonicalMembers.value();
+}
+
+void ParserValueSet::collectSymbols(SymbolSet &symbolSet) const {
+    symbolSet.emplace(*ControlPlaneState::getParserValueSetConfigured(_name));
+    for (size_t keyIndex = 0; keyIndex < _selectKeys.size(); ++keyIndex) {
+        symbolSet.emplace(*ControlPlaneState::getParserValueSetMatch(_name, keyIndex));
+    }
+}
+
+std::vector<ParserValueSetMember> ParserValueSet::convertRange(const big_int &low,
+                                                               const big_int &high, int width) {
+    std::vector<ParserValueSetMember> members;
+    auto maxValue = IR::getMaxBvVal(width);
+    big_int current = low;
+    while (current <= high) {
+        // Find the largest aligned block starting at the current value which fits into the range.
+        int blockBits = 0;
+        while (blockBits < width) {
+            big_int blockSize = big_int(1) << (blockBits + 1);
+            if ((current & (blockSize - 1)) != 0 || current + blockSize - 1 > high) {
+                break;
+            }
+            blockBits++;
+        }
+        big_int blockMask = (big_int(1) << blockBits) - 1;
+        members.push_back({current, maxValue ^ blockMask});
+        current += blockMask + 1;
+    }
+    return members;
+}
+
+std::vector<ParserValueSetMember> ParserValueSet::concatenate(
+    const std::vector<std::vector<ParserValueSetMember>> &fields, const std::vector<int> &widths) {
+    BUG_CHECK(fields.size() == widths.size(), "Expected %1% field widths, but got %2%.",
+              fields.size(), widths.size());
+    std::vector<ParserValueSetMember> members{{0, 0}};
+    for (size_t fieldIdx = 0; fieldIdx < fields.size(); ++fieldIdx) {
+        std::vector<ParserValueSetMember> extendedMembers;
+        for (const auto &member : members) {
+            for (const auto &field : fields[fieldIdx]) {
+                extendedMembers.push_back({(member.value << widths[fieldIdx]) | field.value,
+                                           (member.mask << widths[fieldIdx]) | field.mask});
+            }
+        }
+        members = std::move(extendedMembers);
+    }
+    return members;
+}
+
+const IR::Expression *ParserValueSet::computeMembership(
+    const IR::Expression *selectKey, const std::vector<ParserValueSetMember> &members) const {
+    const auto *keyType = selectKey->type->checkedTo<IR::Type_Bits>();
+    auto maxValue = IR::getMaxBvVal(keyType->width_bits());
+    const IR::Expression *membership = nullptr;
+    for (const auto &member : members) {
+        if (member.mask == 0) {
+            return IR::BoolLiteral::get(true);
+        }
+        const auto *value = IR::Constant::get(keyType, member.value);
+        const IR::Expression *maskedKey = selectKey;
+        if (member.mask != maxValue) {
+            maskedKey = new IR::BAnd(selectKey, IR::Constant::get(keyType, member.mask));
+        }
+        const auto *isMember = new IR::Equ(maskedKey, value);
+        membership = membership == nullptr ? isMember : new IR::LOr(membership, isMember);
+    }
+    return membership == nullptr ? IR::BoolLiteral::get(false) : membership;
+}
+
 ControlPlaneAssignmentSet ParserValueSet::computeControlPlaneAssignments() const {
-    return {{*ControlPlaneState::getParserValueSetConfigured(_name), *IR::BoolLiteral::get(false)}};
+    ControlPlaneAssignmentSet assignments;
+    assignments.emplace(*ControlPlaneState::getParserValueSetConfigured(_name),
+                        *IR::BoolLiteral::get(!_members.empty()));
+    const auto &members = computeCanonicalMembers();
+    for (size_t keyIndex = 0; keyIndex < _selectKeys.size(); ++keyIndex) {
+        assignments.emplace(*ControlPlaneState::getParserValueSetMatch(_name, keyIndex),
+                            *computeMembership(_selectKeys[keyIndex], members));
+    }
+    return assignments;
 }
 
 Z3ControlPlaneAssignmentSet ParserValueSet::computeZ3ControlPlaneAssignments() const {
     Z3ControlPlaneAssignmentSet z3Assignments;
     z3Assignments.add(*ControlPlaneState::getParserValueSetConfigured(_name),
-                      Z3Cache::set(IR::BoolLiteral::get(false)));
+                      Z3Cache::set(IR::BoolLiteral::get(!_members.empty())));
+    const auto &members = computeCanonicalMembers();
+    for (size_t keyIndex = 0; keyIndex < _selectKeys.size(); ++keyIndex) {
+        z3Assignments.add(*ControlPlaneState::getParserValueSetMatch(_name, keyIndex),
+                          Z3Cache::set(computeMembership(_selectKeys[keyIndex], members)));
+    }
     return z3Assignments;
 }
 
@@ -459,6 +789,23 @@ Z3ControlPlaneAssignmentSet ParserValueSet::computeZ3ControlPlaneAssignments() c
 ActionProfile
 **************************************************************************************************/
 
+ActionProfileMember::ActionProfileMember(const IR::StringLiteral *actionName,
+                                         std::map<cstring, const IR::Literal *> arguments)
+    : _actionName(actionName), _arguments(std::move(arguments)) {}
+
+cstring ActionProfileMember::actionName() const { return _actionName->value; }
+
+ControlPlaneAssignmentSet ActionProfileMember::computeActionAssignment(cstring tableName) const {
+    ControlPlaneAssignmentSet actionAssignment;
+    actionAssignment.emplace(*ControlPlaneState::getTableActionChoice(tableName), *_actionName);
+    for (const auto &[paramName, argument] : _arguments) {
+        actionAssignment.emplace(*ControlPlaneState::getTableActionArgument(
+                                     tableName, actionName(), paramName, argument->type),
+                                 *argument);
+    }
+    return actionAssignment;
+}
+
 bool ActionProfile::operator<(const ControlPlaneItem &other) const {
     // There is only one action profile active, we ignore the set of associated tables.
     return typeid(*this) == typeid(other) ? false
@@ -469,6 +816,212 @@ const std::set<cstring> &ActionProfile::associatedTables() const { return _assoc
 
 void ActionProfile::addAssociatedTable(cstring table) { _associatedTables.insert(table); }
 
+int ActionProfile::addMember(uint32_t memberId, ActionProfileMember member, bool replace) {
+    auto [it, inserted] = _members.emplace(memberId, member);
+    if (inserted) {
+        return EXIT_SUCCESS;
+    }
+    if (!replace) {
+        return EXIT_FAILURE;
+    }
+    it->second = std::move(member);
+    return EXIT_SUCCESS;
+}
+
+size_t ActionProfile::deleteMember(uint32_t memberId) { return _members.erase(memberId); }
+
+int ActionProfile::addGroup(uint32_t groupId, std::set<uint32_t> memberIds, bool replace) {
+    for (auto memberId : memberIds) {
+        if (_members.find(memberId) == _members.end()) {
+            return EXIT_FAILURE;
+        }
+    }
+    auto [it, inserted] = _groups.emplace(groupId, memberIds);
+    if (inserted) {
+        return EXIT_SUCCESS;
+    }
+    if (!replace) {
+        return EXIT_FAILURE;
+    }
+    it->second = std::move(memberIds);
+    return EXIT_SUCCESS;
+}
+
+size_t ActionProfile::deleteGroup(uint32_t groupId) { return _groups.erase(groupId); }
+
+void ActionProfile::clear() {
+    _members.clear();
+    _groups.clear();
+}
+
+const ActionProfileMember *ActionProfile::findMember(uint32_t memberId) const {
+    auto it = _members.find(memberId);
+    return it == _members.end() ? nullptr : &it->second;
+}
+
+const std::set<uint32_t> *ActionProfile::findGroup(uint32_t groupId) const {
+    auto it = _groups.find(groupId);
+    return it == _groups.end() ? nullptr : &it->second;
+}
+
+std::set<ActionProfileReference> ActionProfile::references() const {
+    std::set<ActionProfileReference> references;
+    for (const auto &member : _members) {
+        references.insert({ActionProfileReference::Kind::kMember, member.first});
+    }
+    for (const auto &group : _groups) {
+        references.insert({ActionProfileReference::Kind::kGroup, group.first});
+    }
+    return references;
+}
+
+std::set<ActionProfileReference> ActionProfile::referencesToMember(uint32_t memberId) const {
+    std::set<ActionProfileReference> references{
+        {ActionProfileReference::Kind::kMember, memberId}};
+    for (const auto &[groupId, memberIds] : _groups) {
+        if (memberIds.count(memberId) != 0) {
+            references.insert({ActionProfileReference::Kind::kGroup, groupId});
+        }
+    }
+    return references;
+}
+
+std::optional<ControlPlaneAssignmentSet> ActionProfile::computeActionAssignment(
+    cstring tableName, const ActionProfileReference &reference) const {
+    if (reference.kind == ActionProfileReference::Kind::kMember) {
+        const auto *member = findMember(reference.id);
+        if (member == nullptr) {
+            return std::nullopt;
+        }
+        return member->computeActionAssignment(tableName);
+    }
+    const auto *memberIds = findGroup(reference.id);
+    if (memberIds == nullptr) {
+        return std::nullopt;
+    }
+    std::vector<std::reference_wrapper<const ActionProfileMember>> members;
+    for (auto memberId : *memberIds) {
+        const auto *member = findMember(memberId);
+        if (member == nullptr) {
+            return std::nullopt;
+        }
+        members.emplace_back(*member);
+    }
+    return computeActionSetAssignment(tableName, members);
+}
+
+bool ActionProfile::isReferenced(const ControlPlaneConstraints &constraints,
+                                 const std::set<ActionProfileReference> &references) const {
+    for (auto tableName : _associatedTables) {
+        auto it = constraints.find(tableName);
+        if (it == constraints.end()) {
+            continue;
+        }
+        const auto *tableConfiguration = it->second.get().to<TableConfiguration>();
+        if (tableConfiguration != nullptr && tableConfiguration->refersTo(references)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int ActionProfile::updateAssociatedTables(ControlPlaneConstraints &constraints,
+                                          const std::set<ActionProfileReference> &references,
+                                          SymbolSet &symbolSet) const {
+    for (auto tableName : _associatedTables) {
+        auto it = constraints.find(tableName);
+        if (it == constraints.end()) {
+            error("Configuration for table %1% associated with action profile %2% not found.",
+                  tableName, _name);
+            return EXIT_FAILURE;
+        }
+        auto *tableConfiguration = it->second.get().to<TableConfiguration>();
+        if (tableConfiguration == nullptr || !tableConfiguration->refersTo(references)) {
+            continue;
+        }
+        if (tableConfiguration->updateActionProfileEntries(*this, references, symbolSet) !=
+            EXIT_SUCCESS) {
+            error("Table %1% refers to a member or group of action profile %2% which does not "
+                  "exist.",
+                  tableName, _name);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+void ActionProfile::restoreMember(ControlPlaneConstraints &constraints, uint32_t memberId,
+                                  std::optional<ActionProfileMember> previousMember) {
+    if (previousMember.has_value()) {
+        addMember(memberId, std::move(previousMember.value()), true);
+    } else {
+        deleteMember(memberId);
+    }
+    // The symbols touched by the rejected update are not reported.
+    SymbolSet symbolSet;
+    updateAssociatedTables(constraints, referencesToMember(memberId), symbolSet);
+}
+
+void ActionProfile::restoreGroup(ControlPlaneConstraints &constraints, uint32_t groupId,
+                                 std::optional<std::set<uint32_t>> previousGroup) {
+    if (previousGroup.has_value()) {
+        _groups[groupId] = std::move(previousGroup.value());
+    } else {
+        deleteGroup(groupId);
+    }
+    SymbolSet symbolSet;
+    updateAssociatedTables(constraints, {{ActionProfileReference::Kind::kGroup, groupId}},
+                           symbolSet);
+}
+
+ControlPlaneAssignmentSet ActionProfile::computeActionSetAssignment(
+    cstring tableName,
+    const std::vector<std::reference_wrapper<const ActionProfileMember>> &members) {
+    const auto *actionChoice = ControlPlaneState::getTableActionChoice(tableName);
+    // An empty group executes no known action, so the action choice stays unconstrained.
+    if (members.empty()) {
+        ControlPlaneAssignmentSet actionAssignment;
+        actionAssignment.emplace(*actionChoice, *actionChoice);
+        return actionAssignment;
+    }
+    if (members.size() == 1) {
+        return members.front().get().computeActionAssignment(tableName);
+    }
+
+    // Collect the values every variable takes across the members. Arguments are only assigned by
+    // the members executing the corresponding action.
+    using Candidates = std::vector<std::pair<size_t, const IR::Expression *>>;
+    std::map<std::reference_wrapper<const IR::SymbolicVariable>, Candidates,
+             IR::IsSemanticallyLessComparator>
+        candidates;
+    for (size_t idx = 0; idx < members.size(); ++idx) {
+        for (const auto &[variable, value] :
+             members.at(idx).get().computeActionAssignment(tableName)) {
+            candidates[variable].emplace_back(idx, &value.get());
+        }
+    }
+
+    // The selector picks one of the members. Variables which differ across the members become a
+    // choice over the selector, the last candidate covers all remaining selector values.
+    const auto *selectorChoice = ControlPlaneState::getActionSelectorChoice(tableName);
+    ControlPlaneAssignmentSet actionAssignment;
+    for (const auto &[variable, variableCandidates] : candidates) {
+        const auto *value = variableCandidates.back().second;
+        bool isUniform = std::all_of(
+            variableCandidates.begin(), variableCandidates.end(),
+            [value](const auto &candidate) { return candidate.second->equiv(*value); });
+        for (auto it = std::next(variableCandidates.rbegin());
+             !isUniform && it != variableCandidates.rend(); ++it) {
+            auto idx = static_cast<int>(it->first);
+            const auto *isSelected =
+                new IR::Equ(selectorChoice, IR::Constant::get(selectorChoice->type, idx));
+            value = new IR::Mux(value->type, isSelected, it->second, value);
+        }
+        actionAssignment.emplace(variable, *value);
+    }
+    return actionAssignment;
+}
+
 ControlPlaneAssignmentSet ActionProfile::computeControlPlaneAssignments() const {
     // Action profiles are indirect and associated with the constraints of a table.
     return {};
@@ -500,6 +1053,8 @@ void ActionSelector::addAssociatedTable(cstring table) {
 
 const ActionProfile &ActionSelector::actionProfile() const { return _actionProfile; }
 
+ActionProfile &ActionSelector::actionProfile() { return _actionProfile; }
+
 ControlPlaneAssignmentSet ActionSelector::computeControlPlaneAssignments() const {
     // Action selectors are indirect and associated with the constraints of a table.
     return {};
@@ -1,15 +1,22 @@
 #ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_CONTROL_PLANE_OBJECTS_H_
 #define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_CONTROL_PLANE_OBJECTS_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <map>
 #include <optional>
 #include <set>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include "backends/p4tools/modules/flay/core/control_plane/control_plane_item.h"
+#include "backends/p4tools/modules/flay/core/control_plane/lpm_trie.h"
+#include "backends/p4tools/modules/flay/core/control_plane/symbols.h"
 #include "ir/ir.h"
 #include "ir/irutils.h"
+#include "lib/big_int.h"
 
 namespace P4::P4Tools::ControlPlaneState {
 
@@ -17,19 +24,40 @@ namespace P4::P4Tools::ControlPlaneState {
 /// been configured by the control plane.
 const IR::SymbolicVariable *getParserValueSetConfigured(cstring parserValueSetName);
 
+/// @returns the symbolic boolean variable indicating whether the select key with index
+/// @param keyIndex is a member of the parser value set @param parserValueSetName.
+const IR::SymbolicVariable *getParserValueSetMatch(cstring parserValueSetName, size_t keyIndex);
+
 /// @returns the symbolic string variable that represents the default action that is active for a
 /// particular table.
 const IR::SymbolicVariable *getDefaultActionVariable(cstring tableName);
 
+/// @returns the symbolic variable that represents which member of a group or action set the action
+/// selector of a particular table picks. The variable is never assigned by the control plane.
+const IR::SymbolicVariable *getActionSelectorChoice(cstring tableName);
+
 }  // namespace P4::P4Tools::ControlPlaneState
 
 namespace P4::P4Tools::Flay {
 
-/// How many entries per table we can support before we fall back to making the entire table
-/// configuration symbolic.
+/// How many entries per table the IR encoding supports before we fall back to making the entire
+/// table configuration symbolic. The Z3 encoding does not have this limit.
 /// TODO: Consider making this an option?
 constexpr size_t kMaxEntriesPerTable = 50;
 
+/// The strategies available to encode the entries of a table as Z3 assignments.
+enum class TableEncodingStrategy {
+    /// One ite per entry, nested in entry order. Supports any match kind.
+    kIteChain,
+    /// All keys are exact. Entry conditions are disjoint and are grouped per assigned value.
+    kExactPartition,
+    /// The table has a single LPM key. Entry conditions are made disjoint using a prefix trie.
+    kLpmTrie,
+    /// The table has a single range key. Entry conditions are made disjoint by partitioning the
+    /// key space into intervals.
+    kRangePartition,
+};
+
 /**************************************************************************************************
 TableMatchKeys
 **************************************************************************************************/
@@ -272,7 +300,10 @@ class TableMatchEntry : public Z3ControlPlaneItem {
     [[nodiscard]] ControlPlaneAssignmentSet actionAssignment() const;
 
     /// @returns the action that will be executed by this entry.
-    [[nodiscard]] Z3ControlPlaneAssignmentSet z3ActionAssignment() const;
+    [[nodiscard]] const Z3ControlPlaneAssignmentSet &z3ActionAssignment() const;
+
+    /// @returns the key assignments of this entry.
+    [[nodiscard]] const ControlPlaneAssignmentSet &matches() const;
 
     /// @returns the priority of this entry.
     [[nodiscard]] int32_t priority() const;
@@ -288,6 +319,9 @@ class TableMatchEntry : public Z3ControlPlaneItem {
 
     void setZ3Condition(z3::expr condition) { _condition = _z3Matches.substitute(condition); }
 
+    /// Replace the action that will be executed by this entry.
+    void setActionAssignment(ControlPlaneAssignmentSet actionAssignment);
+
     bool operator<(const ControlPlaneItem &other) const override;
 
     [[nodiscard]] ControlPlaneAssignmentSet computeControlPlaneAssignments() const override;
@@ -334,6 +368,43 @@ class WildCardMatchEntry : public TableMatchEntry {
     DECLARE_TYPEINFO(WildCardMatchEntry);
 };
 
+/**************************************************************************************************
+ActionProfileTableMatchEntry
+**************************************************************************************************/
+
+/// Refers to a member or a group of an action profile.
+struct ActionProfileReference {
+    enum class Kind { kMember, kGroup };
+
+    /// Whether the reference is a member or a group id.
+    Kind kind;
+
+    /// The member or group id.
+    uint32_t id;
+
+    bool operator<(const ActionProfileReference &other) const {
+        return std::make_pair(kind, id) < std::make_pair(other.kind, other.id);
+    }
+};
+
+/// An entry of a table which is implemented by an action profile or action selector. The action of
+/// the entry is resolved from the member or group the entry refers to and is updated whenever that
+/// member or group changes.
+class ActionProfileTableMatchEntry : public TableMatchEntry {
+    /// The member or group this entry refers to.
+    ActionProfileReference _reference;
+
+ public:
+    explicit ActionProfileTableMatchEntry(ActionProfileReference reference,
+                                          ControlPlaneAssignmentSet actionAssignment,
+                                          int32_t priority, ControlPlaneAssignmentSet matches);
+
+    /// @returns the member or group this entry refers to.
+    [[nodiscard]] const ActionProfileReference &reference() const;
+
+    DECLARE_TYPEINFO(ActionProfileTableMatchEntry);
+};
+
 /**************************************************************************************************
 TableConfiguration
 **************************************************************************************************/
@@ -343,6 +414,8 @@ using TableEntrySet = std::set<std::reference_wrapper<TableMatchEntry>, std::les
 
 using KeyMap = std::vector<const TableMatchKey *>;
 
+class ActionProfile;
+
 /// Concrete configuration of a control plane table. May contain arbitrary many table match
 /// entries.
 class TableConfiguration : public Z3ControlPlaneItem {
@@ -358,6 +431,13 @@ class TableConfiguration : public Z3ControlPlaneItem {
     /// The match key expression for the table . This is derived from the data-plane analysis.
     const IR::Expression *_tableKeyMatch = IR::BoolLiteral::get(false);
 
+    /// The individual keys of the table. Used to select the entry encoding strategy.
+    KeyMap _tableKeyMap;
+
+    /// The prefix trie of the entries if the table has a single LPM key. Kept up to date as
+    /// entries are added and removed.
+    std::optional<LpmTrie> _lpmTrie;
+
     /// Second-order sorting function for table entries. Sorts entries by priority.
     class CompareTableMatch {
      public:
@@ -376,6 +456,9 @@ class TableConfiguration : public Z3ControlPlaneItem {
     /// Set the table key match expression.
     void setTableKeyMatch(const KeyMap &tableKeyMap);
 
+    /// @returns the individual keys of the table as set by @setTableKeyMatch.
+    [[nodiscard]] const KeyMap &tableKeyMap() const;
+
     /// Adds a new table entry.
     int addTableEntry(TableMatchEntry &tableMatchEntry, bool replace);
 
@@ -388,6 +471,22 @@ class TableConfiguration : public Z3ControlPlaneItem {
     /// Set the default action for this table.
     void setDefaultTableAction(TableDefaultAction defaultTableAction);
 
+    /// @returns true if an entry of this table refers to one of @param references.
+    [[nodiscard]] bool refersTo(const std::set<ActionProfileReference> &references) const;
+
+    /// Resolve the action of every entry which refers to one of @param references again using
+    /// @param actionProfile. The variables of the previous and the new action assignment of every
+    /// updated entry are added to @param symbolSet.
+    /// @returns EXIT_FAILURE if a reference no longer exists.
+    int updateActionProfileEntries(const ActionProfile &actionProfile,
+                                   const std::set<ActionProfileReference> &references,
+                                   SymbolSet &symbolSet);
+
+    /// Compute the Z3 assignments of the table using the given entry encoding strategy.
+    /// computeZ3ControlPlaneAssignments picks the most scalable strategy that is sound.
+    [[nodiscard]] Z3ControlPlaneAssignmentSet encodeZ3ControlPlaneAssignments(
+        TableEncodingStrategy strategy) const;
+
     [[nodiscard]] ControlPlaneAssignmentSet computeControlPlaneAssignments() const override;
     [[nodiscard]] Z3ControlPlaneAssignmentSet computeZ3ControlPlaneAssignments() const override;
 
@@ -398,17 +497,86 @@ class TableConfiguration : public Z3ControlPlaneItem {
 ParserValueSet
 **************************************************************************************************/
 
+/// A member of a parser value set in ternary form. Bits of the value outside of the mask are zero.
+struct ParserValueSetMember {
+    /// The value of the member.
+    big_int value;
+
+    /// The bits of the select key which are compared with the value.
+    big_int mask;
+
+    bool operator<(const ParserValueSetMember &other) const {
+        return std::tie(value, mask) < std::tie(other.value, other.mask);
+    }
+};
+
 /// Implements a parser value set as specified in
 /// https://p4.org/p4-spec/docs/P4-16-working-spec.html#sec-value-set.
-/// TODO: Actually implement all the elments in the value set.
+/// The select keys the value set is matched against are registered by the parser stepper. Each key
+/// is a single bit vector, which is the concatenation of the fields of the value set. Whether a
+/// key is a member is represented by a symbolic variable, which is assigned the membership test
+/// of the configured members.
 class ParserValueSet : public Z3ControlPlaneItem {
+    /// The control plane name of the parser value set.
     cstring _name;
 
+    /// The select keys the parser value set is matched against.
+    std::vector<const IR::Expression *> _selectKeys;
+
+    /// The configured members with the number of times they have been added.
+    std::map<ParserValueSetMember, size_t> _members;
+
+    /// The canonical form of the configured members. Computed on first use and reset whenever
+    /// the members change.
+    mutable std::optional<std::vector<ParserValueSetMember>> _canonicalMembers;
+
+    /// @returns the membership test of @param selectKey.
+    [[nodiscard]] const IR::Expression *computeMembership(
+        const IR::Expression *selectKey, const std::vector<ParserValueSetMember> &members) const;
+
  public:
     explicit ParserValueSet(cstring name);
 
     bool operator<(const ControlPlaneItem &other) const override;
 
+    /// Register @param selectKey as a key the parser value set is matched against.
+    /// @returns the symbolic variable which represents the membership of the key.
+    const IR::SymbolicVariable *addSelectKey(const IR::Expression *selectKey);
+
+    /// @returns the registered select keys. The position of a key is the index of its match
+    /// variable.
+    [[nodiscard]] const std::vector<const IR::Expression *> &selectKeys() const;
+
+    /// Add @param members to the parser value set.
+    void addMembers(const std::vector<ParserValueSetMember> &members);
+
+    /// Remove @param members from the parser value set.
+    /// @returns EXIT_FAILURE and keeps the parser value set unchanged if a member does not exist.
+    int deleteMembers(const std::vector<ParserValueSetMember> &members);
+
+    /// Remove all members from the parser value set.
+    void clear();
+
+    /// @returns the members in canonical form. Members which are covered by another member are
+    /// dropped and members which only differ in a single value bit are merged into one ternary
+    /// member. The result matches the same keys as the configured members.
+    [[nodiscard]] const std::vector<ParserValueSetMember> &computeCanonicalMembers() const;
+
+    /// Add all symbols assigned by this parser value set to @param symbolSet.
+    void collectSymbols(SymbolSet &symbolSet) const;
+
+    /// @returns the ternary members which cover the range [@param low, @param high] of a field
+    /// with @param width bits.
+    static std::vector<ParserValueSetMember> convertRange(const big_int &low, const big_int &high,
+                                                          int width);
+
+    /// @returns the members of the value set which are the combination of the ternary matches of
+    /// each field in @param fields. The first field occupies the most significant bits.
+    /// @param widths are the widths of the fields.
+    static std::vector<ParserValueSetMember> concatenate(
+        const std::vector<std::vector<ParserValueSetMember>> &fields,
+        const std::vector<int> &widths);
+
     [[nodiscard]] ControlPlaneAssignmentSet computeControlPlaneAssignments() const override;
     [[nodiscard]] Z3ControlPlaneAssignmentSet computeZ3ControlPlaneAssignments() const override;
 
@@ -419,9 +587,31 @@ class ParserValueSet : public Z3ControlPlaneItem {
 ActionProfile
 **************************************************************************************************/
 
+/// An action of an action profile member together with its arguments.
+class ActionProfileMember {
+    /// The literal the action choice of a table is assigned when this member is executed.
+    const IR::StringLiteral *_actionName;
+
+    /// The arguments of the action by control plane parameter name.
+    std::map<cstring, const IR::Literal *> _arguments;
+
+ public:
+    ActionProfileMember(const IR::StringLiteral *actionName,
+                        std::map<cstring, const IR::Literal *> arguments);
+
+    /// @returns the control plane name of the action.
+    [[nodiscard]] cstring actionName() const;
+
+    /// @returns the assignments of the action choice and the action arguments of the table
+    /// @param tableName when this member is executed.
+    [[nodiscard]] ControlPlaneAssignmentSet computeActionAssignment(cstring tableName) const;
+};
+
 /// An action profile. Action profiles are programmed like a table, but each table associated
 /// with the respective table shares the action profile configuration. Hence, we use a set of
 /// table control plane names to represent this data structure.
+/// The members of the profile and, if the profile is used by an action selector, the groups of
+/// members are kept here. Entries of the associated tables refer to them by id.
 class ActionProfile : public Z3ControlPlaneItem {
     /// The control plane name of the action profile.
     cstring _name;
@@ -429,6 +619,12 @@ class ActionProfile : public Z3ControlPlaneItem {
     /// The control plane names of the tables associated with this action profile.
     std::set<cstring> _associatedTables;
 
+    /// The members of the action profile by member id.
+    std::map<uint32_t, ActionProfileMember> _members;
+
+    /// The member ids of each group by group id.
+    std::map<uint32_t, std::set<uint32_t>> _groups;
+
  public:
     explicit ActionProfile(cstring name) : _name(name){};
     explicit ActionProfile(cstring name, std::set<cstring> associatedTables)
@@ -445,6 +641,78 @@ class ActionProfile : public Z3ControlPlaneItem {
     /// Add the control plane name of a  table to the set of associated tables.
     void addAssociatedTable(cstring table);
 
+    /// Adds member @param member with id @param memberId. Replaces an existing member if
+    /// @param replace is true.
+    /// @returns EXIT_FAILURE if the member exists and @param replace is false.
+    int addMember(uint32_t memberId, ActionProfileMember member, bool replace);
+
+    /// Delete the member with id @param memberId.
+    /// @returns the number of deleted members.
+    size_t deleteMember(uint32_t memberId);
+
+    /// Adds the group @param groupId with members @param memberIds. Replaces an existing group if
+    /// @param replace is true.
+    /// @returns EXIT_FAILURE if the group exists and @param replace is false or if a member does
+    /// not exist.
+    int addGroup(uint32_t groupId, std::set<uint32_t> memberIds, bool replace);
+
+    /// Delete the group with id @param groupId.
+    /// @returns the number of deleted groups.
+    size_t deleteGroup(uint32_t groupId);
+
+    /// Delete all members and groups.
+    void clear();
+
+    /// @returns the member with id @param memberId or nullptr if there is no such member.
+    [[nodiscard]] const ActionProfileMember *findMember(uint32_t memberId) const;
+
+    /// @returns the member ids of group @param groupId or nullptr if there is no such group.
+    [[nodiscard]] const std::set<uint32_t> *findGroup(uint32_t groupId) const;
+
+    /// @returns all members and groups of the action profile.
+    [[nodiscard]] std::set<ActionProfileReference> references() const;
+
+    /// @returns the member and every group containing the member @param memberId. These are the
+    /// references whose action changes when the member changes.
+    [[nodiscard]] std::set<ActionProfileReference> referencesToMember(uint32_t memberId) const;
+
+    /// @returns the action assignments of table @param tableName for an entry referring to
+    /// @param reference, or std::nullopt if the member or group does not exist.
+    [[nodiscard]] std::optional<ControlPlaneAssignmentSet> computeActionAssignment(
+        cstring tableName, const ActionProfileReference &reference) const;
+
+    /// @returns true if an entry of an associated table in @param constraints refers to one of
+    /// @param references.
+    [[nodiscard]] bool isReferenced(const ControlPlaneConstraints &constraints,
+                                    const std::set<ActionProfileReference> &references) const;
+
+    /// Resolve the action of all entries of the associated tables in @param constraints which
+    /// refer to one of @param references again. The action choice and the action arguments of
+    /// every updated entry are added to @param symbolSet.
+    /// @returns EXIT_FAILURE if an associated table is missing or a reference no longer exists.
+    int updateAssociatedTables(ControlPlaneConstraints &constraints,
+                               const std::set<ActionProfileReference> &references,
+                               SymbolSet &symbolSet) const;
+
+    /// Roll back a member update whose associated tables could not be updated. Member
+    /// @param memberId is reset to @param previousMember, or deleted if there was none, and the
+    /// entries of the associated tables in @param constraints which refer to it are resolved again.
+    void restoreMember(ControlPlaneConstraints &constraints, uint32_t memberId,
+                       std::optional<ActionProfileMember> previousMember);
+
+    /// Roll back a group update whose associated tables could not be updated. Group
+    /// @param groupId is reset to @param previousGroup, or deleted if there was none, and the
+    /// entries of the associated tables in @param constraints which refer to it are resolved again.
+    void restoreGroup(ControlPlaneConstraints &constraints, uint32_t groupId,
+                      std::optional<std::set<uint32_t>> previousGroup);
+
+    /// @returns the action assignments of table @param tableName for an entry which executes any
+    /// of @param members. The choice of the action selector is left symbolic, so every action of
+    /// the members stays reachable and no other action is.
+    static ControlPlaneAssignmentSet computeActionSetAssignment(
+        cstring tableName, const std::vector<std::reference_wrapper<const ActionProfileMember>>
+                               &members);
+
     [[nodiscard]] ControlPlaneAssignmentSet computeControlPlaneAssignments() const override;
     [[nodiscard]] Z3ControlPlaneAssignmentSet computeZ3ControlPlaneAssignments() const override;
 
@@ -475,6 +743,10 @@ class ActionSelector : public Z3ControlPlaneItem {
     /// Get the reference to the action profile associated with the selector.
     [[nodiscard]] const ActionProfile &actionProfile() const;
 
+    /// Get the reference to the action profile associated with the selector. The groups of the
+    /// selector are kept by the action profile.
+    ActionProfile &actionProfile();
+
     /// Get the set of control plane names of the tables associated with this action profile.
     [[nodiscard]] const std::set<cstring> &associatedTables() const;
 
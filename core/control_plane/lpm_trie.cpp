@@ -0,0 +1,158 @@
+#include "backends/p4tools/modules/flay/core/control_plane/lpm_trie.h"
+
+#include <limits>
+
+#include "backends/p4tools/modules/flay/core/control_plane/control_plane_objects.h"
+#include "ir/irutils.h"
+
+namespace P4::P4Tools::Flay {
+
+LpmTrie::LpmTrie(const IR::SymbolicVariable *variable, const IR::SymbolicVariable *prefix)
+    : _variable(variable), _prefix(prefix), _width(variable->type->width_bits()) {}
+
+big_int LpmTrie::computeMask(int length) const {
+    auto maxValue = IR::getMaxBvVal(_width);
+    return (maxValue << (_width - length)) & maxValue;
+}
+
+std::optional<LpmTrie::NodeKey> LpmTrie::computeNodeKey(const TableMatchEntry &entry) const {
+    const auto &matches = entry.matches();
+    auto valueIt = matches.find(*_variable);
+    auto prefixIt = matches.find(*_prefix);
+    if (valueIt == matches.end() || prefixIt == matches.end()) {
+        return std::nullopt;
+    }
+    const auto *value = valueIt->second.get().to<IR::Constant>();
+    const auto *prefix = prefixIt->second.get().to<IR::Constant>();
+    if (value == nullptr || prefix == nullptr) {
+        return std::nullopt;
+    }
+    // The key matches on the bits covered by the mask `max << prefix`, see createLpmKey.
+    int length = 0;
+    if (prefix->value <= 0) {
+        length = _width;
+    } else if (prefix->value < _width) {
+        length = _width - static_cast<int>(prefix->value);
+    }
+    return std::make_pair(value->value & computeMask(length), length);
+}
+
+std::set<LpmTrie::NodeKey> &LpmTrie::childrenOf(const std::optional<NodeKey> &parent) {
+    return parent.has_value() ? _nodes.at(parent.value()).children : _roots;
+}
+
+void LpmTrie::invalidate(const std::optional<NodeKey> &key) {
+    if (key.has_value()) {
+        _nodes.at(key.value()).guard = std::nullopt;
+    }
+}
+
+void LpmTrie::insert(const TableMatchEntry &entry) {
+    auto key = computeNodeKey(entry);
+    if (!key.has_value()) {
+        _valid = false;
+        return;
+    }
+    auto [it, inserted] = _nodes.try_emplace(key.value());
+    auto &node = it->second;
+    node.entries.insert(entry);
+    node.guard = std::nullopt;
+    if (!inserted) {
+        // The entry of this node may have changed, which affects the condition of the parent.
+        invalidate(node.parent);
+        return;
+    }
+
+    const auto &[prefix, length] = key.value();
+    for (int parentLength = length - 1; parentLength >= 0; --parentLength) {
+        auto parentKey = std::make_pair(prefix & computeMask(parentLength), parentLength);
+        if (_nodes.find(parentKey) != _nodes.end()) {
+            node.parent = parentKey;
+            break;
+        }
+    }
+
+    // Siblings with a prefix value in the range covered by the new node are now covered by it.
+    // Siblings are not covered by any node which is longer than the parent, so all siblings in
+    // this range have a longer prefix than the new node.
+    auto &siblings = childrenOf(node.parent);
+    auto upper = prefix | (IR::getMaxBvVal(_width) & ~computeMask(length));
+    auto begin = siblings.lower_bound(std::make_pair(prefix, 0));
+    auto end = siblings.upper_bound(std::make_pair(upper, std::numeric_limits<int>::max()));
+    for (auto childIt = begin; childIt != end; ++childIt) {
+        _nodes.at(*childIt).parent = key;
+        node.children.insert(*childIt);
+    }
+    siblings.erase(begin, end);
+    siblings.insert(key.value());
+    invalidate(node.parent);
+}
+
+void LpmTrie::remove(const TableMatchEntry &entry) {
+    auto key = computeNodeKey(entry);
+    if (!key.has_value()) {
+        return;
+    }
+    auto it = _nodes.find(key.value());
+    if (it == _nodes.end()) {
+        return;
+    }
+    auto &node = it->second;
+    node.entries.erase(entry);
+    node.guard = std::nullopt;
+    invalidate(node.parent);
+    if (!node.entries.empty()) {
+        return;
+    }
+
+    // The children of the removed node are now covered by its parent.
+    auto &siblings = childrenOf(node.parent);
+    siblings.erase(key.value());
+    for (const auto &childKey : node.children) {
+        _nodes.at(childKey).parent = node.parent;
+        siblings.insert(childKey);
+    }
+    _nodes.erase(it);
+}
+
+void LpmTrie::clear() {
+    _nodes.clear();
+    _roots.clear();
+    _valid = true;
+}
+
+size_t LpmTrie::size() const { return _nodes.size(); }
+
+std::optional<std::vector<GuardedTableEntry>> LpmTrie::guardedEntries() const {
+    if (!_valid) {
+        return std::nullopt;
+    }
+    std::vector<GuardedTableEntry> result;
+    result.reserve(_nodes.size());
+    for (const auto &[key, node] : _nodes) {
+        const auto &entry = node.entries.rbegin()->get();
+        if (!node.guard.has_value()) {
+            auto condition = entry._z3Condition();
+            if (!condition.has_value()) {
+                return std::nullopt;
+            }
+            if (!node.children.empty()) {
+                z3::expr_vector childConditions(condition.value().ctx());
+                for (const auto &childKey : node.children) {
+                    auto childCondition =
+                        _nodes.at(childKey).entries.rbegin()->get()._z3Condition();
+                    if (!childCondition.has_value()) {
+                        return std::nullopt;
+                    }
+                    childConditions.push_back(childCondition.value());
+                }
+                condition = condition.value() && !z3::mk_or(childConditions);
+            }
+            node.guard = condition.value();
+        }
+        result.push_back({entry, node.guard.value()});
+    }
+    return result;
+}
+
+}  // namespace P4::P4Tools::Flay
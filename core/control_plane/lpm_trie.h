@@ -0,0 +1,105 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_LPM_TRIE_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_LPM_TRIE_H_
+
+#include <z3++.h>
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "ir/ir.h"
+#include "lib/big_int.h"
+
+namespace P4::P4Tools::Flay {
+
+class TableMatchEntry;
+
+/// A table entry together with the condition under which this entry is executed.
+struct GuardedTableEntry {
+    std::reference_wrapper<const TableMatchEntry> entry;
+    z3::expr condition;
+};
+
+/// A prefix trie over the entries of a table with a single LPM key. Every node is linked to the
+/// closest node with a shorter prefix that covers it. An entry is only executed if none of the
+/// entries with a longer matching prefix matches, and any longer matching prefix implies that one
+/// of the direct children matches. Inserting or removing an entry only relinks the affected
+/// nodes and only invalidates the execution conditions of the entry and its parent.
+class LpmTrie {
+    /// Nodes are identified by the masked value and the length of their prefix.
+    using NodeKey = std::pair<big_int, int>;
+
+    struct Node {
+        /// The entries matching on exactly this prefix. Like in the ite chain, the entry which
+        /// comes last in table order takes precedence.
+        std::set<std::reference_wrapper<const TableMatchEntry>, std::less<TableMatchEntry>>
+            entries;
+
+        /// The closest node with a shorter prefix which covers this node.
+        std::optional<NodeKey> parent;
+
+        /// The nodes whose closest covering node is this node, ordered by prefix value.
+        std::set<NodeKey> children;
+
+        /// The cached execution condition of the entry of this node.
+        mutable std::optional<z3::expr> guard;
+    };
+
+    /// The symbolic variable of the key value.
+    const IR::SymbolicVariable *_variable;
+
+    /// The symbolic variable of the key prefix.
+    const IR::SymbolicVariable *_prefix;
+
+    /// The width of the key.
+    int _width;
+
+    /// All nodes of the trie.
+    std::map<NodeKey, Node> _nodes;
+
+    /// The nodes which are not covered by any other node.
+    std::set<NodeKey> _roots;
+
+    /// False if an entry did not assign a literal value and prefix to the key.
+    bool _valid = true;
+
+    /// @returns the mask covering the first @param length bits of the key.
+    [[nodiscard]] big_int computeMask(int length) const;
+
+    /// @returns the node key of @param entry or std::nullopt if the entry does not assign a
+    /// literal value and prefix to the key.
+    [[nodiscard]] std::optional<NodeKey> computeNodeKey(const TableMatchEntry &entry) const;
+
+    /// @returns the children of @param parent, or the roots if there is no parent.
+    std::set<NodeKey> &childrenOf(const std::optional<NodeKey> &parent);
+
+    /// Invalidate the cached execution condition of the node @param key.
+    void invalidate(const std::optional<NodeKey> &key);
+
+ public:
+    LpmTrie(const IR::SymbolicVariable *variable, const IR::SymbolicVariable *prefix);
+
+    /// Add @param entry to the trie.
+    void insert(const TableMatchEntry &entry);
+
+    /// Remove the entry equal to @param entry from the trie.
+    void remove(const TableMatchEntry &entry);
+
+    /// Remove all entries.
+    void clear();
+
+    /// @returns the number of distinct prefixes in the trie.
+    [[nodiscard]] size_t size() const;
+
+    /// @returns every entry which is executed for some key together with its execution
+    /// condition, or std::nullopt if an entry can not be represented in the trie.
+    [[nodiscard]] std::optional<std::vector<GuardedTableEntry>> guardedEntries() const;
+};
+
+}  // namespace P4::P4Tools::Flay
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_LPM_TRIE_H_ */
@@ -0,0 +1,147 @@
+#include "backends/p4tools/modules/flay/core/control_plane/p4info_index.h"
+
+#include "backends/p4tools/common/control_plane/symbolic_variables.h"
+
+namespace P4::P4Tools::Flay {
+
+namespace {
+
+P4InfoTable indexTable(const p4::config::v1::Table &table) {
+    cstring tableName = table.preamble().name();
+    P4InfoTable tableInfo{table, tableName, {}, {}};
+    tableInfo.keyLayout.reserve(table.match_fields_size());
+    for (const auto &matchField : table.match_fields()) {
+        cstring fieldName = matchField.name();
+        const auto *keyType = IR::Type_Bits::get(matchField.bitwidth());
+        tableInfo.matchFieldPositions.emplace(matchField.id(), tableInfo.keyLayout.size());
+        tableInfo.keyLayout.push_back({
+            matchField,
+            fieldName,
+            keyType,
+            matchField.match_type(),
+            ControlPlaneState::getTableKey(tableName, fieldName, keyType),
+            ControlPlaneState::getTableTernaryMask(tableName, fieldName, keyType),
+            ControlPlaneState::getTableMatchLpmPrefix(tableName, fieldName, keyType),
+            Bmv2ControlPlaneState::getTableRange(tableName, fieldName, keyType),
+        });
+    }
+    return tableInfo;
+}
+
+P4InfoAction indexAction(const p4::config::v1::Action &action) {
+    cstring actionName = action.preamble().name();
+    P4InfoAction actionInfo{action, actionName, IR::StringLiteral::get(actionName), {}};
+    for (const auto &param : action.params()) {
+        const auto *paramType = IR::Type_Bits::get(param.bitwidth());
+        actionInfo.params.emplace(param.id(), P4InfoActionParam{param, param.name(), paramType});
+    }
+    return actionInfo;
+}
+
+P4InfoValueSet indexValueSet(const p4::config::v1::ValueSet &valueSet) {
+    P4InfoValueSet valueSetInfo{valueSet, valueSet.preamble().name(), {}, {}};
+    for (const auto &matchField : valueSet.match()) {
+        valueSetInfo.fieldPositions.emplace(matchField.id(), valueSetInfo.fieldTypes.size());
+        valueSetInfo.fieldTypes.push_back(IR::Type_Bits::get(matchField.bitwidth()));
+    }
+    return valueSetInfo;
+}
+
+}  // namespace
+
+std::optional<size_t> P4InfoTable::findMatchFieldPosition(
+    P4::ControlPlaneAPI::p4rt_id_t fieldId) const {
+    auto it = matchFieldPositions.find(fieldId);
+    if (it == matchFieldPositions.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<size_t> P4InfoValueSet::findFieldPosition(
+    P4::ControlPlaneAPI::p4rt_id_t fieldId) const {
+    auto it = fieldPositions.find(fieldId);
+    if (it == fieldPositions.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+const P4InfoActionParam *P4InfoAction::findParam(P4::ControlPlaneAPI::p4rt_id_t paramId) const {
+    auto it = params.find(paramId);
+    return it != params.end() ? &it->second : nullptr;
+}
+
+P4InfoIndex::P4InfoIndex(const p4::config::v1::P4Info &p4Info) : _p4Info(p4Info) {
+    _tables.reserve(p4Info.tables_size());
+    for (const auto &table : p4Info.tables()) {
+        auto tableId = table.preamble().id();
+        _tableIds.emplace(table.preamble().name(), tableId);
+        _tables.emplace(tableId, indexTable(table));
+    }
+    _actions.reserve(p4Info.actions_size());
+    for (const auto &action : p4Info.actions()) {
+        _actions.emplace(action.preamble().id(), indexAction(action));
+    }
+    for (const auto &valueSet : p4Info.value_sets()) {
+        _valueSets.emplace(valueSet.preamble().id(), indexValueSet(valueSet));
+    }
+    for (const auto &actionProfile : p4Info.action_profiles()) {
+        _actionProfileNames.emplace(actionProfile.preamble().id(),
+                                    actionProfile.preamble().name());
+    }
+    // BfRuntime exposes action profiles and selectors as extern instances.
+    for (const auto &externType : p4Info.externs()) {
+        if (externType.extern_type_name() == "ActionProfile") {
+            for (const auto &instance : externType.instances()) {
+                _actionProfileNames.emplace(instance.preamble().id(), instance.preamble().name());
+            }
+        } else if (externType.extern_type_name() == "ActionSelector") {
+            for (const auto &instance : externType.instances()) {
+                _actionSelectorNames.emplace(instance.preamble().id(), instance.preamble().name());
+            }
+        }
+    }
+}
+
+const p4::config::v1::P4Info &P4InfoIndex::p4Info() const { return _p4Info; }
+
+const P4InfoTable *P4InfoIndex::findTable(P4::ControlPlaneAPI::p4rt_id_t tableId) const {
+    auto it = _tables.find(tableId);
+    return it != _tables.end() ? &it->second : nullptr;
+}
+
+const P4InfoTable *P4InfoIndex::findTable(cstring tableName) const {
+    auto it = _tableIds.find(tableName);
+    return it != _tableIds.end() ? findTable(it->second) : nullptr;
+}
+
+const P4InfoAction *P4InfoIndex::findAction(P4::ControlPlaneAPI::p4rt_id_t actionId) const {
+    auto it = _actions.find(actionId);
+    return it != _actions.end() ? &it->second : nullptr;
+}
+
+const P4InfoValueSet *P4InfoIndex::findValueSet(P4::ControlPlaneAPI::p4rt_id_t valueSetId) const {
+    auto it = _valueSets.find(valueSetId);
+    return it != _valueSets.end() ? &it->second : nullptr;
+}
+
+std::optional<cstring> P4InfoIndex::findActionProfileName(
+    P4::ControlPlaneAPI::p4rt_id_t id) const {
+    auto it = _actionProfileNames.find(id);
+    if (it == _actionProfileNames.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<cstring> P4InfoIndex::findActionSelectorName(
+    P4::ControlPlaneAPI::p4rt_id_t id) const {
+    auto it = _actionSelectorNames.find(id);
+    if (it == _actionSelectorNames.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+}  // namespace P4::P4Tools::Flay
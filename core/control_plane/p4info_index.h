@@ -0,0 +1,182 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_P4INFO_INDEX_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_P4INFO_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "control-plane/p4RuntimeArchHandler.h"
+#include "ir/ir.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include "p4/config/v1/p4info.pb.h"
+#pragma GCC diagnostic pop
+
+namespace P4::P4Tools::Flay {
+
+/// A match field of a table key with its IR type and the control plane symbols it is encoded
+/// with. The symbols do not depend on the table entry and are created once per field.
+struct P4InfoMatchField {
+    /// The P4Info description of the match field.
+    std::reference_wrapper<const p4::config::v1::MatchField> matchField;
+
+    /// The control plane name of the match field.
+    cstring name;
+
+    /// The type of the key.
+    const IR::Type_Bits *type;
+
+    /// The match kind declared in the P4Info.
+    p4::config::v1::MatchField::MatchType matchType;
+
+    /// The symbol of the key value.
+    const IR::SymbolicVariable *keySymbol;
+
+    /// The symbol of the ternary and optional mask.
+    const IR::SymbolicVariable *maskSymbol;
+
+    /// The symbol of the LPM prefix length.
+    const IR::SymbolicVariable *lpmPrefixSymbol;
+
+    /// The symbols of the lower and upper range bound.
+    std::pair<const IR::SymbolicVariable *, const IR::SymbolicVariable *> rangeSymbols;
+};
+
+/// A table of the P4Info with its precomputed key layout.
+struct P4InfoTable {
+    /// The P4Info description of the table.
+    std::reference_wrapper<const p4::config::v1::Table> table;
+
+    /// The control plane name of the table.
+    cstring name;
+
+    /// The match fields of the key in P4Info order.
+    std::vector<P4InfoMatchField> keyLayout;
+
+    /// Maps the id of a match field to its position in the key layout.
+    absl::flat_hash_map<P4::ControlPlaneAPI::p4rt_id_t, size_t> matchFieldPositions;
+
+    /// @returns the position of the match field with @param fieldId in the key layout or
+    /// std::nullopt if the table has no such field.
+    [[nodiscard]] std::optional<size_t> findMatchFieldPosition(
+        P4::ControlPlaneAPI::p4rt_id_t fieldId) const;
+};
+
+/// A parameter of a P4Info action.
+struct P4InfoActionParam {
+    /// The P4Info description of the parameter.
+    std::reference_wrapper<const p4::config::v1::Action_Param> param;
+
+    /// The control plane name of the parameter.
+    cstring name;
+
+    /// The type of the parameter.
+    const IR::Type_Bits *type;
+};
+
+/// An action of the P4Info.
+struct P4InfoAction {
+    /// The P4Info description of the action.
+    std::reference_wrapper<const p4::config::v1::Action> action;
+
+    /// The control plane name of the action.
+    cstring name;
+
+    /// The literal the action choice of a table is assigned when this action is selected.
+    const IR::StringLiteral *nameLiteral;
+
+    /// Maps the id of a parameter to its description.
+    absl::flat_hash_map<P4::ControlPlaneAPI::p4rt_id_t, P4InfoActionParam> params;
+
+    /// @returns the parameter with @param paramId or nullptr if the action has no such parameter.
+    [[nodiscard]] const P4InfoActionParam *findParam(P4::ControlPlaneAPI::p4rt_id_t paramId) const;
+};
+
+/// A parser value set of the P4Info.
+struct P4InfoValueSet {
+    /// The P4Info description of the parser value set.
+    std::reference_wrapper<const p4::config::v1::ValueSet> valueSet;
+
+    /// The control plane name of the parser value set.
+    cstring name;
+
+    /// The types of the fields of a member in P4Info order.
+    std::vector<const IR::Type_Bits *> fieldTypes;
+
+    /// Maps the id of a match field to its position in the field types.
+    absl::flat_hash_map<P4::ControlPlaneAPI::p4rt_id_t, size_t> fieldPositions;
+
+    /// @returns the position of the match field with @param fieldId or std::nullopt if the value
+    /// set has no such field.
+    [[nodiscard]] std::optional<size_t> findFieldPosition(
+        P4::ControlPlaneAPI::p4rt_id_t fieldId) const;
+};
+
+/// Indexes the objects of a P4Info by their P4Runtime id. The P4Runtime and BfRuntime Protobuf
+/// front ends look up the table, action, and match fields of every control plane update. Building
+/// this index once per program replaces the linear scans of the P4Info with hash lookups.
+/// The index references the P4Info, which must outlive it.
+class P4InfoIndex {
+ private:
+    /// The indexed P4Info.
+    std::reference_wrapper<const p4::config::v1::P4Info> _p4Info;
+
+    /// The tables by id.
+    absl::flat_hash_map<P4::ControlPlaneAPI::p4rt_id_t, P4InfoTable> _tables;
+
+    /// The table ids by control plane name.
+    absl::flat_hash_map<cstring, P4::ControlPlaneAPI::p4rt_id_t> _tableIds;
+
+    /// The actions by id.
+    absl::flat_hash_map<P4::ControlPlaneAPI::p4rt_id_t, P4InfoAction> _actions;
+
+    /// The parser value sets by id.
+    absl::flat_hash_map<P4::ControlPlaneAPI::p4rt_id_t, P4InfoValueSet> _valueSets;
+
+    /// The names of action profiles and ActionProfile extern instances by id.
+    absl::flat_hash_map<P4::ControlPlaneAPI::p4rt_id_t, cstring> _actionProfileNames;
+
+    /// The names of ActionSelector extern instances by id.
+    absl::flat_hash_map<P4::ControlPlaneAPI::p4rt_id_t, cstring> _actionSelectorNames;
+
+ public:
+    explicit P4InfoIndex(const p4::config::v1::P4Info &p4Info);
+
+    /// @returns the indexed P4Info.
+    [[nodiscard]] const p4::config::v1::P4Info &p4Info() const;
+
+    /// @returns the table with @param tableId or nullptr if there is no such table.
+    [[nodiscard]] const P4InfoTable *findTable(P4::ControlPlaneAPI::p4rt_id_t tableId) const;
+
+    /// @returns the table with the control plane name @param tableName or nullptr if there is no
+    /// such table.
+    [[nodiscard]] const P4InfoTable *findTable(cstring tableName) const;
+
+    /// @returns the action with @param actionId or nullptr if there is no such action.
+    [[nodiscard]] const P4InfoAction *findAction(P4::ControlPlaneAPI::p4rt_id_t actionId) const;
+
+    /// @returns the parser value set with @param valueSetId or nullptr if there is no such value
+    /// set.
+    [[nodiscard]] const P4InfoValueSet *findValueSet(
+        P4::ControlPlaneAPI::p4rt_id_t valueSetId) const;
+
+    /// @returns the name of the action profile with @param id or std::nullopt if there is no such
+    /// action profile.
+    [[nodiscard]] std::optional<cstring> findActionProfileName(
+        P4::ControlPlaneAPI::p4rt_id_t id) const;
+
+    /// @returns the name of the action selector with @param id or std::nullopt if there is no
+    /// such action selector.
+    [[nodiscard]] std::optional<cstring> findActionSelectorName(
+        P4::ControlPlaneAPI::p4rt_id_t id) const;
+};
+
+}  // namespace P4::P4Tools::Flay
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_P4INFO_INDEX_H_ */
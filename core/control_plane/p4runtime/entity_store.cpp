@@ -0,0 +1,178 @@
+#include "backends/p4tools/modules/flay/core/control_plane/p4runtime/entity_store.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace P4::P4Tools::Flay::P4Runtime {
+
+namespace {
+
+/// @returns the key prefix shared by all entities of @param kind in the object with @param id.
+std::string objectPrefix(const char *kind, uint32_t id) {
+    return std::string(kind) + "/" + std::to_string(id) + "/";
+}
+
+/// @returns the key of @param tableEntry. Entries are identified by their table, priority, and
+/// match fields. The order of the match fields in the message does not matter.
+std::string tableEntryKey(const p4::v1::TableEntry &tableEntry) {
+    auto key = objectPrefix("table", tableEntry.table_id());
+    if (tableEntry.is_default_action()) {
+        return key + "default";
+    }
+    std::vector<const p4::v1::FieldMatch *> matches;
+    for (const auto &match : tableEntry.match()) {
+        matches.push_back(&match);
+    }
+    std::sort(matches.begin(), matches.end(), [](const auto *left, const auto *right) {
+        return left->field_id() < right->field_id();
+    });
+    key += std::to_string(tableEntry.priority());
+    for (const auto *match : matches) {
+        key += "/" + std::to_string(match->field_id()) + ":" + match->SerializeAsString();
+    }
+    return key;
+}
+
+/// @returns the key of @param entity or std::nullopt if the entity kind is not stored.
+std::optional<std::string> entityKey(const p4::v1::Entity &entity) {
+    switch (entity.entity_case()) {
+        case p4::v1::Entity::kTableEntry:
+            return tableEntryKey(entity.table_entry());
+        case p4::v1::Entity::kActionProfileMember: {
+            const auto &member = entity.action_profile_member();
+            return objectPrefix("member", member.action_profile_id()) +
+                   std::to_string(member.member_id());
+        }
+        case p4::v1::Entity::kActionProfileGroup: {
+            const auto &group = entity.action_profile_group();
+            return objectPrefix("group", group.action_profile_id()) +
+                   std::to_string(group.group_id());
+        }
+        case p4::v1::Entity::kValueSetEntry:
+            return objectPrefix("value_set", entity.value_set_entry().value_set_id());
+        default:
+            return std::nullopt;
+    }
+}
+
+/// @returns the key prefix which selects the entities matching the wildcard @param filter, or
+/// std::nullopt if the filter identifies a single entity.
+std::optional<std::string> filterPrefix(const p4::v1::Entity &filter) {
+    switch (filter.entity_case()) {
+        case p4::v1::Entity::kTableEntry: {
+            const auto &tableEntry = filter.table_entry();
+            if (tableEntry.table_id() == 0) {
+                return "table/";
+            }
+            if (tableEntry.match().empty() && !tableEntry.is_default_action()) {
+                return objectPrefix("table", tableEntry.table_id());
+            }
+            return std::nullopt;
+        }
+        case p4::v1::Entity::kActionProfileMember: {
+            const auto &member = filter.action_profile_member();
+            if (member.action_profile_id() == 0) {
+                return "member/";
+            }
+            if (member.member_id() == 0) {
+                return objectPrefix("member", member.action_profile_id());
+            }
+            return std::nullopt;
+        }
+        case p4::v1::Entity::kActionProfileGroup: {
+            const auto &group = filter.action_profile_group();
+            if (group.action_profile_id() == 0) {
+                return "group/";
+            }
+            if (group.group_id() == 0) {
+                return objectPrefix("group", group.action_profile_id());
+            }
+            return std::nullopt;
+        }
+        case p4::v1::Entity::kValueSetEntry:
+            if (filter.value_set_entry().value_set_id() == 0) {
+                return "value_set/";
+            }
+            return std::nullopt;
+        default:
+            return std::nullopt;
+    }
+}
+
+}  // namespace
+
+void EntityStore::apply(const p4::v1::Update &update) {
+    auto key = entityKey(update.entity());
+    if (!key.has_value()) {
+        return;
+    }
+    switch (update.type()) {
+        case p4::v1::Update::INSERT:
+        case p4::v1::Update::MODIFY:
+            _entities[key.value()] = update.entity();
+            return;
+        case p4::v1::Update::DELETE:
+            if (_entities.erase(key.value()) == 0) {
+                _deletedEntities.emplace(key.value(), update.entity());
+            }
+            return;
+        default:
+            return;
+    }
+}
+
+std::vector<p4::v1::Entity> EntityStore::read(const p4::v1::Entity &filter) const {
+    std::vector<p4::v1::Entity> entities;
+    auto prefix = filterPrefix(filter);
+    if (prefix.has_value()) {
+        for (auto it = _entities.lower_bound(prefix.value());
+             it != _entities.end() && it->first.compare(0, prefix->size(), prefix.value()) == 0;
+             ++it) {
+            entities.push_back(it->second);
+        }
+        return entities;
+    }
+    auto key = entityKey(filter);
+    if (!key.has_value()) {
+        return entities;
+    }
+    auto it = _entities.find(key.value());
+    if (it != _entities.end()) {
+        entities.push_back(it->second);
+    }
+    return entities;
+}
+
+bool EntityStore::contains(const p4::v1::Entity &entity) const {
+    auto key = entityKey(entity);
+    return key.has_value() && _entities.find(key.value()) != _entities.end();
+}
+
+p4::v1::WriteRequest EntityStore::toWriteRequest() const {
+    p4::v1::WriteRequest request;
+    auto addUpdates = [&request](const std::map<std::string, p4::v1::Entity> &entities,
+                                 const char *prefix, p4::v1::Update::Type type) {
+        std::string_view prefixView(prefix);
+        for (auto it = entities.lower_bound(prefix);
+             it != entities.end() && it->first.compare(0, prefixView.size(), prefixView) == 0;
+             ++it) {
+            auto *update = request.add_updates();
+            update->set_type(type);
+            *update->mutable_entity() = it->second;
+        }
+    };
+    // Delete in the reverse order of the references, so no entity is deleted while in use.
+    for (const auto *prefix : {"table/", "group/", "member/", "value_set/"}) {
+        addUpdates(_deletedEntities, prefix, p4::v1::Update::DELETE);
+    }
+    for (const auto *prefix : {"member/", "group/", "value_set/", "table/"}) {
+        addUpdates(_entities, prefix, p4::v1::Update::MODIFY);
+    }
+    return request;
+}
+
+size_t EntityStore::size() const { return _entities.size(); }
+
+}  // namespace P4::P4Tools::Flay::P4Runtime
@@ -0,0 +1,59 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_P4RUNTIME_ENTITY_STORE_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_P4RUNTIME_ENTITY_STORE_H_
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include "p4/v1/p4runtime.pb.h"
+#pragma GCC diagnostic pop
+
+namespace P4::P4Tools::Flay::P4Runtime {
+
+/// Mirrors the P4Runtime entities which have been written to Flay, so read requests can be
+/// answered without consulting the control plane constraints or the solver. The constraints
+/// only keep the symbolic assignments of each entity, which loses the original encoding of
+/// values and ids, so reads are served from the written messages instead.
+///
+/// Table entries, action profile members and groups, and parser value sets are stored. Flay
+/// does not model the remaining entity kinds, so they are ignored.
+class EntityStore {
+    /// The stored entities, keyed by their kind and the fields which identify them. The key
+    /// starts with the kind and the id of the containing P4 object, so all entities of one
+    /// object are adjacent.
+    std::map<std::string, p4::v1::Entity> _entities;
+
+    /// Entities which were deleted without having been written before. These were installed by
+    /// the program or the configuration file, so they can not be restored from _entities.
+    std::map<std::string, p4::v1::Entity> _deletedEntities;
+
+ public:
+    /// Apply @param update to the store. Insertions and modifications overwrite the entity with
+    /// the same key, deletions remove it. Writing a parser value set replaces the whole set.
+    void apply(const p4::v1::Update &update);
+
+    /// @returns the stored entities which match @param filter. Follows the wildcard semantics of
+    /// P4Runtime reads: an id of zero matches all objects of the kind of the filter. Table entry
+    /// filters without match fields return all entries of the table.
+    [[nodiscard]] std::vector<p4::v1::Entity> read(const p4::v1::Entity &filter) const;
+
+    /// @returns true if an entity with the same key as @param entity is stored.
+    [[nodiscard]] bool contains(const p4::v1::Entity &entity) const;
+
+    /// @returns a write request which brings a control plane with the initial entries of the
+    /// program into the state of the store. It first deletes the initial entities which have been
+    /// deleted, then writes the stored entities with MODIFY. Action profile members precede the
+    /// groups and table entries which may refer to them.
+    [[nodiscard]] p4::v1::WriteRequest toWriteRequest() const;
+
+    /// @returns the number of stored entities.
+    [[nodiscard]] size_t size() const;
+};
+
+}  // namespace P4::P4Tools::Flay::P4Runtime
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_P4RUNTIME_ENTITY_STORE_H_ */
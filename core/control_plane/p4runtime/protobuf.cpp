@@ -5,14 +5,16 @@
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
+#include <functional>
+#include <map>
 #include <optional>
+#include <set>
+#include <vector>
 
 #include "backends/p4tools/common/control_plane/symbolic_variables.h"
 #include "backends/p4tools/modules/flay/core/control_plane/control_plane_item.h"
 #include "backends/p4tools/modules/flay/core/control_plane/control_plane_objects.h"
 #include "backends/p4tools/modules/flay/core/control_plane/protobuf_utils.h"
-#include "control-plane/p4RuntimeArchHandler.h"
-#include "control-plane/p4infoApi.h"
 #include "ir/irutils.h"
 
 #pragma GCC diagnostic push
@@ -30,11 +32,10 @@ namespace {
 /// assignments.
 /// @param symbolSet tracks the symbols used in this conversion.
 std::optional<ControlPlaneAssignmentSet> produceTableMatch(
-    const p4::v1::FieldMatch &field, cstring tableName,
-    const p4::config::v1::MatchField &matchField, SymbolSet &symbolSet) {
+    const p4::v1::FieldMatch &field, const P4InfoMatchField &matchField, SymbolSet &symbolSet) {
     ControlPlaneAssignmentSet tableKeySet;
-    const auto *keyType = IR::Type_Bits::get(matchField.bitwidth());
-    const auto *keySymbol = ControlPlaneState::getTableKey(tableName, matchField.name(), keyType);
+    const auto *keyType = matchField.type;
+    const auto *keySymbol = matchField.keySymbol;
     symbolSet.emplace(*keySymbol);
     switch (field.field_match_type_case()) {
         case p4::v1::FieldMatch::kExact: {
@@ -43,8 +44,7 @@ std::optional<ControlPlaneAssignmentSet> produceTableMatch(
             return tableKeySet;
         }
         case p4::v1::FieldMatch::kLpm: {
-            const auto *lpmPrefixSymbol =
-                ControlPlaneState::getTableMatchLpmPrefix(tableName, matchField.name(), keyType);
+            const auto *lpmPrefixSymbol = matchField.lpmPrefixSymbol;
             symbolSet.emplace(*lpmPrefixSymbol);
             auto value = Protobuf::stringToBigInt(field.lpm().value());
             int prefix = field.lpm().prefix_len();
@@ -53,8 +53,7 @@ std::optional<ControlPlaneAssignmentSet> produceTableMatch(
             return tableKeySet;
         }
         case p4::v1::FieldMatch::kTernary: {
-            const auto *maskSymbol =
-                ControlPlaneState::getTableTernaryMask(tableName, matchField.name(), keyType);
+            const auto *maskSymbol = matchField.maskSymbol;
             symbolSet.emplace(*maskSymbol);
             auto value = Protobuf::stringToBigInt(field.ternary().value());
             auto mask = Protobuf::stringToBigInt(field.ternary().mask());
@@ -63,8 +62,7 @@ std::optional<ControlPlaneAssignmentSet> produceTableMatch(
             return tableKeySet;
         }
         case p4::v1::FieldMatch::kRange: {
-            const auto &[rangeMinSymbol, rangeMaxSymbol] =
-                Bmv2ControlPlaneState::getTableRange(tableName, matchField.name(), keyType);
+            const auto &[rangeMinSymbol, rangeMaxSymbol] = matchField.rangeSymbols;
             symbolSet.emplace(*rangeMinSymbol);
             symbolSet.emplace(*rangeMaxSymbol);
             auto low = Protobuf::stringToBigInt(field.range().low());
@@ -88,27 +86,23 @@ std::optional<ControlPlaneAssignmentSet> produceTableMatch(
 /// message.
 /// @param symbolSet tracks the symbols used in this conversion.
 std::optional<ControlPlaneAssignmentSet> produceTableMatchForMissingField(
-    cstring tableName, const p4::config::v1::MatchField &matchField, SymbolSet &symbolSet) {
+    const P4InfoMatchField &matchField, SymbolSet &symbolSet) {
     ControlPlaneAssignmentSet tableKeySet;
-    const auto *keyType = IR::Type_Bits::get(matchField.bitwidth());
-    const auto *keySymbol = ControlPlaneState::getTableKey(tableName, matchField.name(), keyType);
+    const auto *keyType = matchField.type;
+    const auto *keySymbol = matchField.keySymbol;
     symbolSet.emplace(*keySymbol);
-    switch (matchField.match_type()) {
+    switch (matchField.matchType) {
         /// We can convert missing ternary and optional fields to 0.
         case p4::config::v1::MatchField::TERNARY:
         case p4::config::v1::MatchField::OPTIONAL: {
-            const auto *keySymbol =
-                ControlPlaneState::getTableKey(tableName, matchField.name(), keyType);
-            const auto *maskSymbol =
-                ControlPlaneState::getTableTernaryMask(tableName, matchField.name(), keyType);
-            symbolSet.emplace(*keySymbol);
+            const auto *maskSymbol = matchField.maskSymbol;
             symbolSet.emplace(*maskSymbol);
             tableKeySet.emplace(*keySymbol, *IR::Constant::get(keyType, 0));
             tableKeySet.emplace(*maskSymbol, *IR::Constant::get(keyType, 0));
             return tableKeySet;
         }
         default:
-            error("Unsupported match type %1%.", matchField.DebugString());
+            error("Unsupported match type %1%.", matchField.matchField.get().DebugString());
     }
     return std::nullopt;
 }
@@ -118,109 +112,212 @@ std::optional<ControlPlaneAssignmentSet> produceTableMatchForMissingField(
 /// specialized towards overriding a default action in a table.
 std::optional<ControlPlaneAssignmentSet> convertTableAction(const p4::v1::Action &tblAction,
                                                             cstring tableName,
-                                                            const p4::config::v1::Action &p4Action,
+                                                            const P4InfoAction &p4Action,
                                                             SymbolSet &symbolSet,
                                                             bool isDefaultAction) {
     const IR::SymbolicVariable *tableActionID =
         isDefaultAction ? ControlPlaneState::getDefaultActionVariable(tableName)
                         : ControlPlaneState::getTableActionChoice(tableName);
     symbolSet.emplace(*tableActionID);
-    auto actionName = p4Action.preamble().name();
-    const auto *actionAssignment = IR::StringLiteral::get(actionName);
+    auto actionName = p4Action.name;
     ControlPlaneAssignmentSet tableActionAssignmentSet;
-    tableActionAssignmentSet.emplace(*tableActionID, *actionAssignment);
-    if (tblAction.params().size() != p4Action.params().size()) {
+    tableActionAssignmentSet.emplace(*tableActionID, *p4Action.nameLiteral);
+    if (static_cast<size_t>(tblAction.params().size()) != p4Action.params.size()) {
         return tableActionAssignmentSet;
     }
-    RETURN_IF_FALSE_WITH_MESSAGE(tblAction.params().size() == p4Action.params().size(),
-                                 std::nullopt,
-                                 error("Action configuration \"%1%\" and target action \"%2%\" "
-                                       "have parameters of different number.",
-                                       p4Action.ShortDebugString(), tblAction.ShortDebugString()));
-    std::map<uint32_t, const p4::config::v1::Action_Param *> paramMap;
-    for (const auto &param : p4Action.params()) {
-        paramMap.emplace(param.id(), &param);
-    }
     for (const auto &paramConfig : tblAction.params()) {
-        auto paramIt = paramMap.find(paramConfig.param_id());
-        RETURN_IF_FALSE_WITH_MESSAGE(
-            paramIt != paramMap.end(), std::nullopt,
+        ASSIGN_OR_RETURN_WITH_MESSAGE(
+            const auto &param, p4Action.findParam(paramConfig.param_id()), std::nullopt,
             error("Parameter %1% of action %2% not found.", paramConfig.DebugString(), actionName));
-        const auto *paramType = IR::Type_Bits::get(paramIt->second->bitwidth());
-        auto paramName = paramIt->second->name();
-        const auto *actionArg =
-            ControlPlaneState::getTableActionArgument(tableName, actionName, paramName, paramType);
+        const auto *actionArg = ControlPlaneState::getTableActionArgument(
+            tableName, actionName, param.name, param.type);
         symbolSet.emplace(*actionArg);
         const auto *actionVal =
-            IR::Constant::get(paramType, Protobuf::stringToBigInt(paramConfig.value()));
+            IR::Constant::get(param.type, Protobuf::stringToBigInt(paramConfig.value()));
         tableActionAssignmentSet.emplace(*actionArg, *actionVal);
     }
     return tableActionAssignmentSet;
 }
 
-/// Convert a P4Runtime TableEntry into a TableMatchEntry.
-/// Returns std::nullopt if the conversion fails.
-/// @param symbolSet tracks the symbols used in this conversion.
-std::optional<TableMatchEntry *> produceTableEntry(cstring tableName,
-                                                   P4::ControlPlaneAPI::p4rt_id_t tblId,
-                                                   const p4::config::v1::P4Info &p4Info,
-                                                   const p4::v1::TableEntry &tableEntry,
-                                                   SymbolSet &symbolSet) {
-    RETURN_IF_FALSE_WITH_MESSAGE(tableEntry.action().has_action(), std::nullopt,
-                                 error("Table entry %1% has no action.", tableEntry.DebugString()));
+/// Convert a P4Runtime Action into a member of an action profile.
+std::optional<ActionProfileMember> convertActionProfileMember(const P4InfoIndex &p4InfoIndex,
+                                                              const p4::v1::Action &action) {
+    auto actionId = action.action_id();
+    ASSIGN_OR_RETURN_WITH_MESSAGE(auto &p4Action, p4InfoIndex.findAction(actionId), std::nullopt,
+                                  error("Action ID %1% not found in the P4Info.", actionId));
+    std::map<cstring, const IR::Literal *> arguments;
+    // Like table actions, actions with missing parameters leave the arguments unconstrained.
+    if (static_cast<size_t>(action.params().size()) != p4Action.params.size()) {
+        return ActionProfileMember(p4Action.nameLiteral, arguments);
+    }
+    for (const auto &paramConfig : action.params()) {
+        ASSIGN_OR_RETURN_WITH_MESSAGE(
+            const auto &param, p4Action.findParam(paramConfig.param_id()), std::nullopt,
+            error("Parameter %1% of action %2% not found.", paramConfig.DebugString(),
+                  p4Action.name));
+        arguments.emplace(param.name, IR::Constant::get(param.type, Protobuf::stringToBigInt(
+                                                                        paramConfig.value())));
+    }
+    return ActionProfileMember(p4Action.nameLiteral, arguments);
+}
 
-    auto tableAction = tableEntry.action().action();
-    auto actionId = tableAction.action_id();
+/// @returns the action profile with @param actionProfileId. Action profiles which are not
+/// initialized by the target are created on first use and associated with the tables listed in
+/// the P4Info.
+std::optional<ActionProfile *> findActionProfile(const P4InfoIndex &p4InfoIndex,
+                                                 P4::ControlPlaneAPI::p4rt_id_t actionProfileId,
+                                                 ControlPlaneConstraints &controlPlaneConstraints) {
     ASSIGN_OR_RETURN_WITH_MESSAGE(
-        auto &p4Action, P4::ControlPlaneAPI::findP4RuntimeAction(p4Info, actionId), std::nullopt,
-        error("Action ID %1% not found in the P4Info.", actionId));
-    ASSIGN_OR_RETURN(const auto &tableActionAssignmentSet,
-                     convertTableAction(tableAction, tableName, p4Action, symbolSet, false),
-                     std::nullopt);
-    ControlPlaneAssignmentSet tableKeySet;
-    ASSIGN_OR_RETURN_WITH_MESSAGE(
-        auto &p4InfoTable, P4::ControlPlaneAPI::findP4RuntimeTable(p4Info, tblId), std::nullopt,
-        error("Table ID %1% not found in the P4Info.", actionId));
+        auto actionProfileName, p4InfoIndex.findActionProfileName(actionProfileId), std::nullopt,
+        error("Action profile ID %1% not found in the P4Info.", actionProfileId));
+    auto it = controlPlaneConstraints.find(actionProfileName);
+    if (it != controlPlaneConstraints.end()) {
+        if (auto *actionProfile = it->second.get().to<ActionProfile>()) {
+            return actionProfile;
+        }
+        if (auto *actionSelector = it->second.get().to<ActionSelector>()) {
+            return &actionSelector->actionProfile();
+        }
+        error("Configuration result %1% is not an action profile.", actionProfileName);
+        return std::nullopt;
+    }
+    auto *actionProfile = new ActionProfile(actionProfileName);
+    for (const auto &p4InfoActionProfile : p4InfoIndex.p4Info().action_profiles()) {
+        if (p4InfoActionProfile.preamble().id() != actionProfileId) {
+            continue;
+        }
+        for (auto tableId : p4InfoActionProfile.table_ids()) {
+            ASSIGN_OR_RETURN_WITH_MESSAGE(
+                const auto &p4InfoTable, p4InfoIndex.findTable(tableId), std::nullopt,
+                error("Table ID %1% of action profile %2% not found in the P4Info.", tableId,
+                      actionProfileName));
+            actionProfile->addAssociatedTable(p4InfoTable.name);
+        }
+    }
+    controlPlaneConstraints.emplace(actionProfileName, *actionProfile);
+    return actionProfile;
+}
 
+/// Convert the match of a P4Runtime TableEntry into the appropriate symbolic constraint
+/// assignments.
+/// @param symbolSet tracks the symbols used in this conversion.
+std::optional<ControlPlaneAssignmentSet> produceTableKeySet(const P4InfoTable &p4InfoTable,
+                                                            const p4::v1::TableEntry &tableEntry,
+                                                            SymbolSet &symbolSet) {
+    const auto &keyLayout = p4InfoTable.keyLayout;
     RETURN_IF_FALSE_WITH_MESSAGE(
-        tableEntry.match().size() <= p4InfoTable.match_fields().size(), std::nullopt,
+        static_cast<size_t>(tableEntry.match().size()) <= keyLayout.size(), std::nullopt,
         error("Table entry %1% has %2% matches, but P4Info has %3%.", tableEntry.DebugString(),
-              tableEntry.match().size(), p4InfoTable.match_fields().size()));
-    // Use this map to look up which match fields are present in the control plane entry.
-    // TODO: Cache this somehow?
-    auto matchMap = std::map<uint32_t, p4::v1::FieldMatch>();
+              tableEntry.match().size(), keyLayout.size()));
+    // Look up which match fields of the key layout are present in the control plane entry.
+    std::vector<const p4::v1::FieldMatch *> entryMatches(keyLayout.size(), nullptr);
     for (const auto &matchField : tableEntry.match()) {
-        matchMap.emplace(matchField.field_id(), matchField);
+        auto position = p4InfoTable.findMatchFieldPosition(matchField.field_id());
+        if (position.has_value()) {
+            entryMatches[position.value()] = &matchField;
+        }
     }
 
-    for (const auto &p4InfoMatchField : p4InfoTable.match_fields()) {
-        auto matchFieldIt = matchMap.find(p4InfoMatchField.id());
+    ControlPlaneAssignmentSet tableKeySet;
+    for (size_t position = 0; position < keyLayout.size(); ++position) {
+        const auto &p4InfoMatchField = keyLayout[position];
         std::optional<ControlPlaneAssignmentSet> matchSetOpt;
         // If we are missing a match entry, create the dummy entry for supported fields.
-        if (matchFieldIt == matchMap.end()) {
-            matchSetOpt = produceTableMatchForMissingField(tableName, p4InfoMatchField, symbolSet);
+        if (entryMatches[position] == nullptr) {
+            matchSetOpt = produceTableMatchForMissingField(p4InfoMatchField, symbolSet);
         } else {
-            matchSetOpt =
-                produceTableMatch(matchFieldIt->second, tableName, p4InfoMatchField, symbolSet);
+            matchSetOpt = produceTableMatch(*entryMatches[position], p4InfoMatchField, symbolSet);
         }
         ASSIGN_OR_RETURN(auto matchSet, matchSetOpt, std::nullopt);
         tableKeySet.insert(matchSet.begin(), matchSet.end());
     }
+    return tableKeySet;
+}
 
-    return new TableMatchEntry(tableActionAssignmentSet, tableEntry.priority(), tableKeySet);
+/// Convert a P4Runtime TableEntry into a TableMatchEntry.
+/// Returns std::nullopt if the conversion fails.
+/// @param symbolSet tracks the symbols used in this conversion.
+std::optional<TableMatchEntry *> produceTableEntry(const P4InfoIndex &p4InfoIndex,
+                                                   const P4InfoTable &p4InfoTable,
+                                                   const p4::v1::TableEntry &tableEntry,
+                                                   ControlPlaneConstraints &controlPlaneConstraints,
+                                                   SymbolSet &symbolSet) {
+    ASSIGN_OR_RETURN(auto tableKeySet, produceTableKeySet(p4InfoTable, tableEntry, symbolSet),
+                     std::nullopt);
+    cstring tableName = p4InfoTable.name;
+    const auto &tableAction = tableEntry.action();
+    switch (tableAction.type_case()) {
+        case p4::v1::TableAction::kAction: {
+            auto actionId = tableAction.action().action_id();
+            ASSIGN_OR_RETURN_WITH_MESSAGE(
+                auto &p4Action, p4InfoIndex.findAction(actionId), std::nullopt,
+                error("Action ID %1% not found in the P4Info.", actionId));
+            ASSIGN_OR_RETURN(
+                const auto &tableActionAssignmentSet,
+                convertTableAction(tableAction.action(), tableName, p4Action, symbolSet, false),
+                std::nullopt);
+            return new TableMatchEntry(tableActionAssignmentSet, tableEntry.priority(),
+                                       tableKeySet);
+        }
+        case p4::v1::TableAction::kActionProfileMemberId:
+        case p4::v1::TableAction::kActionProfileGroupId: {
+            ASSIGN_OR_RETURN(auto *actionProfile,
+                             findActionProfile(p4InfoIndex,
+                                               p4InfoTable.table.get().implementation_id(),
+                                               controlPlaneConstraints),
+                             std::nullopt);
+            ActionProfileReference reference =
+                tableAction.has_action_profile_member_id()
+                    ? ActionProfileReference{ActionProfileReference::Kind::kMember,
+                                             tableAction.action_profile_member_id()}
+                    : ActionProfileReference{ActionProfileReference::Kind::kGroup,
+                                             tableAction.action_profile_group_id()};
+            ASSIGN_OR_RETURN_WITH_MESSAGE(
+                auto actionAssignment, actionProfile->computeActionAssignment(tableName, reference),
+                std::nullopt,
+                error("Table entry %1% refers to a member or group which does not exist.",
+                      tableEntry.ShortDebugString()));
+            for (const auto &assignment : actionAssignment) {
+                symbolSet.emplace(assignment.first);
+            }
+            return new ActionProfileTableMatchEntry(reference, actionAssignment,
+                                                    tableEntry.priority(), tableKeySet);
+        }
+        case p4::v1::TableAction::kActionProfileActionSet: {
+            // One-shot action selector programming. The set is not shared with other entries.
+            std::vector<ActionProfileMember> members;
+            for (const auto &profileAction :
+                 tableAction.action_profile_action_set().action_profile_actions()) {
+                ASSIGN_OR_RETURN(auto member,
+                                 convertActionProfileMember(p4InfoIndex, profileAction.action()),
+                                 std::nullopt);
+                members.push_back(member);
+            }
+            std::vector<std::reference_wrapper<const ActionProfileMember>> memberReferences(
+                members.begin(), members.end());
+            auto actionAssignment =
+                ActionProfile::computeActionSetAssignment(tableName, memberReferences);
+            for (const auto &assignment : actionAssignment) {
+                symbolSet.emplace(assignment.first);
+            }
+            return new TableMatchEntry(actionAssignment, tableEntry.priority(), tableKeySet);
+        }
+        default:
+            error("Table entry %1% has no action.", tableEntry.DebugString());
+    }
+    return std::nullopt;
 }
 
 /// Convert a P4Runtime TableEntry into the appropriate symbolic constraint
 /// assignments.
 /// @param symbolSet tracks the symbols used in this conversion.
-int updateTableEntry(const p4::config::v1::P4Info &p4Info, const p4::v1::TableEntry &tableEntry,
+int updateTableEntry(const P4InfoIndex &p4InfoIndex, const p4::v1::TableEntry &tableEntry,
                      ControlPlaneConstraints &controlPlaneConstraints,
                      const ::p4::v1::Update_Type &updateType, SymbolSet &symbolSet) {
     auto tblId = tableEntry.table_id();
-    ASSIGN_OR_RETURN_WITH_MESSAGE(
-        auto &p4Table, P4::ControlPlaneAPI::findP4RuntimeTable(p4Info, tblId), EXIT_FAILURE,
-        error("Table ID %1% not found in the P4Info.", tblId));
-    cstring tableName = p4Table.preamble().name();
+    ASSIGN_OR_RETURN_WITH_MESSAGE(auto &p4InfoTable, p4InfoIndex.findTable(tblId), EXIT_FAILURE,
+                                  error("Table ID %1% not found in the P4Info.", tblId));
+    cstring tableName = p4InfoTable.name;
 
     auto it = controlPlaneConstraints.find(tableName);
     RETURN_IF_FALSE_WITH_MESSAGE(
@@ -233,25 +330,27 @@ int updateTableEntry(const p4::config::v1::P4Info &p4Info, const p4::v1::TableEn
         auto &tableResult, it->second.get().to<TableConfiguration>(), EXIT_FAILURE,
         error("Configuration result is not a TableConfiguration.", tableName));
 
+    // The table configuration is only changed once the whole entry has been converted, so a
+    // rejected entry leaves the control plane constraints unchanged.
+    std::optional<TableDefaultAction> defaultTableAction;
     if (tableEntry.is_default_action()) {
-        auto defaultAction = tableEntry.action().action();
+        const auto &defaultAction = tableEntry.action().action();
         ASSIGN_OR_RETURN_WITH_MESSAGE(
-            auto &p4Action,
-            P4::ControlPlaneAPI::findP4RuntimeAction(p4Info, defaultAction.action_id()),
-            EXIT_FAILURE,
+            auto &p4Action, p4InfoIndex.findAction(defaultAction.action_id()), EXIT_FAILURE,
             error("Action ID %1% not found in the P4Info.", defaultAction.action_id()));
         ASSIGN_OR_RETURN(auto defaultActionExpr,
                          convertTableAction(defaultAction, tableName, p4Action, symbolSet, true),
                          EXIT_FAILURE);
-        tableResult.setDefaultTableAction(TableDefaultAction(defaultActionExpr));
+        defaultTableAction = TableDefaultAction(defaultActionExpr);
     }
 
     RETURN_IF_FALSE_WITH_MESSAGE(
-        !p4Table.is_const_table(), EXIT_FAILURE,
+        !p4InfoTable.table.get().is_const_table(), EXIT_FAILURE,
         error("Trying to insert an entry into table '%1%', which is a const table.", tableName));
 
     ASSIGN_OR_RETURN(auto *tableMatchEntry,
-                     produceTableEntry(tableName, tblId, p4Info, tableEntry, symbolSet),
+                     produceTableEntry(p4InfoIndex, p4InfoTable, tableEntry,
+                                       controlPlaneConstraints, symbolSet),
                      EXIT_FAILURE);
 
     if (updateType == p4::v1::Update::MODIFY) {
@@ -270,19 +369,227 @@ int updateTableEntry(const p4::config::v1::P4Info &p4Info, const p4::v1::TableEn
         return EXIT_FAILURE;
     }
 
+    if (defaultTableAction.has_value()) {
+        tableResult.setDefaultTableAction(defaultTableAction.value());
+    }
+    return EXIT_SUCCESS;
+}
+
+/// Convert a P4Runtime ActionProfileMember into a member of the respective action profile and
+/// update all table entries which refer to the member.
+/// @param symbolSet tracks the symbols used in this conversion.
+int updateActionProfileMember(const P4InfoIndex &p4InfoIndex,
+                              const p4::v1::ActionProfileMember &profileMember,
+                              ControlPlaneConstraints &controlPlaneConstraints,
+                              const ::p4::v1::Update_Type &updateType, SymbolSet &symbolSet) {
+    ASSIGN_OR_RETURN(auto *actionProfile,
+                     findActionProfile(p4InfoIndex, profileMember.action_profile_id(),
+                                       controlPlaneConstraints),
+                     EXIT_FAILURE);
+    auto memberId = profileMember.member_id();
+    auto references = actionProfile->referencesToMember(memberId);
+
+    if (updateType == p4::v1::Update::DELETE) {
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            !actionProfile->isReferenced(controlPlaneConstraints, references) &&
+                references.size() == 1,
+            EXIT_FAILURE,
+            error("Member %1% of action profile %2% is still in use and can not be deleted.",
+                  memberId, actionProfile->name()));
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            actionProfile->deleteMember(memberId) != 0, EXIT_FAILURE,
+            error("Member %1% of action profile %2% not found and can not be deleted.", memberId,
+                  actionProfile->name()));
+        return EXIT_SUCCESS;
+    }
+
+    ASSIGN_OR_RETURN(auto member, convertActionProfileMember(p4InfoIndex, profileMember.action()),
+                     EXIT_FAILURE);
+    std::optional<ActionProfileMember> previousMember;
+    if (const auto *currentMember = actionProfile->findMember(memberId)) {
+        previousMember = *currentMember;
+    }
+    if (updateType == p4::v1::Update::MODIFY) {
+        actionProfile->addMember(memberId, member, true);
+    } else if (updateType == p4::v1::Update::INSERT) {
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            actionProfile->addMember(memberId, member, false) == EXIT_SUCCESS, EXIT_FAILURE,
+            error("Member %1% of action profile %2% already exists.", memberId,
+                  actionProfile->name()));
+    } else {
+        error("Unsupported update type %1%.", updateType);
+        return EXIT_FAILURE;
+    }
+    // Only the entries which refer to the member or a group containing it change.
+    if (actionProfile->updateAssociatedTables(controlPlaneConstraints, references, symbolSet) !=
+        EXIT_SUCCESS) {
+        actionProfile->restoreMember(controlPlaneConstraints, memberId, previousMember);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/// Convert a P4Runtime ActionProfileGroup into a group of the respective action profile and
+/// update all table entries which refer to the group.
+/// @param symbolSet tracks the symbols used in this conversion.
+int updateActionProfileGroup(const P4InfoIndex &p4InfoIndex,
+                             const p4::v1::ActionProfileGroup &profileGroup,
+                             ControlPlaneConstraints &controlPlaneConstraints,
+                             const ::p4::v1::Update_Type &updateType, SymbolSet &symbolSet) {
+    ASSIGN_OR_RETURN(auto *actionProfile,
+                     findActionProfile(p4InfoIndex, profileGroup.action_profile_id(),
+                                       controlPlaneConstraints),
+                     EXIT_FAILURE);
+    auto groupId = profileGroup.group_id();
+    std::set<ActionProfileReference> references{{ActionProfileReference::Kind::kGroup, groupId}};
+
+    if (updateType == p4::v1::Update::DELETE) {
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            !actionProfile->isReferenced(controlPlaneConstraints, references), EXIT_FAILURE,
+            error("Group %1% of action profile %2% is still in use and can not be deleted.",
+                  groupId, actionProfile->name()));
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            actionProfile->deleteGroup(groupId) != 0, EXIT_FAILURE,
+            error("Group %1% of action profile %2% not found and can not be deleted.", groupId,
+                  actionProfile->name()));
+        return EXIT_SUCCESS;
+    }
+
+    std::set<uint32_t> memberIds;
+    for (const auto &member : profileGroup.members()) {
+        memberIds.insert(member.member_id());
+    }
+    RETURN_IF_FALSE_WITH_MESSAGE(
+        updateType == p4::v1::Update::MODIFY || updateType == p4::v1::Update::INSERT,
+        EXIT_FAILURE, error("Unsupported update type %1%.", updateType));
+    std::optional<std::set<uint32_t>> previousGroup;
+    if (const auto *currentGroup = actionProfile->findGroup(groupId)) {
+        previousGroup = *currentGroup;
+    }
+    RETURN_IF_FALSE_WITH_MESSAGE(
+        actionProfile->addGroup(groupId, memberIds, updateType == p4::v1::Update::MODIFY) ==
+            EXIT_SUCCESS,
+        EXIT_FAILURE,
+        error("Group %1% of action profile %2% already exists or refers to an unknown member.",
+              groupId, actionProfile->name()));
+    if (actionProfile->updateAssociatedTables(controlPlaneConstraints, references, symbolSet) !=
+        EXIT_SUCCESS) {
+        actionProfile->restoreGroup(controlPlaneConstraints, groupId, previousGroup);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/// Convert a P4Runtime FieldMatch of a parser value set member into ternary matches of the field.
+std::optional<std::vector<ParserValueSetMember>> convertValueSetFieldMatch(
+    const p4::v1::FieldMatch &field, const IR::Type_Bits *fieldType) {
+    auto width = fieldType->width_bits();
+    auto maxValue = IR::getMaxBvVal(width);
+    switch (field.field_match_type_case()) {
+        case p4::v1::FieldMatch::kExact: {
+            auto value = Protobuf::stringToBigInt(field.exact().value());
+            return std::vector<ParserValueSetMember>{{value & maxValue, maxValue}};
+        }
+        case p4::v1::FieldMatch::kTernary: {
+            auto value = Protobuf::stringToBigInt(field.ternary().value());
+            auto mask = Protobuf::stringToBigInt(field.ternary().mask()) & maxValue;
+            return std::vector<ParserValueSetMember>{{value & mask, mask}};
+        }
+        case p4::v1::FieldMatch::kLpm: {
+            auto value = Protobuf::stringToBigInt(field.lpm().value());
+            auto mask = maxValue ^ IR::getMaxBvVal(width - field.lpm().prefix_len());
+            return std::vector<ParserValueSetMember>{{value & mask, mask}};
+        }
+        case p4::v1::FieldMatch::kRange: {
+            auto low = Protobuf::stringToBigInt(field.range().low());
+            auto high = Protobuf::stringToBigInt(field.range().high());
+            return ParserValueSet::convertRange(low, high, width);
+        }
+        case p4::v1::FieldMatch::kOptional: {
+            auto value = Protobuf::stringToBigInt(field.optional().value());
+            return std::vector<ParserValueSetMember>{{value & maxValue, maxValue}};
+        }
+        default:
+            error("Unsupported parser value set match %1%.", field.DebugString().c_str());
+    }
+    return std::nullopt;
+}
+
+/// Convert a P4Runtime ValueSetEntry into the members of the respective parser value set. An entry
+/// always replaces all members of the parser value set.
+/// @param symbolSet tracks the symbols used in this conversion.
+int updateValueSetEntry(const P4InfoIndex &p4InfoIndex, const p4::v1::ValueSetEntry &valueSetEntry,
+                        ControlPlaneConstraints &controlPlaneConstraints,
+                        const ::p4::v1::Update_Type &updateType, SymbolSet &symbolSet) {
+    auto valueSetId = valueSetEntry.value_set_id();
+    ASSIGN_OR_RETURN_WITH_MESSAGE(
+        auto &p4InfoValueSet, p4InfoIndex.findValueSet(valueSetId), EXIT_FAILURE,
+        error("Parser value set ID %1% not found in the P4Info.", valueSetId));
+    auto it = controlPlaneConstraints.find(p4InfoValueSet.name);
+    RETURN_IF_FALSE_WITH_MESSAGE(
+        it != controlPlaneConstraints.end(), EXIT_FAILURE,
+        error("Parser value set %1% not found in the control plane constraints. It should "
+              "have already been initialized at this point.",
+              p4InfoValueSet.name));
+    ASSIGN_OR_RETURN_WITH_MESSAGE(
+        auto &parserValueSet, it->second.get().to<ParserValueSet>(), EXIT_FAILURE,
+        error("Configuration result %1% is not a parser value set.", p4InfoValueSet.name));
+
+    const auto &fieldTypes = p4InfoValueSet.fieldTypes;
+    std::vector<int> widths;
+    for (const auto *fieldType : fieldTypes) {
+        widths.push_back(fieldType->width_bits());
+    }
+    std::vector<ParserValueSetMember> members;
+    for (const auto &valueSetMember : valueSetEntry.members()) {
+        // Fields which are not set match any value.
+        std::vector<std::vector<ParserValueSetMember>> fields(fieldTypes.size(), {{0, 0}});
+        for (const auto &field : valueSetMember.match()) {
+            ASSIGN_OR_RETURN_WITH_MESSAGE(
+                auto position, p4InfoValueSet.findFieldPosition(field.field_id()), EXIT_FAILURE,
+                error("Field %1% of parser value set %2% not found in the P4Info.",
+                      field.field_id(), p4InfoValueSet.name));
+            ASSIGN_OR_RETURN(fields[position],
+                             convertValueSetFieldMatch(field, fieldTypes[position]), EXIT_FAILURE);
+        }
+        auto fieldMembers = ParserValueSet::concatenate(fields, widths);
+        members.insert(members.end(), fieldMembers.begin(), fieldMembers.end());
+    }
+
+    parserValueSet.clear();
+    if (updateType != p4::v1::Update::DELETE) {
+        parserValueSet.addMembers(members);
+    }
+    parserValueSet.collectSymbols(symbolSet);
     return EXIT_SUCCESS;
 }
 
 }  // namespace
 
 int updateControlPlaneConstraintsWithEntityMessage(const p4::v1::Entity &entity,
-                                                   const p4::config::v1::P4Info &p4Info,
+                                                   const P4InfoIndex &p4InfoIndex,
                                                    ControlPlaneConstraints &controlPlaneConstraints,
                                                    const ::p4::v1::Update_Type &updateType,
                                                    SymbolSet &symbolSet) {
     if (entity.has_table_entry()) {
-        RETURN_IF_FALSE(updateTableEntry(p4Info, entity.table_entry(), controlPlaneConstraints,
-                                         updateType, symbolSet) == EXIT_SUCCESS,
+        RETURN_IF_FALSE(updateTableEntry(p4InfoIndex, entity.table_entry(),
+                                         controlPlaneConstraints, updateType,
+                                         symbolSet) == EXIT_SUCCESS,
+                        EXIT_FAILURE)
+    } else if (entity.has_value_set_entry()) {
+        RETURN_IF_FALSE(updateValueSetEntry(p4InfoIndex, entity.value_set_entry(),
+                                            controlPlaneConstraints, updateType,
+                                            symbolSet) == EXIT_SUCCESS,
+                        EXIT_FAILURE)
+    } else if (entity.has_action_profile_member()) {
+        RETURN_IF_FALSE(updateActionProfileMember(p4InfoIndex, entity.action_profile_member(),
+                                                  controlPlaneConstraints, updateType,
+                                                  symbolSet) == EXIT_SUCCESS,
+                        EXIT_FAILURE)
+    } else if (entity.has_action_profile_group()) {
+        RETURN_IF_FALSE(updateActionProfileGroup(p4InfoIndex, entity.action_profile_group(),
+                                                 controlPlaneConstraints, updateType,
+                                                 symbolSet) == EXIT_SUCCESS,
                         EXIT_FAILURE)
     } else {
         error("Unsupported control plane entry %1%.", entity.DebugString().c_str());
@@ -292,11 +599,12 @@ int updateControlPlaneConstraintsWithEntityMessage(const p4::v1::Entity &entity,
 }
 
 int updateControlPlaneConstraints(const ::p4runtime::flaytests::Config &protoControlPlaneConfig,
-                                  const p4::config::v1::P4Info &p4Info,
+                                  const P4InfoIndex &p4InfoIndex,
                                   ControlPlaneConstraints &controlPlaneConstraints,
                                   SymbolSet &symbolSet) {
     for (const auto &entity : protoControlPlaneConfig.entities()) {
-        if (updateControlPlaneConstraintsWithEntityMessage(entity, p4Info, controlPlaneConstraints,
+        if (updateControlPlaneConstraintsWithEntityMessage(entity, p4InfoIndex,
+                                                           controlPlaneConstraints,
                                                            p4::v1::Update::MODIFY,
                                                            symbolSet) != EXIT_SUCCESS) {
             return EXIT_FAILURE;
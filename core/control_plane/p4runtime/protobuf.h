@@ -13,6 +13,7 @@
 #pragma GCC diagnostic pop
 
 #include "backends/p4tools/modules/flay/core/control_plane/control_plane_item.h"
+#include "backends/p4tools/modules/flay/core/control_plane/p4info_index.h"
 #include "backends/p4tools/modules/flay/core/control_plane/symbols.h"
 
 /// Parses a Protobuf text message file and converts the instructions contained
@@ -25,7 +26,7 @@ namespace P4::P4Tools::Flay::P4Runtime {
 /// control-plane constraints. Use the
 /// @param symbolSet tracks the symbols used in this conversion.
 [[nodiscard]] int updateControlPlaneConstraintsWithEntityMessage(
-    const p4::v1::Entity &entity, const p4::config::v1::P4Info &p4Info,
+    const p4::v1::Entity &entity, const P4InfoIndex &p4InfoIndex,
     ControlPlaneConstraints &controlPlaneConstraints, const ::p4::v1::Update_Type &updateType,
     SymbolSet &symbolSet);
 
@@ -34,9 +35,8 @@ namespace P4::P4Tools::Flay::P4Runtime {
 /// @param irToIdMap to lookup the nodes associated with P4Runtime Ids.
 /// @param symbolSet tracks the symbols used in this conversion.
 [[nodiscard]] int updateControlPlaneConstraints(
-    const ::p4runtime::flaytests::Config &protoControlPlaneConfig,
-    const p4::config::v1::P4Info &p4Info, ControlPlaneConstraints &controlPlaneConstraints,
-    SymbolSet &symbolSet);
+    const ::p4runtime::flaytests::Config &protoControlPlaneConfig, const P4InfoIndex &p4InfoIndex,
+    ControlPlaneConstraints &controlPlaneConstraints, SymbolSet &symbolSet);
 
 }  // namespace P4::P4Tools::Flay::P4Runtime
 
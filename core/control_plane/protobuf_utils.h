@@ -2,16 +2,22 @@
 #define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_PROTOBUF_UTILS_H_
 
 #include <fcntl.h>
+#include <unistd.h>
 
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/text_format.h>
+#include <google/protobuf/util/delimited_message_util.h>
 
+#include <cstdlib>
 #include <filesystem>
+#include <functional>
+#include <optional>
 
 #include "backends/p4tools/common/lib/logging.h"
 #include "backends/p4tools/modules/flay/core/lib/return_macros.h"
 #include "lib/big_int.h"
 #include "lib/error.h"
+#include "lib/log.h"
 
 namespace P4::P4Tools::Flay::Protobuf {
 
@@ -50,6 +56,57 @@ template <class T>
     return protoObject;
 }
 
+/// Read length-delimited binary Protobuf objects from @param inputFile, or from standard input if
+/// the path is "-". Every object is passed to @param processObject as soon as it is decoded, so
+/// only a single object is held in memory at a time.
+/// @returns EXIT_FAILURE if the file could not be read or @param processObject failed.
+template <class T>
+[[nodiscard]] static int readDelimitedObjectsFromFile(
+    const std::filesystem::path &inputFile, const std::function<int(const T &)> &processObject) {
+    bool readFromStdin = inputFile == "-";
+    int fd = readFromStdin ? STDIN_FILENO
+                           : open(inputFile.c_str(),
+                                  O_RDONLY);  // NOLINT, we are forced to use open here.
+    RETURN_IF_FALSE_WITH_MESSAGE(fd >= 0, EXIT_FAILURE,
+                                 error("Failed to open file %1%", inputFile.c_str()));
+    google::protobuf::io::FileInputStream input(fd);
+    input.SetCloseOnDelete(!readFromStdin);
+
+    int result = EXIT_SUCCESS;
+    size_t objectCount = 0;
+    while (result == EXIT_SUCCESS) {
+        T protoObject;
+        bool cleanEof = false;
+        if (!google::protobuf::util::ParseDelimitedFromZeroCopyStream(&protoObject, &input,
+                                                                      &cleanEof)) {
+            if (!cleanEof) {
+                error("Failed to parse object %1% in file %2%", objectCount, inputFile.c_str());
+                result = EXIT_FAILURE;
+            }
+            break;
+        }
+        // Formatting the object is expensive, so only do it if the output is logged.
+        if (Log::fileLogLevelIsAtLeast("flay_protobuf", 4)) {
+            printFeature("flay_protobuf", 4, "Parsed object %1%: %2%", objectCount,
+                         protoObject.DebugString());
+        }
+        objectCount++;
+        result = processObject(protoObject);
+    }
+    return result;
+}
+
+/// Append @param protoObject to @param output as a length-delimited binary Protobuf object.
+/// @returns EXIT_FAILURE if the object could not be written.
+template <class T>
+[[nodiscard]] static int serializeDelimitedObjectToStream(
+    const T &protoObject, google::protobuf::io::ZeroCopyOutputStream &output) {
+    RETURN_IF_FALSE_WITH_MESSAGE(
+        google::protobuf::util::SerializeDelimitedToZeroCopyStream(protoObject, &output),
+        EXIT_FAILURE, error("Failed to serialize object \"%1%\"", protoObject.ShortDebugString()));
+    return EXIT_SUCCESS;
+}
+
 }  // namespace P4::P4Tools::Flay::Protobuf
 
 #endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_PROTOBUF_UTILS_H_ */
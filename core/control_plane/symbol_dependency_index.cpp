@@ -0,0 +1,102 @@
+#include "backends/p4tools/modules/flay/core/control_plane/symbol_dependency_index.h"
+
+#include <algorithm>
+
+#include "lib/exceptions.h"
+
+namespace P4::P4Tools::Flay {
+
+size_t SymbolDependencyIndex::SymbolHash::operator()(const SymbolRef &symbol) const {
+    // Symbols with the same label but different types are told apart by SymbolEq.
+    return std::hash<cstring>()(symbol.get().label);
+}
+
+bool SymbolDependencyIndex::SymbolEq::operator()(const SymbolRef &left,
+                                                 const SymbolRef &right) const {
+    IR::IsSemanticallyLessComparator less;
+    return !less(left, right) && !less(right, left);
+}
+
+SymbolDependencyIndex::NodeId SymbolDependencyIndex::getOrAddNode(const IR::Node *node) {
+    auto [it, inserted] = _nodeIds.emplace(node, static_cast<NodeId>(_nodes.size()));
+    if (inserted) {
+        _nodes.push_back(node);
+    }
+    return it->second;
+}
+
+void SymbolDependencyIndex::addDependency(const IR::SymbolicVariable &symbol,
+                                          const IR::Node *node) {
+    auto nodeId = getOrAddNode(node);
+    auto &dependents = _dependents[symbol];
+    // New nodes have the largest id, so appending is the common case.
+    if (dependents.empty() || dependents.back() < nodeId) {
+        dependents.push_back(nodeId);
+        return;
+    }
+    auto it = std::lower_bound(dependents.begin(), dependents.end(), nodeId);
+    if (it == dependents.end() || *it != nodeId) {
+        dependents.insert(it, nodeId);
+    }
+}
+
+void SymbolDependencyIndex::addDependencies(const SymbolSet &symbols, const IR::Node *node) {
+    for (const auto &symbol : symbols) {
+        addDependency(symbol.get(), node);
+    }
+}
+
+void SymbolDependencyIndex::merge(const SymbolDependencyIndex &other) {
+    // Number the new nodes in the order of the other index to keep the ids deterministic.
+    for (const auto *node : other._nodes) {
+        getOrAddNode(node);
+    }
+    for (const auto &[symbol, dependents] : other._dependents) {
+        for (auto otherId : dependents) {
+            addDependency(symbol.get(), other.node(otherId));
+        }
+    }
+}
+
+std::vector<SymbolDependencyIndex::NodeId> SymbolDependencyIndex::dependentNodeIds(
+    const SymbolSet &symbols) const {
+    std::vector<NodeId> result;
+    for (const auto &symbol : symbols) {
+        auto it = _dependents.find(symbol);
+        if (it != _dependents.end()) {
+            result.insert(result.end(), it->second.begin(), it->second.end());
+        }
+    }
+    // A single symbol yields sorted ids already.
+    if (symbols.size() > 1) {
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+    }
+    return result;
+}
+
+NodeSet SymbolDependencyIndex::dependentNodes(const SymbolSet &symbols) const {
+    NodeSet result;
+    for (auto nodeId : dependentNodeIds(symbols)) {
+        result.insert(node(nodeId));
+    }
+    return result;
+}
+
+const IR::Node *SymbolDependencyIndex::node(NodeId id) const {
+    BUG_CHECK(id < _nodes.size(), "Node id %1% is out of range.", id);
+    return _nodes[id];
+}
+
+std::optional<SymbolDependencyIndex::NodeId> SymbolDependencyIndex::nodeId(
+    const IR::Node *node) const {
+    auto it = _nodeIds.find(node);
+    if (it == _nodeIds.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+size_t SymbolDependencyIndex::nodeCount() const { return _nodes.size(); }
+
+}  // namespace P4::P4Tools::Flay
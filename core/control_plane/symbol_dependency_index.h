@@ -0,0 +1,77 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_SYMBOL_DEPENDENCY_INDEX_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_SYMBOL_DEPENDENCY_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "backends/p4tools/modules/flay/core/control_plane/symbols.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools::Flay {
+
+/// A bipartite dependency index between symbolic variables and the annotated nodes whose
+/// condition or value contains them. Nodes are numbered densely in the order in which they are
+/// added, so consumers can keep per-node data in vectors indexed by node id. Symbols are looked up
+/// by hash, using the same semantic equality as SymbolSet.
+class SymbolDependencyIndex {
+ public:
+    /// The dense id of a node in the index.
+    using NodeId = uint32_t;
+
+ private:
+    using SymbolRef = std::reference_wrapper<const IR::SymbolicVariable>;
+
+    struct SymbolHash {
+        size_t operator()(const SymbolRef &symbol) const;
+    };
+
+    struct SymbolEq {
+        bool operator()(const SymbolRef &left, const SymbolRef &right) const;
+    };
+
+    /// The indexed nodes by id.
+    std::vector<const IR::Node *> _nodes;
+
+    /// The id of every indexed node.
+    absl::flat_hash_map<const IR::Node *, NodeId> _nodeIds;
+
+    /// The ids of the nodes which depend on a symbol, in ascending order.
+    absl::flat_hash_map<SymbolRef, std::vector<NodeId>, SymbolHash, SymbolEq> _dependents;
+
+    /// @returns the id of @param node. Assigns a new id if the node is not indexed yet.
+    NodeId getOrAddNode(const IR::Node *node);
+
+ public:
+    /// Record that @param node depends on @param symbol.
+    void addDependency(const IR::SymbolicVariable &symbol, const IR::Node *node);
+
+    /// Record that @param node depends on all symbols in @param symbols.
+    void addDependencies(const SymbolSet &symbols, const IR::Node *node);
+
+    /// Add all dependencies of @param other to this index.
+    void merge(const SymbolDependencyIndex &other);
+
+    /// @returns the ids of the nodes which depend on at least one symbol in @param symbols. The
+    /// ids are sorted and free of duplicates.
+    [[nodiscard]] std::vector<NodeId> dependentNodeIds(const SymbolSet &symbols) const;
+
+    /// @returns the nodes which depend on at least one symbol in @param symbols.
+    [[nodiscard]] NodeSet dependentNodes(const SymbolSet &symbols) const;
+
+    /// @returns the node with @param id.
+    [[nodiscard]] const IR::Node *node(NodeId id) const;
+
+    /// @returns the id of @param node or std::nullopt if the node does not depend on any symbol.
+    [[nodiscard]] std::optional<NodeId> nodeId(const IR::Node *node) const;
+
+    /// @returns the number of indexed nodes. Node ids are smaller than this number.
+    [[nodiscard]] size_t nodeCount() const;
+};
+
+}  // namespace P4::P4Tools::Flay
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_SYMBOL_DEPENDENCY_INDEX_H_ */
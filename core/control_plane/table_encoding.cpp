@@ -0,0 +1,266 @@
+#include "backends/p4tools/modules/flay/core/control_plane/table_encoding.h"
+
+#include <iterator>
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
+#include "ir/irutils.h"
+#include "lib/big_int.h"
+
+namespace P4::P4Tools::Flay {
+
+void TableEntryEncoder::encodeIteChain(const TableEntrySet &entries,
+                                       Z3ControlPlaneAssignmentSet &assignments) {
+    for (const auto &tableEntry : entries) {
+        auto constraint = tableEntry.get()._z3Condition();
+        if (!constraint.has_value()) {
+            return;
+        }
+        assignments.mergeConditionally(
+            tableEntry.get().computeZ3ControlPlaneAssignments().substitute(constraint.value()),
+            tableEntry.get().z3ActionAssignment());
+    }
+}
+
+std::optional<std::vector<TableEntryEncoder::GuardedEntry>>
+TableEntryEncoder::computeExactPartition(const KeyMap &keyMap, const TableEntrySet &entries) {
+    std::vector<const IR::SymbolicVariable *> keyVariables;
+    for (const auto *key : keyMap) {
+        const auto *exactKey = key->to<ExactTableMatchKey>();
+        if (exactKey == nullptr) {
+            return std::nullopt;
+        }
+        keyVariables.push_back(exactKey->variable());
+    }
+
+    // Every entry assigns a literal to every key. Since no two entries have the same matches,
+    // the conditions of the entries are pairwise disjoint.
+    std::vector<GuardedEntry> guardedEntries;
+    guardedEntries.reserve(entries.size());
+    for (const auto &tableEntry : entries) {
+        const auto &matches = tableEntry.get().matches();
+        if (matches.size() != keyVariables.size()) {
+            return std::nullopt;
+        }
+        for (const auto *keyVariable : keyVariables) {
+            auto it = matches.find(*keyVariable);
+            if (it == matches.end() || !it->second.get().is<IR::Literal>()) {
+                return std::nullopt;
+            }
+        }
+        auto condition = tableEntry.get()._z3Condition();
+        if (!condition.has_value()) {
+            return std::nullopt;
+        }
+        guardedEntries.push_back({tableEntry.get(), condition.value()});
+    }
+    return guardedEntries;
+}
+
+std::optional<std::vector<TableEntryEncoder::GuardedEntry>> TableEntryEncoder::computeLpmTrie(
+    const LpmTableMatchKey &key, const TableEntrySet &entries) {
+    LpmTrie trie(key.variable(), key.prefix());
+    for (const auto &tableEntry : entries) {
+        trie.insert(tableEntry.get());
+    }
+    return trie.guardedEntries();
+}
+
+std::optional<std::vector<TableEntryEncoder::GuardedEntry>>
+TableEntryEncoder::computeRangePartition(const RangeTableMatchKey &key,
+                                         const TableEntrySet &entries) {
+    const auto *keyType = key.keyExpression()->type->to<IR::Type_Bits>();
+    if (keyType == nullptr || keyType->isSigned) {
+        return std::nullopt;
+    }
+    auto maxValue = IR::getMaxBvVal(keyType->width_bits());
+
+    // Collect where the range of every entry starts and ends. Entries are ranked in table order.
+    std::vector<std::reference_wrapper<const TableMatchEntry>> rankedEntries;
+    std::map<big_int, std::vector<size_t>> starts;
+    std::map<big_int, std::vector<size_t>> ends;
+    for (const auto &tableEntry : entries) {
+        const auto &matches = tableEntry.get().matches();
+        auto minIt = matches.find(*key.minKey());
+        auto maxIt = matches.find(*key.maxKey());
+        if (minIt == matches.end() || maxIt == matches.end()) {
+            return std::nullopt;
+        }
+        const auto *minValue = minIt->second.get().to<IR::Constant>();
+        const auto *maxBound = maxIt->second.get().to<IR::Constant>();
+        if (minValue == nullptr || maxBound == nullptr) {
+            return std::nullopt;
+        }
+        // The range key requires the minimum to be strictly smaller than the maximum, see
+        // createRangeKey. Other entries never match.
+        if (minValue->value >= maxBound->value) {
+            continue;
+        }
+        auto rank = rankedEntries.size();
+        rankedEntries.push_back(tableEntry.get());
+        starts[minValue->value].push_back(rank);
+        ends[maxBound->value + 1].push_back(rank);
+    }
+    std::set<big_int> boundaries;
+    for (const auto &[boundary, ranks] : starts) {
+        boundaries.insert(boundary);
+    }
+    for (const auto &[boundary, ranks] : ends) {
+        boundaries.insert(boundary);
+    }
+
+    // Sweep over the boundaries. Between two boundaries, the active entry which comes last in
+    // table order takes precedence, like in the ite chain. Adjacent intervals with the same
+    // entry are merged.
+    std::vector<std::vector<std::pair<big_int, big_int>>> intervals(rankedEntries.size());
+    std::set<size_t> active;
+    std::optional<size_t> previousRank;
+    for (auto it = boundaries.begin(); it != boundaries.end(); ++it) {
+        for (auto rank : ends[*it]) {
+            active.erase(rank);
+        }
+        for (auto rank : starts[*it]) {
+            active.insert(rank);
+        }
+        auto next = std::next(it);
+        if (active.empty() || next == boundaries.end()) {
+            previousRank = std::nullopt;
+            continue;
+        }
+        auto rank = *active.rbegin();
+        if (previousRank == rank) {
+            intervals.at(rank).back().second = *next - 1;
+        } else {
+            intervals.at(rank).emplace_back(*it, *next - 1);
+        }
+        previousRank = rank;
+    }
+
+    auto keyExpression = Z3Cache::set(key.keyExpression());
+    std::vector<GuardedEntry> guardedEntries;
+    for (size_t rank = 0; rank < rankedEntries.size(); ++rank) {
+        if (intervals.at(rank).empty()) {
+            continue;
+        }
+        z3::expr_vector conditions(keyExpression.ctx());
+        for (const auto &[low, high] : intervals.at(rank)) {
+            auto condition = keyExpression.ctx().bool_val(true);
+            if (low > 0) {
+                condition = condition &&
+                            z3::ule(Z3Cache::set(IR::Constant::get(keyType, low)), keyExpression);
+            }
+            if (high < maxValue) {
+                condition = condition &&
+                            z3::ule(keyExpression, Z3Cache::set(IR::Constant::get(keyType, high)));
+            }
+            conditions.push_back(condition.simplify());
+        }
+        guardedEntries.push_back({rankedEntries.at(rank), z3::mk_or(conditions)});
+    }
+    return guardedEntries;
+}
+
+void TableEntryEncoder::encodeGrouped(const std::vector<GuardedEntry> &guardedEntries,
+                                      Z3ControlPlaneAssignmentSet &assignments) {
+    /// All the entries which assign the same value to a variable.
+    struct ValueGroup {
+        z3::expr value;
+        std::vector<z3::expr> conditions;
+    };
+    /// The value groups of a variable, in order of appearance, indexed by the Z3 id of the value.
+    struct VariableGroups {
+        std::vector<ValueGroup> groups;
+        std::map<unsigned, size_t> index;
+    };
+
+    std::map<std::reference_wrapper<const IR::SymbolicVariable>, VariableGroups,
+             IR::IsSemanticallyLessComparator>
+        variableGroups;
+    for (const auto &guardedEntry : guardedEntries) {
+        guardedEntry.entry.get().z3ActionAssignment().forEach(
+            [&variableGroups, &guardedEntry](const IR::SymbolicVariable &var,
+                                             const z3::expr &value) {
+                auto &variable = variableGroups[var];
+                auto [it, inserted] = variable.index.emplace(value.id(), variable.groups.size());
+                if (inserted) {
+                    variable.groups.push_back({value, {}});
+                }
+                variable.groups.at(it->second).conditions.push_back(guardedEntry.condition);
+            });
+    }
+
+    for (const auto &[var, variable] : variableGroups) {
+        const auto &groups = variable.groups;
+        // Like addConditionally, the first value serves as fallback if the variable is unassigned.
+        auto result = assignments.get(var).value_or(groups.front().value);
+        for (auto it = groups.rbegin(); it != groups.rend(); ++it) {
+            z3::expr_vector conditions(result.ctx());
+            for (const auto &condition : it->conditions) {
+                conditions.push_back(condition);
+            }
+            result = z3::ite(z3::mk_or(conditions), it->value, result);
+        }
+        assignments.set(var, result.simplify());
+    }
+}
+
+TableEncodingStrategy TableEntryEncoder::selectStrategy(const KeyMap &keyMap) {
+    if (keyMap.empty()) {
+        return TableEncodingStrategy::kIteChain;
+    }
+    bool allExact = true;
+    for (const auto *key : keyMap) {
+        allExact &= key->is<ExactTableMatchKey>();
+    }
+    if (allExact) {
+        return TableEncodingStrategy::kExactPartition;
+    }
+    if (keyMap.size() == 1 && keyMap.front()->is<LpmTableMatchKey>()) {
+        return TableEncodingStrategy::kLpmTrie;
+    }
+    if (keyMap.size() == 1 && keyMap.front()->is<RangeTableMatchKey>()) {
+        return TableEncodingStrategy::kRangePartition;
+    }
+    return TableEncodingStrategy::kIteChain;
+}
+
+void TableEntryEncoder::encode(TableEncodingStrategy strategy, const KeyMap &keyMap,
+                               const TableEntrySet &entries,
+                               Z3ControlPlaneAssignmentSet &assignments,
+                               const LpmTrie *lpmTrie) {
+    std::optional<std::vector<GuardedEntry>> guardedEntries;
+    switch (strategy) {
+        case TableEncodingStrategy::kExactPartition:
+            guardedEntries = computeExactPartition(keyMap, entries);
+            break;
+        case TableEncodingStrategy::kLpmTrie:
+            if (lpmTrie != nullptr) {
+                guardedEntries = lpmTrie->guardedEntries();
+            } else if (keyMap.size() == 1) {
+                if (const auto *lpmKey = keyMap.front()->to<LpmTableMatchKey>()) {
+                    guardedEntries = computeLpmTrie(*lpmKey, entries);
+                }
+            }
+            break;
+        case TableEncodingStrategy::kRangePartition:
+            if (keyMap.size() == 1) {
+                if (const auto *rangeKey = keyMap.front()->to<RangeTableMatchKey>()) {
+                    guardedEntries = computeRangePartition(*rangeKey, entries);
+                }
+            }
+            break;
+        case TableEncodingStrategy::kIteChain:
+            break;
+    }
+    if (!guardedEntries.has_value() || guardedEntries.value().empty()) {
+        encodeIteChain(entries, assignments);
+        return;
+    }
+    encodeGrouped(guardedEntries.value(), assignments);
+}
+
+}  // namespace P4::P4Tools::Flay
@@ -0,0 +1,68 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_TABLE_ENCODING_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_TABLE_ENCODING_H_
+
+#include <z3++.h>
+
+#include <optional>
+#include <vector>
+
+#include "backends/p4tools/modules/flay/core/control_plane/control_plane_objects.h"
+#include "backends/p4tools/modules/flay/core/control_plane/lpm_trie.h"
+#include "backends/p4tools/modules/flay/core/control_plane/z3_control_plane_assignment.h"
+
+namespace P4::P4Tools::Flay {
+
+/// Encodes the entries of a table configuration as conditional Z3 assignments.
+/// The legacy encoding nests one ite per entry, which grows quadratically with the number of
+/// entries. When the entry conditions can be made pairwise disjoint, entries are instead grouped
+/// per assigned value and each group is encoded as a single disjunction.
+class TableEntryEncoder {
+ public:
+    /// A table entry together with the condition under which this entry is executed.
+    using GuardedEntry = GuardedTableEntry;
+
+ private:
+    /// Encodes the entries as a chain of ite expressions in entry order.
+    static void encodeIteChain(const TableEntrySet &entries,
+                               Z3ControlPlaneAssignmentSet &assignments);
+
+    /// Computes the guarded entries for a table with only exact keys.
+    /// @returns std::nullopt if an entry does not assign a literal to every key.
+    static std::optional<std::vector<GuardedEntry>> computeExactPartition(
+        const KeyMap &keyMap, const TableEntrySet &entries);
+
+    /// Computes the guarded entries for a table with a single LPM key. Each entry is only
+    /// executed if no entry with a longer prefix in its subtree matches.
+    /// @returns std::nullopt if an entry does not assign a literal value and prefix to the key.
+    static std::optional<std::vector<GuardedEntry>> computeLpmTrie(const LpmTableMatchKey &key,
+                                                                   const TableEntrySet &entries);
+
+    /// Computes the guarded entries for a table with a single range key. The key space is split
+    /// into disjoint intervals, each of which is assigned to the entry that takes precedence on
+    /// it. Each entry is executed if the key falls into one of its intervals.
+    /// @returns std::nullopt if an entry does not assign literal bounds to the key or the key is
+    /// signed.
+    static std::optional<std::vector<GuardedEntry>> computeRangePartition(
+        const RangeTableMatchKey &key, const TableEntrySet &entries);
+
+    /// Encodes entries with pairwise disjoint conditions. Entries assigning the same value to a
+    /// variable are merged into one disjunction.
+    static void encodeGrouped(const std::vector<GuardedEntry> &guardedEntries,
+                              Z3ControlPlaneAssignmentSet &assignments);
+
+ public:
+    /// @returns the most scalable strategy which is sound for the given table keys.
+    static TableEncodingStrategy selectStrategy(const KeyMap &keyMap);
+
+    /// Encodes @param entries into @param assignments using @param strategy. Falls back to
+    /// TableEncodingStrategy::kIteChain if the entries do not fit the requested strategy.
+    /// If @param lpmTrie is set, it must hold @param entries and is used instead of building a
+    /// new trie for TableEncodingStrategy::kLpmTrie.
+    static void encode(TableEncodingStrategy strategy, const KeyMap &keyMap,
+                       const TableEntrySet &entries, Z3ControlPlaneAssignmentSet &assignments,
+                       const LpmTrie *lpmTrie = nullptr);
+};
+
+}  // namespace P4::P4Tools::Flay
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_CONTROL_PLANE_TABLE_ENCODING_H_ */
@@ -3,6 +3,12 @@
 
 #include <z3++.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
 #include "backends/p4tools/common/lib/variables.h"
 #include "backends/p4tools/modules/flay/core/control_plane/control_plane_assignment.h"
 #include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
@@ -11,42 +17,181 @@
 namespace P4::P4Tools::Flay {
 
 /// The Z3 version of a ControlPlaneAssignmentSet. A little bit more restricted.
+/// The set stores its assignments directly in the source and destination vectors which are passed
+/// to z3::expr::substitute. Modifications update these vectors in place, so substituting never
+/// has to rebuild them. Every modification increments the version of the set.
 class Z3ControlPlaneAssignmentSet
-    : private ordered_map<std::reference_wrapper<const IR::SymbolicVariable>, z3::expr,
+    : private ordered_map<std::reference_wrapper<const IR::SymbolicVariable>, unsigned,
                           IR::IsSemanticallyLessComparator> {
+ private:
+    using PositionMap = ordered_map<std::reference_wrapper<const IR::SymbolicVariable>, unsigned,
+                                    IR::IsSemanticallyLessComparator>;
+
+    /// The substitution sources. The i-th entry is the Z3 variable of the i-th symbol.
+    z3::expr_vector _variables;
+
+    /// The substitution destinations. The i-th entry is the assignment of the i-th symbol.
+    z3::expr_vector _assignments;
+
+    /// The symbol at each position of the substitution vectors.
+    std::vector<std::reference_wrapper<const IR::SymbolicVariable>> _symbols;
+
+    /// Incremented whenever an assignment is added, changed, or removed.
+    uint64_t _version = 0;
+
+    /// Append a new assignment to the substitution vectors. @param var must not be in the set.
+    void append(const IR::SymbolicVariable &var, z3::expr assignment) {
+        PositionMap::emplace(var, _symbols.size());
+        _symbols.emplace_back(var);
+        _variables.push_back(Z3Cache::set(&var));
+        _assignments.push_back(assignment);
+        _version++;
+    }
+
+    /// Overwrite the assignment at @param position.
+    void replace(unsigned position, z3::expr assignment) {
+        _assignments.set(position, assignment);
+        _version++;
+    }
+
+    /// Copy the assignments of @param other into this set, which must be empty.
+    void copyFrom(const Z3ControlPlaneAssignmentSet &other) {
+        for (const auto &[symbol, position] : other) {
+            append(symbol.get(), other._assignments[position]);
+        }
+    }
+
  public:
-    Z3ControlPlaneAssignmentSet() = default;
+    Z3ControlPlaneAssignmentSet()
+        : _variables(Z3Cache::context()), _assignments(Z3Cache::context()) {}
 
-    /// Return the number of entries in the set.
-    [[nodiscard]] size_t size() const {
-        return ordered_map<std::reference_wrapper<const IR::SymbolicVariable>, z3::expr,
-                           IR::IsSemanticallyLessComparator>::size();
+    /// z3::expr_vector copies share the underlying vector. Copies of the set are deep, because
+    /// the vectors are modified in place.
+    Z3ControlPlaneAssignmentSet(const Z3ControlPlaneAssignmentSet &other)
+        : Z3ControlPlaneAssignmentSet() {
+        copyFrom(other);
     }
 
+    Z3ControlPlaneAssignmentSet &operator=(const Z3ControlPlaneAssignmentSet &other) {
+        if (this != &other) {
+            clear();
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    /// Moving hands over the vectors and leaves @param other empty.
+    Z3ControlPlaneAssignmentSet(Z3ControlPlaneAssignmentSet &&other) noexcept
+        : PositionMap(std::move(other)),
+          _variables(other._variables),
+          _assignments(other._assignments),
+          _symbols(std::move(other._symbols)),
+          _version(other._version) {
+        other.PositionMap::clear();
+        other._symbols.clear();
+        other._variables = z3::expr_vector(_variables.ctx());
+        other._assignments = z3::expr_vector(_assignments.ctx());
+    }
+
+    Z3ControlPlaneAssignmentSet &operator=(Z3ControlPlaneAssignmentSet &&other) noexcept {
+        if (this != &other) {
+            PositionMap::operator=(std::move(other));
+            _variables = other._variables;
+            _assignments = other._assignments;
+            _symbols = std::move(other._symbols);
+            _version = std::max(_version, other._version) + 1;
+            other.PositionMap::clear();
+            other._symbols.clear();
+            other._variables = z3::expr_vector(_variables.ctx());
+            other._assignments = z3::expr_vector(_assignments.ctx());
+        }
+        return *this;
+    }
+
+    ~Z3ControlPlaneAssignmentSet() = default;
+
+    /// Return the number of entries in the set.
+    [[nodiscard]] size_t size() const { return PositionMap::size(); }
+
+    /// @returns the version of the set. The version changes with every modification, so callers
+    /// can detect whether results they derived from the set are stale.
+    [[nodiscard]] uint64_t version() const { return _version; }
+
     /// Add a new variable to the set. If the variable is already in the set, returns false.
     bool add(const IR::SymbolicVariable &var, z3::expr assignment) {
-        auto result = emplace(var, assignment);
-        if (!result.second) {
+        if (find(var) != end()) {
             error("Entry for `%1%` already in the set", var);
+            return false;
         }
-        return result.second;
+        append(var, std::move(assignment));
+        return true;
     }
 
-    /// Replaces an assignment in the set with a symbolic wildcard that can have any value.
-    void setSymbolic(const IR::SymbolicVariable &var) {
-        auto symbolicVar =
-            Z3Cache::set(ToolsVariables::getSymbolicVariable(var.type, var.label + "*"));
+    /// Set the assignment for a variable, overwriting any existing assignment.
+    void set(const IR::SymbolicVariable &var, const z3::expr &assignment) {
         auto it = find(var);
         if (it == end()) {
-            emplace(var, symbolicVar);
+            append(var, assignment);
         } else {
-            it->second = symbolicVar;
+            replace(it->second, assignment);
+        }
+    }
+
+    /// Remove the assignment for a variable. @returns false if the variable is not in the set.
+    /// The last assignment of the substitution vectors takes the place of the removed one.
+    bool remove(const IR::SymbolicVariable &var) {
+        auto it = find(var);
+        if (it == end()) {
+            return false;
+        }
+        auto position = it->second;
+        erase(it);
+        auto last = static_cast<unsigned>(_symbols.size() - 1);
+        if (position != last) {
+            auto lastVariable = _variables[last];
+            auto lastAssignment = _assignments[last];
+            _variables.set(position, lastVariable);
+            _assignments.set(position, lastAssignment);
+            _symbols[position] = _symbols[last];
+            find(_symbols[position])->second = position;
+        }
+        _symbols.pop_back();
+        _variables.resize(last);
+        _assignments.resize(last);
+        _version++;
+        return true;
+    }
+
+    /// @returns the assignment for a variable or std::nullopt if the variable is not in the set.
+    [[nodiscard]] std::optional<z3::expr> get(const IR::SymbolicVariable &var) const {
+        auto it = find(var);
+        if (it == end()) {
+            return std::nullopt;
+        }
+        return _assignments[it->second];
+    }
+
+    /// @returns true if the set contains an assignment for the variable.
+    [[nodiscard]] bool contains(const IR::SymbolicVariable &var) const {
+        return find(var) != end();
+    }
+
+    /// Invokes @param function on every variable-assignment pair in the set.
+    template <typename Fn>
+    void forEach(Fn function) const {
+        for (const auto &[symbol, position] : *this) {
+            function(symbol.get(), _assignments[position]);
         }
     }
 
+    /// Replaces an assignment in the set with a symbolic wildcard that can have any value.
+    void setSymbolic(const IR::SymbolicVariable &var) {
+        set(var, Z3Cache::set(ToolsVariables::getSymbolicVariable(var.type, var.label + "*")));
+    }
+
     /// Set all assignments in this set to a symbolic wildcard that can have any value.
     void setAllSymbolic() {
-        for (const auto &[symbol, assignment] : *this) {
+        for (const auto &[symbol, position] : *this) {
             setSymbolic(symbol.get());
         }
     }
@@ -59,40 +204,68 @@ class Z3ControlPlaneAssignmentSet
         if (it == end()) {
             /// There is only one possible value for the variable. Use it as default.
             /// TODO: Can we make this assumption and still be semantically correct?
-            emplace(var, assignment);
+            append(var, assignment);
             /// Wildcard the result if it does not exist yet.
             // emplace(var, z3::ite(condition, assignment, Z3Cache::set(&var)));
         } else {
-            it->second = z3::ite(condition, assignment, it->second).simplify();
+            replace(it->second,
+                    z3::ite(condition, assignment, _assignments[it->second]).simplify());
         }
     }
 
     /// Clear the set.
     void clear() {
-        ordered_map<std::reference_wrapper<const IR::SymbolicVariable>, z3::expr,
-                    IR::IsSemanticallyLessComparator>::clear();
+        PositionMap::clear();
+        _symbols.clear();
+        _variables.resize(0);
+        _assignments.resize(0);
+        _version++;
     }
 
-    /// Substitutes the given expression with the variables contained in the set.
-    /// Use the context of the given expression to build the set.
+    /// Substitutes the given expression with the variables contained in the set and simplifies
+    /// the result.
     [[nodiscard]] z3::expr substitute(z3::expr &toSubstitute) const {
-        /// TODO: This is a bit inefficient since we are rebuilding the vectors with each
-        /// substitution. The problem is that the vectors are not maps and addConditionally may
-        /// conflict.
-        z3::expr_vector substitutionVariables(toSubstitute.ctx());
-        z3::expr_vector substitutionAssignments(toSubstitute.ctx());
-        for (const auto &match : *this) {
-            substitutionVariables.push_back(Z3Cache::set(&match.first.get()));
-            substitutionAssignments.push_back(match.second);
+        if (_symbols.empty()) {
+            return toSubstitute.simplify();
+        }
+        return toSubstitute.substitute(_variables, _assignments).simplify();
+    }
+
+    /// Applies the substitution of the set to all @param expressions. The results are in the
+    /// order of the input. The expressions are substituted and simplified as the arguments of a
+    /// single uninterpreted function application, so Z3 memoizes the results of sub-expressions
+    /// which are shared between them.
+    [[nodiscard]] std::vector<z3::expr> substitute(std::vector<z3::expr> expressions) const {
+        if (expressions.size() < 2) {
+            for (auto &expression : expressions) {
+                expression = substitute(expression);
+            }
+            return expressions;
         }
-        return toSubstitute.substitute(substitutionVariables, substitutionAssignments).simplify();
+        auto &context = expressions.front().ctx();
+        z3::sort_vector domain(context);
+        z3::expr_vector arguments(context);
+        for (const auto &expression : expressions) {
+            domain.push_back(expression.get_sort());
+            arguments.push_back(expression);
+        }
+        auto batchFunction = z3::function("flay_substitution_batch", domain, context.bool_sort());
+        auto batch = batchFunction(arguments);
+        if (!_symbols.empty()) {
+            batch = batch.substitute(_variables, _assignments);
+        }
+        batch = batch.simplify();
+        for (unsigned idx = 0; idx < expressions.size(); ++idx) {
+            expressions[idx] = batch.arg(idx);
+        }
+        return expressions;
     }
 
     /// Merges the other set into this one.
     void merge(const Z3ControlPlaneAssignmentSet &other) {
-        for (const auto &match : other) {
-            add(match.first.get(), match.second);
-        }
+        other.forEach([this](const IR::SymbolicVariable &symbol, const z3::expr &assignment) {
+            add(symbol, assignment);
+        });
     }
 
     /// Merges the other set into this one. Translate the expression in the other set into Z3.
@@ -104,9 +277,10 @@ class Z3ControlPlaneAssignmentSet
 
     /// Merges the other set into this one using the provided condition.
     void mergeConditionally(const z3::expr &condition, const Z3ControlPlaneAssignmentSet &other) {
-        for (const auto &match : other) {
-            addConditionally(match.first.get(), condition, match.second);
-        }
+        other.forEach([this, &condition](const IR::SymbolicVariable &symbol,
+                                         const z3::expr &assignment) {
+            addConditionally(symbol, condition, assignment);
+        });
     }
 
     /// Merges the other set into this one using the provided condition. Translate the expression in
@@ -15,12 +15,15 @@ FlayCompilerResult::FlayCompilerResult(CompilerResult compilerResult,
     : CompilerResult(std::move(compilerResult)),
       originalProgram(originalProgram),
       p4runtimeApi(p4runtimeApi),
+      p4InfoIndex(*p4runtimeApi.p4Info),
       defaultControlPlaneConstraints(std::move(defaultControlPlaneConstraints)) {}
 
 const IR::P4Program &FlayCompilerResult::getOriginalProgram() const { return originalProgram; }
 
 const P4::P4RuntimeAPI &FlayCompilerResult::getP4RuntimeApi() const { return p4runtimeApi; }
 
+const P4InfoIndex &FlayCompilerResult::getP4InfoIndex() const { return p4InfoIndex; }
+
 const ControlPlaneConstraints &FlayCompilerResult::getDefaultControlPlaneConstraints() const {
     return defaultControlPlaneConstraints;
 }
@@ -1,10 +1,12 @@
 #include "backends/p4tools/modules/flay/core/interpreter/execution_state.h"
 
+#include <cstddef>
 #include <utility>
 
 #include "backends/p4tools/common/lib/symbolic_env.h"
 #include "backends/p4tools/common/lib/variables.h"
 #include "backends/p4tools/modules/flay/core/interpreter/substitute_placeholders.h"
+#include "backends/p4tools/modules/flay/core/lib/expression_interner.h"
 #include "backends/p4tools/modules/flay/core/lib/simplify_expression.h"
 #include "backends/p4tools/modules/flay/options.h"
 #include "ir/id.h"
@@ -68,7 +70,8 @@ const IR::Expression *ExecutionState::get(const IR::StateVariable &var) const {
 }
 
 void ExecutionState::set(const IR::StateVariable &var, const IR::Expression *value) {
-    env.set(var, value);
+    _writeLog->writes.push_back(var);
+    env.set(var, ExpressionInterner::intern(value));
 }
 
 void ExecutionState::addParserId(int parserId) { visitedParserIds.emplace(parserId); }
@@ -87,41 +90,67 @@ const IR::Expression *ExecutionState::getExecutionCondition() const {
 
 void ExecutionState::pushExecutionCondition(const IR::Expression *cond) {
     if (executionCondition == nullptr) {
-        executionCondition = cond;
+        executionCondition = ExpressionInterner::intern(cond);
     } else {
-        executionCondition = SimplifyExpression::simplify(new IR::LAnd(executionCondition, cond));
+        executionCondition =
+            SimplifyExpression::simplifyInterned(new IR::LAnd(executionCondition, cond));
     }
 }
 
+bool ExecutionState::collectDivergedVariables(const ExecutionState &mergeState,
+                                              std::set<IR::StateVariable> &variables) const {
+    const auto *log = mergeState._writeLog.get();
+    auto writeCount = log->writes.size();
+    while (log != nullptr) {
+        if (log == _writeLog.get()) {
+            // Add the writes of this state since the clone was taken.
+            variables.insert(log->writes.begin() + static_cast<std::ptrdiff_t>(writeCount),
+                             log->writes.end());
+            return true;
+        }
+        variables.insert(log->writes.begin(),
+                         log->writes.begin() + static_cast<std::ptrdiff_t>(writeCount));
+        writeCount = log->parentWriteCount;
+        log = log->parent.get();
+    }
+    return false;
+}
+
 void ExecutionState::merge(const ExecutionState &mergeState) {
     const auto *cond = mergeState.getExecutionCondition();
-    cond = SimplifyExpression::simplify(cond);
+    cond = SimplifyExpression::simplifyInterned(cond);
     const auto &mergeEnv = mergeState.getSymbolicEnv();
     _nodeAnnotationMap.mergeAnnotationMapping(mergeState.nodeAnnotationMap());
 
+    // Variables which were not written in either state since the clone have the same value.
+    std::set<IR::StateVariable> divergedVariables;
+    if (!collectDivergedVariables(mergeState, divergedVariables)) {
+        for (const auto &envTuple : mergeEnv.getInternalMap()) {
+            divergedVariables.insert(envTuple.first);
+        }
+    }
+
     if (const auto *boolExpr = cond->to<IR::BoolLiteral>()) {
         // If the condition is false, do nothing. If it is true, set all the values.
         if (boolExpr->value) {
-            for (const auto &envTuple : mergeEnv.getInternalMap()) {
-                auto ref = envTuple.first;
-                if (exists(ref)) {
-                    set(ref, envTuple.second);
+            for (const auto &ref : divergedVariables) {
+                if (exists(ref) && mergeEnv.exists(ref)) {
+                    set(ref, mergeEnv.get(ref));
                 }
             }
         }
         return;
     }
-    for (const auto &envTuple : mergeEnv.getInternalMap()) {
-        auto ref = envTuple.first;
-        const auto *mergeExpr = envTuple.second;
+    for (const auto &ref : divergedVariables) {
         // Do not merge any variable that did not exist previously.
-        if (exists(ref)) {
-            const auto *currentExpr = get(ref);
-            // Only merge when the current and the merged expression are different.
-            if (!currentExpr->equiv(*mergeExpr)) {
-                set(envTuple.first,
-                    SimplifyExpression::produceSimplifiedMux(cond, mergeExpr, currentExpr));
-            }
+        if (!exists(ref) || !mergeEnv.exists(ref)) {
+            continue;
+        }
+        const auto *mergeExpr = mergeEnv.get(ref);
+        const auto *currentExpr = get(ref);
+        // Only merge when the current and the merged expression are different.
+        if (!currentExpr->equiv(*mergeExpr)) {
+            set(ref, SimplifyExpression::produceSimplifiedMux(cond, mergeExpr, currentExpr));
         }
     }
 }
@@ -130,7 +159,7 @@ const NodeAnnotationMap &ExecutionState::nodeAnnotationMap() const { return _nod
 
 void ExecutionState::addReachabilityMapping(const IR::Node *node, const IR::Expression *cond) {
     bool notAlreadyInMap = _nodeAnnotationMap.initializeReachabilityMapping(
-        node, new IR::LAnd(getExecutionCondition(), cond));
+        node, ExpressionInterner::intern(new IR::LAnd(getExecutionCondition(), cond)));
     if (!notAlreadyInMap && FlayOptions::get().isStrict()) {
         // Throw a fatal error if we try to add a duplicate mapping.
         // This can affect the correctness of the entire mapping.
@@ -147,8 +176,8 @@ void ExecutionState::addExpressionMapping(const IR::Expression *expression,
         return;
     }
 
-    bool notAlreadyInMap =
-        _nodeAnnotationMap.initializeExpressionMapping(expression, value, getExecutionCondition());
+    bool notAlreadyInMap = _nodeAnnotationMap.initializeExpressionMapping(
+        expression, ExpressionInterner::intern(value), getExecutionCondition());
     if (!notAlreadyInMap && FlayOptions::get().isStrict()) {
         // Throw a fatal error if we try to add a duplicate mapping.
         // This can affect the correctness of the entire mapping.
@@ -191,6 +220,13 @@ ExecutionState &ExecutionState::create(const IR::P4Program *program) {
     return *new ExecutionState(program);
 }
 
-ExecutionState &ExecutionState::clone() const { return *new ExecutionState(*this); }
+ExecutionState &ExecutionState::clone() const {
+    auto &clonedState = *new ExecutionState(*this);
+    // The clone records its own writes and remembers where it diverged from this state.
+    clonedState._writeLog = std::make_shared<WriteLog>();
+    clonedState._writeLog->parent = _writeLog;
+    clonedState._writeLog->parentWriteCount = _writeLog->writes.size();
+    return clonedState;
+}
 
 }  // namespace P4::P4Tools::Flay
@@ -1,8 +1,11 @@
 #ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_INTERPRETER_EXECUTION_STATE_H_
 #define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_INTERPRETER_EXECUTION_STATE_H_
 
+#include <cstddef>
+#include <memory>
 #include <optional>
 #include <set>
+#include <vector>
 
 #include "backends/p4tools/common/core/abstract_execution_state.h"
 #include "backends/p4tools/modules/flay/core/interpreter/node_map.h"
@@ -23,8 +26,32 @@ class ExecutionState : public AbstractExecutionState {
     std::set<int> visitedParserIds;
 
     /// Keeps track of the annotations on individual nodes in the program, for example reachability.
+    /// Clones share the annotations which existed at the time of the clone.
     NodeAnnotationMap _nodeAnnotationMap;
 
+    /// Records the state variables written in an execution state since it was cloned.
+    struct WriteLog {
+        /// The written state variables in the order of the writes. May contain duplicates.
+        std::vector<IR::StateVariable> writes;
+
+        /// The write log of the state this state was cloned from.
+        std::shared_ptr<const WriteLog> parent;
+
+        /// The number of writes in the parent log at the time of the clone.
+        size_t parentWriteCount = 0;
+    };
+
+    /// The writes of this state. Used to find the variables which may differ between two states
+    /// without comparing the entire symbolic environment.
+    std::shared_ptr<WriteLog> _writeLog = std::make_shared<WriteLog>();
+
+    /// Collects the variables which may have a different value in @param mergeState than in
+    /// this state into @param variables. These are the variables written in either state since
+    /// @param mergeState was (transitively) cloned from this state.
+    /// @returns false if @param mergeState is not a clone of this state.
+    bool collectDivergedVariables(const ExecutionState &mergeState,
+                                  std::set<IR::StateVariable> &variables) const;
+
     /// A static label for placeholder variables used in Flay.
     static const IR::PathExpression PLACEHOLDER_LABEL;
     /* =========================================================================================
@@ -1,19 +1,117 @@
 #include "backends/p4tools/modules/flay/core/interpreter/node_map.h"
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 namespace P4::P4Tools::Flay {
 
-bool NodeAnnotationMap::initializeReachabilityMapping(const IR::Node *node,
-                                                      const IR::Expression *cond) {
-    SymbolCollector collector;
-    cond->apply(collector);
-    const auto &collectedSymbols = collector.collectedSymbols();
-    for (const auto &symbol : collectedSymbols) {
-        _reachabilitySymbolMap[symbol.get()].emplace(node);
+size_t NodeAnnotationMap::Layer::size() const {
+    return reachabilityMap.size() + substitutionMap.size();
+}
+
+void NodeAnnotationMap::Layer::absorb(std::shared_ptr<Layer> other) {
+    // Keys are unique across layers, so no annotation is lost.
+    if (other.use_count() == 1) {
+        reachabilityMap.merge(other->reachabilityMap);
+        substitutionMap.merge(other->substitutionMap);
+        return;
+    }
+    reachabilityMap.insert(other->reachabilityMap.begin(), other->reachabilityMap.end());
+    substitutionMap.insert(other->substitutionMap.begin(), other->substitutionMap.end());
+}
+
+NodeAnnotationMap::NodeAnnotationMap(const NodeAnnotationMap &other)
+    : _sharedLayers(other.share()) {}
+
+NodeAnnotationMap &NodeAnnotationMap::operator=(const NodeAnnotationMap &other) {
+    if (this != &other) {
+        _sharedLayers = other.share();
+        _reachabilityMap.clear();
+        _substitutionMap.clear();
+        invalidateDependencies();
+    }
+    return *this;
+}
+
+std::shared_ptr<NodeAnnotationMap::Layer> NodeAnnotationMap::share() const {
+    if (_reachabilityMap.empty() && _substitutionMap.empty()) {
+        return _sharedLayers;
+    }
+    auto layer = std::make_shared<Layer>();
+    layer->reachabilityMap.swap(_reachabilityMap);
+    layer->substitutionMap.swap(_substitutionMap);
+    // Absorb every parent which is not larger than the new layer.
+    auto parent = std::move(_sharedLayers);
+    while (parent != nullptr && parent->size() <= layer->size()) {
+        auto grandParent = parent->parent;
+        layer->absorb(std::move(parent));
+        parent = std::move(grandParent);
+    }
+    layer->parent = std::move(parent);
+    _sharedLayers = std::move(layer);
+    return _sharedLayers;
+}
+
+const NodeAnnotationMap::Layer &NodeAnnotationMap::flatten() const {
+    share();
+    if (_sharedLayers == nullptr) {
+        _sharedLayers = std::make_shared<Layer>();
+    }
+    if (_sharedLayers->parent == nullptr) {
+        return *_sharedLayers;
+    }
+    auto layer = std::make_shared<Layer>();
+    auto current = std::move(_sharedLayers);
+    while (current != nullptr) {
+        auto parent = current->parent;
+        layer->absorb(std::move(current));
+        current = std::move(parent);
     }
+    _sharedLayers = std::move(layer);
+    return *_sharedLayers;
+}
 
+ReachabilityExpression *NodeAnnotationMap::findReachability(const IR::Node *node) const {
     auto it = _reachabilityMap.find(node);
     if (it != _reachabilityMap.end()) {
-        it->second->addCondition(cond);
+        return it->second;
+    }
+    for (const auto *layer = _sharedLayers.get(); layer != nullptr; layer = layer->parent.get()) {
+        auto layerIt = layer->reachabilityMap.find(node);
+        if (layerIt != layer->reachabilityMap.end()) {
+            return layerIt->second;
+        }
+    }
+    return nullptr;
+}
+
+SubstitutionExpression *NodeAnnotationMap::findSubstitution(
+    const IR::Expression *expression) const {
+    auto it = _substitutionMap.find(expression);
+    if (it != _substitutionMap.end()) {
+        return it->second;
+    }
+    for (const auto *layer = _sharedLayers.get(); layer != nullptr; layer = layer->parent.get()) {
+        auto layerIt = layer->substitutionMap.find(expression);
+        if (layerIt != layer->substitutionMap.end()) {
+            return layerIt->second;
+        }
+    }
+    return nullptr;
+}
+
+void NodeAnnotationMap::invalidateDependencies() {
+    _expressionDependencies = std::nullopt;
+    _reachabilityDependencies = std::nullopt;
+}
+
+bool NodeAnnotationMap::initializeReachabilityMapping(const IR::Node *node,
+                                                      const IR::Expression *cond) {
+    invalidateDependencies();
+    auto *reachabilityExpression = findReachability(node);
+    if (reachabilityExpression != nullptr) {
+        reachabilityExpression->addCondition(cond);
         return false;
     }
     return _reachabilityMap.emplace(node, new ReachabilityExpression(cond)).second;
@@ -22,31 +120,47 @@ bool NodeAnnotationMap::initializeReachabilityMapping(const IR::Node *node,
 bool NodeAnnotationMap::initializeExpressionMapping(const IR::Expression *expression,
                                                     const IR::Expression *value,
                                                     const IR::Expression *cond) {
-    SymbolCollector collector;
-    value->apply(collector);
-    const auto &collectedSymbols = collector.collectedSymbols();
-    for (const auto &symbol : collectedSymbols) {
-        _expressionSymbolMap[symbol.get()].emplace(expression);
+    if (findSubstitution(expression) != nullptr) {
+        return false;
     }
-    auto result = _substitutionMap.emplace(expression, new SubstitutionExpression(cond, value));
-    return result.second;
+    invalidateDependencies();
+    return _substitutionMap.emplace(expression, new SubstitutionExpression(cond, value)).second;
 }
 
 void NodeAnnotationMap::mergeAnnotationMapping(const NodeAnnotationMap &otherMap) {
-    _reachabilityMap.insert(otherMap._reachabilityMap.begin(), otherMap._reachabilityMap.end());
-    _substitutionMap.insert(otherMap._substitutionMap.begin(), otherMap._substitutionMap.end());
-
-    for (const auto &symbol : otherMap.reachabilitySymbolMap()) {
-        _reachabilitySymbolMap[symbol.first.get()].insert(symbol.second.begin(),
-                                                          symbol.second.end());
+    // The layers which both maps share hold the same annotations and can be skipped.
+    std::vector<const Layer *> ownLayers;
+    for (const auto *layer = _sharedLayers.get(); layer != nullptr; layer = layer->parent.get()) {
+        ownLayers.push_back(layer);
     }
-    for (const auto &symbol : otherMap.expressionSymbolMap()) {
-        _expressionSymbolMap[symbol.first.get()].insert(symbol.second.begin(), symbol.second.end());
+    auto isOwnLayer = [&ownLayers](const Layer *layer) {
+        return std::find(ownLayers.begin(), ownLayers.end(), layer) != ownLayers.end();
+    };
+    auto mergeMaps = [this](const ReachabilityMap &reachabilityMap,
+                            const SubstitutionMap &substitutionMap) {
+        for (const auto &[node, reachabilityExpression] : reachabilityMap) {
+            if (findReachability(node) == nullptr) {
+                _reachabilityMap.emplace(node, reachabilityExpression);
+            }
+        }
+        for (const auto &[expression, substitutionExpression] : substitutionMap) {
+            if (findSubstitution(expression) == nullptr) {
+                _substitutionMap.emplace(expression, substitutionExpression);
+            }
+        }
+    };
+
+    mergeMaps(otherMap._reachabilityMap, otherMap._substitutionMap);
+    for (const auto *layer = otherMap._sharedLayers.get(); layer != nullptr && !isOwnLayer(layer);
+         layer = layer->parent.get()) {
+        mergeMaps(layer->reachabilityMap, layer->substitutionMap);
     }
+    invalidateDependencies();
 }
 
 void NodeAnnotationMap::substitutePlaceholders(Transform &substitute) {
-    for (auto &[node, reachabilityExpression] : _reachabilityMap) {
+    invalidateDependencies();
+    for (auto &[node, reachabilityExpression] : reachabilityMap()) {
         reachabilityExpression->setCondition(
             reachabilityExpression->getCondition()->apply(substitute));
     }
@@ -54,12 +168,36 @@ void NodeAnnotationMap::substitutePlaceholders(Transform &substitute) {
     P4C_UNIMPLEMENTED("NodeAnnotationMap::substitutePlaceholders not implemented");
 }
 
-SymbolMap NodeAnnotationMap::reachabilitySymbolMap() const { return _reachabilitySymbolMap; }
+const SymbolDependencyIndex &NodeAnnotationMap::reachabilityDependencies() const {
+    if (!_reachabilityDependencies.has_value()) {
+        auto &dependencies = _reachabilityDependencies.emplace();
+        for (const auto &[node, reachabilityExpression] : reachabilityMap()) {
+            SymbolCollector collector;
+            reachabilityExpression->getCondition()->apply(collector);
+            dependencies.addDependencies(collector.collectedSymbols(), node);
+        }
+    }
+    return _reachabilityDependencies.value();
+}
 
-SymbolMap NodeAnnotationMap::expressionSymbolMap() const { return _expressionSymbolMap; }
+const SymbolDependencyIndex &NodeAnnotationMap::expressionDependencies() const {
+    if (!_expressionDependencies.has_value()) {
+        auto &dependencies = _expressionDependencies.emplace();
+        for (const auto &[expression, substitutionExpression] : substitutionMap()) {
+            SymbolCollector collector;
+            substitutionExpression->originalExpression()->apply(collector);
+            dependencies.addDependencies(collector.collectedSymbols(), expression);
+        }
+    }
+    return _expressionDependencies.value();
+}
 
-ReachabilityMap NodeAnnotationMap::reachabilityMap() const { return _reachabilityMap; }
+const ReachabilityMap &NodeAnnotationMap::reachabilityMap() const {
+    return flatten().reachabilityMap;
+}
 
-SubstitutionMap NodeAnnotationMap::substitutionMap() const { return _substitutionMap; }
+const SubstitutionMap &NodeAnnotationMap::substitutionMap() const {
+    return flatten().substitutionMap;
+}
 
 }  // namespace P4::P4Tools::Flay
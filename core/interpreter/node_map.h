@@ -1,6 +1,10 @@
 #ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_INTERPRETER_NODE_MAP_H_
 #define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_INTERPRETER_NODE_MAP_H_
 
+#include <memory>
+#include <optional>
+
+#include "backends/p4tools/modules/flay/core/control_plane/symbol_dependency_index.h"
 #include "backends/p4tools/modules/flay/core/interpreter/reachability_expression.h"
 #include "backends/p4tools/modules/flay/core/interpreter/substitution_expression.h"
 #include "ir/ir.h"
@@ -9,21 +13,70 @@
 namespace P4::P4Tools::Flay {
 
 /// Annotates P4C nodes with specific information (e.g., reachability or the present value).
+/// Copies of the map share their annotations. A copy moves the annotations added since the last
+/// copy into a layer, which the copy and the original then share. New annotations are added to
+/// a private map, so copying is cheap and merging a copy back only visits the annotations added
+/// after the copy was taken. The accessors return views instead of copies. They flatten the
+/// layers into a single layer first, splicing the layers no other map shares.
 class NodeAnnotationMap {
  private:
+    /// A set of annotations shared by several node annotation maps. A layer is only modified
+    /// while a single map holds it.
+    struct Layer {
+        /// The annotations which are older than the annotations of this layer.
+        std::shared_ptr<Layer> parent;
+
+        /// The reachability annotations of this layer.
+        ReachabilityMap reachabilityMap;
+
+        /// The expression annotations of this layer.
+        SubstitutionMap substitutionMap;
+
+        /// @returns the number of annotations in this layer.
+        [[nodiscard]] size_t size() const;
+
+        /// Move or copy the annotations of @param other into this layer. The annotations are
+        /// moved without allocation if @param other is not shared.
+        void absorb(std::shared_ptr<Layer> other);
+    };
+
+    /// The shared annotations. Every node is annotated in at most one layer.
+    mutable std::shared_ptr<Layer> _sharedLayers;
+
     /// Associated reachability information with a particular node.
-    ReachabilityMap _reachabilityMap;
+    /// Only contains nodes which are not annotated in the shared layers.
+    mutable ReachabilityMap _reachabilityMap;
 
     /// A mapping of expressions to their values in the node annotation map.
-    SubstitutionMap _substitutionMap;
+    /// Only contains expressions which are not annotated in the shared layers.
+    mutable SubstitutionMap _substitutionMap;
 
-    /// A mapping of symbolic variables to IR nodes that depend on these symbolic variables in the
-    /// node annotation map. This map can we used for incremental re-computation.
-    SymbolMap _expressionSymbolMap;
+    /// Indexes the expressions of the substitution map by the symbolic variables their values
+    /// depend on. This index is used for incremental re-computation and built on first use.
+    mutable std::optional<SymbolDependencyIndex> _expressionDependencies;
 
-    /// A mapping of symbolic variables to IR nodes that depend on these symbolic variables in the
-    /// node annotation map. This map can we used for incremental re-computation.
-    SymbolMap _reachabilitySymbolMap;
+    /// Indexes the nodes of the reachability map by the symbolic variables their conditions
+    /// depend on. This index is used for incremental re-computation and built on first use.
+    mutable std::optional<SymbolDependencyIndex> _reachabilityDependencies;
+
+    /// Move the private annotations into a new shared layer. Small layers are combined with
+    /// their parents so that the number of layers stays logarithmic in the number of
+    /// annotations.
+    /// @returns the shared layers.
+    std::shared_ptr<Layer> share() const;
+
+    /// Combine the private annotations and all layers into a single layer.
+    /// @returns the combined layer.
+    const Layer &flatten() const;
+
+    /// @returns the reachability expression of @param node or nullptr if there is none.
+    [[nodiscard]] ReachabilityExpression *findReachability(const IR::Node *node) const;
+
+    /// @returns the substitution expression of @param expression or nullptr if there is none.
+    [[nodiscard]] SubstitutionExpression *findSubstitution(const IR::Expression *expression) const;
+
+    /// Drop the dependency indices after the annotations have changed.
+    void invalidateDependencies();
 
  public:
     /// Initialize the reachability mapping for the given node.
@@ -36,22 +89,34 @@ class NodeAnnotationMap {
                                      const IR::Expression *cond);
 
     /// Merge an other node annotation map into this node annotation map.
+    /// Existing annotations are not overwritten.
     void mergeAnnotationMapping(const NodeAnnotationMap &otherMap);
 
     /// Substitute all placeholders in the node annotation map and update each condition.
     void substitutePlaceholders(Transform &substitute);
 
-    /// @returns the reachability symbol map accumulated in the map.
-    [[nodiscard]] SymbolMap reachabilitySymbolMap() const;
+    /// @returns the dependency index of the reachability map.
+    [[nodiscard]] const SymbolDependencyIndex &reachabilityDependencies() const;
 
-    /// @returns the expression symbol map accumulated in the map.
-    [[nodiscard]] SymbolMap expressionSymbolMap() const;
+    /// @returns the dependency index of the expression map.
+    [[nodiscard]] const SymbolDependencyIndex &expressionDependencies() const;
 
     /// @returns the reachability map associated with the node annotation map.
-    [[nodiscard]] ReachabilityMap reachabilityMap() const;
+    /// The view is valid until the node annotation map is modified or copied.
+    [[nodiscard]] const ReachabilityMap &reachabilityMap() const;
 
     /// @returns the expression map associated with the node annotation map.
-    [[nodiscard]] SubstitutionMap substitutionMap() const;
+    /// The view is valid until the node annotation map is modified or copied.
+    [[nodiscard]] const SubstitutionMap &substitutionMap() const;
+
+    NodeAnnotationMap() = default;
+
+    /// Copies share the annotations of @param other. Dependency indices are rebuilt on demand.
+    NodeAnnotationMap(const NodeAnnotationMap &other);
+    NodeAnnotationMap(NodeAnnotationMap &&) = default;
+    NodeAnnotationMap &operator=(const NodeAnnotationMap &other);
+    NodeAnnotationMap &operator=(NodeAnnotationMap &&) = default;
+    ~NodeAnnotationMap() = default;
 };
 
 }  // namespace P4::P4Tools::Flay
@@ -1,15 +1,17 @@
 #include "backends/p4tools/modules/flay/core/interpreter/parser_stepper.h"
 
-#include <optional>
+#include <vector>
 
 #include "backends/p4tools/common/lib/arch_spec.h"
 #include "backends/p4tools/common/lib/gen_eq.h"
+#include "backends/p4tools/modules/flay/core/control_plane/control_plane_objects.h"
 #include "backends/p4tools/modules/flay/core/interpreter/target.h"
 #include "ir/declaration.h"
 #include "ir/id.h"
 #include "ir/indexed_vector.h"
 #include "ir/irutils.h"
 #include "lib/cstring.h"
+#include "lib/error.h"
 #include "lib/exceptions.h"
 
 namespace P4::P4Tools::Flay {
@@ -22,6 +24,43 @@ ExecutionState &ParserStepper::getExecutionState() const {
     return stepper.get().getExecutionState();
 }
 
+namespace {
+
+/// Concatenate the components of @param selectKey into a single bit vector. The first component
+/// occupies the most significant bits, which matches the layout of parser value set members.
+const IR::Expression *flattenSelectKey(const IR::Expression *selectKey) {
+    std::vector<const IR::Expression *> components;
+    if (const auto *listKey = selectKey->to<IR::ListExpression>()) {
+        components.insert(components.end(), listKey->components.begin(),
+                          listKey->components.end());
+    } else if (const auto *structKey = selectKey->to<IR::StructExpression>()) {
+        for (const auto *component : structKey->components) {
+            components.push_back(component->expression);
+        }
+    } else {
+        components.push_back(selectKey);
+    }
+    const IR::Expression *flatKey = nullptr;
+    for (const auto *component : components) {
+        if (component->type->is<IR::Type_Boolean>()) {
+            component = new IR::Cast(IR::Type_Bits::get(1), component);
+        }
+        const auto *componentType = component->type->to<IR::Type_Bits>();
+        if (componentType == nullptr) {
+            P4C_UNIMPLEMENTED("Parser value set key %1% of type %2% is not supported.", component,
+                              component->type);
+        }
+        flatKey = flatKey == nullptr
+                      ? component
+                      : new IR::Concat(IR::Type_Bits::get(flatKey->type->width_bits() +
+                                                          componentType->width_bits()),
+                                       flatKey, component);
+    }
+    return flatKey;
+}
+
+}  // namespace
+
 bool ParserStepper::preorder(const IR::Node *node) {
     P4C_UNIMPLEMENTED("Node %1% of type %2% not implemented in the core stepper.", node,
                       node->node_type_name());
@@ -116,32 +155,28 @@ void ParserStepper::processSelectExpression(const IR::SelectExpression *selectEx
                 selectCase->state);
             continue;
         }
-        const IR::Expression *selectCaseMatchExpr = nullptr;
-
-        // We need to handle parser value sets a little differently, because we are converting them
-        // into a struct expression.
+        const IR::Expression *matchCond = nullptr;
+        // We need to handle parser value sets a little differently, because their members are
+        // configured by the control plane. The membership of the select key is represented by a
+        // variable, which the parser value set assigns once it is configured.
         // We do not resolve the value set in the expression resolver because resolution is only
         // supported in parser select expressions.
-        std::optional<std::string> parserValueSetName = std::nullopt;
         if (selectCase->keyset->type->is<IR::Type_Set>() &&
             selectCase->keyset->is<IR::PathExpression>()) {
             const auto *p4ValueSet =
                 executionState.findDecl(selectCase->keyset->checkedTo<IR::PathExpression>())
                     ->checkedTo<IR::P4ValueSet>();
-            // TODO: We should make this an explicit symbolic state variable for control plane
-            // configurations.
-            parserValueSetName = p4ValueSet->controlPlaneName();
-            selectCaseMatchExpr = executionState.createSymbolicExpression(
-                p4ValueSet->elementType, "pvs_" + parserValueSetName.value());
+            auto &controlPlaneConstraints = stepper.get().controlPlaneConstraints();
+            auto it = controlPlaneConstraints.find(p4ValueSet->controlPlaneName());
+            if (it == controlPlaneConstraints.end()) {
+                error("Parser value set %1% has no control plane configuration.",
+                      p4ValueSet->controlPlaneName());
+                return;
+            }
+            matchCond = it->second.get().checkedTo<ParserValueSet>()->addSelectKey(
+                flattenSelectKey(selectKeyExpr));
         } else {
-            selectCaseMatchExpr = resolver.computeResult(selectCase->keyset);
-        }
-
-        const auto *matchCond = GenEq::equate(selectKeyExpr, selectCaseMatchExpr);
-        // If there is a value set it only matches when it is configured.
-        if (parserValueSetName.has_value()) {
-            matchCond = new IR::LAnd(matchCond, ControlPlaneState::getParserValueSetConfigured(
-                                                    parserValueSetName.value()));
+            matchCond = GenEq::equate(selectKeyExpr, resolver.computeResult(selectCase->keyset));
         }
         auto &selectState = executionState.clone();
         selectState.addParserId(declId);
@@ -1,6 +1,10 @@
 #include "backends/p4tools/modules/flay/core/interpreter/partial_evaluator.h"
 
+#include <z3++.h>
+
+#include <cstdint>
 #include <cstdlib>
+#include <sstream>
 
 #include "backends/p4tools/common/lib/logging.h"
 #include "backends/p4tools/modules/flay/core/control_plane/bfruntime/protobuf.h"
@@ -8,12 +12,16 @@
 #include "backends/p4tools/modules/flay/core/control_plane/p4runtime/protobuf.h"
 #include "backends/p4tools/modules/flay/core/interpreter/program_info.h"
 #include "backends/p4tools/modules/flay/core/interpreter/target.h"
+#include "backends/p4tools/modules/flay/core/lib/expression_interner.h"
 #include "backends/p4tools/modules/flay/core/lib/incremental_analysis.h"
+#include "backends/p4tools/modules/flay/core/lib/memory_usage.h"
 #include "backends/p4tools/modules/flay/core/lib/return_macros.h"
-#include "backends/p4tools/modules/flay/core/specialization/passes/specializer.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_result_cache.h"
 #include "backends/p4tools/modules/flay/core/specialization/z3/reachability_map.h"
 #include "backends/p4tools/modules/flay/core/specialization/z3/substitution_map.h"
 #include "backends/p4tools/modules/flay/options.h"
+#include "flay_build_id.h"  // Generated at build time, defines FLAY_BUILD_ID.
+#include "frontends/p4/toP4/toP4.h"
 #include "lib/error.h"
 #include "lib/timer.h"
 
@@ -44,6 +52,19 @@ std::string PartialEvaluationStatistics::toFormattedString() const {
     return output.str();
 }
 
+void PartialEvaluationStatistics::exportTo(StatisticsReport &report,
+                                           std::string_view section) const {
+    uint64_t replacedCount = 0;
+    for (const auto &[node, replaced] : eliminatedNodes) {
+        if (replaced != nullptr) {
+            replacedCount++;
+        }
+    }
+    report.set(section, "eliminated_nodes",
+               static_cast<uint64_t>(eliminatedNodes.size()) - replacedCount);
+    report.set(section, "replaced_nodes", replacedCount);
+}
+
 namespace {
 
 AbstractReachabilityMap *initializeReachabilityMap(ReachabilityMapType mapType,
@@ -70,6 +91,20 @@ AbstractSubstitutionMap *initializeSubstitutionMap(ReachabilityMapType mapType,
     return initializedSubstitutionMap;
 }
 
+/// @returns a fingerprint of @param program, the target in @param flayOptions, and the builds of
+/// Flay and Z3. Results in the persistent result cache are only reused for the program and the
+/// build they were computed with, because translation and simplification differ between builds.
+uint64_t computeProgramFingerprint(const IR::P4Program &program, const FlayOptions &flayOptions) {
+    std::stringstream programText;
+    P4::ToP4 toP4(&programText, false);
+    program.apply(toP4);
+    auto fingerprint = Z3ResultCache::hashString(FLAY_BUILD_ID);
+    fingerprint = Z3ResultCache::hashString(Z3_get_full_version(), fingerprint);
+    fingerprint = Z3ResultCache::hashString(flayOptions.target.c_str(), fingerprint);
+    fingerprint = Z3ResultCache::hashString(flayOptions.arch.c_str(), fingerprint);
+    return Z3ResultCache::hashString(programText.str(), fingerprint);
+}
+
 }  // namespace
 
 AbstractReachabilityMap *PartialEvaluation::mutableReachabilityMap() { return _reachabilityMap; }
@@ -120,13 +155,23 @@ std::optional<bool> PartialEvaluation::checkForSemanticsChange(const SymbolSet &
 
 std::optional<const IR::P4Program *> PartialEvaluation::specializeProgram(
     const IR::P4Program &program) {
-    auto flaySpecializer = FlaySpecializer(_refMap, *_reachabilityMap, *_substitutionMap);
-    const auto *optimizedProgram = program.apply(flaySpecializer);
+    // Only the declarations containing nodes whose reachability or substitution changed since
+    // the last specialization need to be specialized again.
+    auto changedNodes = _reachabilityMap->takeChangedNodes();
+    auto changedExpressions = _substitutionMap->takeChangedNodes();
+    changedNodes.insert(changedExpressions.begin(), changedExpressions.end());
+    const IR::P4Program *optimizedProgram = nullptr;
+    if (_specializer == nullptr) {
+        _specializer = new IncrementalSpecializer(_refMap, *_reachabilityMap, *_substitutionMap);
+        optimizedProgram = _specializer->specialize(program);
+    } else {
+        optimizedProgram = _specializer->respecialize(program, changedNodes);
+    }
     if (errorCount() > 0) {
         return std::nullopt;
     }
     // Update the list of eliminated nodes.
-    _eliminatedNodes = flaySpecializer.eliminatedNodes();
+    _eliminatedNodes = _specializer->eliminatedNodes();
     return optimizedProgram;
 }
 
@@ -135,14 +180,14 @@ std::optional<SymbolSet> PartialEvaluation::convertControlPlaneUpdate(
     SymbolSet symbolSet;
     if (const auto *p4RuntimeUpdate = controlPlaneUpdate.to<P4RuntimeControlPlaneUpdate>()) {
         auto result = P4Runtime::updateControlPlaneConstraintsWithEntityMessage(
-            p4RuntimeUpdate->update.entity(), *flayCompilerResult().getP4RuntimeApi().p4Info,
+            p4RuntimeUpdate->update.entity(), flayCompilerResult().getP4InfoIndex(),
             _controlPlaneConstraints, p4RuntimeUpdate->update.type(), symbolSet);
         if (result != EXIT_SUCCESS) {
             return std::nullopt;
         }
     } else if (const auto *bfRuntimeUpdate = controlPlaneUpdate.to<BfRuntimeControlPlaneUpdate>()) {
         auto result = BfRuntime::updateControlPlaneConstraintsWithEntityMessage(
-            bfRuntimeUpdate->update.entity(), *flayCompilerResult().getP4RuntimeApi().p4Info,
+            bfRuntimeUpdate->update.entity(), flayCompilerResult().getP4InfoIndex(),
             _controlPlaneConstraints, bfRuntimeUpdate->update.type(), symbolSet);
         if (result != EXIT_SUCCESS) {
             return std::nullopt;
@@ -163,17 +208,7 @@ PartialEvaluation::PartialEvaluation(const FlayOptions &flayOptions,
     flayCompilerResult.getProgram().apply(P4::ResolveReferences(&_refMap));
 }
 
-int PartialEvaluation::initialize() {
-    printInfo("Computing initial control plane constraints...");
-    // Gather the initial control-plane configuration. Also from a file input,
-    // if present.
-    ASSIGN_OR_RETURN(
-        _controlPlaneConstraints,
-        FlayTarget::computeControlPlaneConstraints(flayCompilerResult(), flayOptions()),
-        EXIT_FAILURE);
-
-    ExecutionState executionState(&programInfo().getP4Program());
-
+void PartialEvaluation::analyzeDataPlane(ExecutionState &executionState) {
     printInfo("Starting data plane analysis...");
     Util::ScopedTimer timer("Data plane analysis");
     const auto *pipelineSequence = programInfo().getPipelineSequence();
@@ -186,12 +221,60 @@ int PartialEvaluation::initialize() {
     /// Substitute any placeholder variables encountered in the execution state.
     printInfo("Substituting placeholder variables...");
     executionState.substitutePlaceholders();
+    // The interned expressions stay valid, only the lookup tables are released.
+    ExpressionInterner::clear();
+}
+
+int PartialEvaluation::initialize() {
+    printInfo("Computing initial control plane constraints...");
+    // Gather the initial control-plane configuration. Also from a file input,
+    // if present.
+    ASSIGN_OR_RETURN(
+        _controlPlaneConstraints,
+        FlayTarget::computeControlPlaneConstraints(flayCompilerResult(), flayOptions()),
+        EXIT_FAILURE);
+
+    ExecutionState executionState(&programInfo().getP4Program());
+    const NodeAnnotationMap *nodeAnnotationMap = &executionState.nodeAnnotationMap();
+    const auto *snapshot = _partialEvaluationOptions.get().snapshot;
+    if (snapshot != nullptr) {
+        printInfo("Restoring data plane analysis from snapshot...");
+        if (snapshot->restoreKeys(mutableControlPlaneConstraints()) != EXIT_SUCCESS) {
+            return EXIT_FAILURE;
+        }
+        nodeAnnotationMap = &snapshot->nodeAnnotationMap();
+    } else {
+        analyzeDataPlane(executionState);
+        MemoryUsage::record("Data plane analysis");
+    }
+
+    auto saveSnapshot = flayOptions().saveSnapshot();
+    if (saveSnapshot.has_value()) {
+        printInfo("Writing snapshot...");
+        if (FlaySnapshot::save(saveSnapshot.value(), flayOptions(), flayCompilerResult(),
+                               *nodeAnnotationMap, controlPlaneConstraints()) != EXIT_SUCCESS) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto z3ResultCache = flayOptions().z3ResultCache();
+    if (z3ResultCache.has_value() &&
+        _partialEvaluationOptions.get().mapType == ReachabilityMapType::kZ3Precomputed) {
+        printInfo("Opening Z3 result cache...");
+        auto programFingerprint =
+            computeProgramFingerprint(programInfo().getP4Program(), flayOptions());
+        if (Z3ResultCache::open(z3ResultCache.value(), programFingerprint,
+                                flayOptions().z3ResultCacheCapacity()) != EXIT_SUCCESS) {
+            return EXIT_FAILURE;
+        }
+    }
 
     printInfo("Setting up analysis maps...");
-    _reachabilityMap = initializeReachabilityMap(_partialEvaluationOptions.get().mapType,
-                                                 executionState.nodeAnnotationMap());
-    _substitutionMap = initializeSubstitutionMap(_partialEvaluationOptions.get().mapType,
-                                                 executionState.nodeAnnotationMap());
+    _reachabilityMap =
+        initializeReachabilityMap(_partialEvaluationOptions.get().mapType, *nodeAnnotationMap);
+    _substitutionMap =
+        initializeSubstitutionMap(_partialEvaluationOptions.get().mapType, *nodeAnnotationMap);
+    MemoryUsage::record("Analysis map setup");
 
     printInfo("Precomputing reachability and substitution maps with initial constraints...");
     auto reachabilityResult = _reachabilityMap->recomputeReachability(controlPlaneConstraints());
@@ -203,6 +286,7 @@ int PartialEvaluation::initialize() {
     if (!substitutionResult.has_value()) {
         return EXIT_FAILURE;
     }
+    MemoryUsage::record("Initial map computation");
     return EXIT_SUCCESS;
 }
 
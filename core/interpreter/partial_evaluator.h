@@ -7,8 +7,11 @@
 
 #include "backends/p4tools/modules/flay/core/control_plane/control_plane_item.h"
 #include "backends/p4tools/modules/flay/core/interpreter/compiler_result.h"
+#include "backends/p4tools/modules/flay/core/interpreter/execution_state.h"
 #include "backends/p4tools/modules/flay/core/interpreter/program_info.h"
+#include "backends/p4tools/modules/flay/core/interpreter/snapshot.h"
 #include "backends/p4tools/modules/flay/core/lib/incremental_analysis.h"
+#include "backends/p4tools/modules/flay/core/specialization/incremental_specializer.h"
 #include "backends/p4tools/modules/flay/core/specialization/passes/specialization_statistics.h"
 #include "backends/p4tools/modules/flay/core/specialization/reachability_map.h"
 #include "backends/p4tools/modules/flay/core/specialization/substitution_map.h"
@@ -22,6 +25,10 @@ enum ReachabilityMapType { kZ3Precomputed, kDefault };
 struct PartialEvaluationOptions {
     /// The type of map to initialize.
     ReachabilityMapType mapType = ReachabilityMapType::kZ3Precomputed;
+
+    /// If set, the result of the data plane analysis is restored from this snapshot instead of
+    /// stepping through the program.
+    const FlaySnapshot *snapshot = nullptr;
 };
 
 struct PartialEvaluationStatistics : public AnalysisStatistics {
@@ -32,6 +39,7 @@ struct PartialEvaluationStatistics : public AnalysisStatistics {
     std::vector<EliminatedReplacedPair> eliminatedNodes;
 
     [[nodiscard]] std::string toFormattedString() const override;
+    void exportTo(StatisticsReport &report, std::string_view section) const override;
     DECLARE_TYPEINFO(PartialEvaluationStatistics);
 };
 
@@ -50,6 +58,10 @@ class PartialEvaluation : public IncrementalAnalysis {
     /// A map to look up declaration references.
     P4::ReferenceMap _refMap;
 
+    /// Caches the specialized program and only respecializes the declarations affected by a
+    /// change. Created on the first specialization.
+    IncrementalSpecializer *_specializer = nullptr;
+
     /// Options for partial evaluation.
     std::reference_wrapper<const PartialEvaluationOptions> _partialEvaluationOptions;
 
@@ -71,6 +83,9 @@ class PartialEvaluation : public IncrementalAnalysis {
     /// program info object was initialized with.
     ControlPlaneConstraints &mutableControlPlaneConstraints();
 
+    /// Step through the program and collect the annotations in @param executionState.
+    void analyzeDataPlane(ExecutionState &executionState);
+
  protected:
     std::optional<bool> checkForSemanticsChange() override;
     std::optional<bool> checkForSemanticsChange(const SymbolSet &symbolSet) override;
@@ -0,0 +1,464 @@
+#include "backends/p4tools/modules/flay/core/interpreter/snapshot.h"
+
+#include <google/protobuf/text_format.h>
+
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "backends/p4tools/common/lib/logging.h"
+#include "backends/p4tools/modules/flay/core/control_plane/symbols.h"
+#include "backends/p4tools/modules/flay/core/interpreter/target.h"
+#include "backends/p4tools/modules/flay/core/lib/return_macros.h"
+#include "ir/json_generator.h"
+#include "ir/json_loader.h"
+#include "ir/visitor.h"
+#include "lib/error.h"
+#include "lib/exceptions.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include "p4/config/v1/p4info.pb.h"
+#pragma GCC diagnostic pop
+
+namespace P4::P4Tools::Flay {
+
+namespace {
+
+/// Maps a node to the node of the original program with the same source information and clone id.
+using OriginalNodeMap = std::map<const IR::Node *, const IR::Node *, SourceIdCmp>;
+
+/// Collects all the nodes of the original program.
+class OriginalNodeCollector : public Inspector {
+    std::reference_wrapper<OriginalNodeMap> _originalNodes;
+
+ public:
+    explicit OriginalNodeCollector(OriginalNodeMap &originalNodes)
+        : _originalNodes(originalNodes) {
+        setName("OriginalNodeCollector");
+    }
+
+    bool preorder(const IR::Node *node) override {
+        _originalNodes.get().emplace(node, node);
+        return true;
+    }
+};
+
+/// The table keys of a single table as listed in the snapshot header.
+struct TableKeyManifest {
+    std::string tableName;
+    /// The kind and the name of each key.
+    std::vector<std::pair<std::string, std::string>> keys;
+};
+
+/// The select keys of a single parser value set as listed in the snapshot header.
+struct ValueSetKeyManifest {
+    std::string valueSetName;
+    size_t keyCount = 0;
+};
+
+/// @returns the kind and the key expression of @param key.
+std::pair<std::string_view, const IR::Expression *> describeKey(const TableMatchKey &key) {
+    if (const auto *exactKey = key.to<ExactTableMatchKey>()) {
+        return {"exact", exactKey->keyExpression()};
+    }
+    if (const auto *ternaryKey = key.to<TernaryTableMatchKey>()) {
+        return {"ternary", ternaryKey->keyExpression()};
+    }
+    if (const auto *lpmKey = key.to<LpmTableMatchKey>()) {
+        return {"lpm", lpmKey->keyExpression()};
+    }
+    if (const auto *optionalKey = key.to<OptionalMatchKey>()) {
+        return {"optional", optionalKey->keyExpression()};
+    }
+    if (const auto *selectorKey = key.to<SelectorMatchKey>()) {
+        return {"selector", selectorKey->keyExpression()};
+    }
+    if (const auto *rangeKey = key.to<RangeTableMatchKey>()) {
+        return {"range", rangeKey->keyExpression()};
+    }
+    BUG("Unsupported table match key %1% of table %2%.", key.name(), key.tableName());
+}
+
+/// @returns a table match key of the given @param kind or nullptr if the kind is unknown.
+const TableMatchKey *createKey(std::string_view kind, cstring tableName, cstring name,
+                               const IR::Expression *keyExpression) {
+    if (kind == "exact") {
+        return new ExactTableMatchKey(tableName, name, keyExpression);
+    }
+    if (kind == "ternary") {
+        return new TernaryTableMatchKey(tableName, name, keyExpression);
+    }
+    if (kind == "lpm") {
+        return new LpmTableMatchKey(tableName, name, keyExpression);
+    }
+    if (kind == "optional") {
+        return new OptionalMatchKey(tableName, name, keyExpression);
+    }
+    if (kind == "selector") {
+        return new SelectorMatchKey(tableName, name, keyExpression);
+    }
+    if (kind == "range") {
+        return new RangeTableMatchKey(tableName, name, keyExpression);
+    }
+    return nullptr;
+}
+
+/// Reads the next token from @param input and checks that it is @param field.
+bool readField(std::istream &input, std::string_view field) {
+    std::string token;
+    input >> token;
+    return !input.fail() && token == field;
+}
+
+/// Reads a section that is introduced by @param field and its size in bytes.
+std::optional<std::string> readSection(std::istream &input, std::string_view field) {
+    size_t size = 0;
+    if (!readField(input, field) || !(input >> size)) {
+        return std::nullopt;
+    }
+    // Skip the line break after the size.
+    input.get();
+    std::string section(size, '\0');
+    if (!input.read(section.data(), static_cast<std::streamsize>(size))) {
+        return std::nullopt;
+    }
+    return section;
+}
+
+}  // namespace
+
+FlaySnapshot::FlaySnapshot(const FlayCompilerResult &compilerResult,
+                           NodeAnnotationMap nodeAnnotationMap,
+                           std::map<cstring, KeyMap> tableKeyMaps,
+                           ValueSetSelectKeys valueSetSelectKeys,
+                           p4::v1::WriteRequest entities)
+    : _compilerResult(compilerResult),
+      _nodeAnnotationMap(std::move(nodeAnnotationMap)),
+      _tableKeyMaps(std::move(tableKeyMaps)),
+      _valueSetSelectKeys(std::move(valueSetSelectKeys)),
+      _entities(std::move(entities)) {}
+
+int FlaySnapshot::save(const std::filesystem::path &path, const FlayOptions &options,
+                       const FlayCompilerResult &compilerResult,
+                       const NodeAnnotationMap &nodeAnnotationMap,
+                       const ControlPlaneConstraints &constraints) {
+    const auto &originalProgram = compilerResult.getOriginalProgram();
+
+    // The annotations are looked up with nodes of the original program. The data plane analysis
+    // annotates nodes of the mid end program, which only match by their source information and
+    // clone id. Clone ids are not preserved by the JSON loader, so we store the matching node of
+    // the original program instead.
+    OriginalNodeMap originalNodes;
+    originalProgram.apply(OriginalNodeCollector(originalNodes));
+    auto toOriginalNode = [&originalNodes](const IR::Node *node) {
+        auto it = originalNodes.find(node);
+        return it != originalNodes.end() ? it->second : node;
+    };
+
+    IR::Vector<IR::Node> objects;
+    objects.push_back(&originalProgram);
+    objects.push_back(&compilerResult.getProgram());
+    const auto &reachabilityMap = nodeAnnotationMap.reachabilityMap();
+    for (const auto &[node, reachabilityExpression] : reachabilityMap) {
+        objects.push_back(toOriginalNode(node));
+        objects.push_back(reachabilityExpression->getCondition());
+    }
+    const auto &substitutionMap = nodeAnnotationMap.substitutionMap();
+    for (const auto &[expression, substitutionExpression] : substitutionMap) {
+        const auto *originalExpression = toOriginalNode(expression)->to<IR::Expression>();
+        objects.push_back(originalExpression != nullptr ? originalExpression : expression);
+        objects.push_back(substitutionExpression->originalExpression());
+        objects.push_back(substitutionExpression->condition());
+    }
+    std::stringstream tableManifest;
+    size_t tableCount = 0;
+    for (const auto &[tableName, controlPlaneItem] : constraints) {
+        const auto *tableConfiguration = controlPlaneItem.get().to<TableConfiguration>();
+        if (tableConfiguration == nullptr || tableConfiguration->tableKeyMap().empty()) {
+            continue;
+        }
+        const auto &keyMap = tableConfiguration->tableKeyMap();
+        tableManifest << "table " << std::quoted(tableName.c_str()) << " " << keyMap.size()
+                      << "\n";
+        for (const auto *key : keyMap) {
+            auto [kind, keyExpression] = describeKey(*key);
+            tableManifest << "key " << kind << " " << std::quoted(key->name().c_str()) << "\n";
+            objects.push_back(keyExpression);
+        }
+        tableCount++;
+    }
+    // Parser value sets only learn their select keys during the data plane analysis.
+    std::stringstream valueSetManifest;
+    size_t valueSetCount = 0;
+    for (const auto &[valueSetName, controlPlaneItem] : constraints) {
+        const auto *parserValueSet = controlPlaneItem.get().to<ParserValueSet>();
+        if (parserValueSet == nullptr || parserValueSet->selectKeys().empty()) {
+            continue;
+        }
+        const auto &selectKeys = parserValueSet->selectKeys();
+        valueSetManifest << "valueset " << std::quoted(valueSetName.c_str()) << " "
+                         << selectKeys.size() << "\n";
+        for (const auto *selectKey : selectKeys) {
+            objects.push_back(selectKey);
+        }
+        valueSetCount++;
+    }
+
+    std::string p4Info;
+    RETURN_IF_FALSE_WITH_MESSAGE(google::protobuf::TextFormat::PrintToString(
+                                     *compilerResult.getP4RuntimeApi().p4Info, &p4Info),
+                                 EXIT_FAILURE, error("Failed to serialize the P4Info."));
+    // Source information is required to match nodes and to report eliminated nodes.
+    std::stringstream json;
+    JSONGenerator(json, true) << new IR::P4Program(objects) << std::endl;
+    auto jsonString = json.str();
+
+    std::ofstream output(path, std::ios::binary);
+    if (!output.is_open()) {
+        error("Could not open snapshot file %1% for writing.", path.c_str());
+        return EXIT_FAILURE;
+    }
+    output << kMagic << " " << kVersion << "\n";
+    output << "target " << std::quoted(options.target.c_str()) << " "
+           << std::quoted(options.arch.c_str()) << "\n";
+    output << "reachability " << reachabilityMap.size() << "\n";
+    output << "substitution " << substitutionMap.size() << "\n";
+    output << "tables " << tableCount << "\n" << tableManifest.str();
+    output << "valuesets " << valueSetCount << "\n" << valueSetManifest.str();
+    output << "p4info " << p4Info.size() << "\n" << p4Info << "\n";
+    output << "ir " << jsonString.size() << "\n" << jsonString << "\n";
+    output.close();
+    if (output.fail()) {
+        error("Failed to write snapshot file %1%.", path.c_str());
+        return EXIT_FAILURE;
+    }
+    printInfo("Wrote snapshot to %1%", path.c_str());
+    return EXIT_SUCCESS;
+}
+
+int FlaySnapshot::appendEntities(const std::filesystem::path &path,
+                                 const p4::v1::WriteRequest &entities) {
+    std::string entitiesString;
+    RETURN_IF_FALSE_WITH_MESSAGE(google::protobuf::TextFormat::PrintToString(entities,
+                                                                             &entitiesString),
+                                 EXIT_FAILURE, error("Failed to serialize the entities."));
+    std::ofstream output(path, std::ios::binary | std::ios::app);
+    if (!output.is_open()) {
+        error("Could not open snapshot file %1% for writing.", path.c_str());
+        return EXIT_FAILURE;
+    }
+    output << "entities " << entitiesString.size() << "\n" << entitiesString << "\n";
+    output.close();
+    if (output.fail()) {
+        error("Failed to write snapshot file %1%.", path.c_str());
+        return EXIT_FAILURE;
+    }
+    printInfo("Wrote %1% entities to snapshot %2%", entities.updates_size(), path.c_str());
+    return EXIT_SUCCESS;
+}
+
+const FlaySnapshot *FlaySnapshot::load(const std::filesystem::path &path,
+                                       const FlayOptions &options) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input.is_open()) {
+        error("Could not open snapshot file %1%.", path.c_str());
+        return nullptr;
+    }
+    int version = 0;
+    RETURN_IF_FALSE_WITH_MESSAGE(readField(input, kMagic) && (input >> version), nullptr,
+                                 error("%1% is not a Flay snapshot.", path.c_str()));
+    RETURN_IF_FALSE_WITH_MESSAGE(
+        version == kVersion, nullptr,
+        error("Snapshot %1% has version %2%, but only version %3% is supported. Please recreate "
+              "the snapshot.",
+              path.c_str(), version, kVersion));
+
+    // Parse the header.
+    std::string target;
+    std::string arch;
+    size_t reachabilityCount = 0;
+    size_t substitutionCount = 0;
+    size_t tableCount = 0;
+    bool validHeader = readField(input, "target") && (input >> std::quoted(target)) &&
+                       (input >> std::quoted(arch)) && readField(input, "reachability") &&
+                       (input >> reachabilityCount) && readField(input, "substitution") &&
+                       (input >> substitutionCount) && readField(input, "tables") &&
+                       (input >> tableCount);
+    std::vector<TableKeyManifest> tableManifests(validHeader ? tableCount : 0);
+    size_t keyCount = 0;
+    for (auto &tableManifest : tableManifests) {
+        size_t tableKeyCount = 0;
+        validHeader = validHeader && readField(input, "table") &&
+                      (input >> std::quoted(tableManifest.tableName)) && (input >> tableKeyCount);
+        for (size_t idx = 0; validHeader && idx < tableKeyCount; ++idx) {
+            std::string kind;
+            std::string name;
+            validHeader = readField(input, "key") && (input >> kind) && (input >> std::quoted(name));
+            tableManifest.keys.emplace_back(kind, name);
+        }
+        keyCount += tableKeyCount;
+    }
+    size_t valueSetCount = 0;
+    validHeader = validHeader && readField(input, "valuesets") && (input >> valueSetCount);
+    std::vector<ValueSetKeyManifest> valueSetManifests(validHeader ? valueSetCount : 0);
+    size_t selectKeyCount = 0;
+    for (auto &valueSetManifest : valueSetManifests) {
+        validHeader = validHeader && readField(input, "valueset") &&
+                      (input >> std::quoted(valueSetManifest.valueSetName)) &&
+                      (input >> valueSetManifest.keyCount);
+        selectKeyCount += valueSetManifest.keyCount;
+    }
+    RETURN_IF_FALSE_WITH_MESSAGE(validHeader, nullptr,
+                                 error("Snapshot %1% has an invalid header.", path.c_str()));
+    RETURN_IF_FALSE_WITH_MESSAGE(
+        target == options.target.c_str() && arch == options.arch.c_str(), nullptr,
+        error("Snapshot %1% was created for target %2% and architecture %3%.", path.c_str(),
+              target, arch));
+
+    ASSIGN_OR_RETURN_WITH_MESSAGE(auto p4InfoString, readSection(input, "p4info"), nullptr,
+                                  error("Snapshot %1% has no valid P4Info.", path.c_str()));
+    auto *p4Info = new p4::config::v1::P4Info();
+    RETURN_IF_FALSE_WITH_MESSAGE(google::protobuf::TextFormat::ParseFromString(p4InfoString, p4Info),
+                                 nullptr,
+                                 error("Snapshot %1% has no valid P4Info.", path.c_str()));
+    ASSIGN_OR_RETURN_WITH_MESSAGE(auto jsonString, readSection(input, "ir"), nullptr,
+                                  error("Snapshot %1% has no valid program.", path.c_str()));
+    // The entities are optional. They are only present if they were appended after the run.
+    p4::v1::WriteRequest entities;
+    if (!(input >> std::ws).eof()) {
+        ASSIGN_OR_RETURN_WITH_MESSAGE(auto entitiesString, readSection(input, "entities"), nullptr,
+                                      error("Snapshot %1% has no valid entities.", path.c_str()));
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            google::protobuf::TextFormat::ParseFromString(entitiesString, &entities), nullptr,
+            error("Snapshot %1% has no valid entities.", path.c_str()));
+    }
+
+    printInfo("Loading programs from snapshot %1%...", path.c_str());
+    std::istringstream json(jsonString);
+    JSONLoader loader(json);
+    const IR::Node *node = nullptr;
+    loader >> node;
+    const auto *container = node != nullptr ? node->to<IR::P4Program>() : nullptr;
+    auto expectedSize =
+        2 + 2 * reachabilityCount + 3 * substitutionCount + keyCount + selectKeyCount;
+    RETURN_IF_FALSE_WITH_MESSAGE(
+        container != nullptr && container->objects.size() == expectedSize, nullptr,
+        error("Snapshot %1% is corrupted. Expected %2% serialized nodes.", path.c_str(),
+              expectedSize));
+    const auto &objects = container->objects;
+    const auto *originalProgram = objects.at(0)->to<IR::P4Program>();
+    const auto *midEndProgram = objects.at(1)->to<IR::P4Program>();
+    RETURN_IF_FALSE_WITH_MESSAGE(
+        originalProgram != nullptr && midEndProgram != nullptr, nullptr,
+        error("Snapshot %1% is corrupted. Expected two P4 programs.", path.c_str()));
+
+    // Restore the annotations in the order they were written.
+    size_t objectIdx = 2;
+    auto nextExpression = [&objects, &objectIdx]() {
+        return objects.at(objectIdx++)->to<IR::Expression>();
+    };
+    NodeAnnotationMap nodeAnnotationMap;
+    for (size_t idx = 0; idx < reachabilityCount; ++idx) {
+        const auto *annotatedNode = objects.at(objectIdx++);
+        const auto *condition = nextExpression();
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            condition != nullptr, nullptr,
+            error("Snapshot %1% is corrupted. Invalid reachability condition.", path.c_str()));
+        nodeAnnotationMap.initializeReachabilityMapping(annotatedNode, condition);
+    }
+    for (size_t idx = 0; idx < substitutionCount; ++idx) {
+        const auto *expression = nextExpression();
+        const auto *value = nextExpression();
+        const auto *condition = nextExpression();
+        RETURN_IF_FALSE_WITH_MESSAGE(
+            expression != nullptr && value != nullptr && condition != nullptr, nullptr,
+            error("Snapshot %1% is corrupted. Invalid substitution.", path.c_str()));
+        nodeAnnotationMap.initializeExpressionMapping(expression, value, condition);
+    }
+    std::map<cstring, KeyMap> tableKeyMaps;
+    for (const auto &tableManifest : tableManifests) {
+        auto tableName = cstring(tableManifest.tableName);
+        auto &keyMap = tableKeyMaps[tableName];
+        for (const auto &[kind, name] : tableManifest.keys) {
+            const auto *keyExpression = nextExpression();
+            const auto *key =
+                keyExpression != nullptr ? createKey(kind, tableName, cstring(name), keyExpression)
+                                         : nullptr;
+            RETURN_IF_FALSE_WITH_MESSAGE(
+                key != nullptr, nullptr,
+                error("Snapshot %1% is corrupted. Invalid key %2% of table %3%.", path.c_str(),
+                      name, tableManifest.tableName));
+            keyMap.push_back(key);
+        }
+    }
+
+    ValueSetSelectKeys valueSetSelectKeys;
+    for (const auto &valueSetManifest : valueSetManifests) {
+        auto &selectKeys = valueSetSelectKeys[cstring(valueSetManifest.valueSetName)];
+        for (size_t idx = 0; idx < valueSetManifest.keyCount; ++idx) {
+            const auto *selectKey = nextExpression();
+            RETURN_IF_FALSE_WITH_MESSAGE(
+                selectKey != nullptr, nullptr,
+                error("Snapshot %1% is corrupted. Invalid select key of parser value set %2%.",
+                      path.c_str(), valueSetManifest.valueSetName));
+            selectKeys.push_back(selectKey);
+        }
+    }
+
+    ASSIGN_OR_RETURN(auto defaultConstraints,
+                     FlayTarget::generateDefaultControlPlaneConstraints(*midEndProgram), nullptr);
+    const auto *compilerResult =
+        new FlayCompilerResult(CompilerResult(*midEndProgram), *originalProgram,
+                               P4::P4RuntimeAPI(p4Info, nullptr), defaultConstraints);
+    return new FlaySnapshot(*compilerResult, std::move(nodeAnnotationMap), std::move(tableKeyMaps),
+                            std::move(valueSetSelectKeys), std::move(entities));
+}
+
+const FlayCompilerResult &FlaySnapshot::compilerResult() const { return _compilerResult; }
+
+const NodeAnnotationMap &FlaySnapshot::nodeAnnotationMap() const { return _nodeAnnotationMap; }
+
+const p4::v1::WriteRequest &FlaySnapshot::entities() const { return _entities; }
+
+int FlaySnapshot::restoreKeys(ControlPlaneConstraints &constraints) const {
+    for (const auto &[tableName, keyMap] : _tableKeyMaps) {
+        auto it = constraints.find(tableName);
+        if (it == constraints.end()) {
+            error("Table %1% has no control plane configuration.", tableName);
+            return EXIT_FAILURE;
+        }
+        auto *tableConfiguration = it->second.get().to<TableConfiguration>();
+        if (tableConfiguration == nullptr) {
+            error("Control plane item %1% is not a table.", tableName);
+            return EXIT_FAILURE;
+        }
+        tableConfiguration->setTableKeyMatch(keyMap);
+    }
+    for (const auto &[valueSetName, selectKeys] : _valueSetSelectKeys) {
+        auto it = constraints.find(valueSetName);
+        if (it == constraints.end()) {
+            error("Parser value set %1% has no control plane configuration.", valueSetName);
+            return EXIT_FAILURE;
+        }
+        auto *parserValueSet = it->second.get().to<ParserValueSet>();
+        if (parserValueSet == nullptr) {
+            error("Control plane item %1% is not a parser value set.", valueSetName);
+            return EXIT_FAILURE;
+        }
+        // Registering the keys in their original order restores the indices of the match
+        // variables the annotations refer to.
+        for (const auto *selectKey : selectKeys) {
+            parserValueSet->addSelectKey(selectKey);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+}  // namespace P4::P4Tools::Flay
@@ -0,0 +1,109 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_INTERPRETER_SNAPSHOT_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_INTERPRETER_SNAPSHOT_H_
+
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string_view>
+#include <vector>
+
+#include "backends/p4tools/modules/flay/core/control_plane/control_plane_item.h"
+#include "backends/p4tools/modules/flay/core/control_plane/control_plane_objects.h"
+#include "backends/p4tools/modules/flay/core/interpreter/compiler_result.h"
+#include "backends/p4tools/modules/flay/core/interpreter/node_map.h"
+#include "backends/p4tools/modules/flay/options.h"
+#include "lib/cstring.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include "p4/v1/p4runtime.pb.h"
+#pragma GCC diagnostic pop
+
+namespace P4::P4Tools::Flay {
+
+/// A snapshot of the compiled program and the result of the data plane analysis. Restoring a
+/// snapshot skips the compiler and the symbolic execution of the program.
+///
+/// A snapshot file starts with a textual header containing the format version, the target, and
+/// the number of serialized annotations. It is followed by the P4Info in text format and by a
+/// single IR JSON document. The JSON document holds the original program, the mid end program,
+/// and all annotated nodes, so nodes shared between them remain shared after loading.
+/// The control plane constraints are recomputed from the program. Only the table keys and the
+/// parser value set select keys computed by the data plane analysis are stored. The P4Runtime
+/// entities applied while the snapshot was taken can be appended as a final, optional section.
+/// They are stored as a write request in text format, which restores the runtime configuration
+/// when it is applied to a session created from the snapshot.
+class FlaySnapshot {
+ public:
+    /// The version of the snapshot format. Snapshots with a different version are rejected.
+    static constexpr int kVersion = 2;
+
+    /// The keyword every snapshot file starts with.
+    static constexpr std::string_view kMagic = "flay-snapshot";
+
+ private:
+    /// The compiler result restored from the snapshot.
+    std::reference_wrapper<const FlayCompilerResult> _compilerResult;
+
+    /// The reachability and substitution annotations computed by the data plane analysis.
+    NodeAnnotationMap _nodeAnnotationMap;
+
+    /// The keys of every table as computed by the data plane analysis.
+    std::map<cstring, KeyMap> _tableKeyMaps;
+
+    /// Maps a parser value set to its flattened select keys in the order they were registered.
+    using ValueSetSelectKeys = std::map<cstring, std::vector<const IR::Expression *>>;
+
+    /// The select keys of every parser value set as computed by the data plane analysis.
+    ValueSetSelectKeys _valueSetSelectKeys;
+
+    /// The P4Runtime entities which were applied to the session the snapshot was taken from.
+    p4::v1::WriteRequest _entities;
+
+    FlaySnapshot(const FlayCompilerResult &compilerResult, NodeAnnotationMap nodeAnnotationMap,
+                 std::map<cstring, KeyMap> tableKeyMaps, ValueSetSelectKeys valueSetSelectKeys,
+                 p4::v1::WriteRequest entities);
+
+ public:
+    /// Write a snapshot of @param compilerResult and the annotations in @param nodeAnnotationMap
+    /// to @param path. The table keys and the parser value set select keys are taken from
+    /// @param constraints.
+    /// @returns EXIT_FAILURE if the snapshot could not be written.
+    static int save(const std::filesystem::path &path, const FlayOptions &options,
+                    const FlayCompilerResult &compilerResult,
+                    const NodeAnnotationMap &nodeAnnotationMap,
+                    const ControlPlaneConstraints &constraints);
+
+    /// Append the P4Runtime entities in @param entities to the snapshot at @param path, which must
+    /// have been written by save and must not have any entities yet.
+    /// @returns EXIT_FAILURE if the entities could not be written.
+    static int appendEntities(const std::filesystem::path &path,
+                              const p4::v1::WriteRequest &entities);
+
+    /// Load the snapshot at @param path. The target must already be initialized and match the
+    /// target the snapshot was created for.
+    /// @returns nullptr if the snapshot could not be loaded.
+    static const FlaySnapshot *load(const std::filesystem::path &path, const FlayOptions &options);
+
+    /// @returns the compiler result restored from the snapshot.
+    [[nodiscard]] const FlayCompilerResult &compilerResult() const;
+
+    /// @returns the annotations computed by the data plane analysis.
+    [[nodiscard]] const NodeAnnotationMap &nodeAnnotationMap() const;
+
+    /// @returns a write request which restores the P4Runtime entities of the snapshot. It is empty
+    /// if the snapshot has no entities.
+    [[nodiscard]] const p4::v1::WriteRequest &entities() const;
+
+    /// Set the table keys and the parser value set select keys computed by the data plane analysis
+    /// in @param constraints.
+    /// @returns EXIT_FAILURE if a table or parser value set has no configuration in
+    /// @param constraints.
+    int restoreKeys(ControlPlaneConstraints &constraints) const;
+};
+
+}  // namespace P4::P4Tools::Flay
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_INTERPRETER_SNAPSHOT_H_ */
@@ -83,6 +83,11 @@ std::optional<ControlPlaneConstraints> FlayTarget::computeControlPlaneConstraint
     return get().computeControlPlaneConstraintsImpl(compilerResult, options);
 }
 
+std::optional<ControlPlaneConstraints> FlayTarget::generateDefaultControlPlaneConstraints(
+    const IR::P4Program &program) {
+    return get().generateDefaultControlPlaneConstraintsImpl(program);
+}
+
 const ProgramInfo *FlayTarget::produceProgramInfo(const CompilerResult &compilerResult) {
     return get().produceProgramInfoImpl(compilerResult);
 }
@@ -122,8 +127,8 @@ std::optional<ControlPlaneConstraints> FlayTarget::computeControlPlaneConstraint
             SymbolSet symbolSet;
             for (const auto &msg : deserializedConfig.value().updates()) {
                 if (P4Runtime::updateControlPlaneConstraintsWithEntityMessage(
-                        msg.entity(), *compilerResult.getP4RuntimeApi().p4Info, constraints,
-                        msg.type(), symbolSet) != EXIT_SUCCESS) {
+                        msg.entity(), compilerResult.getP4InfoIndex(), constraints, msg.type(),
+                        symbolSet) != EXIT_SUCCESS) {
                     return std::nullopt;
                 }
             }
@@ -140,8 +145,8 @@ std::optional<ControlPlaneConstraints> FlayTarget::computeControlPlaneConstraint
             SymbolSet symbolSet;
             for (const auto &msg : deserializedConfig.value().updates()) {
                 if (BfRuntime::updateControlPlaneConstraintsWithEntityMessage(
-                        msg.entity(), *compilerResult.getP4RuntimeApi().p4Info, constraints,
-                        msg.type(), symbolSet) != EXIT_SUCCESS) {
+                        msg.entity(), compilerResult.getP4InfoIndex(), constraints, msg.type(),
+                        symbolSet) != EXIT_SUCCESS) {
                     return std::nullopt;
                 }
             }
@@ -39,6 +39,11 @@ class FlayTarget : public CompilerTarget {
     static std::optional<ControlPlaneConstraints> computeControlPlaneConstraints(
         const FlayCompilerResult &compilerResult, const FlayOptions &options);
 
+    /// @returns the control plane constraints the target assumes for @param program before any
+    /// configuration is applied. @param program is the program after the mid end.
+    static std::optional<ControlPlaneConstraints> generateDefaultControlPlaneConstraints(
+        const IR::P4Program &program);
+
  protected:
     /// @see @produceProgramInfo.
     [[nodiscard]] virtual const ProgramInfo *produceProgramInfoImpl(
@@ -57,6 +62,10 @@ class FlayTarget : public CompilerTarget {
     [[nodiscard]] virtual std::optional<ControlPlaneConstraints> computeControlPlaneConstraintsImpl(
         const FlayCompilerResult &compilerResult, const FlayOptions &options) const;
 
+    /// @see @generateDefaultControlPlaneConstraints.
+    [[nodiscard]] virtual std::optional<ControlPlaneConstraints>
+    generateDefaultControlPlaneConstraintsImpl(const IR::P4Program &program) const = 0;
+
     /// @see getArchSpec
     [[nodiscard]] virtual const ArchSpec *getArchSpecImpl() const = 0;
 
@@ -0,0 +1,204 @@
+#include "backends/p4tools/modules/flay/core/lib/expression_interner.h"
+
+#include <functional>
+#include <string_view>
+#include <typeinfo>
+
+namespace P4::P4Tools {
+
+namespace {
+
+size_t combineHash(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+size_t hashString(std::string_view value) { return std::hash<std::string_view>{}(value); }
+
+/// @returns a hash of @param type. Types are usually shared, so only a few distinguishing
+/// members are hashed.
+size_t hashType(const IR::Type *type) {
+    if (type == nullptr) {
+        return 0;
+    }
+    auto hash = hashString(type->node_type_name().c_str());
+    if (const auto *typeBits = type->to<IR::Type_Bits>()) {
+        hash = combineHash(hash, static_cast<size_t>(typeBits->width_bits()));
+        hash = combineHash(hash, static_cast<size_t>(typeBits->isSigned));
+    }
+    return hash;
+}
+
+/// @returns true if @param left and @param right are the same type.
+bool isSameType(const IR::Type *left, const IR::Type *right) {
+    if (left == right) {
+        return true;
+    }
+    return left != nullptr && right != nullptr && left->equiv(*right);
+}
+
+}  // namespace
+
+ExpressionInterner &ExpressionInterner::getInstance() {
+    thread_local ExpressionInterner EXPRESSION_INTERNER;
+    return EXPRESSION_INTERNER;
+}
+
+std::optional<ExpressionInterner::Operands> ExpressionInterner::getOperands(
+    const IR::Expression *expression) {
+    if (const auto *unary = expression->to<IR::Operation_Unary>()) {
+        return Operands{unary->expr, nullptr, nullptr};
+    }
+    if (const auto *binary = expression->to<IR::Operation_Binary>()) {
+        return Operands{binary->left, binary->right, nullptr};
+    }
+    if (const auto *ternary = expression->to<IR::Operation_Ternary>()) {
+        return Operands{ternary->e0, ternary->e1, ternary->e2};
+    }
+    return std::nullopt;
+}
+
+size_t ExpressionInterner::computeShallowHash(const IR::Expression *expression) {
+    auto hash = hashString(expression->node_type_name().c_str());
+    hash = combineHash(hash, hashType(expression->type));
+    auto operands = getOperands(expression);
+    if (operands.has_value()) {
+        for (const auto *operand : operands.value()) {
+            hash = combineHash(hash, std::hash<const IR::Expression *>{}(operand));
+        }
+        if (const auto *member = expression->to<IR::Member>()) {
+            hash = combineHash(hash, hashString(member->member.name.c_str()));
+        }
+        return hash;
+    }
+    if (const auto *constant = expression->to<IR::Constant>()) {
+        return combineHash(hash, hashString(constant->value.str()));
+    }
+    if (const auto *boolLiteral = expression->to<IR::BoolLiteral>()) {
+        return combineHash(hash, static_cast<size_t>(boolLiteral->value));
+    }
+    if (const auto *stringLiteral = expression->to<IR::StringLiteral>()) {
+        return combineHash(hash, hashString(stringLiteral->value.c_str()));
+    }
+    if (const auto *symbolicVariable = expression->to<IR::SymbolicVariable>()) {
+        return combineHash(hash, hashString(symbolicVariable->label.c_str()));
+    }
+    return hash;
+}
+
+bool ExpressionInterner::isShallowEqual(const IR::Expression *left, const IR::Expression *right) {
+    if (typeid(*left) != typeid(*right)) {
+        return false;
+    }
+    auto leftOperands = getOperands(left);
+    if (!leftOperands.has_value()) {
+        // Leaves are small, compare them by value.
+        return left->equiv(*right);
+    }
+    if (leftOperands != getOperands(right) || !isSameType(left->type, right->type)) {
+        return false;
+    }
+    if (const auto *member = left->to<IR::Member>()) {
+        return member->member == right->checkedTo<IR::Member>()->member;
+    }
+    if (left->is<IR::Cast>()) {
+        // Casts carry their destination type, which is not an operand.
+        return left->equiv(*right);
+    }
+    return true;
+}
+
+const IR::Expression *ExpressionInterner::insert(const IR::Expression *expression) {
+    auto &bucket = _buckets[computeShallowHash(expression)];
+    for (const auto *candidate : bucket) {
+        if (isShallowEqual(candidate, expression)) {
+            _statistics.hits++;
+            return candidate;
+        }
+    }
+    bucket.push_back(expression);
+    _interned.insert(expression);
+    _statistics.size++;
+    return expression;
+}
+
+const IR::Expression *ExpressionInterner::internImpl(const IR::Expression *expression) {
+    if (_interned.contains(expression)) {
+        return expression;
+    }
+    auto aliasIt = _aliases.find(expression);
+    if (aliasIt != _aliases.end()) {
+        return aliasIt->second;
+    }
+
+    const IR::Expression *result = expression;
+    if (const auto *unary = expression->to<IR::Operation_Unary>()) {
+        const auto *operand = internImpl(unary->expr);
+        if (operand != unary->expr) {
+            auto *copy = unary->clone();
+            copy->expr = operand;
+            result = copy;
+        }
+    } else if (const auto *binary = expression->to<IR::Operation_Binary>()) {
+        const auto *left = internImpl(binary->left);
+        const auto *right = internImpl(binary->right);
+        if (left != binary->left || right != binary->right) {
+            auto *copy = binary->clone();
+            copy->left = left;
+            copy->right = right;
+            result = copy;
+        }
+    } else if (const auto *ternary = expression->to<IR::Operation_Ternary>()) {
+        const auto *e0 = internImpl(ternary->e0);
+        const auto *e1 = internImpl(ternary->e1);
+        const auto *e2 = internImpl(ternary->e2);
+        if (e0 != ternary->e0 || e1 != ternary->e1 || e2 != ternary->e2) {
+            auto *copy = ternary->clone();
+            copy->e0 = e0;
+            copy->e1 = e1;
+            copy->e2 = e2;
+            result = copy;
+        }
+    } else if (!expression->is<IR::Literal>() && !expression->is<IR::SymbolicVariable>()) {
+        // Other expressions, for example struct expressions, are not interned.
+        return expression;
+    }
+
+    result = insert(result);
+    if (result != expression) {
+        _aliases.emplace(expression, result);
+    }
+    return result;
+}
+
+const IR::Expression *ExpressionInterner::intern(const IR::Expression *expression) {
+    return getInstance().internImpl(expression);
+}
+
+std::optional<const IR::Expression *> ExpressionInterner::getSimplified(
+    const IR::Expression *expression) {
+    auto &interner = getInstance();
+    auto it = interner._simplified.find(expression);
+    if (it == interner._simplified.end()) {
+        return std::nullopt;
+    }
+    interner._statistics.simplificationHits++;
+    return it->second;
+}
+
+void ExpressionInterner::setSimplified(const IR::Expression *expression,
+                                       const IR::Expression *simplified) {
+    getInstance()._simplified.insert_or_assign(expression, simplified);
+}
+
+void ExpressionInterner::clear() {
+    auto &interner = getInstance();
+    interner._buckets.clear();
+    interner._interned.clear();
+    interner._aliases.clear();
+    interner._simplified.clear();
+    interner._statistics = {};
+}
+
+ExpressionInternerStatistics ExpressionInterner::statistics() { return getInstance()._statistics; }
+
+}  // namespace P4::P4Tools
@@ -0,0 +1,98 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_EXPRESSION_INTERNER_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_EXPRESSION_INTERNER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools {
+
+/// Usage statistics of the expression interner of the calling thread.
+struct ExpressionInternerStatistics {
+    /// The number of expressions which were replaced by an existing interned expression.
+    uint64_t hits = 0;
+
+    /// The number of distinct interned expressions.
+    uint64_t size = 0;
+
+    /// The number of simplifications answered from the memo.
+    uint64_t simplificationHits = 0;
+};
+
+/// Hash-conses the expressions built by the Flay interpreter. Structurally equal expressions are
+/// replaced by a single interned node, so expressions which were built independently on
+/// different paths share memory and can be compared by pointer. Interned nodes are never
+/// modified. Operations (unary, binary, and ternary, including Mux) and leaves (literals and
+/// symbolic variables) are interned bottom-up. Other expressions are kept as they are.
+/// The interner also memoizes the simplified form of interned expressions.
+/// The interner is a thread-local instance.
+class ExpressionInterner {
+ private:
+    /// The operands of an operation. Unused operands are nullptr.
+    using Operands = std::array<const IR::Expression *, 3>;
+
+    /// The interned expressions by shallow hash. Multiple expressions can share a hash.
+    absl::flat_hash_map<size_t, std::vector<const IR::Expression *>> _buckets;
+
+    /// All interned expressions.
+    absl::flat_hash_set<const IR::Expression *> _interned;
+
+    /// Maps expressions which were interned before to their interned expression.
+    absl::flat_hash_map<const IR::Expression *, const IR::Expression *> _aliases;
+
+    /// The memoized simplified form of interned expressions.
+    absl::flat_hash_map<const IR::Expression *, const IR::Expression *> _simplified;
+
+    /// The statistics of this interner.
+    ExpressionInternerStatistics _statistics;
+
+    ExpressionInterner() = default;
+
+    /// The interner is a thread-local instance.
+    static ExpressionInterner &getInstance();
+
+    /// @returns the operands of @param expression if it is an operation.
+    static std::optional<Operands> getOperands(const IR::Expression *expression);
+
+    /// @returns a hash of @param expression which treats the operands as pointers.
+    static size_t computeShallowHash(const IR::Expression *expression);
+
+    /// @returns true if @param left and @param right are equal, assuming their operands are
+    /// interned.
+    static bool isShallowEqual(const IR::Expression *left, const IR::Expression *right);
+
+    /// @returns the interned expression equal to @param expression. The operands of
+    /// @param expression must be interned. Interns @param expression if no such expression
+    /// exists.
+    const IR::Expression *insert(const IR::Expression *expression);
+
+    /// See @intern.
+    const IR::Expression *internImpl(const IR::Expression *expression);
+
+ public:
+    /// @returns the interned expression structurally equal to @param expression.
+    static const IR::Expression *intern(const IR::Expression *expression);
+
+    /// @returns the memoized simplified form of the interned @param expression, if any.
+    static std::optional<const IR::Expression *> getSimplified(const IR::Expression *expression);
+
+    /// Memoize @param simplified as the simplified form of the interned @param expression.
+    static void setSimplified(const IR::Expression *expression, const IR::Expression *simplified);
+
+    /// Drop all interned expressions and memoized simplifications of the calling thread.
+    /// Expressions which were interned before remain valid.
+    static void clear();
+
+    /// @returns the statistics of the calling thread.
+    static ExpressionInternerStatistics statistics();
+};
+
+}  // namespace P4::P4Tools
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_EXPRESSION_INTERNER_H_ */
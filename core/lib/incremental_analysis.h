@@ -1,12 +1,20 @@
 #ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_INCREMENTAL_ANALYSIS_H_
 #define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_INCREMENTAL_ANALYSIS_H_
 
+#include <cstddef>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "backends/p4tools/common/compiler/context.h"
 #include "backends/p4tools/common/lib/logging.h"
 #include "backends/p4tools/modules/flay/core/control_plane/symbols.h"
 #include "backends/p4tools/modules/flay/core/interpreter/program_info.h"
 #include "backends/p4tools/modules/flay/core/lib/return_macros.h"
+#include "backends/p4tools/modules/flay/core/lib/statistics_report.h"
 #include "backends/p4tools/modules/flay/options.h"
 #include "lib/castable.h"
+#include "lib/compile_context.h"
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
@@ -27,6 +35,9 @@ struct AnalysisStatistics : public ICastable {
     /// Convert the statistics into a formatted string that can be written to a file.
     [[nodiscard]] virtual std::string toFormattedString() const = 0;
 
+    /// Add the statistics to the section @param section of @param report.
+    virtual void exportTo(StatisticsReport &report, std::string_view section) const = 0;
+
     friend std::ostream &operator<<(std::ostream &stream, const AnalysisStatistics &statistics) {
         stream << statistics.toFormattedString();
         return stream;
@@ -56,6 +67,23 @@ class IncrementalAnalysis : public ICastable {
     /// The program info derived from the Flay compiler.
     std::reference_wrapper<const ProgramInfo> _programInfo;
 
+    /// The compile context control-plane updates are converted in. A rejected update reports
+    /// its errors here and not in the context of the caller, whose error count has to stay zero
+    /// for later specializations. Replaced once it has recorded an error.
+    std::unique_ptr<P4Tools::CompileContext<FlayOptions>> _conversionContext;
+
+    /// Convert @param controlPlaneUpdate in the conversion context.
+    std::optional<SymbolSet> convertControlPlaneUpdateInIsolation(
+        const ControlPlaneUpdate &controlPlaneUpdate) {
+        if (_conversionContext == nullptr ||
+            _conversionContext->errorReporter().getErrorCount() > 0) {
+            _conversionContext = std::make_unique<P4Tools::CompileContext<FlayOptions>>(
+                P4Tools::CompileContext<FlayOptions>::get());
+        }
+        AutoCompileContext conversionContext(_conversionContext.get());
+        return convertControlPlaneUpdate(controlPlaneUpdate);
+    }
+
  protected:
     /// Check whether the semantics of the program have changed.
     /// Returns true if yes, std::nullopt if an error has occurred.
@@ -112,8 +140,8 @@ class IncrementalAnalysis : public ICastable {
     std::optional<const IR::P4Program *> processControlPlaneUpdate(
         const IR::P4Program &program, const ControlPlaneUpdate &controlPlaneUpdate) {
         printInfo("Processing 1 control plane update.");
-        ASSIGN_OR_RETURN(SymbolSet symbolSet, convertControlPlaneUpdate(controlPlaneUpdate),
-                         std::nullopt);
+        ASSIGN_OR_RETURN(SymbolSet symbolSet,
+                         convertControlPlaneUpdateInIsolation(controlPlaneUpdate), std::nullopt);
         ASSIGN_OR_RETURN(bool changeNeeded, checkForSemanticsChange(symbolSet), std::nullopt);
         printInfo("Change in semantics detected: %1%", changeNeeded ? "yes" : "no");
         if (!changeNeeded) {
@@ -125,15 +153,29 @@ class IncrementalAnalysis : public ICastable {
     /// Receive a series of control plane updates, convert each update to its intermediate
     /// representation needed for the respective incremental analysis, check whether the updates
     /// affect the semantics of the program, and specialize the program if necessary.
+    /// Updates which can not be converted are skipped and their positions are added to
+    /// @param rejectedUpdates. Updates which are already listed there are not converted. The
+    /// program is specialized once for all remaining updates. A rejected update changes neither
+    /// the control plane state nor the error count of the current compile context.
     std::optional<const IR::P4Program *> processControlPlaneUpdate(
         const IR::P4Program &program,
-        const std::vector<const ControlPlaneUpdate *> &controlPlaneUpdates) {
+        const std::vector<const ControlPlaneUpdate *> &controlPlaneUpdates,
+        std::set<size_t> &rejectedUpdates) {
         SymbolSet symbolSet;
         printInfo("Processing %s control plane updates.", controlPlaneUpdates.size());
-        for (const auto &update : controlPlaneUpdates) {
-            ASSIGN_OR_RETURN(SymbolSet updateSymbolSet, convertControlPlaneUpdate(*update),
-                             std::nullopt);
-            symbolSet.insert(updateSymbolSet.begin(), updateSymbolSet.end());
+        for (size_t idx = 0; idx < controlPlaneUpdates.size(); ++idx) {
+            if (rejectedUpdates.count(idx) != 0) {
+                continue;
+            }
+            auto updateSymbolSet = convertControlPlaneUpdateInIsolation(*controlPlaneUpdates[idx]);
+            if (!updateSymbolSet.has_value()) {
+                rejectedUpdates.insert(idx);
+                continue;
+            }
+            symbolSet.insert(updateSymbolSet.value().begin(), updateSymbolSet.value().end());
+        }
+        if (rejectedUpdates.size() == controlPlaneUpdates.size()) {
+            return std::optional{nullptr};
         }
         if (flayOptions().useSymbolSet()) {
             ASSIGN_OR_RETURN(bool changeNeeded, checkForSemanticsChange(symbolSet), std::nullopt);
@@ -0,0 +1,74 @@
+#include "backends/p4tools/modules/flay/core/lib/memory_usage.h"
+
+#include <sys/resource.h>
+
+#include <fstream>
+#include <mutex>
+
+#include "backends/p4tools/common/lib/logging.h"
+#include "lib/log.h"
+
+namespace P4::P4Tools {
+
+namespace {
+
+/// The recorded peaks. Phases may be recorded from several threads.
+std::mutex MEMORY_USAGE_MUTEX;
+std::vector<std::pair<std::string, uint64_t>> MEMORY_USAGE_PEAKS;
+
+constexpr double kBytesPerMebibyte = 1024.0 * 1024.0;
+
+}  // namespace
+
+std::optional<uint64_t> MemoryUsage::peakResidentSetSize() {
+    struct rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return std::nullopt;
+    }
+#ifdef __APPLE__
+    // macOS reports bytes.
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    // Linux reports kilobytes.
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+void MemoryUsage::record(std::string_view phase) {
+    auto peak = peakResidentSetSize();
+    if (!peak.has_value()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(MEMORY_USAGE_MUTEX);
+    MEMORY_USAGE_PEAKS.emplace_back(phase, peak.value());
+}
+
+std::vector<std::pair<std::string, uint64_t>> MemoryUsage::recordedPeaks() {
+    std::lock_guard<std::mutex> lock(MEMORY_USAGE_MUTEX);
+    return MEMORY_USAGE_PEAKS;
+}
+
+void MemoryUsage::printStatistics(const std::optional<std::filesystem::path> &basePath) {
+    // Do not emit a report if performance logging is not enabled.
+    if (!Log::fileLogLevelIsAtLeast("performance", 4)) {
+        return;
+    }
+    auto peaks = recordedPeaks();
+    printFeature("performance", 4, "============ Peak Memory ============");
+    for (const auto &[phase, peak] : peaks) {
+        printFeature("performance", 4, "%1%: %2% MiB", phase,
+                     static_cast<double>(peak) / kBytesPerMebibyte);
+    }
+    if (!basePath.has_value()) {
+        return;
+    }
+    auto statisticsPath = basePath.value();
+    statisticsPath.replace_extension(".memory.csv");
+    std::ofstream statisticsFile(statisticsPath);
+    statisticsFile << "Phase,Peak RSS (bytes)\n";
+    for (const auto &[phase, peak] : peaks) {
+        statisticsFile << phase << "," << peak << "\n";
+    }
+}
+
+}  // namespace P4::P4Tools
@@ -0,0 +1,37 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_MEMORY_USAGE_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_MEMORY_USAGE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace P4::P4Tools {
+
+/// Tracks the peak memory usage of the process at the end of named phases, for example the
+/// phases of the data plane analysis.
+class MemoryUsage {
+ public:
+    /// @returns the peak resident set size of the process in bytes or std::nullopt if it can not
+    /// be determined.
+    static std::optional<uint64_t> peakResidentSetSize();
+
+    /// Record the peak resident set size at the end of @param phase.
+    static void record(std::string_view phase);
+
+    /// @returns the recorded phases and their peak resident set size in bytes, in the order in
+    /// which they were recorded.
+    static std::vector<std::pair<std::string, uint64_t>> recordedPeaks();
+
+    /// Print the recorded peaks if performance logging is enabled. If @param basePath is set,
+    /// the peaks are also written to a CSV file next to it.
+    static void printStatistics(
+        const std::optional<std::filesystem::path> &basePath = std::nullopt);
+};
+
+}  // namespace P4::P4Tools
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_MEMORY_USAGE_H_ */
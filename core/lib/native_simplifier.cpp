@@ -0,0 +1,291 @@
+#include "backends/p4tools/modules/flay/core/lib/native_simplifier.h"
+
+namespace P4::P4Tools {
+
+namespace {
+
+/// @returns the value of @param expression if it is a boolean literal.
+std::optional<bool> literalValue(const IR::Expression *expression) {
+    if (const auto *boolLiteral = expression->to<IR::BoolLiteral>()) {
+        return boolLiteral->value;
+    }
+    return std::nullopt;
+}
+
+/// @returns true if @param left is the negation of @param right or vice versa.
+bool isNegationOf(const IR::Expression *left, const IR::Expression *right) {
+    if (const auto *lNot = left->to<IR::LNot>()) {
+        return lNot->expr->equiv(*right);
+    }
+    if (const auto *lNot = right->to<IR::LNot>()) {
+        return lNot->expr->equiv(*left);
+    }
+    return false;
+}
+
+/// @returns the value of the comparison of @param left and @param right if both are literals.
+std::optional<bool> compareLiterals(const IR::Expression *left, const IR::Expression *right) {
+    if (const auto *leftConstant = left->to<IR::Constant>()) {
+        if (const auto *rightConstant = right->to<IR::Constant>()) {
+            return leftConstant->value == rightConstant->value;
+        }
+        return std::nullopt;
+    }
+    if (const auto *leftBool = left->to<IR::BoolLiteral>()) {
+        if (const auto *rightBool = right->to<IR::BoolLiteral>()) {
+            return leftBool->value == rightBool->value;
+        }
+        return std::nullopt;
+    }
+    if (const auto *leftString = left->to<IR::StringLiteral>()) {
+        if (const auto *rightString = right->to<IR::StringLiteral>()) {
+            return leftString->value == rightString->value;
+        }
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
+const IR::Expression *NativeSimplifier::simplify(const IR::Expression *expression) {
+    NativeSimplifier simplifier;
+    return simplifier.rewrite(expression, nullptr, 0);
+}
+
+std::optional<bool> NativeSimplifier::lookup(const Assumption *assumptions,
+                                             const IR::Expression *expression) {
+    if (auto value = literalValue(expression)) {
+        return value;
+    }
+    for (const auto *assumption = assumptions; assumption != nullptr;
+         assumption = assumption->next) {
+        if (assumption->expression == expression ||
+            assumption->expression->equiv(*expression)) {
+            return assumption->value;
+        }
+    }
+    return std::nullopt;
+}
+
+uint64_t NativeSimplifier::getId(const Assumption *assumptions) {
+    return assumptions == nullptr ? 0 : assumptions->id;
+}
+
+const NativeSimplifier::Assumption *NativeSimplifier::assume(const IR::Expression *expression,
+                                                             bool value,
+                                                             const Assumption *assumptions) {
+    if (literalValue(expression).has_value()) {
+        return assumptions;
+    }
+    assumptions = &_assumptions.emplace_back(
+        Assumption{expression, value, assumptions, _nextAssumptionId++});
+    if (const auto *lNot = expression->to<IR::LNot>()) {
+        return assume(lNot->expr, !value, assumptions);
+    }
+    // A true conjunction implies that both operands are true, a false disjunction that both
+    // operands are false.
+    if (const auto *lAnd = expression->to<IR::LAnd>(); lAnd != nullptr && value) {
+        return assume(lAnd->right, true, assume(lAnd->left, true, assumptions));
+    }
+    if (const auto *lOr = expression->to<IR::LOr>(); lOr != nullptr && !value) {
+        return assume(lOr->right, false, assume(lOr->left, false, assumptions));
+    }
+    return assumptions;
+}
+
+const IR::Expression *NativeSimplifier::rewrite(const IR::Expression *expression,
+                                                const Assumption *assumptions, size_t depth) {
+    if (depth > kDepthBudget) {
+        return expression;
+    }
+    auto key = std::make_pair(expression, getId(assumptions));
+    auto it = _memo.find(key);
+    if (it != _memo.end()) {
+        return it->second;
+    }
+    const auto *result = rewriteImpl(expression, assumptions, depth);
+    _memo.emplace(key, result);
+    return result;
+}
+
+const IR::Expression *NativeSimplifier::rewriteImpl(const IR::Expression *expression,
+                                                    const Assumption *assumptions,
+                                                    size_t depth) {
+    if (assumptions != nullptr && expression->type->is<IR::Type_Boolean>()) {
+        if (auto value = lookup(assumptions, expression)) {
+            return IR::BoolLiteral::get(value.value(), expression->getSourceInfo());
+        }
+    }
+
+    if (const auto *mux = expression->to<IR::Mux>()) {
+        const auto *cond = rewrite(mux->e0, assumptions, depth + 1);
+        if (auto condValue = literalValue(cond)) {
+            return rewrite(condValue.value() ? mux->e1 : mux->e2, assumptions, depth + 1);
+        }
+        const auto *trueExpression = rewrite(mux->e1, assume(cond, true, assumptions), depth + 1);
+        const auto *falseExpression =
+            rewrite(mux->e2, assume(cond, false, assumptions), depth + 1);
+        return rewriteMux(mux, cond, trueExpression, falseExpression);
+    }
+
+    if (const auto *lNot = expression->to<IR::LNot>()) {
+        const auto *operand = rewrite(lNot->expr, assumptions, depth + 1);
+        if (auto value = literalValue(operand)) {
+            return IR::BoolLiteral::get(!value.value(), lNot->getSourceInfo());
+        }
+        if (const auto *innerNot = operand->to<IR::LNot>()) {
+            return innerNot->expr;
+        }
+        if (operand == lNot->expr) {
+            return lNot;
+        }
+        auto *result = lNot->clone();
+        result->expr = operand;
+        return result;
+    }
+
+    if (const auto *unary = expression->to<IR::Operation_Unary>()) {
+        const auto *operand = rewrite(unary->expr, assumptions, depth + 1);
+        if (operand == unary->expr) {
+            return unary;
+        }
+        auto *result = unary->clone();
+        result->expr = operand;
+        return result;
+    }
+
+    if (const auto *binary = expression->to<IR::Operation_Binary>()) {
+        const auto *left = rewrite(binary->left, assumptions, depth + 1);
+        const auto *right = rewrite(binary->right, assumptions, depth + 1);
+        return rewriteBinary(binary, left, right);
+    }
+
+    if (const auto *ternary = expression->to<IR::Operation_Ternary>()) {
+        const auto *e0 = rewrite(ternary->e0, assumptions, depth + 1);
+        const auto *e1 = rewrite(ternary->e1, assumptions, depth + 1);
+        const auto *e2 = rewrite(ternary->e2, assumptions, depth + 1);
+        if (e0 == ternary->e0 && e1 == ternary->e1 && e2 == ternary->e2) {
+            return ternary;
+        }
+        auto *result = ternary->clone();
+        result->e0 = e0;
+        result->e1 = e1;
+        result->e2 = e2;
+        return result;
+    }
+
+    return expression;
+}
+
+const IR::Expression *NativeSimplifier::rewriteMux(const IR::Mux *mux, const IR::Expression *cond,
+                                                   const IR::Expression *trueExpression,
+                                                   const IR::Expression *falseExpression) {
+    // Lift the conditions of nested Mux expressions which share a branch with this Mux. Every
+    // step consumes one nested Mux, so this terminates.
+    while (true) {
+        if (const auto *trueMux = trueExpression->to<IR::Mux>()) {
+            // "X ? (Y ? B : A) : B" turns into "X && !Y ? A : B".
+            if (falseExpression->equiv(*trueMux->e1)) {
+                cond = new IR::LAnd(cond, new IR::LNot(trueMux->e0));
+                trueExpression = trueMux->e2;
+                continue;
+            }
+            // "X ? (Y ? A : B) : B" turns into "X && Y ? A : B".
+            if (falseExpression->equiv(*trueMux->e2)) {
+                cond = new IR::LAnd(cond, trueMux->e0);
+                trueExpression = trueMux->e1;
+                continue;
+            }
+        }
+        if (const auto *falseMux = falseExpression->to<IR::Mux>()) {
+            // "X ? A : (Y ? A : B)" turns into "X || Y ? A : B".
+            if (trueExpression->equiv(*falseMux->e1)) {
+                cond = new IR::LOr(cond, falseMux->e0);
+                falseExpression = falseMux->e2;
+                continue;
+            }
+            // "X ? A : (Y ? B : A)" turns into "X || !Y ? A : B".
+            if (trueExpression->equiv(*falseMux->e2)) {
+                cond = new IR::LOr(cond, new IR::LNot(falseMux->e0));
+                falseExpression = falseMux->e1;
+                continue;
+            }
+        }
+        break;
+    }
+
+    if (trueExpression->equiv(*falseExpression)) {
+        return trueExpression;
+    }
+    auto trueValue = literalValue(trueExpression);
+    auto falseValue = literalValue(falseExpression);
+    if (trueValue.has_value() && falseValue.has_value()) {
+        // The branches differ, so this is either "X ? true : false" or "X ? false : true".
+        return trueValue.value() ? cond : new IR::LNot(cond);
+    }
+    if (cond == mux->e0 && trueExpression == mux->e1 && falseExpression == mux->e2) {
+        return mux;
+    }
+    return new IR::Mux(mux->getSourceInfo(), mux->type, cond, trueExpression, falseExpression);
+}
+
+const IR::Expression *NativeSimplifier::rewriteBinary(const IR::Operation_Binary *binary,
+                                                      const IR::Expression *left,
+                                                      const IR::Expression *right) {
+    const auto &srcInfo = binary->getSourceInfo();
+    if (binary->is<IR::LAnd>()) {
+        auto leftValue = literalValue(left);
+        auto rightValue = literalValue(right);
+        if (leftValue.has_value()) {
+            return leftValue.value() ? right : IR::BoolLiteral::get(false, srcInfo);
+        }
+        if (rightValue.has_value()) {
+            return rightValue.value() ? left : IR::BoolLiteral::get(false, srcInfo);
+        }
+        if (left->equiv(*right)) {
+            return left;
+        }
+        if (isNegationOf(left, right)) {
+            return IR::BoolLiteral::get(false, srcInfo);
+        }
+    } else if (binary->is<IR::LOr>()) {
+        auto leftValue = literalValue(left);
+        auto rightValue = literalValue(right);
+        if (leftValue.has_value()) {
+            return leftValue.value() ? IR::BoolLiteral::get(true, srcInfo) : right;
+        }
+        if (rightValue.has_value()) {
+            return rightValue.value() ? IR::BoolLiteral::get(true, srcInfo) : left;
+        }
+        if (left->equiv(*right)) {
+            return left;
+        }
+        if (isNegationOf(left, right)) {
+            return IR::BoolLiteral::get(true, srcInfo);
+        }
+    } else if (binary->is<IR::Equ>() || binary->is<IR::Neq>()) {
+        bool isEqu = binary->is<IR::Equ>();
+        if (auto equal = compareLiterals(left, right)) {
+            return IR::BoolLiteral::get(equal.value() == isEqu, srcInfo);
+        }
+        if (left->equiv(*right)) {
+            return IR::BoolLiteral::get(isEqu, srcInfo);
+        }
+        // "X == true" turns into "X" and "X == false" into "!X".
+        if (auto rightValue = literalValue(right)) {
+            return rightValue.value() == isEqu ? left : new IR::LNot(srcInfo, left);
+        }
+        if (auto leftValue = literalValue(left)) {
+            return leftValue.value() == isEqu ? right : new IR::LNot(srcInfo, right);
+        }
+    }
+    if (left == binary->left && right == binary->right) {
+        return binary;
+    }
+    auto *result = binary->clone();
+    result->left = left;
+    result->right = right;
+    return result;
+}
+
+}  // namespace P4::P4Tools
@@ -0,0 +1,90 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_NATIVE_SIMPLIFIER_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_NATIVE_SIMPLIFIER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools {
+
+/// A bottom-up term rewriter for the expressions Flay builds: Mux, LAnd, LOr, LNot, Equ, Neq,
+/// literals, and symbolic variables. It implements the same rewrites as the pass-based
+/// ExpressionRewriter without the visitor overhead:
+///   - Conditions of a Mux are assumed to hold in its true branch and to fail in its false
+///     branch, so nested occurrences of the condition fold to literals.
+///   - Nested Mux expressions with a shared branch are lifted into a conjunction or
+///     disjunction of their conditions.
+///   - Logical operators, comparisons of literals, and Mux expressions with equal branches
+///     are folded.
+/// Other operations are rebuilt with simplified operands. Results are memoized per node and
+/// set of assumptions. Sub-expressions deeper than the depth budget are left as they are.
+class NativeSimplifier {
+ public:
+    /// The maximum nesting depth the simplifier descends into.
+    static constexpr size_t kDepthBudget = 512;
+
+    /// Simplify @param expression.
+    static const IR::Expression *simplify(const IR::Expression *expression);
+
+ private:
+    /// A boolean expression assumed to have a particular value. Assumptions form a linked list
+    /// which is extended when entering a Mux branch.
+    struct Assumption {
+        const IR::Expression *expression;
+        bool value;
+        const Assumption *next;
+        /// Uniquely identifies this list of assumptions for memoization.
+        uint64_t id;
+    };
+
+    /// The memoized results, by node and the id of the assumptions they were computed under.
+    absl::flat_hash_map<std::pair<const IR::Expression *, uint64_t>, const IR::Expression *>
+        _memo;
+
+    /// Owns the assumptions of this run.
+    std::deque<Assumption> _assumptions;
+
+    /// The id of the next list of assumptions.
+    uint64_t _nextAssumptionId = 1;
+
+    NativeSimplifier() = default;
+
+    /// @returns @param assumptions extended by @param expression having @param value. Operands
+    /// whose value follows from the value of @param expression are added as well.
+    const Assumption *assume(const IR::Expression *expression, bool value,
+                             const Assumption *assumptions);
+
+    /// @returns the assumed value of @param expression, if any.
+    static std::optional<bool> lookup(const Assumption *assumptions,
+                                      const IR::Expression *expression);
+
+    /// @returns the id of @param assumptions. The empty list has id 0.
+    static uint64_t getId(const Assumption *assumptions);
+
+    /// Simplify @param expression under @param assumptions.
+    const IR::Expression *rewrite(const IR::Expression *expression,
+                                  const Assumption *assumptions, size_t depth);
+
+    /// See @rewrite. Does not consult the memo.
+    const IR::Expression *rewriteImpl(const IR::Expression *expression,
+                                      const Assumption *assumptions, size_t depth);
+
+    /// Simplify a Mux expression with already simplified condition and branches.
+    static const IR::Expression *rewriteMux(const IR::Mux *mux, const IR::Expression *cond,
+                                            const IR::Expression *trueExpression,
+                                            const IR::Expression *falseExpression);
+
+    /// Simplify a logical or relational operation with already simplified operands.
+    static const IR::Expression *rewriteBinary(const IR::Operation_Binary *binary,
+                                               const IR::Expression *left,
+                                               const IR::Expression *right);
+};
+
+}  // namespace P4::P4Tools
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_NATIVE_SIMPLIFIER_H_ */
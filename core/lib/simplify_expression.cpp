@@ -4,7 +4,9 @@
 #include <utility>
 
 #include "backends/p4tools/modules/flay/core/lib/collapse_dataplane_variables.h"
+#include "backends/p4tools/modules/flay/core/lib/expression_interner.h"
 #include "backends/p4tools/modules/flay/core/lib/expression_strength_reduction.h"
+#include "backends/p4tools/modules/flay/core/lib/native_simplifier.h"
 #include "backends/p4tools/modules/flay/options.h"
 #include "frontends/common/constantFolding.h"
 #include "ir/compare.h"
@@ -189,7 +191,8 @@ const IR::Expression *produceSimplifiedMux(const IR::Expression *cond,
                                            const IR::Expression *trueExpression,
                                            const IR::Expression *falseExpression) {
     Util::ScopedTimer timer("Mux optimization");
-    return simplify(new IR::Mux(trueExpression->type, cond, trueExpression, falseExpression));
+    return simplifyInterned(
+        new IR::Mux(trueExpression->type, cond, trueExpression, falseExpression));
 }
 
 class ExpressionRewriter : public PassManager {
@@ -211,12 +214,31 @@ class ExpressionRewriter : public PassManager {
 };
 
 const IR::Expression *simplify(const IR::Expression *expr) {
+    auto &options = Flay::FlayOptions::get();
+    if (options.useNativeSimplifier()) {
+        expr = NativeSimplifier::simplify(expr);
+        if (options.collapseDataPlaneOperations() && !options.skipParsers()) {
+            expr = expr->apply(Flay::DataPlaneVariablePropagator());
+        }
+        return expr;
+    }
     static ExpressionRewriter REWRITER;
     expr = expr->apply(REWRITER);
     BUG_CHECK(errorCount() == 0, "Encountered errors while trying to simplify expressions.");
     return expr;
 }
 
+const IR::Expression *simplifyInterned(const IR::Expression *expr) {
+    expr = ExpressionInterner::intern(expr);
+    auto simplified = ExpressionInterner::getSimplified(expr);
+    if (simplified.has_value()) {
+        return simplified.value();
+    }
+    const auto *result = ExpressionInterner::intern(simplify(expr));
+    ExpressionInterner::setSimplified(expr, result);
+    return result;
+}
+
 }  // namespace SimplifyExpression
 
 }  // namespace P4::P4Tools
@@ -8,14 +8,19 @@ namespace P4::P4Tools {
 namespace SimplifyExpression {
 
 /// Produce a Mux expression where the amount of sub-expressions has been simplified under the given
-/// Mux conditon.
+/// Mux conditon. The result is interned, see @simplifyInterned.
 const IR::Expression *produceSimplifiedMux(const IR::Expression *cond,
                                            const IR::Expression *trueExpression,
                                            const IR::Expression *falseExpression);
 
-/// Simplify the given expression using a series of compiler passes.
+/// Simplify the given expression using a series of compiler passes. If --native-simplifier is
+/// set, the expression is simplified with the NativeSimplifier instead.
 const IR::Expression *simplify(const IR::Expression *expr);
 
+/// Intern and simplify the given expression. The result is interned as well. Simplifications are
+/// memoized per interned expression, so structurally equal expressions are simplified only once.
+const IR::Expression *simplifyInterned(const IR::Expression *expr);
+
 };  // namespace SimplifyExpression
 
 }  // namespace P4::P4Tools
@@ -0,0 +1,204 @@
+#include "backends/p4tools/modules/flay/core/lib/statistics_report.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <utility>
+
+#include "backends/p4tools/modules/flay/core/lib/memory_usage.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_result_cache.h"
+#include "lib/error.h"
+#include "lib/timer.h"
+
+namespace P4::P4Tools {
+
+namespace {
+
+/// Write @param text as a quoted JSON string.
+void writeJsonString(std::ostream &output, std::string_view text) {
+    output << '"';
+    for (auto character : text) {
+        switch (character) {
+            case '"':
+                output << "\\\"";
+                break;
+            case '\\':
+                output << "\\\\";
+                break;
+            case '\n':
+                output << "\\n";
+                break;
+            case '\t':
+                output << "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(character) < 0x20) {
+                    char escaped[7];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", character);
+                    output << escaped;
+                } else {
+                    output << character;
+                }
+        }
+    }
+    output << '"';
+}
+
+/// Write @param text as a CSV field, quoted if necessary.
+void writeCsvField(std::ostream &output, std::string_view text) {
+    if (text.find_first_of(",\"\n") == std::string_view::npos) {
+        output << text;
+        return;
+    }
+    output << '"';
+    for (auto character : text) {
+        if (character == '"') {
+            output << '"';
+        }
+        output << character;
+    }
+    output << '"';
+}
+
+/// Write @param value as a JSON value. Strings are quoted if @param isJson is set and written as
+/// CSV fields otherwise.
+void writeValue(std::ostream &output, const StatisticsValue &value, bool isJson) {
+    if (const auto *text = std::get_if<std::string>(&value)) {
+        if (isJson) {
+            writeJsonString(output, *text);
+        } else {
+            writeCsvField(output, *text);
+        }
+        return;
+    }
+    std::visit([&output](const auto &number) { output << number; }, value);
+}
+
+}  // namespace
+
+std::optional<StatisticsFormat> StatisticsReport::parseFormat(std::string_view name) {
+    if (name == "json") {
+        return StatisticsFormat::kJson;
+    }
+    if (name == "csv") {
+        return StatisticsFormat::kCsv;
+    }
+    return std::nullopt;
+}
+
+void StatisticsReport::set(std::string_view section, std::string_view metric,
+                           StatisticsValue value) {
+    auto &entry = _sections[std::string(section)][std::string(metric)];
+    entry.values = {std::move(value)};
+    entry.isSeries = false;
+}
+
+void StatisticsReport::append(std::string_view section, std::string_view metric,
+                              StatisticsValue value) {
+    auto &entry = _sections[std::string(section)][std::string(metric)];
+    entry.values.push_back(std::move(value));
+    entry.isSeries = true;
+}
+
+void StatisticsReport::addProcessStatistics() {
+    for (const auto &timer : Util::getTimers()) {
+        set("timers_ms", timer.timerName, static_cast<uint64_t>(timer.milliseconds));
+    }
+
+    auto z3CacheStatistics = Z3Cache::statistics();
+    set("z3_cache", "hits", z3CacheStatistics.hits);
+    set("z3_cache", "structural_hits", z3CacheStatistics.structuralHits);
+    set("z3_cache", "misses", z3CacheStatistics.misses);
+    set("z3_cache", "evictions", z3CacheStatistics.evictions);
+    set("z3_cache", "size", z3CacheStatistics.size);
+
+    if (Z3ResultCache::isEnabled()) {
+        auto resultCacheStatistics = Z3ResultCache::statistics();
+        set("z3_result_cache", "hits", resultCacheStatistics.hits);
+        set("z3_result_cache", "misses", resultCacheStatistics.misses);
+        set("z3_result_cache", "loaded", resultCacheStatistics.loaded);
+        set("z3_result_cache", "size", resultCacheStatistics.size);
+    }
+
+    for (const auto &[phase, peak] : MemoryUsage::recordedPeaks()) {
+        set("peak_memory_bytes", phase, peak);
+    }
+    auto peak = MemoryUsage::peakResidentSetSize();
+    if (peak.has_value()) {
+        set("peak_memory_bytes", "process", peak.value());
+    }
+}
+
+void StatisticsReport::writeJson(std::ostream &output) const {
+    output << "{";
+    bool isFirstSection = true;
+    for (const auto &[sectionName, metrics] : _sections) {
+        output << (isFirstSection ? "\n  " : ",\n  ");
+        isFirstSection = false;
+        writeJsonString(output, sectionName);
+        output << ": {";
+        bool isFirstMetric = true;
+        for (const auto &[metricName, metric] : metrics) {
+            output << (isFirstMetric ? "\n    " : ",\n    ");
+            isFirstMetric = false;
+            writeJsonString(output, metricName);
+            output << ": ";
+            if (!metric.isSeries) {
+                writeValue(output, metric.values.front(), true);
+                continue;
+            }
+            output << "[";
+            for (size_t idx = 0; idx < metric.values.size(); idx++) {
+                output << (idx == 0 ? "" : ", ");
+                writeValue(output, metric.values[idx], true);
+            }
+            output << "]";
+        }
+        output << (metrics.empty() ? "}" : "\n  }");
+    }
+    output << (_sections.empty() ? "}\n" : "\n}\n");
+}
+
+void StatisticsReport::writeCsv(std::ostream &output) const {
+    output << "section,metric,index,value\n";
+    for (const auto &[sectionName, metrics] : _sections) {
+        for (const auto &[metricName, metric] : metrics) {
+            for (size_t idx = 0; idx < metric.values.size(); idx++) {
+                writeCsvField(output, sectionName);
+                output << ",";
+                writeCsvField(output, metricName);
+                output << ",";
+                if (metric.isSeries) {
+                    output << idx;
+                }
+                output << ",";
+                writeValue(output, metric.values[idx], false);
+                output << "\n";
+            }
+        }
+    }
+}
+
+void StatisticsReport::write(std::ostream &output, StatisticsFormat format) const {
+    switch (format) {
+        case StatisticsFormat::kJson:
+            writeJson(output);
+            return;
+        case StatisticsFormat::kCsv:
+            writeCsv(output);
+            return;
+    }
+}
+
+int StatisticsReport::write(const std::filesystem::path &path, StatisticsFormat format) const {
+    std::ofstream output(path);
+    if (!output.is_open()) {
+        error("Could not open file %1% for writing.", path.c_str());
+        return EXIT_FAILURE;
+    }
+    write(output, format);
+    return EXIT_SUCCESS;
+}
+
+}  // namespace P4::P4Tools
@@ -0,0 +1,71 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_STATISTICS_REPORT_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_STATISTICS_REPORT_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "lib/ordered_map.h"
+
+namespace P4::P4Tools {
+
+/// The machine-readable formats a StatisticsReport can be written in.
+enum class StatisticsFormat { kJson, kCsv };
+
+/// A value of a metric.
+using StatisticsValue = std::variant<uint64_t, double, std::string>;
+
+/// A machine-readable collection of named metrics, grouped into sections. A metric is either a
+/// single value or a series of values, for example the latency of every update. Sections and
+/// metrics are written in the order in which they were added.
+///
+/// JSON reports contain one object per section, which maps metric names to values or arrays of
+/// values. CSV reports contain one "section,metric,index,value" row per value. The index is
+/// empty for single values.
+class StatisticsReport {
+    /// The values of a metric.
+    struct Metric {
+        std::vector<StatisticsValue> values;
+
+        /// Whether the metric is a series, which is written as an array even if it has a single
+        /// value.
+        bool isSeries = false;
+    };
+
+    /// Maps section names to the metrics of the section.
+    ordered_map<std::string, ordered_map<std::string, Metric>> _sections;
+
+    void writeJson(std::ostream &output) const;
+    void writeCsv(std::ostream &output) const;
+
+ public:
+    /// @returns the format named @param name ("json" or "csv") or std::nullopt if the name is not
+    /// known.
+    static std::optional<StatisticsFormat> parseFormat(std::string_view name);
+
+    /// Set the metric @param metric of @param section to the single value @param value.
+    void set(std::string_view section, std::string_view metric, StatisticsValue value);
+
+    /// Append @param value to the series @param metric of @param section.
+    void append(std::string_view section, std::string_view metric, StatisticsValue value);
+
+    /// Add the statistics kept by the process: the performance timers, the Z3 caches, and the
+    /// recorded memory peaks.
+    void addProcessStatistics();
+
+    /// Write the report to @param output in @param format.
+    void write(std::ostream &output, StatisticsFormat format) const;
+
+    /// Write the report to the file @param path in @param format.
+    /// @returns EXIT_FAILURE if the file could not be written.
+    [[nodiscard]] int write(const std::filesystem::path &path, StatisticsFormat format) const;
+};
+
+}  // namespace P4::P4Tools
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_STATISTICS_REPORT_H_ */
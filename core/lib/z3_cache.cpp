@@ -0,0 +1,255 @@
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string_view>
+
+#include "backends/p4tools/common/lib/logging.h"
+#include "ir/visitor.h"
+#include "lib/log.h"
+
+namespace P4::P4Tools {
+
+namespace {
+
+/// Global counters, shared by the caches of all threads.
+std::atomic<uint64_t> Z3_CACHE_HITS{0};
+std::atomic<uint64_t> Z3_CACHE_MISSES{0};
+std::atomic<uint64_t> Z3_CACHE_STRUCTURAL_HITS{0};
+std::atomic<uint64_t> Z3_CACHE_EVICTIONS{0};
+std::atomic<uint64_t> Z3_CACHE_SIZE{0};
+std::atomic<size_t> Z3_CACHE_CAPACITY{Z3Cache::kDefaultCapacity};
+
+size_t combineHash(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+size_t hashString(std::string_view value) { return std::hash<std::string_view>{}(value); }
+
+/// Computes a hash of an IR node which only depends on the structure of the node.
+/// Shared sub-nodes are only visited once and their hash is memoized.
+class StructuralHasher : public Inspector {
+    /// The hashes of the nodes which are currently being visited.
+    std::vector<size_t> _stack;
+
+    /// The hashes of nodes which have already been visited.
+    absl::flat_hash_map<const IR::Node *, size_t> _memo;
+
+    /// The hash of the root node.
+    size_t _result = 0;
+
+    void addToParent(size_t hash) {
+        if (_stack.empty()) {
+            _result = hash;
+        } else {
+            _stack.back() = combineHash(_stack.back(), hash);
+        }
+    }
+
+    /// @returns a hash of the data members of leaf nodes which are not visited as children.
+    static size_t hashNodeData(const IR::Node *node) {
+        if (const auto *constant = node->to<IR::Constant>()) {
+            return hashString(constant->value.str());
+        }
+        if (const auto *boolLiteral = node->to<IR::BoolLiteral>()) {
+            return static_cast<size_t>(boolLiteral->value);
+        }
+        if (const auto *stringLiteral = node->to<IR::StringLiteral>()) {
+            return hashString(stringLiteral->value.c_str());
+        }
+        if (const auto *symbolicVariable = node->to<IR::SymbolicVariable>()) {
+            return hashString(symbolicVariable->label.c_str());
+        }
+        if (const auto *typeBits = node->to<IR::Type_Bits>()) {
+            return combineHash(static_cast<size_t>(typeBits->width_bits()),
+                               static_cast<size_t>(typeBits->isSigned));
+        }
+        if (const auto *path = node->to<IR::Path>()) {
+            return hashString(path->name.name.c_str());
+        }
+        if (const auto *member = node->to<IR::Member>()) {
+            return hashString(member->member.name.c_str());
+        }
+        return 0;
+    }
+
+ public:
+    StructuralHasher() { setName("StructuralHasher"); }
+
+    bool preorder(const IR::Node *node) override {
+        _stack.push_back(hashString(node->node_type_name().c_str()));
+        return true;
+    }
+
+    void postorder(const IR::Node *node) override {
+        auto hash = combineHash(_stack.back(), hashNodeData(node));
+        _stack.pop_back();
+        _memo.emplace(node, hash);
+        addToParent(hash);
+    }
+
+    void revisit(const IR::Node *node) override {
+        auto it = _memo.find(node);
+        if (it != _memo.end()) {
+            addToParent(it->second);
+        }
+    }
+
+    [[nodiscard]] size_t result() const { return _result; }
+};
+
+}  // namespace
+
+Z3Cache &Z3Cache::getInstance() {
+    thread_local Z3Cache Z3_CACHE;
+    return Z3_CACHE;
+}
+
+size_t Z3Cache::computeStructuralHash(const IR::Expression *expression) {
+    StructuralHasher hasher;
+    expression->apply(hasher);
+    return hasher.result();
+}
+
+z3::expr Z3Cache::touch(EntryList::iterator it) {
+    _entries.splice(_entries.begin(), _entries, it);
+    return it->result;
+}
+
+std::optional<Z3Cache::EntryList::iterator> Z3Cache::lookup(const IR::Expression *expression,
+                                                            size_t &hash) {
+    auto pointerIt = _pointerIndex.find(expression);
+    if (pointerIt != _pointerIndex.end()) {
+        return pointerIt->second;
+    }
+    hash = computeStructuralHash(expression);
+    auto bucketIt = _structuralIndex.find(hash);
+    if (bucketIt == _structuralIndex.end()) {
+        return std::nullopt;
+    }
+    for (auto entryIt : bucketIt->second) {
+        if (entryIt->expression->equiv(*expression)) {
+            // Remember the pointer so the next lookup does not need to hash the expression.
+            entryIt->aliases.push_back(expression);
+            _pointerIndex.emplace(expression, entryIt);
+            Z3_CACHE_STRUCTURAL_HITS++;
+            return entryIt;
+        }
+    }
+    return std::nullopt;
+}
+
+void Z3Cache::eraseEntry(EntryList::iterator it) {
+    for (const auto *alias : it->aliases) {
+        _pointerIndex.erase(alias);
+    }
+    auto bucketIt = _structuralIndex.find(it->hash);
+    if (bucketIt != _structuralIndex.end()) {
+        auto &bucket = bucketIt->second;
+        bucket.erase(std::remove(bucket.begin(), bucket.end(), it), bucket.end());
+        if (bucket.empty()) {
+            _structuralIndex.erase(bucketIt);
+        }
+    }
+    _entries.erase(it);
+    Z3_CACHE_SIZE--;
+}
+
+void Z3Cache::evict() {
+    auto capacity = Z3_CACHE_CAPACITY.load();
+    while (_entries.size() > capacity) {
+        eraseEntry(std::prev(_entries.end()));
+        Z3_CACHE_EVICTIONS++;
+    }
+}
+
+z3::expr Z3Cache::setImpl(const IR::Expression *expression) {
+    size_t hash = 0;
+    auto entryIt = lookup(expression, hash);
+    // Already set, nothing to do here.
+    if (entryIt.has_value()) {
+        Z3_CACHE_HITS++;
+        return touch(entryIt.value());
+    }
+    Z3_CACHE_MISSES++;
+    auto result = _z3Translator.translate(expression).simplify();
+    _entries.push_front({expression, result, hash, {expression}});
+    _pointerIndex.emplace(expression, _entries.begin());
+    _structuralIndex[hash].push_back(_entries.begin());
+    Z3_CACHE_SIZE++;
+    evict();
+    return result;
+}
+
+std::optional<z3::expr> Z3Cache::getImpl(const IR::Expression *expression) {
+    size_t hash = 0;
+    auto entryIt = lookup(expression, hash);
+    if (entryIt.has_value()) {
+        Z3_CACHE_HITS++;
+        return touch(entryIt.value());
+    }
+    Z3_CACHE_MISSES++;
+    return std::nullopt;
+}
+
+void Z3Cache::removeImpl(const IR::Expression *expression) {
+    auto pointerIt = _pointerIndex.find(expression);
+    if (pointerIt != _pointerIndex.end()) {
+        eraseEntry(pointerIt->second);
+    }
+}
+
+std::optional<z3::expr> Z3Cache::get(const IR::Expression *expression) {
+    return getInstance().getImpl(expression);
+}
+
+z3::expr Z3Cache::set(const IR::Expression *expression) {
+    return getInstance().setImpl(expression);
+}
+
+void Z3Cache::remove(const IR::Expression *expression) { getInstance().removeImpl(expression); }
+
+z3::context &Z3Cache::context() { return getInstance()._z3Solver.mutableContext(); }
+
+void Z3Cache::setCapacity(size_t capacity) { Z3_CACHE_CAPACITY = std::max<size_t>(capacity, 1); }
+
+Z3CacheStatistics Z3Cache::statistics() {
+    Z3CacheStatistics statistics;
+    statistics.hits = Z3_CACHE_HITS.load();
+    statistics.misses = Z3_CACHE_MISSES.load();
+    statistics.structuralHits = Z3_CACHE_STRUCTURAL_HITS.load();
+    statistics.evictions = Z3_CACHE_EVICTIONS.load();
+    statistics.size = Z3_CACHE_SIZE.load();
+    return statistics;
+}
+
+void Z3Cache::printStatistics(const std::optional<std::filesystem::path> &basePath) {
+    // Do not emit a report if performance logging is not enabled.
+    if (!Log::fileLogLevelIsAtLeast("performance", 4)) {
+        return;
+    }
+    auto statistics = Z3Cache::statistics();
+    printFeature("performance", 4, "============ Z3 Cache ============");
+    printFeature("performance", 4, "Hits: %1% (%2% structural)", statistics.hits,
+                 statistics.structuralHits);
+    printFeature("performance", 4, "Misses: %1%", statistics.misses);
+    printFeature("performance", 4, "Evictions: %1%", statistics.evictions);
+    printFeature("performance", 4, "Size: %1%", statistics.size);
+    if (!basePath.has_value()) {
+        return;
+    }
+    auto statisticsPath = basePath.value();
+    statisticsPath.replace_extension(".z3cache.csv");
+    std::ofstream statisticsFile(statisticsPath);
+    statisticsFile << "Counter,Value\n";
+    statisticsFile << "hits," << statistics.hits << "\n";
+    statisticsFile << "structural_hits," << statistics.structuralHits << "\n";
+    statisticsFile << "misses," << statistics.misses << "\n";
+    statisticsFile << "evictions," << statistics.evictions << "\n";
+    statisticsFile << "size," << statistics.size << "\n";
+}
+
+}  // namespace P4::P4Tools
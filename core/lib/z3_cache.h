@@ -3,69 +3,132 @@
 
 #include <z3++.h>
 
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <optional>
+#include <vector>
+
 #include "absl/container/flat_hash_map.h"
 #include "backends/p4tools/common/core/z3_solver.h"
 #include "ir/ir.h"
 
 namespace P4::P4Tools {
 
+/// Usage statistics of the Z3 cache, aggregated over all threads.
+struct Z3CacheStatistics {
+    /// Lookups which were answered by the cache.
+    uint64_t hits = 0;
+
+    /// Lookups which required a translation.
+    uint64_t misses = 0;
+
+    /// Hits which were found by structural comparison and not by pointer.
+    uint64_t structuralHits = 0;
+
+    /// Entries which were evicted because the cache was full.
+    uint64_t evictions = 0;
+
+    /// Current number of cached expressions.
+    uint64_t size = 0;
+};
+
 /// Memoizes P4C expressions which have been translated to Z3 expressions.
-class Z3Cache : protected absl::flat_hash_map<const IR::Expression *, z3::expr> {
+/// Every thread owns its own cache with its own Z3 context. Z3 expressions returned by the cache
+/// must not be shared across threads. Expressions are looked up by pointer first and then by a
+/// structural hash, which is confirmed with IR::Node::equiv. The least recently used entries are
+/// evicted once the cache exceeds its capacity.
+class Z3Cache {
+    /// A cached translation.
+    struct Entry {
+        /// The expression that was translated.
+        const IR::Expression *expression;
+
+        /// The translated and simplified expression.
+        z3::expr result;
+
+        /// The structural hash of the expression.
+        size_t hash;
+
+        /// All expression pointers which resolve to this entry.
+        std::vector<const IR::Expression *> aliases;
+    };
+
+    using EntryList = std::list<Entry>;
+
     /// The Z3 solver.
     Z3Solver _z3Solver;
 
     /// The Z3 translator.
     Z3Translator _z3Translator;
 
- private:
+    /// The cache entries, ordered from most to least recently used.
+    EntryList _entries;
+
+    /// Fast lookup by expression pointer.
+    absl::flat_hash_map<const IR::Expression *, EntryList::iterator> _pointerIndex;
+
+    /// Lookup by structural hash. Multiple entries can share a hash.
+    absl::flat_hash_map<size_t, std::vector<EntryList::iterator>> _structuralIndex;
+
     Z3Cache() : _z3Translator(_z3Solver) {}
 
-    /// The cache is a singleton instance.
-    static Z3Cache &getInstance() {
-        static Z3Cache Z3_CACHE;
-        return Z3_CACHE;
-    }
+    /// The cache is a thread-local instance.
+    static Z3Cache &getInstance();
+
+    /// Mark the entry as most recently used and return its result.
+    z3::expr touch(EntryList::iterator it);
+
+    /// Find the entry for the expression. Adds the pointer as alias for structural matches.
+    /// Sets @param hash to the structural hash of the expression if it had to be computed.
+    std::optional<EntryList::iterator> lookup(const IR::Expression *expression, size_t &hash);
+
+    /// Remove the entry from all indices.
+    void eraseEntry(EntryList::iterator it);
+
+    /// Evict least recently used entries until the cache respects its capacity.
+    void evict();
 
     /// See @set.
-    z3::expr setImpl(const IR::Expression *expression) {
-        auto it = find(expression);
-        // Already set, nothing to do here.
-        if (it != end()) {
-            return it->second;
-        }
-        auto result = _z3Translator.translate(expression).simplify();
-        insert({expression, result});
-        return result;
-    }
+    z3::expr setImpl(const IR::Expression *expression);
 
     /// See @get.
-    std::optional<z3::expr> getImpl(const IR::Expression *expression) const {
-        auto it = find(expression);
-        if (it != end()) {
-            return it->second;
-        }
-        return std::nullopt;
-    }
+    std::optional<z3::expr> getImpl(const IR::Expression *expression);
 
     /// See @remove.
-    void removeImpl(const IR::Expression *expression) { erase(expression); }
+    void removeImpl(const IR::Expression *expression);
 
  public:
+    /// The default number of entries a cache may hold before it starts evicting.
+    static constexpr size_t kDefaultCapacity = 1 << 20;
+
     /// Return the memoized Z3 expression for the provided expression.
-    static std::optional<z3::expr> get(const IR::Expression *expression) {
-        return getInstance().getImpl(expression);
-    }
+    /// Returns std::nullopt if the expression was never translated or has been evicted.
+    static std::optional<z3::expr> get(const IR::Expression *expression);
 
     /// Translate the provided expression, memoize the result, and return it.
-    static z3::expr set(const IR::Expression *expression) {
-        return getInstance().setImpl(expression);
-    }
+    static z3::expr set(const IR::Expression *expression);
 
     /// Remove the provided expression from the cache.
-    static void remove(const IR::Expression *expression) { getInstance().removeImpl(expression); }
+    static void remove(const IR::Expression *expression);
+
+    /// Return the Z3 context of the calling thread.
+    static z3::context &context();
+
+    /// Set the maximum number of entries of each cache.
+    static void setCapacity(size_t capacity);
+
+    /// @returns the usage statistics aggregated over all threads.
+    static Z3CacheStatistics statistics();
+
+    /// Print the cache statistics if performance logging is enabled. If @param basePath is set,
+    /// the statistics are also written to a CSV file next to it.
+    static void printStatistics(
+        const std::optional<std::filesystem::path> &basePath = std::nullopt);
 
-    /// Return the underlying Z3 context.
-    static z3::context &context() { return getInstance()._z3Solver.mutableContext(); }
+    /// Compute a hash of the expression which is equal for structurally equal expressions.
+    static size_t computeStructuralHash(const IR::Expression *expression);
 };
 
 }  // namespace P4::P4Tools
@@ -0,0 +1,300 @@
+#include "backends/p4tools/modules/flay/core/lib/z3_result_cache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <system_error>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "backends/p4tools/common/lib/logging.h"
+#include "lib/error.h"
+#include "lib/log.h"
+
+namespace P4::P4Tools {
+
+namespace {
+
+/// The FNV-1a prime.
+constexpr uint64_t kHashPrime = 0x100000001b3ULL;
+
+using ResultList = std::list<std::pair<Z3ResultKey, Z3CachedResult>>;
+
+/// The state of the cache, shared by all threads.
+struct ResultCacheState {
+    /// The file the cache is saved to. Not set if the cache is disabled.
+    std::optional<std::filesystem::path> path;
+
+    /// The fingerprint of the program the results belong to.
+    uint64_t programFingerprint = 0;
+
+    /// The maximum number of results.
+    size_t capacity = Z3ResultCache::kDefaultCapacity;
+
+    /// The cached results, ordered from most to least recently used.
+    ResultList results;
+
+    /// Lookup of the results by key.
+    absl::flat_hash_map<Z3ResultKey, ResultList::iterator> index;
+
+    /// Whether the results have changed since they were loaded or saved.
+    bool isDirty = false;
+
+    /// Usage counters.
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t loaded = 0;
+};
+
+std::mutex RESULT_CACHE_MUTEX;
+ResultCacheState RESULT_CACHE;
+
+/// Store @param result for @param key as most recently used result and drop the least recently
+/// used results which exceed the capacity.
+void insertResult(ResultCacheState &state, const Z3ResultKey &key, Z3CachedResult result) {
+    auto it = state.index.find(key);
+    if (it != state.index.end()) {
+        it->second->second = std::move(result);
+        state.results.splice(state.results.begin(), state.results, it->second);
+    } else {
+        state.results.emplace_front(key, std::move(result));
+        state.index.emplace(key, state.results.begin());
+    }
+    while (state.results.size() > state.capacity) {
+        state.index.erase(state.results.back().first);
+        state.results.pop_back();
+    }
+    state.isDirty = true;
+}
+
+/// Read the results in @param input into @param state. @returns false if the file is malformed
+/// or belongs to a different program.
+bool readResults(std::istream &input, ResultCacheState &state) {
+    std::string magic;
+    int version = 0;
+    std::string field;
+    uint64_t programFingerprint = 0;
+    size_t count = 0;
+    if (!(input >> magic >> version) || magic != Z3ResultCache::kMagic ||
+        version != Z3ResultCache::kVersion) {
+        return false;
+    }
+    if (!(input >> field >> std::hex >> programFingerprint >> std::dec) ||
+        field != "fingerprint" || programFingerprint != state.programFingerprint) {
+        return false;
+    }
+    if (!(input >> field >> count) || field != "results") {
+        return false;
+    }
+    for (size_t idx = 0; idx < count; ++idx) {
+        Z3ResultKey key{};
+        int kind = 0;
+        Z3CachedResult result;
+        if (!(input >> std::hex >> key.expressionHash >> key.assignmentHash >> std::dec >> kind >>
+              result.numeral)) {
+            return false;
+        }
+        if (kind < static_cast<int>(Z3CachedResult::Kind::kFalse) ||
+            kind > static_cast<int>(Z3CachedResult::Kind::kNumeral)) {
+            return false;
+        }
+        result.kind = static_cast<Z3CachedResult::Kind>(kind);
+        if (result.numeral == "-") {
+            result.numeral.clear();
+        }
+        insertResult(state, key, std::move(result));
+    }
+    return true;
+}
+
+/// See @ref Z3ResultCache::save. Expects the mutex to be held.
+int saveResults(ResultCacheState &state) {
+    if (!state.path.has_value() || !state.isDirty) {
+        return EXIT_SUCCESS;
+    }
+    // Write to a temporary file first, so an interrupted run never leaves a truncated cache.
+    auto temporaryPath = state.path.value();
+    temporaryPath += ".tmp";
+    std::ofstream output(temporaryPath);
+    if (!output.is_open()) {
+        error("Could not open Z3 result cache file %1% for writing.", temporaryPath.c_str());
+        return EXIT_FAILURE;
+    }
+    output << Z3ResultCache::kMagic << " " << Z3ResultCache::kVersion << "\n";
+    output << "fingerprint " << std::hex << state.programFingerprint << std::dec << "\n";
+    output << "results " << state.results.size() << "\n";
+    // Write the least recently used results first, so loading restores the order.
+    for (auto it = state.results.rbegin(); it != state.results.rend(); ++it) {
+        const auto &[key, result] = *it;
+        output << std::hex << key.expressionHash << " " << key.assignmentHash << std::dec << " "
+               << static_cast<int>(result.kind) << " "
+               << (result.numeral.empty() ? "-" : result.numeral) << "\n";
+    }
+    output.close();
+    if (output.fail()) {
+        error("Failed to write Z3 result cache file %1%.", temporaryPath.c_str());
+        return EXIT_FAILURE;
+    }
+    std::error_code errorCode;
+    std::filesystem::rename(temporaryPath, state.path.value(), errorCode);
+    if (errorCode) {
+        error("Failed to replace Z3 result cache file %1%: %2%", state.path.value().c_str(),
+              errorCode.message());
+        return EXIT_FAILURE;
+    }
+    state.isDirty = false;
+    return EXIT_SUCCESS;
+}
+
+}  // namespace
+
+std::optional<Z3CachedResult> Z3CachedResult::fromExpression(const z3::expr &result) {
+    if (result.is_true()) {
+        return Z3CachedResult{Kind::kTrue, {}};
+    }
+    if (result.is_false()) {
+        return Z3CachedResult{Kind::kFalse, {}};
+    }
+    if (result.is_numeral()) {
+        return Z3CachedResult{Kind::kNumeral, result.get_decimal_string(0)};
+    }
+    return std::nullopt;
+}
+
+std::optional<z3::expr> Z3CachedResult::toExpression(const z3::expr &expression) const {
+    switch (kind) {
+        case Kind::kFalse:
+        case Kind::kTrue:
+            if (!expression.is_bool()) {
+                return std::nullopt;
+            }
+            return expression.ctx().bool_val(kind == Kind::kTrue);
+        case Kind::kNumeral:
+            if (!expression.is_bv()) {
+                return std::nullopt;
+            }
+            return expression.ctx().bv_val(numeral.c_str(), expression.get_sort().bv_size());
+    }
+    return std::nullopt;
+}
+
+int Z3ResultCache::open(const std::filesystem::path &path, uint64_t programFingerprint,
+                        size_t capacity) {
+    std::lock_guard<std::mutex> lock(RESULT_CACHE_MUTEX);
+    auto &state = RESULT_CACHE;
+    if (state.path == path && state.programFingerprint == programFingerprint) {
+        return EXIT_SUCCESS;
+    }
+    if (saveResults(state) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    state = ResultCacheState();
+    state.path = path;
+    state.programFingerprint = programFingerprint;
+    state.capacity = std::max<size_t>(capacity, 1);
+    if (!std::filesystem::exists(path)) {
+        return EXIT_SUCCESS;
+    }
+    std::ifstream input(path);
+    if (!input.is_open()) {
+        error("Could not open Z3 result cache file %1%.", path.c_str());
+        return EXIT_FAILURE;
+    }
+    if (!readResults(input, state)) {
+        printInfo("Z3 result cache %1% belongs to a different program or version. Starting over.",
+                  path.c_str());
+        state.results.clear();
+        state.index.clear();
+        state.isDirty = true;
+        return EXIT_SUCCESS;
+    }
+    state.loaded = state.results.size();
+    state.isDirty = false;
+    printInfo("Loaded %1% results from Z3 result cache %2%.", state.loaded, path.c_str());
+    return EXIT_SUCCESS;
+}
+
+bool Z3ResultCache::isEnabled() {
+    std::lock_guard<std::mutex> lock(RESULT_CACHE_MUTEX);
+    return RESULT_CACHE.path.has_value();
+}
+
+std::optional<Z3CachedResult> Z3ResultCache::lookup(const Z3ResultKey &key) {
+    std::lock_guard<std::mutex> lock(RESULT_CACHE_MUTEX);
+    auto &state = RESULT_CACHE;
+    auto it = state.index.find(key);
+    if (it == state.index.end()) {
+        state.misses++;
+        return std::nullopt;
+    }
+    state.hits++;
+    state.results.splice(state.results.begin(), state.results, it->second);
+    return it->second->second;
+}
+
+void Z3ResultCache::insert(const Z3ResultKey &key, const z3::expr &result) {
+    std::lock_guard<std::mutex> lock(RESULT_CACHE_MUTEX);
+    if (!RESULT_CACHE.path.has_value()) {
+        return;
+    }
+    auto cachedResult = Z3CachedResult::fromExpression(result);
+    if (!cachedResult.has_value()) {
+        return;
+    }
+    insertResult(RESULT_CACHE, key, std::move(cachedResult.value()));
+}
+
+int Z3ResultCache::save() {
+    std::lock_guard<std::mutex> lock(RESULT_CACHE_MUTEX);
+    return saveResults(RESULT_CACHE);
+}
+
+Z3ResultCacheStatistics Z3ResultCache::statistics() {
+    std::lock_guard<std::mutex> lock(RESULT_CACHE_MUTEX);
+    const auto &state = RESULT_CACHE;
+    Z3ResultCacheStatistics statistics;
+    statistics.hits = state.hits;
+    statistics.misses = state.misses;
+    statistics.loaded = state.loaded;
+    statistics.size = state.results.size();
+    return statistics;
+}
+
+void Z3ResultCache::printStatistics() {
+    // Do not emit a report if performance logging is not enabled.
+    if (!isEnabled() || !Log::fileLogLevelIsAtLeast("performance", 4)) {
+        return;
+    }
+    auto statistics = Z3ResultCache::statistics();
+    printFeature("performance", 4, "======== Z3 Result Cache ========");
+    printFeature("performance", 4, "Hits: %1%", statistics.hits);
+    printFeature("performance", 4, "Misses: %1%", statistics.misses);
+    printFeature("performance", 4, "Loaded: %1%", statistics.loaded);
+    printFeature("performance", 4, "Size: %1%", statistics.size);
+}
+
+uint64_t Z3ResultCache::hashString(std::string_view value, uint64_t seed) {
+    uint64_t hash = seed;
+    for (auto character : value) {
+        hash ^= static_cast<uint8_t>(character);
+        hash *= kHashPrime;
+    }
+    return hash;
+}
+
+uint64_t Z3ResultCache::hashInteger(uint64_t value, uint64_t seed) {
+    uint64_t hash = seed;
+    for (size_t byte = 0; byte < sizeof(value); ++byte) {
+        hash ^= (value >> (byte * 8)) & 0xFF;
+        hash *= kHashPrime;
+    }
+    return hash;
+}
+
+uint64_t Z3ResultCache::hashExpression(const z3::expr &expression, uint64_t seed) {
+    return hashString(expression.to_string(), seed);
+}
+
+}  // namespace P4::P4Tools
@@ -0,0 +1,135 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_Z3_RESULT_CACHE_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_Z3_RESULT_CACHE_H_
+
+#include <z3++.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace P4::P4Tools {
+
+/// The key of a result in the Z3ResultCache.
+struct Z3ResultKey {
+    /// The hash of the expression the assignments were substituted into.
+    uint64_t expressionHash;
+
+    /// The hash of the assignments of all symbols which occur in the expression.
+    uint64_t assignmentHash;
+
+    bool operator==(const Z3ResultKey &other) const {
+        return expressionHash == other.expressionHash && assignmentHash == other.assignmentHash;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H state, const Z3ResultKey &key) {
+        return H::combine(std::move(state), key.expressionHash, key.assignmentHash);
+    }
+};
+
+/// The simplified result of substituting control plane assignments into an expression. Only
+/// constant results are cached. A symbolic result is a new expression, which can not be restored
+/// from the expression the assignments were substituted into.
+struct Z3CachedResult {
+    enum class Kind : uint8_t { kFalse, kTrue, kNumeral };
+
+    /// The kind of the result.
+    Kind kind = Kind::kFalse;
+
+    /// The decimal value of a numeral result.
+    std::string numeral;
+
+    /// Convert the simplified @param result into its cached form.
+    /// @returns std::nullopt if the result is not a constant.
+    static std::optional<Z3CachedResult> fromExpression(const z3::expr &result);
+
+    /// @returns the result as Z3 expression of the same sort as @param expression, which is the
+    /// expression the assignments were substituted into. Returns std::nullopt if the sort does
+    /// not fit the result.
+    [[nodiscard]] std::optional<z3::expr> toExpression(const z3::expr &expression) const;
+};
+
+/// Usage statistics of the Z3 result cache.
+struct Z3ResultCacheStatistics {
+    /// Lookups which were answered by the cache.
+    uint64_t hits = 0;
+
+    /// Lookups which had to be solved.
+    uint64_t misses = 0;
+
+    /// Results loaded from the cache file.
+    uint64_t loaded = 0;
+
+    /// Current number of cached results.
+    uint64_t size = 0;
+};
+
+/// A persistent cache of simplified substitution results, shared by all threads of the process.
+/// Results are addressed by the content of the expression and the relevant assignments, so
+/// they stay valid across runs and service restarts. The cache is loaded from and saved to a
+/// single file. The file carries a fingerprint of the program and of the cache format. Files
+/// with a different fingerprint are ignored and overwritten on the next save. The least recently
+/// used results are dropped once the cache exceeds its capacity.
+///
+/// All hashes are computed with FNV-1a over the SMT-LIB representation of the Z3 expressions, so
+/// they do not depend on pointers or on the order in which expressions were created.
+class Z3ResultCache {
+ public:
+    /// The version of the cache file format. Bump it whenever the encoding of expressions or the
+    /// simplification of substitution results changes, which invalidates all cached results.
+    static constexpr int kVersion = 2;
+
+    /// The keyword every cache file starts with.
+    static constexpr std::string_view kMagic = "flay-z3-result-cache";
+
+    /// The default number of results kept in the cache.
+    static constexpr size_t kDefaultCapacity = 1 << 20;
+
+    /// Open the cache file at @param path for the program with @param programFingerprint. Saves
+    /// the currently open cache first. A missing file or a file with a different fingerprint
+    /// starts an empty cache. @returns EXIT_FAILURE if an existing file could not be read.
+    static int open(const std::filesystem::path &path, uint64_t programFingerprint,
+                    size_t capacity = kDefaultCapacity);
+
+    /// @returns true if a cache file is open.
+    static bool isEnabled();
+
+    /// @returns the cached result for @param key or std::nullopt if there is none.
+    static std::optional<Z3CachedResult> lookup(const Z3ResultKey &key);
+
+    /// Store the simplified @param result for @param key. Results which are not constant are
+    /// not stored.
+    static void insert(const Z3ResultKey &key, const z3::expr &result);
+
+    /// Write the open cache to its file if it has changed since it was loaded or last saved.
+    /// @returns EXIT_FAILURE if the file could not be written.
+    static int save();
+
+    /// @returns the usage statistics of the cache.
+    static Z3ResultCacheStatistics statistics();
+
+    /// Print the cache statistics if the cache is enabled and performance logging is enabled.
+    static void printStatistics();
+
+    /// @returns the FNV-1a hash of @param value, continuing from @param seed.
+    static uint64_t hashString(std::string_view value, uint64_t seed = kHashSeed);
+
+    /// @returns the FNV-1a hash of the little-endian bytes of @param value, continuing from
+    /// @param seed.
+    static uint64_t hashInteger(uint64_t value, uint64_t seed = kHashSeed);
+
+    /// @returns the hash of the SMT-LIB representation of @param expression.
+    static uint64_t hashExpression(const z3::expr &expression, uint64_t seed = kHashSeed);
+
+ private:
+    /// The FNV-1a offset basis.
+    static constexpr uint64_t kHashSeed = 0xcbf29ce484222325ULL;
+};
+
+}  // namespace P4::P4Tools
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_LIB_Z3_RESULT_CACHE_H_ */
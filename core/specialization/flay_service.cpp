@@ -2,6 +2,8 @@
 
 #include <glob.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <fstream>
 #include <utility>
@@ -15,12 +17,26 @@
 
 namespace P4::P4Tools::Flay {
 
+namespace {
+
+/// @returns the microseconds passed since @param start.
+uint64_t elapsedMicroseconds(std::chrono::steady_clock::time_point start) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+}  // namespace
+
 FlayServiceBase::FlayServiceBase(const FlayCompilerResult &compilerResult,
                                  IncrementalAnalysisMap incrementalAnalysisMap)
     : _incrementalAnalysisMap(std::move(incrementalAnalysisMap)),
       _originalProgram(compilerResult.getOriginalProgram()),
       _midEndProgram(compilerResult.getProgram()),
       _optimizedProgram(&compilerResult.getOriginalProgram()) {
+    StatementCounter midEndCounter;
+    midEndProgram().apply(midEndCounter);
+    _midEndStatementCount = midEndCounter.getStatementCount();
     printInfo("Specializing the program unconditionally...");
     specializeProgram();
 }
@@ -37,11 +53,18 @@ void FlayServiceBase::outputOptimizedProgram(
         error("Could not open file %1% for writing.", optimizedOutputFile.c_str());
         return;
     }
-    P4::ToP4 toP4(&output, false);
-    optimizedProgram().apply(toP4);
+    _programEmitter.emit(optimizedProgram(), output);
     output.close();
 }
 
+size_t FlayServiceBase::measureOptimizedProgramSize() const {
+    return _programEmitter.measureSize(optimizedProgram());
+}
+
+const ProgramEmitterStatistics &FlayServiceBase::programEmitterStatistics() const {
+    return _programEmitter.statistics();
+}
+
 const IR::P4Program &FlayServiceBase::originalProgram() const { return _originalProgram; }
 
 const IR::P4Program &FlayServiceBase::optimizedProgram() const { return *_optimizedProgram; }
@@ -65,6 +88,7 @@ int FlayServiceBase::specializeProgram() {
 
 int FlayServiceBase::processControlPlaneUpdate(const ControlPlaneUpdate &controlPlaneUpdate) {
     Util::ScopedTimer timer("Processing control plane update");
+    auto start = std::chrono::steady_clock::now();
     const auto *optimizedProg = &originalProgram();
     _updateCount++;
     bool hasRespecialized = false;
@@ -84,18 +108,21 @@ int FlayServiceBase::processControlPlaneUpdate(const ControlPlaneUpdate &control
     if (hasRespecialized) {
         _respecializationCount++;
     }
+    recordUpdateLatency(elapsedMicroseconds(start));
+    checkStatistics();
     return EXIT_SUCCESS;
 }
 
 int FlayServiceBase::processControlPlaneUpdate(
-    const std::vector<const ControlPlaneUpdate *> &controlPlaneUpdates) {
+    const std::vector<const ControlPlaneUpdate *> &controlPlaneUpdates,
+    std::set<size_t> &rejectedUpdates) {
     Util::ScopedTimer timer("Processing control plane updates");
-    _updateCount += controlPlaneUpdates.size();
+    auto start = std::chrono::steady_clock::now();
     const auto *optimizedProg = &originalProgram();
     bool hasRespecialized = false;
     for (const auto &[analysisName, incrementalAnalysis] : _incrementalAnalysisMap) {
-        auto optProgram =
-            incrementalAnalysis->processControlPlaneUpdate(*optimizedProg, controlPlaneUpdates);
+        auto optProgram = incrementalAnalysis->processControlPlaneUpdate(
+            *optimizedProg, controlPlaneUpdates, rejectedUpdates);
         if (!optProgram.has_value()) {
             return EXIT_FAILURE;
         }
@@ -108,12 +135,66 @@ int FlayServiceBase::processControlPlaneUpdate(
     if (hasRespecialized) {
         _respecializationCount++;
     }
+    _updateCount += controlPlaneUpdates.size() - rejectedUpdates.size();
+    recordUpdateLatency(elapsedMicroseconds(start));
+    checkStatistics();
+    return EXIT_SUCCESS;
+}
+
+int FlayServiceBase::processControlPlaneUpdate(
+    const std::vector<const ControlPlaneUpdate *> &controlPlaneUpdates) {
+    std::set<size_t> rejectedUpdates;
+    auto result = processControlPlaneUpdate(controlPlaneUpdates, rejectedUpdates);
+    if (result != EXIT_SUCCESS || !rejectedUpdates.empty()) {
+        return EXIT_FAILURE;
+    }
     return EXIT_SUCCESS;
 }
 
+void FlayServiceBase::recordUpdateLatency(uint64_t latency) {
+    _batchCount++;
+    _totalUpdateLatency += latency;
+    _maxUpdateLatency = std::max(_maxUpdateLatency, latency);
+    if (_updateLatencies.size() < kUpdateLatencyWindow) {
+        _updateLatencies.push_back(latency);
+        return;
+    }
+    _updateLatencies[_oldestLatencySlot] = latency;
+    _oldestLatencySlot = (_oldestLatencySlot + 1) % kUpdateLatencyWindow;
+}
+
+std::vector<uint64_t> FlayServiceBase::updateLatencies() const {
+    std::vector<uint64_t> latencies(_updateLatencies.begin() + _oldestLatencySlot,
+                                    _updateLatencies.end());
+    latencies.insert(latencies.end(), _updateLatencies.begin(),
+                     _updateLatencies.begin() + _oldestLatencySlot);
+    return latencies;
+}
+
+uint64_t FlayServiceBase::countOptimizedStatements() const {
+    return _programEmitter.countStatements(optimizedProgram());
+}
+
+void FlayServiceBase::checkStatistics() const {
+    if (_statisticsCheckInterval == 0 || _batchCount % _statisticsCheckInterval != 0) {
+        return;
+    }
+    auto statementCount = countOptimizedStatements();
+    StatementCounter counter;
+    optimizedProgram().apply(counter);
+    BUG_CHECK(counter.getStatementCount() == statementCount,
+              "Incremental statement count %1% does not match the full recount %2% after %3% "
+              "update batches.",
+              statementCount, counter.getStatementCount(), _batchCount);
+}
+
+void FlayServiceBase::setStatisticsCheckInterval(size_t interval) {
+    _statisticsCheckInterval = interval;
+}
+
 void FlayServiceBase::recordProgramChange() const {
-    auto statementCountBefore = countStatements(midEndProgram());
-    auto statementCountAfter = countStatements(optimizedProgram());
+    auto statementCountBefore = _midEndStatementCount;
+    auto statementCountAfter = countOptimizedStatements();
     float stmtPct = 100.0F * (1.0F - static_cast<float>(statementCountAfter) /
                                          static_cast<float>(statementCountBefore));
     printInfo("Number of statements - Before: %1% After: %2% Total reduction in statements = %3%%%",
@@ -121,10 +202,17 @@ void FlayServiceBase::recordProgramChange() const {
 }
 
 FlayServiceStatisticsMap FlayServiceBase::computeFlayServiceStatistics() const {
-    auto statementCountBefore = countStatements(midEndProgram());
-    auto statementCountAfter = countStatements(optimizedProgram());
-    auto cyclomaticComplexity = computeCyclomaticComplexity(midEndProgram());
-    auto numParsersPaths = ParserPathsCounter::computeParserPaths(midEndProgram());
+    auto statementCountBefore = _midEndStatementCount;
+    auto statementCountAfter = countOptimizedStatements();
+    // The mid-end program does not change, so its call graph is only analyzed once.
+    if (!_midEndCyclomaticComplexity.has_value()) {
+        _midEndCyclomaticComplexity = computeCyclomaticComplexity(midEndProgram());
+    }
+    if (!_midEndParserPathCount.has_value()) {
+        _midEndParserPathCount = ParserPathsCounter::computeParserPaths(midEndProgram());
+    }
+    auto cyclomaticComplexity = _midEndCyclomaticComplexity.value();
+    auto numParsersPaths = _midEndParserPathCount.value();
     FlayServiceStatisticsMap statistics;
     for (const auto &[analysisName, incrementalAnalysis] : _incrementalAnalysisMap) {
         statistics.emplace(analysisName, incrementalAnalysis->computeAnalysisStatistics());
@@ -132,7 +220,9 @@ FlayServiceStatisticsMap FlayServiceBase::computeFlayServiceStatistics() const {
     statistics.emplace(
         "main", new FlayServiceStatistics(&optimizedProgram(), statementCountBefore,
                                           statementCountAfter, cyclomaticComplexity,
-                                          numParsersPaths, updateCount(), respecializationCount()));
+                                          numParsersPaths, updateCount(), respecializationCount(),
+                                          _batchCount, _totalUpdateLatency, _maxUpdateLatency,
+                                          updateLatencies()));
     return statistics;
 }
 
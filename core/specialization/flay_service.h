@@ -1,61 +1,40 @@
 #ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_FLAY_SERVICE_H_
 #define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_FLAY_SERVICE_H_
 
+#include <cstdint>
+#include <filesystem>
 #include <functional>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "backends/p4tools/modules/flay/core/lib/incremental_analysis.h"
-#include "frontends/p4/toP4/toP4.h"
+#include "backends/p4tools/modules/flay/core/specialization/program_emitter.h"
 
 namespace P4::P4Tools::Flay {
 
-class StatementCounter : public Inspector {
-    uint64_t _statementCount = 0;
-
- public:
-    bool preorder(const IR::AssignmentStatement * /*statement*/) override {
-        _statementCount++;
-        return false;
-    }
-    bool preorder(const IR::MethodCallStatement * /*statement*/) override {
-        _statementCount++;
-        return false;
-    }
-
-    [[nodiscard]] uint64_t getStatementCount() const { return _statementCount; }
-};
-
-inline uint64_t countStatements(const IR::P4Program &prog) {
-    auto *counter = new StatementCounter();
-    prog.apply(*counter);
-    return counter->getStatementCount();
-}
-
-inline double measureProgramSize(const IR::P4Program &prog) {
-    auto *programStream = new std::stringstream;
-    auto *toP4 = new P4::ToP4(programStream, false);
-    prog.apply(*toP4);
-    return static_cast<double>(programStream->str().length());
-}
-
-inline double measureSizeDifference(const IR::P4Program &programBefore,
-                                    const IR::P4Program &programAfter) {
-    double beforeLength = measureProgramSize(programBefore);
-
-    return (beforeLength - measureProgramSize(programAfter)) * (100.0 / beforeLength);
-}
-
 struct FlayServiceStatistics : public AnalysisStatistics {
     FlayServiceStatistics(const IR::P4Program *optimizedProgram, uint64_t statementCountBefore,
                           uint64_t statementCountAfter, size_t cyclomaticComplexity,
                           size_t numParsersPaths, size_t numUpdatesProcessed,
-                          size_t numRespecializations)
+                          size_t numRespecializations, size_t numUpdateBatches,
+                          uint64_t totalUpdateLatency, uint64_t maxUpdateLatency,
+                          std::vector<uint64_t> updateLatencies)
         : optimizedProgram(optimizedProgram),
           statementCountBefore(statementCountBefore),
           statementCountAfter(statementCountAfter),
           cyclomaticComplexity(cyclomaticComplexity),
           numParsersPaths(numParsersPaths),
           numUpdatesProcessed(numUpdatesProcessed),
-          numRespecializations(numRespecializations) {}
+          numRespecializations(numRespecializations),
+          numUpdateBatches(numUpdateBatches),
+          totalUpdateLatency(totalUpdateLatency),
+          maxUpdateLatency(maxUpdateLatency),
+          updateLatencies(std::move(updateLatencies)) {}
 
     /// The optimized program.
     const IR::P4Program *optimizedProgram;
@@ -71,6 +50,13 @@ struct FlayServiceStatistics : public AnalysisStatistics {
     size_t numUpdatesProcessed = 0;
     /// The total number of times a respecialization was necessary.
     size_t numRespecializations = 0;
+    /// The total number of processed batches of updates.
+    size_t numUpdateBatches = 0;
+    /// The sum and the maximum of the time taken by the processed batches, in microseconds.
+    uint64_t totalUpdateLatency = 0;
+    uint64_t maxUpdateLatency = 0;
+    /// The time taken by the most recent processed batches, oldest first, in microseconds.
+    std::vector<uint64_t> updateLatencies;
 
     [[nodiscard]] std::string toFormattedString() const override {
         std::stringstream output;
@@ -83,6 +69,21 @@ struct FlayServiceStatistics : public AnalysisStatistics {
         return output.str();
     }
 
+    void exportTo(StatisticsReport &report, std::string_view section) const override {
+        report.set(section, "statement_count_before", statementCountBefore);
+        report.set(section, "statement_count_after", statementCountAfter);
+        report.set(section, "cyclomatic_complexity", static_cast<uint64_t>(cyclomaticComplexity));
+        report.set(section, "num_parsers_paths", static_cast<uint64_t>(numParsersPaths));
+        report.set(section, "num_updates_processed", static_cast<uint64_t>(numUpdatesProcessed));
+        report.set(section, "num_respecializations", static_cast<uint64_t>(numRespecializations));
+        report.set(section, "num_update_batches", static_cast<uint64_t>(numUpdateBatches));
+        report.set(section, "update_latency_total_us", totalUpdateLatency);
+        report.set(section, "update_latency_max_us", maxUpdateLatency);
+        for (auto latency : updateLatencies) {
+            report.append(section, "update_latency_us", latency);
+        }
+    }
+
     DECLARE_TYPEINFO(FlayServiceStatistics);
 };
 
@@ -97,6 +98,46 @@ class FlayServiceBase {
     /// Number of times respecialization was necessary.
     size_t _respecializationCount = 0;
 
+    /// Number of update batches applied successfully.
+    size_t _batchCount = 0;
+
+    /// The time taken by the most recent calls to processControlPlaneUpdate, in microseconds.
+    /// Once @ref kUpdateLatencyWindow latencies are kept, the oldest one is overwritten.
+    std::vector<uint64_t> _updateLatencies;
+
+    /// The slot of the oldest latency in @ref _updateLatencies once the window is full.
+    size_t _oldestLatencySlot = 0;
+
+    /// The sum and the maximum of the latencies of all batches, in microseconds.
+    uint64_t _totalUpdateLatency = 0;
+    uint64_t _maxUpdateLatency = 0;
+
+    /// Record the latency @param latency of an applied update batch.
+    void recordUpdateLatency(uint64_t latency);
+
+    /// Emits and measures the optimized program. Only declarations which changed since the last
+    /// call are rendered again.
+    mutable ProgramEmitter _programEmitter;
+
+    /// The number of statements in the mid-end program, which does not change.
+    uint64_t _midEndStatementCount = 0;
+
+    /// The cyclomatic complexity and the number of parser paths of the mid-end program. Computed
+    /// on first use, because both traverse the call graph of the whole program.
+    mutable std::optional<size_t> _midEndCyclomaticComplexity;
+    mutable std::optional<size_t> _midEndParserPathCount;
+
+    /// The number of applied update batches between two full recounts. 0 disables the recount.
+    size_t _statisticsCheckInterval = 0;
+
+    /// @returns the number of statements in the optimized program. Only the declarations which
+    /// changed since the previous call are counted.
+    [[nodiscard]] uint64_t countOptimizedStatements() const;
+
+    /// After every @ref _statisticsCheckInterval applied update batches, count the statements of
+    /// the whole optimized program again and check the incrementally maintained count against it.
+    void checkStatistics() const;
+
  protected:
     /// The incremental analysis.
     IncrementalAnalysisMap _incrementalAnalysisMap;
@@ -119,7 +160,15 @@ class FlayServiceBase {
     /// Return the number of times respecialization was necessary.
     [[nodiscard]] size_t respecializationCount() const { return _respecializationCount; }
 
+    /// Return the time taken by the most recent processed batches of updates, oldest first, in
+    /// microseconds.
+    [[nodiscard]] std::vector<uint64_t> updateLatencies() const;
+
  public:
+    /// The number of most recent batch latencies kept for the statistics. Older batches only
+    /// contribute to the sum and the maximum.
+    static constexpr size_t kUpdateLatencyWindow = 4096;
+
     explicit FlayServiceBase(const FlayCompilerResult &compilerResult,
                              IncrementalAnalysisMap incrementalAnalysisMap);
 
@@ -129,6 +178,13 @@ class FlayServiceBase {
     /// Output the optimized program to file.
     void outputOptimizedProgram(const std::filesystem::path &optimizedOutputFile) const;
 
+    /// @returns the number of characters of the optimized program as printed by
+    /// outputOptimizedProgram.
+    [[nodiscard]] size_t measureOptimizedProgramSize() const;
+
+    /// @returns the counters of the emitter which prints the optimized program.
+    [[nodiscard]] const ProgramEmitterStatistics &programEmitterStatistics() const;
+
     /// @returns the original program.
     [[nodiscard]] const IR::P4Program &originalProgram() const;
 
@@ -141,7 +197,22 @@ class FlayServiceBase {
     /// Compute some statistics on the changes in the program and print them out.
     void recordProgramChange() const;
 
+    /// Recount the statistics of the whole optimized program after every @param interval
+    /// applied update batches and check them against the incrementally maintained ones.
+    void setStatisticsCheckInterval(size_t interval);
+
     int processControlPlaneUpdate(const ControlPlaneUpdate &controlPlaneUpdate);
+
+    /// Apply @param controlPlaneUpdates as one batch and specialize the program once. Updates
+    /// which are rejected by an analysis are skipped and their positions are added to
+    /// @param rejectedUpdates, the remaining updates are still applied.
+    /// @returns EXIT_FAILURE if the program could not be specialized.
+    int processControlPlaneUpdate(
+        const std::vector<const ControlPlaneUpdate *> &controlPlaneUpdates,
+        std::set<size_t> &rejectedUpdates);
+
+    /// Apply @param controlPlaneUpdates as one batch.
+    /// @returns EXIT_FAILURE if an update was rejected or the program could not be specialized.
     int processControlPlaneUpdate(
         const std::vector<const ControlPlaneUpdate *> &controlPlaneUpdates);
 
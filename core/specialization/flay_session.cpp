@@ -0,0 +1,61 @@
+#include "backends/p4tools/modules/flay/core/specialization/flay_session.h"
+
+#include <cstdlib>
+#include <utility>
+
+namespace P4::P4Tools::Flay {
+
+FlaySession::FlaySession(const FlayCompilerResult &compilerResult,
+                         IncrementalAnalysisMap incrementalAnalysisMap)
+    : FlayServiceBase(compilerResult, std::move(incrementalAnalysisMap)),
+      _compilerResult(compilerResult) {}
+
+const FlayCompilerResult &FlaySession::compilerResult() const { return _compilerResult; }
+
+int FlaySession::applyUpdates(const std::vector<const ControlPlaneUpdate *> &updates) {
+    std::set<size_t> rejectedUpdates;
+    auto result = applyUpdates(updates, rejectedUpdates);
+    if (result != EXIT_SUCCESS) {
+        return result;
+    }
+    for (size_t idx = 0; idx < updates.size(); ++idx) {
+        const auto *p4RuntimeUpdate = updates[idx]->to<P4RuntimeControlPlaneUpdate>();
+        if (p4RuntimeUpdate != nullptr && rejectedUpdates.count(idx) == 0) {
+            recordUpdate(p4RuntimeUpdate->update);
+        }
+    }
+    return rejectedUpdates.empty() ? result : EXIT_FAILURE;
+}
+
+int FlaySession::applyUpdates(const std::vector<const ControlPlaneUpdate *> &updates,
+                              std::set<size_t> &rejectedUpdates) {
+    const auto *programBefore = &optimizedProgram();
+    auto result = processControlPlaneUpdate(updates, rejectedUpdates);
+    if (&optimizedProgram() != programBefore) {
+        _programVersion++;
+    }
+    return result;
+}
+
+int FlaySession::applyWriteRequest(const p4::v1::WriteRequest &writeRequest) {
+    _p4RuntimeUpdates.clear();
+    _updateBatch.clear();
+    _p4RuntimeUpdates.reserve(static_cast<size_t>(writeRequest.updates_size()));
+    for (const auto &update : writeRequest.updates()) {
+        _p4RuntimeUpdates.emplace_back(update);
+    }
+    for (const auto &update : _p4RuntimeUpdates) {
+        _updateBatch.push_back(&update);
+    }
+    return applyUpdates(_updateBatch);
+}
+
+void FlaySession::recordUpdate(const p4::v1::Update &update) { _entityStore.apply(update); }
+
+const P4Runtime::EntityStore &FlaySession::entityStore() const { return _entityStore; }
+
+const IR::P4Program &FlaySession::specializedProgram() const { return optimizedProgram(); }
+
+uint64_t FlaySession::programVersion() const { return _programVersion; }
+
+}  // namespace P4::P4Tools::Flay
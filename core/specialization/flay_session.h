@@ -0,0 +1,79 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_FLAY_SESSION_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_FLAY_SESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <vector>
+
+#include "backends/p4tools/modules/flay/core/control_plane/p4runtime/entity_store.h"
+#include "backends/p4tools/modules/flay/core/interpreter/compiler_result.h"
+#include "backends/p4tools/modules/flay/core/lib/incremental_analysis.h"
+#include "backends/p4tools/modules/flay/core/specialization/flay_service.h"
+
+namespace P4::P4Tools::Flay {
+
+/// A long-running analysis session. It owns the incremental analyses of a compiled program and
+/// the program specialized for the current control plane configuration. The offline service
+/// wrappers and the gRPC server both drive a session: they apply batches of control plane
+/// updates and fetch the specialized program in between.
+///
+/// A session must be driven from the thread which initialized its analyses, because the Z3
+/// state of the analyses is thread-local.
+class FlaySession : public FlayServiceBase {
+    /// The compiled program the session analyses.
+    std::reference_wrapper<const FlayCompilerResult> _compilerResult;
+
+    /// The P4Runtime entities which have been applied so far. A snapshot stores them, so a session
+    /// created from the snapshot can replay them.
+    P4Runtime::EntityStore _entityStore;
+
+    /// Incremented whenever a batch changes the specialized program.
+    uint64_t _programVersion = 0;
+
+    /// Buffers of applyWriteRequest, which are reused so the update loop does not allocate.
+    std::vector<P4RuntimeControlPlaneUpdate> _p4RuntimeUpdates;
+    std::vector<const ControlPlaneUpdate *> _updateBatch;
+
+ public:
+    FlaySession(const FlayCompilerResult &compilerResult,
+                IncrementalAnalysisMap incrementalAnalysisMap);
+
+    /// @returns the compiled program the session analyses.
+    [[nodiscard]] const FlayCompilerResult &compilerResult() const;
+
+    /// Apply @param updates as a single batch and respecialize the program if necessary.
+    /// @returns EXIT_FAILURE if an update was rejected or one of the analyses failed.
+    [[nodiscard]] int applyUpdates(const std::vector<const ControlPlaneUpdate *> &updates);
+
+    /// Apply @param updates as a single batch. Updates which are rejected by an analysis are
+    /// skipped and their positions are added to @param rejectedUpdates. The program is
+    /// respecialized once for the remaining updates.
+    /// @returns EXIT_FAILURE if the program could not be specialized.
+    [[nodiscard]] int applyUpdates(const std::vector<const ControlPlaneUpdate *> &updates,
+                                   std::set<size_t> &rejectedUpdates);
+
+    /// Apply all updates of @param writeRequest as a single batch. See applyUpdates.
+    [[nodiscard]] int applyWriteRequest(const p4::v1::WriteRequest &writeRequest);
+
+    /// Mirror @param update, which has been applied, in the entity store. The single-argument
+    /// applyUpdates records its updates itself. Callers of the other overload record the updates
+    /// which were not rejected.
+    void recordUpdate(const p4::v1::Update &update);
+
+    /// @returns the P4Runtime entities which have been applied so far.
+    [[nodiscard]] const P4Runtime::EntityStore &entityStore() const;
+
+    /// @returns the program specialized for the current control plane configuration. The program
+    /// is immutable, so the reference stays valid after further updates.
+    [[nodiscard]] const IR::P4Program &specializedProgram() const;
+
+    /// @returns a counter which changes whenever the specialized program changes. Callers can
+    /// compare it to skip work on programs they have already seen.
+    [[nodiscard]] uint64_t programVersion() const;
+};
+
+}  // namespace P4::P4Tools::Flay
+
+#endif  // BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_FLAY_SESSION_H_
@@ -0,0 +1,106 @@
+#include "backends/p4tools/modules/flay/core/specialization/incremental_specializer.h"
+
+#include "backends/p4tools/modules/flay/core/specialization/passes/specializer.h"
+#include "ir/visitor.h"
+#include "lib/timer.h"
+
+namespace P4::P4Tools::Flay {
+
+namespace {
+
+/// Records that every node with valid source information is contained in the visited top-level
+/// declaration.
+class DeclarationIndexer : public Inspector {
+    /// The index which is populated.
+    std::reference_wrapper<IncrementalSpecializer::DeclarationIndex> _declarationIndex;
+
+    /// The index of the declaration currently visited.
+    size_t _index;
+
+ public:
+    DeclarationIndexer(IncrementalSpecializer::DeclarationIndex &declarationIndex, size_t index)
+        : _declarationIndex(declarationIndex), _index(index) {
+        setName("DeclarationIndexer");
+    }
+
+    bool preorder(const IR::Node *node) override {
+        if (node->getSourceInfo().isValid()) {
+            _declarationIndex.get()[node].insert(_index);
+        }
+        return true;
+    }
+};
+
+}  // namespace
+
+IncrementalSpecializer::IncrementalSpecializer(const P4::ReferenceMap &refMap,
+                                               const AbstractReachabilityMap &reachabilityMap,
+                                               const AbstractSubstitutionMap &substitutionMap)
+    : _refMap(refMap), _reachabilityMap(reachabilityMap), _substitutionMap(substitutionMap) {}
+
+void IncrementalSpecializer::specializeDeclaration(size_t index) {
+    const auto *declaration = _program->objects.at(index);
+    auto flaySpecializer = FlaySpecializer(_refMap, _reachabilityMap, _substitutionMap);
+    _declarations.at(index) = {declaration->apply(flaySpecializer),
+                               flaySpecializer.eliminatedNodes()};
+}
+
+void IncrementalSpecializer::assembleProgram() {
+    IR::Vector<IR::Node> objects;
+    for (const auto &declaration : _declarations) {
+        // Declarations may be removed entirely.
+        if (declaration.node != nullptr) {
+            objects.push_back(declaration.node);
+        }
+    }
+    _specializedProgram = new IR::P4Program(_program->srcInfo, objects);
+}
+
+const IR::P4Program *IncrementalSpecializer::specialize(const IR::P4Program &program) {
+    Util::ScopedTimer timer("Specialize all declarations");
+    _program = &program;
+    _declarationIndex.clear();
+    _declarations.assign(program.objects.size(), {nullptr, {}});
+    for (size_t index = 0; index < program.objects.size(); ++index) {
+        DeclarationIndexer declarationIndexer(_declarationIndex, index);
+        program.objects.at(index)->apply(declarationIndexer);
+        specializeDeclaration(index);
+    }
+    assembleProgram();
+    return _specializedProgram;
+}
+
+const IR::P4Program *IncrementalSpecializer::respecialize(const IR::P4Program &program,
+                                                          const NodeSet &changedNodes) {
+    if (_program != &program) {
+        return specialize(program);
+    }
+    std::set<size_t> affectedDeclarations;
+    for (const auto *node : changedNodes) {
+        auto it = _declarationIndex.find(node);
+        if (it == _declarationIndex.end()) {
+            return specialize(program);
+        }
+        affectedDeclarations.insert(it->second.begin(), it->second.end());
+    }
+    if (affectedDeclarations.empty()) {
+        return _specializedProgram;
+    }
+    Util::ScopedTimer timer("Specialize affected declarations");
+    for (auto index : affectedDeclarations) {
+        specializeDeclaration(index);
+    }
+    assembleProgram();
+    return _specializedProgram;
+}
+
+std::vector<EliminatedReplacedPair> IncrementalSpecializer::eliminatedNodes() const {
+    std::vector<EliminatedReplacedPair> result;
+    for (const auto &declaration : _declarations) {
+        result.insert(result.end(), declaration.eliminatedNodes.begin(),
+                      declaration.eliminatedNodes.end());
+    }
+    return result;
+}
+
+}  // namespace P4::P4Tools::Flay
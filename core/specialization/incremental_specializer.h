@@ -0,0 +1,87 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_INCREMENTAL_SPECIALIZER_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_INCREMENTAL_SPECIALIZER_H_
+
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "backends/p4tools/modules/flay/core/control_plane/symbols.h"
+#include "backends/p4tools/modules/flay/core/specialization/passes/specialization_statistics.h"
+#include "backends/p4tools/modules/flay/core/specialization/reachability_map.h"
+#include "backends/p4tools/modules/flay/core/specialization/substitution_map.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools::Flay {
+
+/// Specializes a program one top-level declaration at a time and caches the result.
+/// After the reachability or substitution of a set of nodes has changed, only the top-level
+/// declarations (controls, parsers, ...) containing these nodes are specialized again. The
+/// results are spliced into the previously specialized program.
+class IncrementalSpecializer {
+ public:
+    /// Maps a node to the indices of the top-level declarations containing it.
+    using DeclarationIndex = std::map<const IR::Node *, std::set<size_t>, SourceIdCmp>;
+
+ private:
+    /// The specialization result of a single top-level declaration.
+    struct SpecializedDeclaration {
+        /// The specialized declaration.
+        const IR::Node *node;
+
+        /// The nodes eliminated or replaced in the declaration.
+        std::vector<EliminatedReplacedPair> eliminatedNodes;
+    };
+
+    /// A map to look up declaration references.
+    std::reference_wrapper<const P4::ReferenceMap> _refMap;
+
+    /// The reachability map used to eliminate dead code.
+    std::reference_wrapper<const AbstractReachabilityMap> _reachabilityMap;
+
+    /// The substitution map used to replace expressions with constants.
+    std::reference_wrapper<const AbstractSubstitutionMap> _substitutionMap;
+
+    /// The program the cached results were computed for.
+    const IR::P4Program *_program = nullptr;
+
+    /// Maps every node with valid source information to the indices of all top-level
+    /// declarations which contain it. Inlined or copied code shares its source information, so a
+    /// node may belong to several declarations.
+    DeclarationIndex _declarationIndex;
+
+    /// The specialized top-level declarations, in program order.
+    std::vector<SpecializedDeclaration> _declarations;
+
+    /// The most recently specialized program.
+    const IR::P4Program *_specializedProgram = nullptr;
+
+    /// Specialize the top-level declaration at @param index.
+    void specializeDeclaration(size_t index);
+
+    /// Assemble the specialized program from the specialized declarations.
+    void assembleProgram();
+
+ public:
+    explicit IncrementalSpecializer(const P4::ReferenceMap &refMap,
+                                    const AbstractReachabilityMap &reachabilityMap,
+                                    const AbstractSubstitutionMap &substitutionMap);
+
+    /// Specialize all declarations of @param program.
+    /// @returns the specialized program.
+    const IR::P4Program *specialize(const IR::P4Program &program);
+
+    /// Specialize the declarations of @param program which contain any of @param changedNodes.
+    /// Falls back to a full specialization if @param program was not specialized before or a
+    /// node can not be attributed to a declaration.
+    /// @returns the specialized program.
+    const IR::P4Program *respecialize(const IR::P4Program &program, const NodeSet &changedNodes);
+
+    /// @returns the nodes eliminated or replaced in the most recently specialized program.
+    [[nodiscard]] std::vector<EliminatedReplacedPair> eliminatedNodes() const;
+};
+
+}  // namespace P4::P4Tools::Flay
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_INCREMENTAL_SPECIALIZER_H_ */
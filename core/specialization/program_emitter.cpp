@@ -0,0 +1,132 @@
+#include "backends/p4tools/modules/flay/core/specialization/program_emitter.h"
+
+#include <cstring>
+#include <sstream>
+#include <string_view>
+#include <utility>
+
+#include "absl/container/flat_hash_set.h"
+#include "frontends/common/parser_options.h"
+#include "frontends/p4/toP4/toP4.h"
+
+namespace P4::P4Tools::Flay {
+
+namespace {
+
+/// @returns the ToP4 output for a program consisting of @param objects.
+std::string renderObjects(IR::Vector<IR::Node> objects) {
+    std::stringstream stream;
+    P4::ToP4 toP4(&stream, false);
+    const auto *program = new IR::P4Program(std::move(objects));
+    program->apply(toP4);
+    return stream.str();
+}
+
+}  // namespace
+
+bool ProgramEmitter::isSystemDeclaration(const IR::Node &node) {
+    // Mirrors ToP4, which always prints errors and match kinds because they can be declared in
+    // several files.
+    if (node.is<IR::Type_Error>() || node.is<IR::Declaration_MatchKind>()) {
+        return false;
+    }
+    if (!node.srcInfo.isValid() || p4includePath == nullptr || *p4includePath == '\0') {
+        return false;
+    }
+    std::string_view sourceFile(node.srcInfo.getSourceFile().c_str());
+    return sourceFile.substr(0, std::strlen(p4includePath)) == p4includePath;
+}
+
+ProgramEmitter::Declaration &ProgramEmitter::getDeclaration(const IR::Node *node) {
+    return _declarations[node];
+}
+
+const std::string &ProgramEmitter::getText(const IR::Node *node) {
+    auto &declaration = getDeclaration(node);
+    if (declaration.text.has_value()) {
+        _statistics.reusedDeclarations++;
+        return declaration.text.value();
+    }
+    _statistics.renderedDeclarations++;
+    // Print the declaration as the only object of a program, so ToP4 formats it exactly as it
+    // does within the whole program.
+    IR::Vector<IR::Node> objects;
+    objects.push_back(node);
+    declaration.text = renderObjects(std::move(objects));
+    return declaration.text.value();
+}
+
+const std::string &ProgramEmitter::getPreamble(const IR::P4Program &program) {
+    std::vector<const IR::Node *> systemDeclarations;
+    for (const auto *object : program.objects) {
+        if (isSystemDeclaration(*object)) {
+            systemDeclarations.push_back(object);
+        }
+    }
+    if (systemDeclarations == _systemDeclarations) {
+        return _preamble;
+    }
+    _systemDeclarations = std::move(systemDeclarations);
+    _preamble.clear();
+    if (!_systemDeclarations.empty()) {
+        // ToP4 prints the #include lines in place of these declarations. The V1Model version is
+        // declared in v1model.p4 itself, so it is found among them.
+        IR::Vector<IR::Node> objects;
+        for (const auto *object : _systemDeclarations) {
+            objects.push_back(object);
+        }
+        _preamble = renderObjects(std::move(objects));
+    }
+    return _preamble;
+}
+
+void ProgramEmitter::evict(const IR::P4Program &program) {
+    absl::flat_hash_set<const IR::Node *> objects(program.objects.begin(), program.objects.end());
+    for (auto it = _declarations.begin(); it != _declarations.end();) {
+        if (objects.contains(it->first)) {
+            ++it;
+        } else {
+            _declarations.erase(it++);
+        }
+    }
+}
+
+void ProgramEmitter::emit(const IR::P4Program &program, std::ostream &output) {
+    output << getPreamble(program);
+    for (const auto *object : program.objects) {
+        if (!isSystemDeclaration(*object)) {
+            output << getText(object);
+        }
+    }
+    evict(program);
+}
+
+size_t ProgramEmitter::measureSize(const IR::P4Program &program) {
+    size_t size = getPreamble(program).size();
+    for (const auto *object : program.objects) {
+        if (!isSystemDeclaration(*object)) {
+            size += getText(object).size();
+        }
+    }
+    evict(program);
+    return size;
+}
+
+uint64_t ProgramEmitter::countStatements(const IR::P4Program &program) {
+    uint64_t statementCount = 0;
+    for (const auto *object : program.objects) {
+        auto &declaration = getDeclaration(object);
+        if (!declaration.statementCount.has_value()) {
+            StatementCounter counter;
+            object->apply(counter);
+            declaration.statementCount = counter.getStatementCount();
+        }
+        statementCount += declaration.statementCount.value();
+    }
+    evict(program);
+    return statementCount;
+}
+
+const ProgramEmitterStatistics &ProgramEmitter::statistics() const { return _statistics; }
+
+}  // namespace P4::P4Tools::Flay
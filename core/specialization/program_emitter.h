@@ -0,0 +1,103 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_PROGRAM_EMITTER_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_PROGRAM_EMITTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "ir/ir.h"
+#include "ir/visitor.h"
+
+namespace P4::P4Tools::Flay {
+
+class StatementCounter : public Inspector {
+    uint64_t _statementCount = 0;
+
+ public:
+    bool preorder(const IR::AssignmentStatement * /*statement*/) override {
+        _statementCount++;
+        return false;
+    }
+    bool preorder(const IR::MethodCallStatement * /*statement*/) override {
+        _statementCount++;
+        return false;
+    }
+
+    [[nodiscard]] uint64_t getStatementCount() const { return _statementCount; }
+};
+
+/// Counters of the work done by a ProgramEmitter.
+struct ProgramEmitterStatistics {
+    /// Declarations which had to be converted to source text.
+    uint64_t renderedDeclarations = 0;
+
+    /// Declarations whose source text was taken from the cache.
+    uint64_t reusedDeclarations = 0;
+};
+
+/// Emits P4 programs as source text one top-level declaration at a time. The source text and
+/// the statement count of every declaration are cached by node. Specialization only replaces the
+/// declarations it changes, so emitting or measuring the next version of a program only
+/// processes the changed declarations.
+///
+/// The emitted text is identical to the output of ToP4 for the whole program as long as all
+/// declarations from system include files precede the other declarations, which is the case for
+/// programs produced by the front end.
+class ProgramEmitter {
+    /// The cached properties of a top-level declaration.
+    struct Declaration {
+        /// The source text, including the trailing newline. Rendered on first use.
+        std::optional<std::string> text;
+
+        /// The number of statements. Counted on first use.
+        std::optional<uint64_t> statementCount;
+    };
+
+    /// The cached declarations of the program which was processed last, keyed by node.
+    absl::flat_hash_map<const IR::Node *, Declaration> _declarations;
+
+    /// The system declarations the preamble was rendered for.
+    std::vector<const IR::Node *> _systemDeclarations;
+
+    /// The #include lines which replace the system declarations.
+    std::string _preamble;
+
+    ProgramEmitterStatistics _statistics;
+
+    /// @returns the cache entry of @param node.
+    Declaration &getDeclaration(const IR::Node *node);
+
+    /// @returns the source text of @param node.
+    const std::string &getText(const IR::Node *node);
+
+    /// @returns the #include lines for the system declarations of @param program.
+    const std::string &getPreamble(const IR::P4Program &program);
+
+    /// Drop the cache entries of declarations which are not part of @param program.
+    void evict(const IR::P4Program &program);
+
+ public:
+    /// @returns true if ToP4 replaces @param node with an #include of its system file.
+    static bool isSystemDeclaration(const IR::Node &node);
+
+    /// Write the source text of @param program to @param output.
+    void emit(const IR::P4Program &program, std::ostream &output);
+
+    /// @returns the number of characters of the source text of @param program.
+    [[nodiscard]] size_t measureSize(const IR::P4Program &program);
+
+    /// @returns the number of assignment and method call statements in @param program. Does not
+    /// render any source text.
+    [[nodiscard]] uint64_t countStatements(const IR::P4Program &program);
+
+    /// @returns the counters of the emitter.
+    [[nodiscard]] const ProgramEmitterStatistics &statistics() const;
+};
+
+}  // namespace P4::P4Tools::Flay
+
+#endif  // BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_PROGRAM_EMITTER_H_
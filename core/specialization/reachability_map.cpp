@@ -8,7 +8,7 @@
 namespace P4::P4Tools::Flay {
 
 IRReachabilityMap::IRReachabilityMap(const NodeAnnotationMap &map)
-    : _symbolMap(map.reachabilitySymbolMap()) {
+    : _dependencies(map.reachabilityDependencies()) {
     for (auto &pair : map.reachabilityMap()) {
         emplace(pair.first, pair.second);
     }
@@ -71,6 +71,9 @@ std::optional<bool> IRReachabilityMap::recomputeReachability(
         if (!result.has_value()) {
             return std::nullopt;
         }
+        if (result.value()) {
+            recordChange(pair.first);
+        }
         hasChanged |= result.value();
     }
     return hasChanged;
@@ -79,16 +82,7 @@ std::optional<bool> IRReachabilityMap::recomputeReachability(
 std::optional<bool> IRReachabilityMap::recomputeReachability(
     const SymbolSet &symbolSet, const ControlPlaneConstraints &controlPlaneConstraints) {
     Util::ScopedTimer timer("IRReachabilityMap::recomputeReachability with symbol set");
-    NodeSet targetNodes;
-    for (const auto &symbol : symbolSet) {
-        auto it = _symbolMap.find(symbol);
-        if (it != _symbolMap.end()) {
-            for (const auto *node : it->second) {
-                targetNodes.insert(node);
-            }
-        }
-    }
-    return recomputeReachability(targetNodes, controlPlaneConstraints);
+    return recomputeReachability(_dependencies.dependentNodes(symbolSet), controlPlaneConstraints);
 }
 
 std::optional<bool> IRReachabilityMap::recomputeReachability(
@@ -108,6 +102,9 @@ std::optional<bool> IRReachabilityMap::recomputeReachability(
         if (!result.has_value()) {
             return std::nullopt;
         }
+        if (result.value()) {
+            recordChange(node);
+        }
         hasChanged |= result.value();
     }
     return hasChanged;
@@ -2,13 +2,23 @@
 #define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_REACHABILITY_MAP_H_
 
 #include <optional>
+#include <utility>
 
 #include "backends/p4tools/modules/flay/core/control_plane/control_plane_item.h"
+#include "backends/p4tools/modules/flay/core/control_plane/symbol_dependency_index.h"
 #include "backends/p4tools/modules/flay/core/interpreter/node_map.h"
 
 namespace P4::P4Tools::Flay {
 
 class AbstractReachabilityMap {
+ private:
+    /// The nodes whose reachability has changed since the last call to @ref takeChangedNodes.
+    NodeSet _changedNodes;
+
+ protected:
+    /// Record that the reachability of @param node has changed.
+    void recordChange(const IR::Node *node) { _changedNodes.insert(node); }
+
  public:
     AbstractReachabilityMap(const AbstractReachabilityMap &) = default;
     AbstractReachabilityMap(AbstractReachabilityMap &&) = delete;
@@ -36,13 +46,16 @@ class AbstractReachabilityMap {
     /// true when the node is always reachable, and std::nullopt if the node is sometimes reachable
     /// or the node could not be found.
     virtual std::optional<bool> isNodeReachable(const IR::Node *node) const = 0;
+
+    /// @returns the nodes whose reachability has changed since the last call and clears the set.
+    NodeSet takeChangedNodes() { return std::exchange(_changedNodes, {}); }
 };
 
 class IRReachabilityMap : private ReachabilityMap, public AbstractReachabilityMap {
  private:
-    /// A mapping of symbolic variables to IR nodes that depend on these symbolic variables in the
-    /// reachability map. This map can we used for incremental re-computation of reachability.
-    SymbolMap _symbolMap;
+    /// Indexes the nodes of the reachability map by the symbolic variables they depend on. This
+    /// index is used for incremental re-computation of reachability.
+    SymbolDependencyIndex _dependencies;
 
     /// Compute reachability for the node given the set of constraints.
     std::optional<bool> computeNodeReachability(
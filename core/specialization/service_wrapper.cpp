@@ -16,10 +16,26 @@ void FlayServiceWrapper::outputOptimizedProgram(
     const std::filesystem::path &optimizedOutputFileName) {
     auto absoluteFilePath =
         FlayOptions::get().optimizedOutputDir().value() / optimizedOutputFileName;
-    _flayService.outputOptimizedProgram(absoluteFilePath);
+    _flaySession.get().outputOptimizedProgram(absoluteFilePath);
     printInfo("Wrote optimized program to %1%", absoluteFilePath);
 }
 
+void FlayServiceWrapper::checkpointOptimizedProgram(
+    const std::filesystem::path &optimizedOutputFile) {
+    _processedWriteRequestCount++;
+    const auto &flayOptions = FlayOptions::get();
+    if (flayOptions.optimizedOutputDir() == std::nullopt) {
+        return;
+    }
+    // Printing the program after every update dominates the update latency. By default, only the
+    // final program is written.
+    auto interval = flayOptions.optimizedOutputInterval();
+    if (interval == 0 || _processedWriteRequestCount % interval != 0) {
+        return;
+    }
+    outputOptimizedProgram(optimizedOutputFile);
+}
+
 namespace {
 
 /// Sourced from https://stackoverflow.com/a/9745132.
@@ -83,10 +99,8 @@ std::vector<std::string> FlayServiceWrapper::findFiles(std::string_view pattern)
 }
 
 FlayServiceStatisticsMap FlayServiceWrapper::computeFlayServiceStatistics() const {
-    return _flayService.computeFlayServiceStatistics();
+    return _flaySession.get().computeFlayServiceStatistics();
 }
 
-FlayServiceWrapper::FlayServiceWrapper(const FlayCompilerResult &compilerResult,
-                                       IncrementalAnalysisMap incrementalAnalysisMap)
-    : _flayService(compilerResult, std::move(incrementalAnalysisMap)) {}
+FlayServiceWrapper::FlayServiceWrapper(FlaySession &flaySession) : _flaySession(flaySession) {}
 }  // namespace P4::P4Tools::Flay
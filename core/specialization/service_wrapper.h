@@ -1,10 +1,11 @@
 #ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_SERVICE_WRAPPER_H_
 #define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_SERVICE_WRAPPER_H_
 
+#include <functional>
 #include <vector>
 
 #include "backends/p4tools/modules/flay/core/interpreter/node_map.h"
-#include "backends/p4tools/modules/flay/core/specialization/flay_service.h"
+#include "backends/p4tools/modules/flay/core/specialization/flay_session.h"
 
 namespace P4::P4Tools::Flay {
 
@@ -14,17 +15,23 @@ class FlayServiceWrapper {
     /// The series of control plane updates which is applied after Flay service has started.
     std::vector<std::string> _controlPlaneUpdateFileNames;
 
-    /// Helper function to retrieve a list of files matching a pattern.
-    static std::vector<std::string> findFiles(std::string_view pattern);
+    /// The analysis session that is driven by the wrapper.
+    std::reference_wrapper<FlaySession> _flaySession;
+
+    /// The number of write requests processed by the wrapper.
+    size_t _processedWriteRequestCount = 0;
 
-    /// The Flay service that is being wrapped.
-    FlayServiceBase _flayService;
+    /// Count a processed write request and output the optimized program to file if the request
+    /// is a checkpoint of --optimized-output-interval.
+    void checkpointOptimizedProgram(const std::filesystem::path &optimizedOutputFile);
 
  public:
-    FlayServiceWrapper(const FlayCompilerResult &compilerResult,
-                       IncrementalAnalysisMap incrementalAnalysisMap);
+    explicit FlayServiceWrapper(FlaySession &flaySession);
     virtual ~FlayServiceWrapper() = default;
 
+    /// Helper function to retrieve a list of files matching a pattern, in natural order.
+    static std::vector<std::string> findFiles(std::string_view pattern);
+
     /// Try to parse the provided pattern into update files and convert them to control-plane
     /// updates.
     virtual int parseControlUpdatesFromPattern(std::string_view pattern) = 0;
@@ -32,6 +39,12 @@ class FlayServiceWrapper {
     /// Run the Flay service.
     [[nodiscard]] virtual int run() = 0;
 
+    /// Read length-delimited binary write requests from @param traceFile, or from standard input
+    /// if the path is "-", and process each request as soon as it has been decoded. Must be
+    /// called after @ref run.
+    [[nodiscard]] virtual int processControlUpdatesFromTrace(
+        const std::filesystem::path &traceFile) = 0;
+
     /// Output the optimized program to file.
     void outputOptimizedProgram(const std::filesystem::path &optimizedOutputFile);
 
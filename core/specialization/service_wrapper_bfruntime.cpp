@@ -25,12 +25,27 @@ int BfRuntimeFlayServiceWrapper::parseControlUpdatesFromPattern(std::string_view
     return EXIT_SUCCESS;
 }
 
+int BfRuntimeFlayServiceWrapper::processWriteRequest(const bfrt_proto::WriteRequest &writeRequest,
+                                                     const std::filesystem::path &outputFileName) {
+    std::vector<const ControlPlaneUpdate *> bfRuntimeUpdates;
+    for (const auto &update : writeRequest.updates()) {
+        bfRuntimeUpdates.emplace_back(new BfRuntimeControlPlaneUpdate(update));
+    }
+    if (_flaySession.get().applyUpdates(bfRuntimeUpdates) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+
+    _flaySession.get().recordProgramChange();
+    checkpointOptimizedProgram(outputFileName);
+    return EXIT_SUCCESS;
+}
+
 int BfRuntimeFlayServiceWrapper::run() {
     if (errorCount() > 0) {
         error("Encountered errors trying to starting the service.");
         return EXIT_FAILURE;
     }
-    _flayService.recordProgramChange();
+    _flaySession.get().recordProgramChange();
     if (FlayOptions::get().optimizedOutputDir() != std::nullopt) {
         outputOptimizedProgram("before_updates.p4");
     }
@@ -40,24 +55,24 @@ int BfRuntimeFlayServiceWrapper::run() {
         printInfo("Processing control plane updates...");
     }
     for (size_t updateIdx = 0; updateIdx < _controlPlaneUpdates.size(); updateIdx++) {
-        const auto &controlPlaneUpdate = _controlPlaneUpdates[updateIdx];
-        std::vector<const ControlPlaneUpdate *> bfRuntimeUpdates;
-        for (const auto &update : controlPlaneUpdate.updates()) {
-            bfRuntimeUpdates.emplace_back(new BfRuntimeControlPlaneUpdate(update));
-        }
-        auto result = _flayService.processControlPlaneUpdate(bfRuntimeUpdates);
-        if (result != EXIT_SUCCESS) {
+        auto outputFileName = std::filesystem::path(_controlPlaneUpdateFileNames[updateIdx]);
+        if (processWriteRequest(_controlPlaneUpdates[updateIdx],
+                                outputFileName.replace_extension(".p4")) != EXIT_SUCCESS) {
             return EXIT_FAILURE;
         }
-
-        _flayService.recordProgramChange();
-        if (FlayOptions::get().optimizedOutputDir() != std::nullopt) {
-            outputOptimizedProgram(std::filesystem::path(_controlPlaneUpdateFileNames[updateIdx])
-                                       .replace_extension(".p4"));
-        }
     }
-
     return EXIT_SUCCESS;
 }
 
+int BfRuntimeFlayServiceWrapper::processControlUpdatesFromTrace(
+    const std::filesystem::path &traceFile) {
+    printInfo("Processing control plane updates from trace %1%...", traceFile.c_str());
+    size_t updateIdx = 0;
+    return Protobuf::readDelimitedObjectsFromFile<bfrt_proto::WriteRequest>(
+        traceFile, [this, &updateIdx](const bfrt_proto::WriteRequest &writeRequest) {
+            auto outputFileName = "trace_update_" + std::to_string(updateIdx++) + ".p4";
+            return processWriteRequest(writeRequest, outputFileName);
+        });
+}
+
 }  // namespace P4::P4Tools::Flay
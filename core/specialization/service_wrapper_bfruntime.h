@@ -19,10 +19,14 @@ class BfRuntimeFlayServiceWrapper : public FlayServiceWrapper {
     /// The parsed series of control plane updates which is applied after Flay service has started.
     std::vector<bfrt_proto::WriteRequest> _controlPlaneUpdates;
 
+    /// Apply a single write request to the service. If an output directory is configured, the
+    /// optimized program is written to @param outputFileName afterwards.
+    int processWriteRequest(const bfrt_proto::WriteRequest &writeRequest,
+                            const std::filesystem::path &outputFileName);
+
  public:
-    BfRuntimeFlayServiceWrapper(const FlayCompilerResult &compilerResult,
-                                IncrementalAnalysisMap incrementalAnalysisMap)
-        : FlayServiceWrapper(compilerResult, std::move(incrementalAnalysisMap)) {}
+    explicit BfRuntimeFlayServiceWrapper(FlaySession &flaySession)
+        : FlayServiceWrapper(flaySession) {}
 
     /// Try to parse the provided pattern into update files and convert them to control-plane
     /// updates.
@@ -30,6 +34,10 @@ class BfRuntimeFlayServiceWrapper : public FlayServiceWrapper {
 
     /// Run the Flay service.
     [[nodiscard]] int run() override;
+
+    /// Process the write requests of a binary update trace as they are read.
+    [[nodiscard]] int processControlUpdatesFromTrace(
+        const std::filesystem::path &traceFile) override;
 };
 
 }  // namespace P4::P4Tools::Flay
@@ -26,12 +26,23 @@ int P4RuntimeFlayServiceWrapper::parseControlUpdatesFromPattern(std::string_view
     return EXIT_SUCCESS;
 }
 
+int P4RuntimeFlayServiceWrapper::processWriteRequest(const p4::v1::WriteRequest &writeRequest,
+                                                     const std::filesystem::path &outputFileName) {
+    if (_flaySession.get().applyWriteRequest(writeRequest) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+
+    _flaySession.get().recordProgramChange();
+    checkpointOptimizedProgram(outputFileName);
+    return EXIT_SUCCESS;
+}
+
 int P4RuntimeFlayServiceWrapper::run() {
     if (errorCount() > 0) {
         error("Encountered errors trying to starting the service.");
         return EXIT_FAILURE;
     }
-    _flayService.recordProgramChange();
+    _flaySession.get().recordProgramChange();
     if (FlayOptions::get().optimizedOutputDir() != std::nullopt) {
         outputOptimizedProgram("before_updates.p4");
     }
@@ -41,23 +52,24 @@ int P4RuntimeFlayServiceWrapper::run() {
         printInfo("Processing control plane updates...");
     }
     for (size_t updateIdx = 0; updateIdx < _controlPlaneUpdates.size(); updateIdx++) {
-        const auto &controlPlaneUpdate = _controlPlaneUpdates[updateIdx];
-        std::vector<const ControlPlaneUpdate *> p4RuntimeUpdates;
-        for (const auto &update : controlPlaneUpdate.updates()) {
-            p4RuntimeUpdates.emplace_back(new P4RuntimeControlPlaneUpdate(update));
-        }
-        auto result = _flayService.processControlPlaneUpdate(p4RuntimeUpdates);
-        if (result != EXIT_SUCCESS) {
+        auto outputFileName = std::filesystem::path(_controlPlaneUpdateFileNames[updateIdx]);
+        if (processWriteRequest(_controlPlaneUpdates[updateIdx],
+                                outputFileName.replace_extension(".p4")) != EXIT_SUCCESS) {
             return EXIT_FAILURE;
         }
-
-        _flayService.recordProgramChange();
-        if (FlayOptions::get().optimizedOutputDir() != std::nullopt) {
-            outputOptimizedProgram(std::filesystem::path(_controlPlaneUpdateFileNames[updateIdx])
-                                       .replace_extension(".p4"));
-        }
     }
     return EXIT_SUCCESS;
 }
 
+int P4RuntimeFlayServiceWrapper::processControlUpdatesFromTrace(
+    const std::filesystem::path &traceFile) {
+    printInfo("Processing control plane updates from trace %1%...", traceFile.c_str());
+    size_t updateIdx = 0;
+    return Protobuf::readDelimitedObjectsFromFile<p4::v1::WriteRequest>(
+        traceFile, [this, &updateIdx](const p4::v1::WriteRequest &writeRequest) {
+            auto outputFileName = "trace_update_" + std::to_string(updateIdx++) + ".p4";
+            return processWriteRequest(writeRequest, outputFileName);
+        });
+}
+
 }  // namespace P4::P4Tools::Flay
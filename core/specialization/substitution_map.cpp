@@ -14,7 +14,7 @@ SubstitutionMap
 **************************************************************************************************/
 
 IrSubstitutionMap::IrSubstitutionMap(const NodeAnnotationMap &map)
-    : _symbolMap(map.expressionSymbolMap()) {
+    : _dependencies(map.expressionDependencies()) {
     for (auto &pair : map.substitutionMap()) {
         emplace(pair.first, pair.second);
     }
@@ -81,6 +81,9 @@ std::optional<bool> IrSubstitutionMap::recomputeSubstitution(
         if (!result.has_value()) {
             return std::nullopt;
         }
+        if (result.value()) {
+            recordChange(pair.first);
+        }
         hasChanged |= result.value();
     }
     return hasChanged;
@@ -90,13 +93,8 @@ std::optional<bool> IrSubstitutionMap::recomputeSubstitution(
     const SymbolSet &symbolSet, const ControlPlaneConstraints &controlPlaneConstraints) {
     Util::ScopedTimer timer("IrSubstitutionMap::recomputeReachability with symbol set");
     ExpressionSet targetExpressions;
-    for (const auto &symbol : symbolSet) {
-        auto it = _symbolMap.find(symbol);
-        if (it != _symbolMap.end()) {
-            for (const auto *node : it->second) {
-                targetExpressions.insert(node->checkedTo<IR::Expression>());
-            }
-        }
+    for (auto nodeId : _dependencies.dependentNodeIds(symbolSet)) {
+        targetExpressions.insert(_dependencies.node(nodeId)->checkedTo<IR::Expression>());
     }
     return recomputeSubstitution(targetExpressions, controlPlaneConstraints);
 }
@@ -119,6 +117,9 @@ std::optional<bool> IrSubstitutionMap::recomputeSubstitution(
         if (!result.has_value()) {
             return std::nullopt;
         }
+        if (result.value()) {
+            recordChange(node);
+        }
         hasChanged |= result.value();
     }
     return hasChanged;
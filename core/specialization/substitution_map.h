@@ -2,13 +2,23 @@
 #define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_SUBSTITUTION_MAP_H_
 
 #include <optional>
+#include <utility>
 
 #include "backends/p4tools/modules/flay/core/control_plane/control_plane_item.h"
+#include "backends/p4tools/modules/flay/core/control_plane/symbol_dependency_index.h"
 #include "backends/p4tools/modules/flay/core/interpreter/node_map.h"
 
 namespace P4::P4Tools::Flay {
 
 class AbstractSubstitutionMap {
+ private:
+    /// The nodes whose substitution has changed since the last call to @ref takeChangedNodes.
+    NodeSet _changedNodes;
+
+ protected:
+    /// Record that the substitution of @param node has changed.
+    void recordChange(const IR::Node *node) { _changedNodes.insert(node); }
+
  public:
     AbstractSubstitutionMap(const AbstractSubstitutionMap &) = default;
     AbstractSubstitutionMap(AbstractSubstitutionMap &&) = delete;
@@ -36,13 +46,16 @@ class AbstractSubstitutionMap {
     /// @return true if the node can be replace with a constant, false otherwise
     virtual std::optional<const IR::Literal *> isExpressionConstant(
         const IR::Expression *expression) const = 0;
+
+    /// @returns the nodes whose substitution has changed since the last call and clears the set.
+    NodeSet takeChangedNodes() { return std::exchange(_changedNodes, {}); }
 };
 
 class IrSubstitutionMap : private SubstitutionMap, public AbstractSubstitutionMap {
  private:
-    /// A mapping of symbolic variables to IR nodes that depend on these symbolic variables in the
-    /// substitution map. This map can we used for incremental re-computation of substitution.
-    SymbolMap _symbolMap;
+    /// Indexes the expressions of the substitution map by the symbolic variables they depend on.
+    /// This index is used for incremental re-computation of substitution.
+    SymbolDependencyIndex _dependencies;
 
     /// Compute substitution for the node given the set of constraints.
     std::optional<bool> computeNodeSubstitution(
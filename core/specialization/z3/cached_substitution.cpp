@@ -0,0 +1,78 @@
+#include "backends/p4tools/modules/flay/core/specialization/z3/cached_substitution.h"
+
+#include <optional>
+#include <utility>
+
+#include "backends/p4tools/modules/flay/core/control_plane/symbols.h"
+#include "lib/exceptions.h"
+
+namespace P4::P4Tools::Flay {
+
+Z3ResultFingerprint::Z3ResultFingerprint(const IR::Expression &expression,
+                                         const z3::expr &z3Expression)
+    : _expressionHash(Z3ResultCache::hashExpression(z3Expression)) {
+    SymbolCollector symbolCollector;
+    expression.apply(symbolCollector);
+    const auto &symbols = symbolCollector.collectedSymbols();
+    _symbols.assign(symbols.begin(), symbols.end());
+}
+
+Z3ResultKey Z3ResultFingerprint::computeKey(const Z3ControlPlaneAssignmentSet &assignmentSet,
+                                            AssignmentHashMap &assignmentHashes) const {
+    uint64_t assignmentHash = Z3ResultCache::hashInteger(_symbols.size());
+    for (const auto &symbol : _symbols) {
+        auto it = assignmentHashes.find(&symbol.get());
+        if (it == assignmentHashes.end()) {
+            auto symbolHash = Z3ResultCache::hashString(symbol.get().label.c_str());
+            auto assignment = assignmentSet.get(symbol.get());
+            // Data plane variables are never assigned, which is different from any assignment.
+            symbolHash = assignment.has_value()
+                             ? Z3ResultCache::hashExpression(assignment.value(), symbolHash)
+                             : Z3ResultCache::hashString("|unassigned|", symbolHash);
+            it = assignmentHashes.emplace(&symbol.get(), symbolHash).first;
+        }
+        assignmentHash = Z3ResultCache::hashInteger(it->second, assignmentHash);
+    }
+    return {_expressionHash, assignmentHash};
+}
+
+std::vector<z3::expr> substituteWithResultCache(
+    const Z3ControlPlaneAssignmentSet &assignmentSet, std::vector<z3::expr> expressions,
+    const std::vector<const Z3ResultFingerprint *> &fingerprints) {
+    BUG_CHECK(expressions.size() == fingerprints.size(), "Expected %1% fingerprints, but got %2%.",
+              expressions.size(), fingerprints.size());
+    Z3ResultFingerprint::AssignmentHashMap assignmentHashes;
+    std::vector<std::optional<Z3ResultKey>> keys(expressions.size());
+    std::vector<size_t> missingIndices;
+    std::vector<z3::expr> missingExpressions;
+    for (size_t idx = 0; idx < expressions.size(); ++idx) {
+        const auto *fingerprint = fingerprints[idx];
+        if (fingerprint != nullptr) {
+            keys[idx] = fingerprint->computeKey(assignmentSet, assignmentHashes);
+            auto cachedResult = Z3ResultCache::lookup(keys[idx].value());
+            if (cachedResult.has_value()) {
+                auto result = cachedResult.value().toExpression(expressions[idx]);
+                if (result.has_value()) {
+                    expressions[idx] = result.value();
+                    continue;
+                }
+            }
+        }
+        missingIndices.push_back(idx);
+        missingExpressions.push_back(expressions[idx]);
+    }
+    if (missingExpressions.empty()) {
+        return expressions;
+    }
+    auto results = assignmentSet.substitute(std::move(missingExpressions));
+    for (size_t missingIdx = 0; missingIdx < missingIndices.size(); ++missingIdx) {
+        auto idx = missingIndices[missingIdx];
+        expressions[idx] = results[missingIdx];
+        if (keys[idx].has_value()) {
+            Z3ResultCache::insert(keys[idx].value(), results[missingIdx]);
+        }
+    }
+    return expressions;
+}
+
+}  // namespace P4::P4Tools::Flay
@@ -0,0 +1,52 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_Z3_CACHED_SUBSTITUTION_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_Z3_CACHED_SUBSTITUTION_H_
+
+#include <z3++.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "backends/p4tools/modules/flay/core/control_plane/z3_control_plane_assignment.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_result_cache.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools::Flay {
+
+/// Identifies an expression whose substitution results are stored in the Z3ResultCache. The
+/// key of a result combines the hash of the expression with the hashes of the assignments of the
+/// symbols in the expression, so assignments to unrelated symbols do not invalidate the result.
+class Z3ResultFingerprint {
+ public:
+    /// Memoizes the hash of the assignment of each symbol within one substitution batch.
+    using AssignmentHashMap = absl::flat_hash_map<const IR::SymbolicVariable *, uint64_t>;
+
+ private:
+    /// The hash of the expression in Z3 form.
+    uint64_t _expressionHash;
+
+    /// The symbols in the expression, in the order of the semantic comparator.
+    std::vector<std::reference_wrapper<const IR::SymbolicVariable>> _symbols;
+
+ public:
+    /// Fingerprint @param expression, whose Z3 form is @param z3Expression.
+    Z3ResultFingerprint(const IR::Expression &expression, const z3::expr &z3Expression);
+
+    /// @returns the key of the result of substituting @param assignmentSet into the expression.
+    [[nodiscard]] Z3ResultKey computeKey(const Z3ControlPlaneAssignmentSet &assignmentSet,
+                                         AssignmentHashMap &assignmentHashes) const;
+};
+
+/// Applies @param assignmentSet to @param expressions like Z3ControlPlaneAssignmentSet::substitute.
+/// Results found in the Z3ResultCache are taken from the cache. The remaining expressions are
+/// substituted in a single batch and their results are added to the cache. The i-th entry of
+/// @param fingerprints belongs to the i-th expression. Expressions without fingerprint bypass the
+/// cache.
+std::vector<z3::expr> substituteWithResultCache(
+    const Z3ControlPlaneAssignmentSet &assignmentSet, std::vector<z3::expr> expressions,
+    const std::vector<const Z3ResultFingerprint *> &fingerprints);
+
+}  // namespace P4::P4Tools::Flay
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_Z3_CACHED_SUBSTITUTION_H_ */
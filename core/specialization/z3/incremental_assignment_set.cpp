@@ -0,0 +1,89 @@
+#include "backends/p4tools/modules/flay/core/specialization/z3/incremental_assignment_set.h"
+
+#include <set>
+
+#include "lib/timer.h"
+
+namespace P4::P4Tools::Flay {
+
+void IncrementalZ3AssignmentSet::removeContribution(cstring name) {
+    auto it = _contributions.find(name);
+    if (it == _contributions.end()) {
+        return;
+    }
+    it->second.forEach([this, name](const IR::SymbolicVariable &symbol,
+                                    const z3::expr & /*expr*/) {
+        // A symbol which another constraint contributed first has already been reported as a
+        // duplicate. It stays with that constraint.
+        auto owner = _symbolOwners.find(symbol);
+        if (owner == _symbolOwners.end() || owner->second != name) {
+            return;
+        }
+        _assignmentSet.remove(symbol);
+        _symbolOwners.erase(owner);
+    });
+    _contributions.erase(it);
+}
+
+void IncrementalZ3AssignmentSet::addContribution(cstring name, const Z3ControlPlaneItem &item) {
+    auto contribution = item.computeZ3ControlPlaneAssignments();
+    // Like the merge of the full set, a symbol assigned by two constraints is an error.
+    contribution.forEach([this, name](const IR::SymbolicVariable &symbol, const z3::expr &expr) {
+        if (_assignmentSet.add(symbol, expr)) {
+            _symbolOwners.emplace(symbol, name);
+        }
+    });
+    _contributions.insert_or_assign(name, std::move(contribution));
+}
+
+const Z3ControlPlaneAssignmentSet &IncrementalZ3AssignmentSet::rebuild(
+    const ControlPlaneConstraints &controlPlaneConstraints) {
+    Util::ScopedTimer timer("Rebuilding Z3 assignment set");
+    _assignmentSet.clear();
+    _contributions.clear();
+    _symbolOwners.clear();
+    for (const auto &[entityName, controlPlaneConstraint] : controlPlaneConstraints) {
+        addContribution(entityName, controlPlaneConstraint.get());
+    }
+    _initialized = true;
+    return _assignmentSet;
+}
+
+const Z3ControlPlaneAssignmentSet &IncrementalZ3AssignmentSet::update(
+    const SymbolSet &symbolSet, const ControlPlaneConstraints &controlPlaneConstraints) {
+    if (!_initialized) {
+        return rebuild(controlPlaneConstraints);
+    }
+    Util::ScopedTimer timer("Updating Z3 assignment set");
+    std::set<cstring> dirtyConstraints;
+    for (const auto &symbol : symbolSet) {
+        auto it = _symbolOwners.find(symbol);
+        if (it != _symbolOwners.end()) {
+            dirtyConstraints.insert(it->second);
+        }
+    }
+    // Constraints which have been added since the last computation always need to be merged.
+    for (const auto &[entityName, controlPlaneConstraint] : controlPlaneConstraints) {
+        if (_contributions.find(entityName) == _contributions.end()) {
+            dirtyConstraints.insert(entityName);
+        }
+    }
+    // We can not attribute the symbols to any constraint. Be conservative and rebuild.
+    if (dirtyConstraints.empty() && !symbolSet.empty()) {
+        return rebuild(controlPlaneConstraints);
+    }
+    for (auto name : dirtyConstraints) {
+        removeContribution(name);
+        auto it = controlPlaneConstraints.find(name);
+        if (it != controlPlaneConstraints.end()) {
+            addContribution(name, it->second.get());
+        }
+    }
+    return _assignmentSet;
+}
+
+const Z3ControlPlaneAssignmentSet &IncrementalZ3AssignmentSet::assignmentSet() const {
+    return _assignmentSet;
+}
+
+}  // namespace P4::P4Tools::Flay
@@ -0,0 +1,59 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_Z3_INCREMENTAL_ASSIGNMENT_SET_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_Z3_INCREMENTAL_ASSIGNMENT_SET_H_
+
+#include <map>
+#include <set>
+
+#include "backends/p4tools/modules/flay/core/control_plane/control_plane_item.h"
+#include "backends/p4tools/modules/flay/core/control_plane/symbols.h"
+#include "backends/p4tools/modules/flay/core/control_plane/z3_control_plane_assignment.h"
+
+namespace P4::P4Tools::Flay {
+
+/// A persistent Z3ControlPlaneAssignmentSet which is maintained incrementally.
+/// Instead of merging the assignments of every control plane constraint on each update, the set
+/// remembers which constraint contributed which variables. On an update only the constraints
+/// which own one of the changed symbols are recomputed and patched into the set.
+/// Every symbol may only be assigned by a single constraint. As with merging the full set, a
+/// symbol assigned by two constraints is reported as an error.
+class IncrementalZ3AssignmentSet {
+ private:
+    /// The merged assignment set of all control plane constraints.
+    Z3ControlPlaneAssignmentSet _assignmentSet;
+
+    /// The contribution of each control plane constraint to the merged assignment set.
+    std::map<cstring, Z3ControlPlaneAssignmentSet> _contributions;
+
+    /// Maps each assigned variable to the name of the constraint which contributed it.
+    std::map<std::reference_wrapper<const IR::SymbolicVariable>, cstring,
+             IR::IsSemanticallyLessComparator>
+        _symbolOwners;
+
+    /// Whether the set has been built at least once.
+    bool _initialized = false;
+
+    /// Remove the current contribution of the constraint @param name from the set.
+    void removeContribution(cstring name);
+
+    /// Compute the contribution of @param item and add it to the set.
+    void addContribution(cstring name, const Z3ControlPlaneItem &item);
+
+ public:
+    IncrementalZ3AssignmentSet() = default;
+
+    /// Discard the current state and merge the assignments of all constraints.
+    const Z3ControlPlaneAssignmentSet &rebuild(
+        const ControlPlaneConstraints &controlPlaneConstraints);
+
+    /// Recompute only the contributions of the constraints which own a symbol in @param symbolSet.
+    /// Falls back to a full rebuild if no constraint could be attributed to the symbols.
+    const Z3ControlPlaneAssignmentSet &update(
+        const SymbolSet &symbolSet, const ControlPlaneConstraints &controlPlaneConstraints);
+
+    /// @returns the current merged assignment set.
+    [[nodiscard]] const Z3ControlPlaneAssignmentSet &assignmentSet() const;
+};
+
+}  // namespace P4::P4Tools::Flay
+
+#endif /* BACKENDS_P4TOOLS_MODULES_FLAY_CORE_SPECIALIZATION_Z3_INCREMENTAL_ASSIGNMENT_SET_H_ */
@@ -4,57 +4,90 @@
 
 #include <cstdio>
 #include <utility>
+#include <vector>
 
 #include "lib/timer.h"
 
 namespace P4::P4Tools::Flay {
 
 Z3ReachabilityExpression::Z3ReachabilityExpression(ReachabilityExpression reachabilityExpression,
-                                                   z3::expr z3Condition)
-    : ReachabilityExpression(reachabilityExpression), _z3Condition(std::move(z3Condition)) {}
+                                                   z3::expr z3Condition,
+                                                   const Z3ResultFingerprint *resultFingerprint)
+    : ReachabilityExpression(reachabilityExpression),
+      _z3Condition(std::move(z3Condition)),
+      _resultFingerprint(resultFingerprint) {}
 
 z3::expr &Z3ReachabilityExpression::getZ3Condition() { return _z3Condition; }
 
-std::optional<bool> Z3SolverReachabilityMap::computeNodeReachability(
-    const IR::Node *node, const Z3ControlPlaneAssignmentSet &assignmentSet) {
-    auto it = find(node);
-    if (it == end()) {
-        error("Reachability mapping for node %1% does not exist.", node);
-        return std::nullopt;
-    }
-    auto *reachabilityExpression = it->second;
-    auto &reachabilityCondition = reachabilityExpression->getZ3Condition();
-    auto newExpr = assignmentSet.substitute(reachabilityCondition).simplify();
-    auto reachabilityAssignment = reachabilityExpression->getReachability();
+const Z3ResultFingerprint *Z3ReachabilityExpression::resultFingerprint() const {
+    return _resultFingerprint;
+}
+
+bool Z3SolverReachabilityMap::updateNodeReachability(
+    Z3ReachabilityExpression &reachabilityExpression, const z3::expr &newExpr) {
+    auto reachabilityAssignment = reachabilityExpression.getReachability();
     auto declKind = newExpr.decl().decl_kind();
     if (declKind == Z3_decl_kind::Z3_OP_FALSE || declKind == Z3_decl_kind::Z3_OP_TRUE) {
         if (newExpr.bool_value() == Z3_lbool::Z3_L_TRUE) {
-            reachabilityExpression->setReachability(true);
+            reachabilityExpression.setReachability(true);
             return !reachabilityAssignment.has_value() || !reachabilityAssignment.value();
         }
         if (newExpr.bool_value() == Z3_lbool::Z3_L_FALSE) {
-            reachabilityExpression->setReachability(false);
+            reachabilityExpression.setReachability(false);
             return !reachabilityAssignment.has_value() || reachabilityAssignment.value();
         }
     }
     if (reachabilityAssignment.has_value()) {
-        reachabilityExpression->setReachability(std::nullopt);
+        reachabilityExpression.setReachability(std::nullopt);
         return true;
     }
     return false;
 }
 
+bool Z3SolverReachabilityMap::computeReachability(
+    const std::vector<ReachabilityTarget> &targets,
+    const Z3ControlPlaneAssignmentSet &assignmentSet) {
+    std::vector<z3::expr> conditions;
+    std::vector<const Z3ResultFingerprint *> fingerprints;
+    conditions.reserve(targets.size());
+    fingerprints.reserve(targets.size());
+    for (const auto &[node, reachabilityExpression] : targets) {
+        conditions.push_back(reachabilityExpression->getZ3Condition());
+        fingerprints.push_back(reachabilityExpression->resultFingerprint());
+    }
+    auto newExprs =
+        substituteWithResultCache(assignmentSet, std::move(conditions), fingerprints);
+    bool hasChanged = false;
+    for (size_t idx = 0; idx < targets.size(); ++idx) {
+        const auto &[node, reachabilityExpression] = targets[idx];
+        if (updateNodeReachability(*reachabilityExpression, newExprs[idx])) {
+            recordChange(node);
+            hasChanged = true;
+        }
+    }
+    return hasChanged;
+}
+
 Z3SolverReachabilityMap::Z3SolverReachabilityMap(const NodeAnnotationMap &map)
-    : _symbolMap(map.reachabilitySymbolMap()) {
+    : _dependencies(map.reachabilityDependencies()) {
     Util::ScopedTimer timer("Precomputing Z3 Reachability");
+    bool useResultCache = Z3ResultCache::isEnabled();
     for (const auto &[node, reachabilityExpression] : map.reachabilityMap()) {
-        (*this)[node] = new Z3ReachabilityExpression(
-            *reachabilityExpression,
-            Z3Cache::set(reachabilityExpression->getCondition()).simplify());
+        const auto *condition = reachabilityExpression->getCondition();
+        auto z3Condition = Z3Cache::set(condition).simplify();
+        const auto *resultFingerprint =
+            useResultCache ? new Z3ResultFingerprint(*condition, z3Condition) : nullptr;
+        (*this)[node] =
+            new Z3ReachabilityExpression(*reachabilityExpression, z3Condition, resultFingerprint);
         // printInfo("Computing reachability for %1%:\t%2%", node,
         //           reachabilityExpression->getCondition());
         // printInfo("##############");
     }
+    _dependentExpressions.reserve(_dependencies.nodeCount());
+    for (SymbolDependencyIndex::NodeId nodeId = 0; nodeId < _dependencies.nodeCount(); ++nodeId) {
+        auto it = find(_dependencies.node(nodeId));
+        _dependentExpressions.push_back(it != end() ? it->second : nullptr);
+    }
 }
 
 std::optional<bool> Z3SolverReachabilityMap::isNodeReachable(const IR::Node *node) const {
@@ -72,56 +105,51 @@ std::optional<bool> Z3SolverReachabilityMap::isNodeReachable(const IR::Node *nod
     return std::nullopt;
 }
 
-std::optional<bool> Z3SolverReachabilityMap::recomputeReachability(
-    const ControlPlaneConstraints &controlPlaneConstraints) {
-    /// Generate IR equalities from the control plane constraints.
-    Z3ControlPlaneAssignmentSet assignmentSet;
-    for (const auto &[entityName, controlPlaneConstraint] : controlPlaneConstraints) {
-        assignmentSet.merge(controlPlaneConstraint.get().computeZ3ControlPlaneAssignments());
-    }
-
-    bool hasChanged = false;
-    for (auto &pair : *this) {
-        auto result = computeNodeReachability(pair.first, assignmentSet);
-        if (!result.has_value()) {
+std::optional<bool> Z3SolverReachabilityMap::computeNodeSetReachability(
+    const NodeSet &targetNodes, const Z3ControlPlaneAssignmentSet &assignmentSet) {
+    std::vector<ReachabilityTarget> targets;
+    targets.reserve(targetNodes.size());
+    for (const auto *node : targetNodes) {
+        auto it = find(node);
+        if (it == end()) {
+            error("Reachability mapping for node %1% does not exist.", node);
             return std::nullopt;
         }
-        hasChanged |= result.value();
+        targets.emplace_back(node, it->second);
     }
-    return hasChanged;
+    return computeReachability(targets, assignmentSet);
+}
+
+std::optional<bool> Z3SolverReachabilityMap::recomputeReachability(
+    const ControlPlaneConstraints &controlPlaneConstraints) {
+    /// Generate IR equalities from the control plane constraints.
+    const auto &assignmentSet = _assignmentSet.rebuild(controlPlaneConstraints);
+    std::vector<ReachabilityTarget> targets(begin(), end());
+    return computeReachability(targets, assignmentSet);
 }
 
 std::optional<bool> Z3SolverReachabilityMap::recomputeReachability(
     const SymbolSet &symbolSet, const ControlPlaneConstraints &controlPlaneConstraints) {
-    NodeSet targetNodes;
-    for (const auto &symbol : symbolSet) {
-        auto it = _symbolMap.find(symbol);
-        if (it != _symbolMap.end()) {
-            for (const auto *node : it->second) {
-                targetNodes.insert(node);
-            }
+    std::vector<ReachabilityTarget> targets;
+    for (auto nodeId : _dependencies.dependentNodeIds(symbolSet)) {
+        const auto *node = _dependencies.node(nodeId);
+        auto *reachabilityExpression = _dependentExpressions[nodeId];
+        if (reachabilityExpression == nullptr) {
+            error("Reachability mapping for node %1% does not exist.", node);
+            return std::nullopt;
         }
+        targets.emplace_back(node, reachabilityExpression);
     }
-    return recomputeReachability(targetNodes, controlPlaneConstraints);
+    /// Only patch the assignments of the constraints affected by the changed symbols.
+    const auto &assignmentSet = _assignmentSet.update(symbolSet, controlPlaneConstraints);
+    return computeReachability(targets, assignmentSet);
 }
 
 std::optional<bool> Z3SolverReachabilityMap::recomputeReachability(
     const NodeSet &targetNodes, const ControlPlaneConstraints &controlPlaneConstraints) {
-    /// Generate IR equalities from the control plane constraints.
-    Z3ControlPlaneAssignmentSet assignmentSet;
-    for (const auto &[entityName, controlPlaneConstraint] : controlPlaneConstraints) {
-        assignmentSet.merge(controlPlaneConstraint.get().computeZ3ControlPlaneAssignments());
-    }
-
-    bool hasChanged = false;
-    for (const auto *node : targetNodes) {
-        auto result = computeNodeReachability(node, assignmentSet);
-        if (!result.has_value()) {
-            return std::nullopt;
-        }
-        hasChanged |= result.value();
-    }
-    return hasChanged;
+    /// We do not know which constraints have changed, so rebuild all assignments.
+    const auto &assignmentSet = _assignmentSet.rebuild(controlPlaneConstraints);
+    return computeNodeSetReachability(targetNodes, assignmentSet);
 }
 
 }  // namespace P4::P4Tools::Flay
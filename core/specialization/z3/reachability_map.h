@@ -3,8 +3,13 @@
 
 #include <z3++.h>
 
+#include <utility>
+#include <vector>
+
 #include "backends/p4tools/modules/flay/core/interpreter/node_map.h"
 #include "backends/p4tools/modules/flay/core/specialization/reachability_map.h"
+#include "backends/p4tools/modules/flay/core/specialization/z3/cached_substitution.h"
+#include "backends/p4tools/modules/flay/core/specialization/z3/incremental_assignment_set.h"
 
 namespace P4::P4Tools::Flay {
 
@@ -15,25 +20,53 @@ class Z3ReachabilityExpression : public ReachabilityExpression {
     /// The condition for the expression to be executable in Z3 form.
     z3::expr _z3Condition;
 
+    /// Identifies the condition in the persistent result cache. Not set if the cache is disabled.
+    const Z3ResultFingerprint *_resultFingerprint;
+
  public:
     explicit Z3ReachabilityExpression(ReachabilityExpression reachabilityExpression,
-                                      z3::expr z3Condition);
+                                      z3::expr z3Condition,
+                                      const Z3ResultFingerprint *resultFingerprint = nullptr);
 
     /// @returns the precomputed Z3 condition.
     [[nodiscard]] z3::expr &getZ3Condition();
+
+    /// @returns the fingerprint of the condition in the persistent result cache, if any.
+    [[nodiscard]] const Z3ResultFingerprint *resultFingerprint() const;
 };
 
 class Z3SolverReachabilityMap
     : private std::map<const IR::Node *, Z3ReachabilityExpression *, SourceIdCmp>,
       public AbstractReachabilityMap {
  private:
-    /// A mapping of symbolic variables to IR nodes that depend on these symbolic variables in the
-    /// reachability map. This map can we used for incremental re-computation of reachability.
-    SymbolMap _symbolMap;
+    /// Indexes the nodes of the reachability map by the symbolic variables they depend on. This
+    /// index is used for incremental re-computation of reachability.
+    SymbolDependencyIndex _dependencies;
+
+    /// The reachability expression of every node in the dependency index, by node id.
+    std::vector<Z3ReachabilityExpression *> _dependentExpressions;
+
+    /// The persistent assignment set derived from the control plane constraints. It is patched
+    /// incrementally when only a subset of the symbols has changed.
+    IncrementalZ3AssignmentSet _assignmentSet;
+
+    /// A node together with its reachability expression.
+    using ReachabilityTarget = std::pair<const IR::Node *, Z3ReachabilityExpression *>;
+
+    /// Set the reachability of @param reachabilityExpression from its substituted condition
+    /// @param newExpr. @returns true if the reachability has changed.
+    static bool updateNodeReachability(Z3ReachabilityExpression &reachabilityExpression,
+                                       const z3::expr &newExpr);
+
+    /// Compute reachability for all @param targets given the set of constraints. The conditions
+    /// of all targets are substituted in a single batch, unless their result is already in the
+    /// persistent result cache.
+    bool computeReachability(const std::vector<ReachabilityTarget> &targets,
+                             const Z3ControlPlaneAssignmentSet &assignmentSet);
 
-    /// Compute reachability for the node given the set of constraints.
-    std::optional<bool> computeNodeReachability(const IR::Node *node,
-                                                const Z3ControlPlaneAssignmentSet &assignmentSet);
+    /// Compute reachability for all @param targetNodes given the set of constraints.
+    std::optional<bool> computeNodeSetReachability(
+        const NodeSet &targetNodes, const Z3ControlPlaneAssignmentSet &assignmentSet);
 
  public:
     explicit Z3SolverReachabilityMap(const NodeAnnotationMap &map);
@@ -3,6 +3,8 @@
 #include <z3++.h>
 
 #include <optional>
+#include <utility>
+#include <vector>
 
 #include "lib/error.h"
 #include "lib/timer.h"
@@ -15,45 +17,56 @@ Z3SubstitutionExpression
 
 Z3SubstitutionExpression::Z3SubstitutionExpression(const IR::Expression *condition,
                                                    const IR::Expression *originalExpression,
-                                                   z3::expr originalZ3Expression)
+                                                   z3::expr originalZ3Expression,
+                                                   const Z3ResultFingerprint *resultFingerprint)
     : SubstitutionExpression(condition, originalExpression),
-      _originalZ3Expression(std::move(originalZ3Expression)) {}
+      _originalZ3Expression(std::move(originalZ3Expression)),
+      _resultFingerprint(resultFingerprint) {}
 
 const z3::expr &Z3SubstitutionExpression::originalZ3Expression() const {
     return _originalZ3Expression;
 }
 
+const Z3ResultFingerprint *Z3SubstitutionExpression::resultFingerprint() const {
+    return _resultFingerprint;
+}
+
 /**************************************************************************************************
 Z3SolverSubstitutionMap
 **************************************************************************************************/
 
 Z3SolverSubstitutionMap::Z3SolverSubstitutionMap(const NodeAnnotationMap &map)
-    : _symbolMap(map.expressionSymbolMap()) {
+    : _dependencies(map.expressionDependencies()) {
     Util::ScopedTimer timer("Precomputing Z3 Substitution Map");
+    bool useResultCache = Z3ResultCache::isEnabled();
     for (auto &[node, substitutionExpression] : map.substitutionMap()) {
-        auto *z3SubstitutionExpression = new Z3SubstitutionExpression(
-            substitutionExpression->condition(), substitutionExpression->originalExpression(),
-            Z3Cache::set(substitutionExpression->originalExpression()).simplify());
+        const auto *originalExpression = substitutionExpression->originalExpression();
+        auto originalZ3Expression = Z3Cache::set(originalExpression).simplify();
+        const auto *resultFingerprint =
+            useResultCache ? new Z3ResultFingerprint(*originalExpression, originalZ3Expression)
+                           : nullptr;
+        auto *z3SubstitutionExpression =
+            new Z3SubstitutionExpression(substitutionExpression->condition(), originalExpression,
+                                         originalZ3Expression, resultFingerprint);
         emplace(node, z3SubstitutionExpression);
     }
-}
-
-std::optional<bool> Z3SolverSubstitutionMap::computeNodeSubstitution(
-    const IR::Expression *expression, const Z3ControlPlaneAssignmentSet &assignmentSet) {
-    auto it = find(expression);
-    if (it == end()) {
-        error("Substitution mapping for node %1% does not exist.", expression);
-        return std::nullopt;
+    _dependentExpressions.reserve(_dependencies.nodeCount());
+    for (SymbolDependencyIndex::NodeId nodeId = 0; nodeId < _dependencies.nodeCount(); ++nodeId) {
+        const auto *expression = _dependencies.node(nodeId)->checkedTo<IR::Expression>();
+        auto it = find(expression);
+        _dependentExpressions.push_back(it != end() ? it->second : nullptr);
     }
+}
 
-    auto original = it->second->originalZ3Expression();
-    auto newExpr = assignmentSet.substitute(original).simplify();
-    auto previousSubstitution = it->second->substitution();
+bool Z3SolverSubstitutionMap::updateNodeSubstitution(
+    const IR::Expression *expression, Z3SubstitutionExpression &substitutionExpression,
+    const z3::expr &newExpr) {
+    auto previousSubstitution = substitutionExpression.substitution();
     auto declKind = newExpr.decl().decl_kind();
     if (declKind == Z3_decl_kind::Z3_OP_FALSE || declKind == Z3_decl_kind::Z3_OP_TRUE) {
         const auto *newSubstitution =
             IR::BoolLiteral::get(newExpr.is_true(), expression->getSourceInfo());
-        it->second->setSubstitution(newSubstitution);
+        substitutionExpression.setSubstitution(newSubstitution);
         return !previousSubstitution.has_value() ||
                !previousSubstitution.value()->equiv(*newSubstitution);
     }
@@ -62,19 +75,42 @@ std::optional<bool> Z3SolverSubstitutionMap::computeNodeSubstitution(
             expression->type,
             big_int(newExpr.get_decimal_string(expression->type->width_bits()).c_str()),
             expression->getSourceInfo());
-        it->second->setSubstitution(newSubstitution);
+        substitutionExpression.setSubstitution(newSubstitution);
         return !previousSubstitution.has_value() ||
                !previousSubstitution.value()->equiv(*newSubstitution);
     }
 
     if (previousSubstitution.has_value()) {
-        it->second->unsetSubstitution();
+        substitutionExpression.unsetSubstitution();
         return true;
     }
 
     return false;
 }
 
+bool Z3SolverSubstitutionMap::computeSubstitution(
+    const std::vector<SubstitutionTarget> &targets,
+    const Z3ControlPlaneAssignmentSet &assignmentSet) {
+    std::vector<z3::expr> originals;
+    std::vector<const Z3ResultFingerprint *> fingerprints;
+    originals.reserve(targets.size());
+    fingerprints.reserve(targets.size());
+    for (const auto &[expression, substitutionExpression] : targets) {
+        originals.push_back(substitutionExpression->originalZ3Expression());
+        fingerprints.push_back(substitutionExpression->resultFingerprint());
+    }
+    auto newExprs = substituteWithResultCache(assignmentSet, std::move(originals), fingerprints);
+    bool hasChanged = false;
+    for (size_t idx = 0; idx < targets.size(); ++idx) {
+        const auto &[expression, substitutionExpression] = targets[idx];
+        if (updateNodeSubstitution(expression, *substitutionExpression, newExprs[idx])) {
+            recordChange(expression);
+            hasChanged = true;
+        }
+    }
+    return hasChanged;
+}
+
 std::optional<const IR::Literal *> Z3SolverSubstitutionMap::isExpressionConstant(
     const IR::Expression *expression) const {
     auto it = find(expression);
@@ -88,57 +124,52 @@ std::optional<const IR::Literal *> Z3SolverSubstitutionMap::isExpressionConstant
     return std::nullopt;
 }
 
-std::optional<bool> Z3SolverSubstitutionMap::recomputeSubstitution(
-    const ControlPlaneConstraints &controlPlaneConstraints) {
-    /// Generate IR equalities from the control plane constraints.
-    Z3ControlPlaneAssignmentSet assignmentSet;
-    for (const auto &[entityName, controlPlaneConstraint] : controlPlaneConstraints) {
-        assignmentSet.merge(controlPlaneConstraint.get().computeZ3ControlPlaneAssignments());
-    }
-
-    bool hasChanged = false;
-    for (auto &pair : *this) {
-        auto result = computeNodeSubstitution(pair.first, assignmentSet);
-        if (!result.has_value()) {
+std::optional<bool> Z3SolverSubstitutionMap::computeExpressionSetSubstitution(
+    const ExpressionSet &targetExpressions, const Z3ControlPlaneAssignmentSet &assignmentSet) {
+    std::vector<SubstitutionTarget> targets;
+    targets.reserve(targetExpressions.size());
+    for (const auto *expression : targetExpressions) {
+        auto it = find(expression);
+        if (it == end()) {
+            error("Substitution mapping for node %1% does not exist.", expression);
             return std::nullopt;
         }
-        hasChanged |= result.value();
+        targets.emplace_back(expression, it->second);
     }
-    return hasChanged;
+    return computeSubstitution(targets, assignmentSet);
+}
+
+std::optional<bool> Z3SolverSubstitutionMap::recomputeSubstitution(
+    const ControlPlaneConstraints &controlPlaneConstraints) {
+    /// Generate IR equalities from the control plane constraints.
+    const auto &assignmentSet = _assignmentSet.rebuild(controlPlaneConstraints);
+    std::vector<SubstitutionTarget> targets(begin(), end());
+    return computeSubstitution(targets, assignmentSet);
 }
 
 std::optional<bool> Z3SolverSubstitutionMap::recomputeSubstitution(
     const SymbolSet &symbolSet, const ControlPlaneConstraints &controlPlaneConstraints) {
-    ExpressionSet targetExpressions;
-    for (const auto &symbol : symbolSet) {
-        auto it = _symbolMap.find(symbol);
-        if (it != _symbolMap.end()) {
-            for (const auto *node : it->second) {
-                targetExpressions.insert(node->checkedTo<IR::Expression>());
-            }
+    std::vector<SubstitutionTarget> targets;
+    for (auto nodeId : _dependencies.dependentNodeIds(symbolSet)) {
+        const auto *expression = _dependencies.node(nodeId)->checkedTo<IR::Expression>();
+        auto *substitutionExpression = _dependentExpressions[nodeId];
+        if (substitutionExpression == nullptr) {
+            error("Substitution mapping for node %1% does not exist.", expression);
+            return std::nullopt;
         }
+        targets.emplace_back(expression, substitutionExpression);
     }
-    return recomputeSubstitution(targetExpressions, controlPlaneConstraints);
+    /// Only patch the assignments of the constraints affected by the changed symbols.
+    const auto &assignmentSet = _assignmentSet.update(symbolSet, controlPlaneConstraints);
+    return computeSubstitution(targets, assignmentSet);
 }
 
 std::optional<bool> Z3SolverSubstitutionMap::recomputeSubstitution(
     const ExpressionSet &targetExpressions,
     const ControlPlaneConstraints &controlPlaneConstraints) {
-    /// Generate IR equalities from the control plane constraints.
-    Z3ControlPlaneAssignmentSet assignmentSet;
-    for (const auto &[entityName, controlPlaneConstraint] : controlPlaneConstraints) {
-        assignmentSet.merge(controlPlaneConstraint.get().computeZ3ControlPlaneAssignments());
-    }
-
-    bool hasChanged = false;
-    for (const auto *node : targetExpressions) {
-        auto result = computeNodeSubstitution(node, assignmentSet);
-        if (!result.has_value()) {
-            return std::nullopt;
-        }
-        hasChanged |= result.value();
-    }
-    return hasChanged;
+    /// We do not know which constraints have changed, so rebuild all assignments.
+    const auto &assignmentSet = _assignmentSet.rebuild(controlPlaneConstraints);
+    return computeExpressionSetSubstitution(targetExpressions, assignmentSet);
 }
 
 }  // namespace P4::P4Tools::Flay
@@ -5,12 +5,16 @@
 
 #include <functional>
 #include <optional>
+#include <utility>
+#include <vector>
 
 #include "backends/p4tools/common/core/z3_solver.h"
 #include "backends/p4tools/modules/flay/core/control_plane/control_plane_item.h"
 #include "backends/p4tools/modules/flay/core/control_plane/symbolic_state.h"
 #include "backends/p4tools/modules/flay/core/interpreter/node_map.h"
 #include "backends/p4tools/modules/flay/core/specialization/substitution_map.h"
+#include "backends/p4tools/modules/flay/core/specialization/z3/cached_substitution.h"
+#include "backends/p4tools/modules/flay/core/specialization/z3/incremental_assignment_set.h"
 
 namespace P4::P4Tools::Flay {
 
@@ -23,13 +27,22 @@ struct Z3SubstitutionExpression : public SubstitutionExpression {
     /// The original expression translated to Z3.
     z3::expr _originalZ3Expression;
 
+    /// Identifies the original expression in the persistent result cache. Not set if the cache
+    /// is disabled.
+    const Z3ResultFingerprint *_resultFingerprint;
+
  public:
     Z3SubstitutionExpression(const IR::Expression *condition,
                              const IR::Expression *originalExpression,
-                             z3::expr originalZ3Expression);
+                             z3::expr originalZ3Expression,
+                             const Z3ResultFingerprint *resultFingerprint = nullptr);
 
     /// @returns the original expression translated to Z3 form.
     [[nodiscard]] const z3::expr &originalZ3Expression() const;
+
+    /// @returns the fingerprint of the original expression in the persistent result cache, if
+    /// any.
+    [[nodiscard]] const Z3ResultFingerprint *resultFingerprint() const;
 };
 
 /// The expression map but using Z3 expressions instead of IR expressions.
@@ -37,13 +50,35 @@ using Z3ExpressionMap = std::map<const IR::Expression *, Z3SubstitutionExpressio
 
 class Z3SolverSubstitutionMap : private Z3ExpressionMap, public AbstractSubstitutionMap {
  private:
-    /// A mapping of symbolic variables to IR nodes that depend on these symbolic variables in the
-    /// substitution map. This map can we used for incremental re-computation of substitution.
-    SymbolMap _symbolMap;
-
-    /// Compute substitution for the node given the set of constraints.
-    std::optional<bool> computeNodeSubstitution(const IR::Expression *expression,
-                                                const Z3ControlPlaneAssignmentSet &assignmentSet);
+    /// Indexes the expressions of the substitution map by the symbolic variables they depend on.
+    /// This index is used for incremental re-computation of substitution.
+    SymbolDependencyIndex _dependencies;
+
+    /// The substitution expression of every expression in the dependency index, by node id.
+    std::vector<Z3SubstitutionExpression *> _dependentExpressions;
+
+    /// The persistent assignment set derived from the control plane constraints. It is patched
+    /// incrementally when only a subset of the symbols has changed.
+    IncrementalZ3AssignmentSet _assignmentSet;
+
+    /// An expression together with its substitution expression.
+    using SubstitutionTarget = std::pair<const IR::Expression *, Z3SubstitutionExpression *>;
+
+    /// Set the substitution of @param expression from its substituted Z3 form @param newExpr.
+    /// @returns true if the substitution has changed.
+    static bool updateNodeSubstitution(const IR::Expression *expression,
+                                       Z3SubstitutionExpression &substitutionExpression,
+                                       const z3::expr &newExpr);
+
+    /// Compute substitution for all @param targets given the set of constraints. The expressions
+    /// of all targets are substituted in a single batch, unless their result is already in the
+    /// persistent result cache.
+    bool computeSubstitution(const std::vector<SubstitutionTarget> &targets,
+                             const Z3ControlPlaneAssignmentSet &assignmentSet);
+
+    /// Compute substitution for all @param targetExpressions given the set of constraints.
+    std::optional<bool> computeExpressionSetSubstitution(
+        const ExpressionSet &targetExpressions, const Z3ControlPlaneAssignmentSet &assignmentSet);
 
  public:
     explicit Z3SolverSubstitutionMap(const NodeAnnotationMap &map);
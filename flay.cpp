@@ -12,6 +12,8 @@
 #include "backends/p4tools/modules/flay/core/interpreter/partial_evaluator.h"
 #include "backends/p4tools/modules/flay/core/interpreter/target.h"
 #include "backends/p4tools/modules/flay/core/lib/return_macros.h"
+#include "backends/p4tools/modules/flay/core/lib/statistics_report.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_result_cache.h"
 #include "backends/p4tools/modules/flay/core/specialization/service_wrapper_bfruntime.h"
 #include "backends/p4tools/modules/flay/core/specialization/service_wrapper_p4runtime.h"
 #include "backends/p4tools/modules/flay/register.h"
@@ -20,49 +22,113 @@
 #include "control-plane/p4RuntimeTypes.h"
 
 #ifdef FLAY_WITH_GRPC
-#include "backends/p4tools/modules/flay/service/flay_grpc_service.h"
+#include "backends/p4tools/modules/flay/grpc_service/flay_grpc_service.h"
 #endif
+#include "lib/compile_context.h"
 #include "lib/error.h"
 #include "lib/nullstream.h"
 
 namespace P4::P4Tools::Flay {
 
+std::unique_ptr<FlaySession> Flay::createSession(const FlayOptions &flayOptions,
+                                                 const FlayCompilerResult &compilerResult,
+                                                 const ProgramInfo &programInfo,
+                                                 const FlaySnapshot *snapshot) {
+    PartialEvaluationOptions partialEvaluationOptions;
+    partialEvaluationOptions.snapshot = snapshot;
+    IncrementalAnalysisMap incrementalAnalysisMap;
+    auto [result, inserted] = incrementalAnalysisMap.emplace(
+        "partialEvaluation",
+        std::make_unique<PartialEvaluation>(flayOptions, compilerResult, programInfo,
+                                            partialEvaluationOptions));
+    if (result->second->initialize() != EXIT_SUCCESS) {
+        return nullptr;
+    }
+    auto flaySession =
+        std::make_unique<FlaySession>(compilerResult, std::move(incrementalAnalysisMap));
+    flaySession->setStatisticsCheckInterval(flayOptions.statisticsCheckInterval());
+    // Restore the runtime configuration the snapshot was taken with.
+    if (snapshot != nullptr && snapshot->entities().updates_size() > 0) {
+        printInfo("Restoring %1% entities from snapshot...", snapshot->entities().updates_size());
+        if (flaySession->applyWriteRequest(snapshot->entities()) != EXIT_SUCCESS) {
+            error("Failed to restore the entities of the snapshot.");
+            return nullptr;
+        }
+    }
+    return flaySession;
+}
+
 void Flay::registerTarget() {
     // Register all available compiler targets.
     // These are discovered by CMAKE, which fills out the register.h.in file.
     registerFlayTargets();
 }
 
+/// Write @param statistics and the statistics of the process to the file set with --stats-file.
+int writeStatisticsReport(const FlayOptions &flayOptions,
+                          const FlayServiceStatisticsMap &statistics) {
+    auto statisticsFile = flayOptions.statisticsFile();
+    if (!statisticsFile.has_value()) {
+        return EXIT_SUCCESS;
+    }
+    StatisticsReport report;
+    for (const auto &[analysisName, statistic] : statistics) {
+        statistic->exportTo(report, analysisName);
+    }
+    report.addProcessStatistics();
+    RETURN_IF_FALSE(report.write(statisticsFile.value(), flayOptions.statisticsFormat()) ==
+                        EXIT_SUCCESS,
+                    EXIT_FAILURE);
+    printInfo("Wrote statistics to %1%", statisticsFile.value());
+    return EXIT_SUCCESS;
+}
+
+/// Append the P4Runtime entities applied to @param flaySession to the snapshot written with
+/// --save-snapshot, so a session restored from the snapshot starts with the same configuration.
+int saveSnapshotEntities(const FlayOptions &flayOptions, const FlaySession &flaySession) {
+    auto saveSnapshot = flayOptions.saveSnapshot();
+    if (!saveSnapshot.has_value()) {
+        return EXIT_SUCCESS;
+    }
+    return FlaySnapshot::appendEntities(saveSnapshot.value(),
+                                        flaySession.entityStore().toWriteRequest());
+}
+
 #ifdef FLAY_WITH_GRPC
-int runServer(const FlayOptions &flayOptions, const FlayCompilerResult &flayCompilerResult,
-              const ExecutionState &executionState, const ControlPlaneConstraints &constraints) {
+int runServer(const FlayOptions &flayOptions, FlaySession &flaySession) {
     FlayServiceOptions serviceOptions;
+    serviceOptions.writeBatchOptions.window = flayOptions.writeBatchWindow();
+    serviceOptions.writeBatchOptions.maxWrites = flayOptions.writeBatchSize();
+    serviceOptions.writeBatchOptions.maxPendingWrites = flayOptions.writeQueueCapacity();
 
-    // Initialize the flay service, which includes a dead code eliminator.
-    FlayService service(serviceOptions, flayCompilerResult, executionState.nodeAnnotationMap(),
-                        constraints);
+    FlayService service(flaySession, serviceOptions);
     if (errorCount() > 0) {
         error("Encountered errors trying to starting the service.");
         return EXIT_FAILURE;
     }
     printInfo("Starting flay server...");
-    service.startServer(flayOptions.getServerAddress());
+    RETURN_IF_FALSE(service.startServer(std::string(flayOptions.serverAddress())), EXIT_FAILURE);
+    if (Z3ResultCache::save() != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    RETURN_IF_FALSE(saveSnapshotEntities(flayOptions, flaySession) == EXIT_SUCCESS, EXIT_FAILURE);
+    RETURN_IF_FALSE(
+        writeStatisticsReport(flayOptions, flaySession.computeFlayServiceStatistics()) ==
+            EXIT_SUCCESS,
+        EXIT_FAILURE);
     return errorCount() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 #endif
 
-std::optional<FlayServiceStatisticsMap> runServiceWrapper(
-    const FlayOptions &flayOptions, const FlayCompilerResult &compilerResult,
-    IncrementalAnalysisMap incrementalAnalysisMap) {
+std::optional<FlayServiceStatisticsMap> runServiceWrapper(const FlayOptions &flayOptions,
+                                                          FlaySession &flaySession) {
     auto controlPlaneApi = flayOptions.controlPlaneApi();
     // TODO: Make this target-specific?
     FlayServiceWrapper *serviceWrapper = nullptr;
     if (controlPlaneApi == "P4RUNTIME") {
-        serviceWrapper =
-            new P4RuntimeFlayServiceWrapper(compilerResult, std::move(incrementalAnalysisMap));
+        serviceWrapper = new P4RuntimeFlayServiceWrapper(flaySession);
     } else if (controlPlaneApi == "BFRUNTIME") {
-        serviceWrapper =
-            new BfRuntimeFlayServiceWrapper(compilerResult, std::move(incrementalAnalysisMap));
+        serviceWrapper = new BfRuntimeFlayServiceWrapper(flaySession);
     } else {
         error("Unsupported control plane API %1%.", controlPlaneApi.data());
         return std::nullopt;
@@ -73,10 +139,57 @@ std::optional<FlayServiceStatisticsMap> runServiceWrapper(
                         std::nullopt);
     }
     RETURN_IF_FALSE(serviceWrapper->run() == EXIT_SUCCESS, std::nullopt);
+    auto configurationUpdateTrace = flayOptions.configurationUpdateTrace();
+    if (configurationUpdateTrace.has_value()) {
+        RETURN_IF_FALSE(serviceWrapper->processControlUpdatesFromTrace(
+                            configurationUpdateTrace.value()) == EXIT_SUCCESS,
+                        std::nullopt);
+    }
     if (FlayOptions::get().optimizedOutputDir() != std::nullopt) {
         serviceWrapper->outputOptimizedProgram("optimized.final.p4");
     }
-    return serviceWrapper->computeFlayServiceStatistics();
+    // Keep the results solved in this run for the next run on the same program.
+    RETURN_IF_FALSE(Z3ResultCache::save() == EXIT_SUCCESS, std::nullopt);
+    RETURN_IF_FALSE(saveSnapshotEntities(flayOptions, flaySession) == EXIT_SUCCESS, std::nullopt);
+    auto statistics = serviceWrapper->computeFlayServiceStatistics();
+    RETURN_IF_FALSE(writeStatisticsReport(flayOptions, statistics) == EXIT_SUCCESS, std::nullopt);
+    return statistics;
+}
+
+int Flay::main(const std::string &toolName, const std::vector<const char *> &args) {
+    // Register supported compiler targets.
+    registerTarget();
+
+    // Process command-line options.
+    auto &flayOptions = FlayOptions::get();
+    auto compileContext = flayOptions.process(args);
+    if (!compileContext) {
+        return EXIT_FAILURE;
+    }
+
+    // Set up the compilation context.
+    AutoCompileContext autoContext(*compileContext);
+    // If not explicitly disabled, print basic information to standard output.
+    if (!flayOptions.disableInformationLogging) {
+        enableInformationLogging();
+    }
+
+    auto loadSnapshot = flayOptions.loadSnapshot();
+    if (loadSnapshot.has_value()) {
+        // The snapshot contains the compiled program, so the compiler does not need to run.
+        _snapshot = FlaySnapshot::load(loadSnapshot.value(), flayOptions);
+        if (_snapshot == nullptr) {
+            return EXIT_FAILURE;
+        }
+        return mainImpl(_snapshot->compilerResult());
+    }
+
+    // Run the compiler to get an IR and invoke the tool.
+    const auto compilerResult = P4Tools::CompilerTarget::runCompiler(flayOptions, toolName);
+    if (!compilerResult.has_value()) {
+        return EXIT_FAILURE;
+    }
+    return mainImpl(compilerResult.value());
 }
 
 int Flay::mainImpl(const CompilerResult &compilerResult) {
@@ -127,35 +240,24 @@ int Flay::mainImpl(const CompilerResult &compilerResult) {
                                                                P4::P4RuntimeFormat::TEXT_PROTOBUF);
     }
 
-    // printInfo("Running analysis...");
-    // SymbolicExecutor symbolicExecutor;
-    // ASSIGN_OR_RETURN(const auto &analysisResult,
-    //                  symbolicExecutor.run(flayOptions, flayCompilerResult, *programInfo),
-    //                  EXIT_FAILURE);
-
 #ifdef FLAY_WITH_GRPC
-    printInfo("Starting the service...");
-    // If server mode is active, start the server and exit once it has finished.
-    if (flayOptions.serverModeActive()) {
-        if (flayOptions.controlPlaneApi() != "P4RUNTIME") {
-            error("Server mode requires P4RUNTIME as --control-plane option.");
-        }
-        return runServer(flayOptions, flayCompilerResult, symbolicExecutor.getExecutionState(),
-                         constraints);
+    if (flayOptions.serverModeActive() && flayOptions.controlPlaneApi() != "P4RUNTIME") {
+        error("Server mode requires P4RUNTIME as --control-plane option.");
+        return EXIT_FAILURE;
     }
 #endif
-    PartialEvaluationOptions partialEvaluationOptions;
-    IncrementalAnalysisMap incrementalAnalysisMap;
-    auto [result, inserted] = incrementalAnalysisMap.emplace(
-        "partialEvaluation",
-        std::make_unique<PartialEvaluation>(flayOptions, flayCompilerResult, *programInfo,
-                                            partialEvaluationOptions));
-    if (result->second->initialize() != EXIT_SUCCESS) {
+    auto flaySession = createSession(flayOptions, flayCompilerResult, *programInfo, _snapshot);
+    if (flaySession == nullptr) {
         return EXIT_FAILURE;
     }
-    RETURN_IF_FALSE(
-        runServiceWrapper(flayOptions, flayCompilerResult, std::move(incrementalAnalysisMap)),
-        EXIT_FAILURE);
+#ifdef FLAY_WITH_GRPC
+    // If server mode is active, start the server and exit once it has finished.
+    if (flayOptions.serverModeActive()) {
+        printInfo("Starting the service...");
+        return runServer(flayOptions, *flaySession);
+    }
+#endif
+    RETURN_IF_FALSE(runServiceWrapper(flayOptions, *flaySession), EXIT_FAILURE);
     return errorCount() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
@@ -167,8 +269,15 @@ std::optional<FlayServiceStatisticsMap> optimizeProgramImpl(
 
     P4Tools::Target::init(flayOptions.target.c_str(), flayOptions.arch.c_str());
 
+    const FlaySnapshot *snapshot = nullptr;
     CompilerResultOrError compilerResult;
-    if (program.has_value()) {
+    auto loadSnapshot = flayOptions.loadSnapshot();
+    if (loadSnapshot.has_value()) {
+        // Restore the compiled program from the snapshot instead of running the compiler.
+        snapshot = FlaySnapshot::load(loadSnapshot.value(), flayOptions);
+        RETURN_IF_FALSE(snapshot != nullptr, std::nullopt);
+        compilerResult = snapshot->compilerResult();
+    } else if (program.has_value()) {
         // Run the compiler to get an IR and invoke the tool.
         ASSIGN_OR_RETURN(
             compilerResult,
@@ -201,16 +310,9 @@ std::optional<FlayServiceStatisticsMap> optimizeProgramImpl(
         }
     }
 
-    PartialEvaluationOptions partialEvaluationOptions;
-    IncrementalAnalysisMap incrementalAnalysisMap;
-    auto [result, inserted] = incrementalAnalysisMap.emplace(
-        "partialEvaluation",
-        std::make_unique<PartialEvaluation>(flayOptions, flayCompilerResult, *programInfo,
-                                            partialEvaluationOptions));
-    if (result->second->initialize() != EXIT_SUCCESS) {
-        return std::nullopt;
-    }
-    return runServiceWrapper(flayOptions, flayCompilerResult, std::move(incrementalAnalysisMap));
+    auto flaySession = Flay::createSession(flayOptions, flayCompilerResult, *programInfo, snapshot);
+    RETURN_IF_FALSE(flaySession != nullptr, std::nullopt);
+    return runServiceWrapper(flayOptions, *flaySession);
 }
 
 std::optional<FlayServiceStatisticsMap> Flay::optimizeProgram(const std::string &program,
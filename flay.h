@@ -1,14 +1,25 @@
 #ifndef BACKENDS_P4TOOLS_MODULES_FLAY_FLAY_H_
 #define BACKENDS_P4TOOLS_MODULES_FLAY_FLAY_H_
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "backends/p4tools/common/p4ctool.h"
+#include "backends/p4tools/modules/flay/core/interpreter/program_info.h"
+#include "backends/p4tools/modules/flay/core/interpreter/snapshot.h"
 #include "backends/p4tools/modules/flay/core/specialization/flay_service.h"
+#include "backends/p4tools/modules/flay/core/specialization/flay_session.h"
 #include "backends/p4tools/modules/flay/options.h"
 
 namespace P4::P4Tools::Flay {
 
 /// This is main implementation of the P4Flay tool.
 class Flay : public AbstractP4cTool<FlayOptions> {
+ private:
+    /// The snapshot loaded with --load-snapshot. If set, it replaces the compiler result.
+    const FlaySnapshot *_snapshot = nullptr;
+
  protected:
     void registerTarget() override;
 
@@ -17,6 +28,19 @@ class Flay : public AbstractP4cTool<FlayOptions> {
  public:
     virtual ~Flay() = default;
 
+    /// Process the options and invoke the tool. Unlike AbstractP4cTool::main, the compiler is not
+    /// run if a snapshot is restored with --load-snapshot.
+    int main(const std::string &toolName, const std::vector<const char *> &args);
+
+    /// Initialize the analyses of @param compilerResult, or restore them from @param snapshot, and
+    /// return a session which applies control plane updates to them. The P4Runtime entities of
+    /// @param snapshot are applied to the session before it is returned.
+    /// @returns nullptr if the analysis failed.
+    static std::unique_ptr<FlaySession> createSession(const FlayOptions &flayOptions,
+                                                      const FlayCompilerResult &compilerResult,
+                                                      const ProgramInfo &programInfo,
+                                                      const FlaySnapshot *snapshot = nullptr);
+
     /// Analyse the given program and return an optimized version.
     static std::optional<FlayServiceStatisticsMap> optimizeProgram(const std::string &program,
                                                                    const FlayOptions &flayOptions);
@@ -1,58 +1,555 @@
 #include "backends/p4tools/modules/flay/grpc_service/flay_grpc_service.h"
 
-#include <glob.h>
+#include <google/protobuf/util/message_differencer.h>
 
+#include <chrono>
 #include <cstdlib>
+#include <functional>
+#include <set>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "backends/p4tools/common/lib/logging.h"
-#include "backends/p4tools/modules/flay/core/control_plane/p4runtime/protobuf.h"
-#include "backends/p4tools/modules/flay/core/specialization/flay_service.h"
-#include "lib/timer.h"
+#include "lib/error.h"
 
 namespace P4::P4Tools::Flay {
 
-FlayService::FlayService(const FlayCompilerResult &compilerResult,
-                         IncrementalAnalysisMap incrementalAnalysisMap)
-    : FlayServiceBase(compilerResult, std::move(incrementalAnalysisMap)) {}
+namespace {
 
-grpc::Status FlayService::Write(grpc::ServerContext * /*context*/,
-                                const p4::v1::WriteRequest *request,
-                                p4::v1::WriteResponse * /*response*/) {
-    SymbolSet symbolSet;
-    std::vector<const ControlPlaneUpdate *> p4RuntimeUpdates;
-    for (const auto &update : request->updates()) {
-        p4RuntimeUpdates.emplace_back(new P4RuntimeControlPlaneUpdate(update));
+/// The P4Runtime API version reported by the Capabilities RPC.
+constexpr const char *kP4RuntimeApiVersion = "1.3.0";
+
+/// How long the server waits for calls to complete on shutdown before it cancels them.
+constexpr auto kShutdownGracePeriod = std::chrono::seconds(1);
+
+/// A unary call. As soon as a call arrives, the next call of the same RPC is requested, so there
+/// is always one call of each RPC waiting.
+template <typename Request, typename Response>
+class UnaryCall final : public FlayService::RpcCall {
+ public:
+    using Responder = grpc::ServerAsyncResponseWriter<Response>;
+
+    /// Requests the next call of the RPC from the asynchronous service.
+    using RequestFunction =
+        std::function<void(grpc::ServerContext *, Request *, Responder *, void *)>;
+
+    /// Sends the response with the given status.
+    using FinishFunction = std::function<void(const grpc::Status &)>;
+
+    /// Serves the request. The function may finish the call later from another thread.
+    using ServeFunction = std::function<void(const Request &, Response &, const FinishFunction &)>;
+
+ private:
+    const FlayService &_service;
+    RequestFunction _requestCall;
+    ServeFunction _serveCall;
+    grpc::ServerContext _context;
+    Request _request;
+    Response _response;
+    Responder _responder;
+
+    /// Whether the call has arrived and is being served.
+    bool _isServing = false;
+
+ public:
+    UnaryCall(const FlayService &service, RequestFunction requestCall, ServeFunction serveCall)
+        : _service(service),
+          _requestCall(std::move(requestCall)),
+          _serveCall(std::move(serveCall)),
+          _responder(&_context) {
+        _requestCall(&_context, &_request, &_responder, this);
     }
-    auto result = processControlPlaneUpdate(p4RuntimeUpdates);
-    if (result != EXIT_SUCCESS) {
-        return {grpc::StatusCode::INTERNAL, "Failed to process update message"};
+
+    void proceed(bool ok) override {
+        // Either the response has been sent or the server shut down before the call arrived.
+        if (!ok || _isServing) {
+            delete this;
+            return;
+        }
+        _isServing = true;
+        if (!_service.isShuttingDown()) {
+            new UnaryCall(_service, _requestCall, _serveCall);
+        }
+        _serveCall(_request, _response, [this](const grpc::Status &status) {
+            _responder.Finish(_response, status, this);
+        });
+    }
+};
+
+/// A Read call. All matching entities are sent in a single response.
+class ReadCall final : public FlayService::RpcCall {
+ public:
+    using Writer = grpc::ServerAsyncWriter<p4::v1::ReadResponse>;
+
+    /// Requests the next Read call from the asynchronous service.
+    using RequestFunction =
+        std::function<void(grpc::ServerContext *, p4::v1::ReadRequest *, Writer *, void *)>;
+
+ private:
+    const FlayService &_service;
+    RequestFunction _requestCall;
+    grpc::ServerContext _context;
+    p4::v1::ReadRequest _request;
+    Writer _writer;
+
+    /// Whether the call has arrived and is being served.
+    bool _isServing = false;
+
+ public:
+    ReadCall(const FlayService &service, RequestFunction requestCall)
+        : _service(service), _requestCall(std::move(requestCall)), _writer(&_context) {
+        _requestCall(&_context, &_request, &_writer, this);
+    }
+
+    void proceed(bool ok) override {
+        if (!ok || _isServing) {
+            delete this;
+            return;
+        }
+        _isServing = true;
+        if (!_service.isShuttingDown()) {
+            new ReadCall(_service, _requestCall);
+        }
+        p4::v1::ReadResponse response;
+        auto status = _service.read(_request, response);
+        if (!status.ok()) {
+            _writer.Finish(status, this);
+            return;
+        }
+        _writer.WriteAndFinish(response, grpc::WriteOptions(), grpc::Status::OK, this);
+    }
+};
+
+/// A StreamChannel call. Reads messages until the client closes the stream and answers
+/// arbitration updates. Reads and writes alternate, so at most one operation is pending.
+class StreamChannelCall final : public FlayService::RpcCall {
+ public:
+    using Stream =
+        grpc::ServerAsyncReaderWriter<p4::v1::StreamMessageResponse, p4::v1::StreamMessageRequest>;
+
+    /// Requests the next StreamChannel call from the asynchronous service.
+    using RequestFunction = std::function<void(grpc::ServerContext *, Stream *, void *)>;
+
+ private:
+    enum class State { kWaiting, kReading, kWriting, kFinishing };
+
+    FlayService &_service;
+    RequestFunction _requestCall;
+    grpc::ServerContext _context;
+    Stream _stream;
+    p4::v1::StreamMessageRequest _request;
+    p4::v1::StreamMessageResponse _response;
+    State _state = State::kWaiting;
+
+    void readNext() {
+        _state = State::kReading;
+        _stream.Read(&_request, this);
+    }
+
+    void finish() {
+        _service.closeStream(*this);
+        _state = State::kFinishing;
+        _stream.Finish(grpc::Status::OK, this);
+    }
+
+ public:
+    StreamChannelCall(FlayService &service, RequestFunction requestCall)
+        : _service(service), _requestCall(std::move(requestCall)), _stream(&_context) {
+        _requestCall(&_context, &_stream, this);
+    }
+
+    void proceed(bool ok) override {
+        switch (_state) {
+            case State::kWaiting: {
+                if (!ok) {
+                    delete this;
+                    return;
+                }
+                if (!_service.isShuttingDown()) {
+                    new StreamChannelCall(_service, _requestCall);
+                }
+                _service.openStream(*this, _context);
+                readNext();
+                return;
+            }
+            case State::kReading: {
+                // The client closed the stream or the call was cancelled.
+                if (!ok) {
+                    finish();
+                    return;
+                }
+                auto response = _service.handleStreamMessage(_request, *this);
+                if (!response.has_value()) {
+                    readNext();
+                    return;
+                }
+                _response = std::move(response.value());
+                _state = State::kWriting;
+                _stream.Write(_response, this);
+                return;
+            }
+            case State::kWriting: {
+                if (!ok) {
+                    finish();
+                    return;
+                }
+                readNext();
+                return;
+            }
+            case State::kFinishing: {
+                delete this;
+                return;
+            }
+        }
+    }
+};
+
+/// @returns the status code of @param update, which has been rejected by the session. Modifying
+/// or deleting an entity which has not been written is reported as NOT_FOUND, every other
+/// rejection as INVALID_ARGUMENT. Default actions and parser value sets always exist, so they are
+/// never missing.
+grpc::StatusCode classifyRejection(const P4Runtime::EntityStore &entityStore,
+                                   const p4::v1::Update &update) {
+    const auto &entity = update.entity();
+    bool alwaysExists = entity.has_value_set_entry() ||
+                        (entity.has_table_entry() && entity.table_entry().is_default_action());
+    bool requiresEntity =
+        update.type() == p4::v1::Update::MODIFY || update.type() == p4::v1::Update::DELETE;
+    if (requiresEntity && !alwaysExists && !entityStore.contains(entity)) {
+        return grpc::StatusCode::NOT_FOUND;
+    }
+    return grpc::StatusCode::INVALID_ARGUMENT;
+}
+
+FlayService::ElectionId toElectionId(const p4::v1::Uint128 &electionId) {
+    return {electionId.high(), electionId.low()};
+}
+
+}  // namespace
+
+FlayService::FlayService(FlaySession &flaySession, const FlayServiceOptions &serviceOptions)
+    : _flaySession(flaySession),
+      _writeQueue(serviceOptions.writeBatchOptions),
+      _p4Info(*flaySession.compilerResult().getP4RuntimeApi().p4Info) {}
+
+FlayService::~FlayService() {
+    _writeQueue.close();
+    shutdown();
+}
+
+bool FlayService::isShuttingDown() const { return _isShuttingDown; }
+
+std::optional<FlayService::ElectionId> FlayService::primaryElectionId() const {
+    std::optional<ElectionId> primary;
+    for (const auto &[stream, electionId] : _electionIds) {
+        if (!primary.has_value() || electionId > primary.value()) {
+            primary = electionId;
+        }
+    }
+    return primary;
+}
+
+grpc::Status FlayService::checkPrimary(const p4::v1::Uint128 &electionId) {
+    std::lock_guard<std::mutex> lock(_arbitrationMutex);
+    // Without any client taking part in the election, every client may configure Flay.
+    auto primary = primaryElectionId();
+    if (primary.has_value() && primary.value() != toElectionId(electionId)) {
+        return {grpc::StatusCode::PERMISSION_DENIED, "Only the primary client may write."};
     }
-    recordProgramChange();
     return grpc::Status::OK;
 }
 
-bool FlayService::startServer(const std::string &serverAddress) {
-    grpc::ServerBuilder builder;
-    builder.AddListeningPort(serverAddress, grpc::InsecureServerCredentials());
-    builder.RegisterService(this);
+void FlayService::requestCalls() {
+    auto *service = &_asyncService;
+    auto *completionQueue = _completionQueue.get();
+    new UnaryCall<p4::v1::WriteRequest, p4::v1::WriteResponse>(
+        *this,
+        [service, completionQueue](auto *context, auto *request, auto *responder, void *tag) {
+            service->RequestWrite(context, request, responder, completionQueue, completionQueue,
+                                  tag);
+        },
+        [this](const auto &request, auto & /*response*/, const auto &finish) {
+            write(request, finish);
+        });
+    new ReadCall(*this, [service, completionQueue](auto *context, auto *request, auto *writer,
+                                                   void *tag) {
+        service->RequestRead(context, request, writer, completionQueue, completionQueue, tag);
+    });
+    new UnaryCall<p4::v1::SetForwardingPipelineConfigRequest,
+                  p4::v1::SetForwardingPipelineConfigResponse>(
+        *this,
+        [service, completionQueue](auto *context, auto *request, auto *responder, void *tag) {
+            service->RequestSetForwardingPipelineConfig(context, request, responder,
+                                                        completionQueue, completionQueue, tag);
+        },
+        [this](const auto &request, auto & /*response*/, const auto &finish) {
+            finish(setForwardingPipelineConfig(request));
+        });
+    new UnaryCall<p4::v1::GetForwardingPipelineConfigRequest,
+                  p4::v1::GetForwardingPipelineConfigResponse>(
+        *this,
+        [service, completionQueue](auto *context, auto *request, auto *responder, void *tag) {
+            service->RequestGetForwardingPipelineConfig(context, request, responder,
+                                                        completionQueue, completionQueue, tag);
+        },
+        [this](const auto &request, auto &response, const auto &finish) {
+            finish(getForwardingPipelineConfig(request, response));
+        });
+    new UnaryCall<p4::v1::CapabilitiesRequest, p4::v1::CapabilitiesResponse>(
+        *this,
+        [service, completionQueue](auto *context, auto *request, auto *responder, void *tag) {
+            service->RequestCapabilities(context, request, responder, completionQueue,
+                                         completionQueue, tag);
+        },
+        [](const auto & /*request*/, auto &response, const auto &finish) {
+            response.set_p4runtime_api_version(kP4RuntimeApiVersion);
+            finish(grpc::Status::OK);
+        });
+    new StreamChannelCall(*this, [service, completionQueue](auto *context, auto *stream,
+                                                            void *tag) {
+        service->RequestStreamChannel(context, stream, completionQueue, completionQueue, tag);
+    });
+}
+
+void FlayService::pollCompletionQueue() {
+    void *tag = nullptr;
+    bool ok = false;
+    while (_completionQueue->Next(&tag, &ok)) {
+        static_cast<RpcCall *>(tag)->proceed(ok);
+    }
+}
 
-    std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
-    if (!server) {
+void FlayService::shutdown() {
+    if (!_completionQueueThread.joinable()) {
+        return;
+    }
+    _isShuttingDown = true;
+    // Open streams only end when the client closes them. Cancel them, so the server does not wait
+    // for the clients. Streams which arrive after this point are cancelled at the deadline.
+    {
+        std::lock_guard<std::mutex> lock(_arbitrationMutex);
+        for (const auto &[stream, context] : _openStreams) {
+            context->TryCancel();
+        }
+    }
+    _server->Shutdown(std::chrono::system_clock::now() + kShutdownGracePeriod);
+    // The completion queue must only be shut down after the server. Draining it releases the
+    // remaining calls.
+    _completionQueue->Shutdown();
+    _completionQueueThread.join();
+}
+
+bool FlayService::start(const std::string &serverAddress) {
+    grpc::ServerBuilder builder;
+    if (!serverAddress.empty()) {
+        builder.AddListeningPort(serverAddress, grpc::InsecureServerCredentials());
+    }
+    builder.RegisterService(&_asyncService);
+    _completionQueue = builder.AddCompletionQueue();
+    _server = builder.BuildAndStart();
+    if (_server == nullptr) {
         error("Failed to start the Flay service.");
         return false;
     }
+    if (!serverAddress.empty()) {
+        printInfo("Flay service listening on: %1%", serverAddress);
+    }
+    requestCalls();
+    _completionQueueThread = std::thread([this]() { pollCompletionQueue(); });
+    return true;
+}
+
+int FlayService::applyBatch(const std::vector<const ControlPlaneUpdate *> &updates,
+                            std::vector<int> &updateResults) {
+    std::set<size_t> rejectedUpdates;
+    auto result = _flaySession.get().applyUpdates(updates, rejectedUpdates);
+    if (result != EXIT_SUCCESS) {
+        return result;
+    }
+    _flaySession.get().recordProgramChange();
+    // Mirror the applied updates before they are acknowledged, so clients read their own writes.
+    // Rejections are classified in the same pass, so the mirror reflects the updates which precede
+    // the rejected update in the batch.
+    std::unique_lock<std::shared_mutex> lock(_entityMutex);
+    for (size_t idx = 0; idx < updates.size(); ++idx) {
+        const auto *p4RuntimeUpdate = updates[idx]->to<P4RuntimeControlPlaneUpdate>();
+        if (p4RuntimeUpdate == nullptr) {
+            continue;
+        }
+        if (rejectedUpdates.count(idx) != 0) {
+            updateResults[idx] =
+                classifyRejection(_flaySession.get().entityStore(), p4RuntimeUpdate->update);
+            continue;
+        }
+        _flaySession.get().recordUpdate(p4RuntimeUpdate->update);
+    }
+    return result;
+}
 
-    printInfo("Flay service listening on: %1%", serverAddress);
+void FlayService::run() {
+    // Apply incoming writes on this thread. The analysis and its Z3 state are owned by the thread
+    // which initialized them, so they must not be touched by the completion queue thread.
+    while (_writeQueue.processNextBatch([this](const auto &updates, auto &updateResults) {
+        return applyBatch(updates, updateResults);
+    })) {
+    }
+    // All queued writes have been acknowledged, so no call waits for this thread anymore.
+    shutdown();
+    _writeQueue.printStatistics();
+}
 
-    auto serveFn = [&]() { server->Wait(); };
-    std::thread servingThread(serveFn);
+void FlayService::requestExit() { _writeQueue.close(); }
 
-    auto f = exitRequested.get_future();
-    f.wait();
-    server->Shutdown();
-    servingThread.join();
+bool FlayService::startServer(const std::string &serverAddress) {
+    if (!start(serverAddress)) {
+        return false;
+    }
+    run();
     return true;
 }
 
+std::shared_ptr<grpc::Channel> FlayService::inProcessChannel() const {
+    return _server->InProcessChannel(grpc::ChannelArguments());
+}
+
+WriteBatchStatistics FlayService::writeBatchStatistics() const {
+    return _writeQueue.statistics();
+}
+
+void FlayService::write(const p4::v1::WriteRequest &request,
+                        const std::function<void(const grpc::Status &)> &onComplete) {
+    auto status = checkPrimary(request.election_id());
+    if (!status.ok()) {
+        onComplete(status);
+        return;
+    }
+    std::vector<const ControlPlaneUpdate *> p4RuntimeUpdates;
+    for (const auto &update : request.updates()) {
+        p4RuntimeUpdates.emplace_back(new P4RuntimeControlPlaneUpdate(update));
+    }
+    // The request stays alive until the write is acknowledged, so the updates can refer to it.
+    auto submitResult = _writeQueue.trySubmit(
+        std::move(p4RuntimeUpdates),
+        [onComplete](int result, const std::vector<int> &updateResults) {
+            if (result != EXIT_SUCCESS) {
+                onComplete({grpc::StatusCode::INTERNAL, "Failed to process update message"});
+                return;
+            }
+            // Report the first rejected update. The other updates of the write have been applied.
+            for (size_t idx = 0; idx < updateResults.size(); ++idx) {
+                if (updateResults[idx] != grpc::StatusCode::OK) {
+                    onComplete({static_cast<grpc::StatusCode>(updateResults[idx]),
+                                "Update " + std::to_string(idx) + " of the write was rejected."});
+                    return;
+                }
+            }
+            onComplete(grpc::Status::OK);
+        });
+    switch (submitResult) {
+        case WriteBatchQueue::SubmitResult::kQueued:
+            return;
+        case WriteBatchQueue::SubmitResult::kQueueFull:
+            onComplete({grpc::StatusCode::RESOURCE_EXHAUSTED,
+                        "Too many pending writes. Retry once earlier writes have completed."});
+            return;
+        case WriteBatchQueue::SubmitResult::kClosed:
+            onComplete({grpc::StatusCode::UNAVAILABLE, "The Flay service is shutting down."});
+            return;
+    }
+}
+
+grpc::Status FlayService::read(const p4::v1::ReadRequest &request,
+                               p4::v1::ReadResponse &response) const {
+    std::shared_lock<std::shared_mutex> lock(_entityMutex);
+    for (const auto &filter : request.entities()) {
+        for (auto &entity : _flaySession.get().entityStore().read(filter)) {
+            *response.add_entities() = std::move(entity);
+        }
+    }
+    return grpc::Status::OK;
+}
+
+grpc::Status FlayService::setForwardingPipelineConfig(
+    const p4::v1::SetForwardingPipelineConfigRequest &request) {
+    using Request = p4::v1::SetForwardingPipelineConfigRequest;
+    auto status = checkPrimary(request.election_id());
+    if (!status.ok()) {
+        return status;
+    }
+    if (request.action() == Request::UNSPECIFIED) {
+        return {grpc::StatusCode::INVALID_ARGUMENT, "Missing pipeline config action."};
+    }
+    if (!request.has_config()) {
+        // Committing without a config refers to the config saved earlier.
+        if (request.action() == Request::COMMIT) {
+            return grpc::Status::OK;
+        }
+        return {grpc::StatusCode::INVALID_ARGUMENT, "Missing pipeline config."};
+    }
+    if (!google::protobuf::util::MessageDifferencer::Equals(request.config().p4info(),
+                                                            _p4Info.get())) {
+        return {grpc::StatusCode::UNIMPLEMENTED,
+                "Flay can not change the analysed program at runtime. The P4Info must match the "
+                "program Flay was started with."};
+    }
+    if (request.action() != Request::VERIFY) {
+        std::unique_lock<std::shared_mutex> lock(_entityMutex);
+        _pipelineCookie = request.config().cookie().cookie();
+    }
+    return grpc::Status::OK;
+}
+
+grpc::Status FlayService::getForwardingPipelineConfig(
+    const p4::v1::GetForwardingPipelineConfigRequest &request,
+    p4::v1::GetForwardingPipelineConfigResponse &response) const {
+    using Request = p4::v1::GetForwardingPipelineConfigRequest;
+    auto *config = response.mutable_config();
+    // Flay does not have a device config, so it is never returned.
+    if (request.response_type() == Request::ALL ||
+        request.response_type() == Request::P4INFO_AND_COOKIE) {
+        *config->mutable_p4info() = _p4Info.get();
+    }
+    std::shared_lock<std::shared_mutex> lock(_entityMutex);
+    if (_pipelineCookie.has_value()) {
+        config->mutable_cookie()->set_cookie(_pipelineCookie.value());
+    }
+    return grpc::Status::OK;
+}
+
+std::optional<p4::v1::StreamMessageResponse> FlayService::handleStreamMessage(
+    const p4::v1::StreamMessageRequest &request, const RpcCall &stream) {
+    if (!request.has_arbitration()) {
+        return std::nullopt;
+    }
+    const auto &arbitration = request.arbitration();
+    auto electionId = toElectionId(arbitration.election_id());
+    std::lock_guard<std::mutex> lock(_arbitrationMutex);
+    _electionIds[&stream] = electionId;
+    auto primary = primaryElectionId().value();
+
+    p4::v1::StreamMessageResponse response;
+    auto *responseArbitration = response.mutable_arbitration();
+    responseArbitration->set_device_id(arbitration.device_id());
+    if (arbitration.has_role()) {
+        *responseArbitration->mutable_role() = arbitration.role();
+    }
+    responseArbitration->mutable_election_id()->set_high(primary.first);
+    responseArbitration->mutable_election_id()->set_low(primary.second);
+    responseArbitration->mutable_status()->set_code(
+        electionId == primary ? grpc::StatusCode::OK : grpc::StatusCode::ALREADY_EXISTS);
+    return response;
+}
+
+void FlayService::openStream(const RpcCall &stream, grpc::ServerContext &context) {
+    std::lock_guard<std::mutex> lock(_arbitrationMutex);
+    _openStreams.emplace(&stream, &context);
+}
+
+void FlayService::closeStream(const RpcCall &stream) {
+    std::lock_guard<std::mutex> lock(_arbitrationMutex);
+    _openStreams.erase(&stream);
+    _electionIds.erase(&stream);
+}
+
 }  // namespace P4::P4Tools::Flay
@@ -2,9 +2,21 @@
 #define BACKENDS_P4TOOLS_MODULES_FLAY_GRPC_SERVICE_FLAY_GRPC_SERVICE_H_
 #include <grpcpp/grpcpp.h>
 
-#include <future>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
-#include "backends/p4tools/modules/flay/core/specialization/flay_service.h"
+#include "backends/p4tools/modules/flay/core/specialization/flay_session.h"
+#include "backends/p4tools/modules/flay/grpc_service/write_batch_queue.h"
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 #pragma GCC diagnostic ignored "-Wpedantic"
@@ -13,20 +25,167 @@
 
 namespace P4::P4Tools::Flay {
 
-class FlayService final : public FlayServiceBase, public p4::v1::P4Runtime::Service {
-    /// For exiting the gRPC server (useful for benchmarking).
-    std::promise<void> exitRequested;
+/// Options for the Flay gRPC service.
+struct FlayServiceOptions {
+    /// Determines how incoming write requests are coalesced and how many may be pending.
+    WriteBatchOptions writeBatchOptions;
+};
+
+/// Serves the P4Runtime API for a FlaySession with the asynchronous gRPC API. A single thread
+/// polls the completion queue and answers all calls, none of which block on the analysis:
+///   - Write requests are queued in a bounded WriteBatchQueue and acknowledged by the processing
+///     thread once their batch has been applied. Writes are rejected with RESOURCE_EXHAUSTED while
+///     the queue is full.
+///   - Writes are validated per update. A rejected update fails its write with NOT_FOUND or
+///     INVALID_ARGUMENT, all other updates of the batch are still applied.
+///   - Read requests are answered from a mirror of the written entities.
+///   - The forwarding pipeline config reports the program Flay was started with. Flay can not
+///     switch programs at runtime, so only configs with the same P4Info are accepted.
+///   - StreamChannel implements primary election. Packet I/O and digests are ignored.
+class FlayService final {
+ public:
+    /// A call in flight. The tag of every completion queue operation is the call it belongs to.
+    class RpcCall {
+     public:
+        virtual ~RpcCall() = default;
+
+        /// Advance the call after its last operation completed. @param ok is false if the
+        /// operation failed, for example because the call was cancelled or the server is shutting
+        /// down.
+        virtual void proceed(bool ok) = 0;
+    };
+
+    /// An election id of the P4Runtime primary election.
+    using ElectionId = std::pair<uint64_t, uint64_t>;
+
+ private:
+    /// The analysis session which applies the writes.
+    std::reference_wrapper<FlaySession> _flaySession;
+
+    /// The asynchronous P4Runtime service.
+    p4::v1::P4Runtime::AsyncService _asyncService;
+
+    /// The gRPC server. Set by start.
+    std::unique_ptr<grpc::Server> _server;
+
+    /// The completion queue all calls are served from.
+    std::unique_ptr<grpc::ServerCompletionQueue> _completionQueue;
+
+    /// The thread polling the completion queue.
+    std::thread _completionQueueThread;
+
+    /// Set once the server is shutting down. No new calls are requested afterwards.
+    std::atomic<bool> _isShuttingDown = false;
+
+    /// Incoming write requests. They are applied in batches by the thread calling run.
+    WriteBatchQueue _writeQueue;
+
+    /// The P4Info of the program Flay analyses.
+    std::reference_wrapper<const p4::config::v1::P4Info> _p4Info;
+
+    /// Guards the entity store of the session and the pipeline cookie. Read requests are served
+    /// from the entity store. The processing thread only takes the exclusive lock after a batch
+    /// has been applied, so reads never wait for the analysis.
+    mutable std::shared_mutex _entityMutex;
+
+    /// The cookie of the last committed forwarding pipeline config.
+    std::optional<uint64_t> _pipelineCookie;
+
+    /// Guards the election state and the open streams.
+    std::mutex _arbitrationMutex;
+
+    /// The server context of every open stream channel. Shutting down cancels them.
+    std::map<const RpcCall *, grpc::ServerContext *> _openStreams;
+
+    /// The election id of every open stream channel which has sent an arbitration update.
+    std::map<const RpcCall *, ElectionId> _electionIds;
+
+    /// @returns the highest election id of all streams. Expects _arbitrationMutex to be held.
+    [[nodiscard]] std::optional<ElectionId> primaryElectionId() const;
+
+    /// @returns PERMISSION_DENIED if a primary has been elected and @param electionId is not its
+    /// election id.
+    grpc::Status checkPrimary(const p4::v1::Uint128 &electionId);
+
+    /// Apply @param updates to the session as one batch and mirror the applied updates. Sets the
+    /// status code of every rejected update in @param updateResults.
+    /// @returns EXIT_FAILURE if the session could not process the batch.
+    int applyBatch(const std::vector<const ControlPlaneUpdate *> &updates,
+                   std::vector<int> &updateResults);
+
+    /// Request one call of every RPC kind, so there is always a call waiting for each RPC.
+    void requestCalls();
+
+    /// Poll the completion queue until it is shut down.
+    void pollCompletionQueue();
+
+    /// Shut down the server and wait for the completion queue thread, if it is running. Open
+    /// streams are cancelled and other calls get a short grace period to complete.
+    void shutdown();
 
  public:
-    explicit FlayService(const FlayCompilerResult &compilerResult,
-                         IncrementalAnalysisMap incrementalAnalysisMap);
+    /// Serve @param flaySession. The session must have been created on the thread which calls run.
+    explicit FlayService(FlaySession &flaySession, const FlayServiceOptions &serviceOptions = {});
+
+    /// Shuts down the server if it is still running.
+    ~FlayService();
+
+    FlayService(const FlayService &) = delete;
+    FlayService &operator=(const FlayService &) = delete;
+    FlayService(FlayService &&) = delete;
+    FlayService &operator=(FlayService &&) = delete;
+
+    /// Start the gRPC server. Listens on @param serverAddress unless it is empty, in which case
+    /// the server is only reachable through inProcessChannel.
+    /// @returns false if the server could not be started.
+    bool start(const std::string &serverAddress);
+
+    /// Apply incoming writes on the calling thread until requestExit is called. Afterwards, shuts
+    /// down the server once all queued writes have been acknowledged.
+    void run();
+
+    /// Stop accepting writes and let run return. Can be called from any thread.
+    void requestExit();
 
-    /// Start the Flay gRPC server and listen to incoming requests.
+    /// Start the Flay gRPC server and serve incoming requests until exit is requested.
     bool startServer(const std::string &serverAddress);
 
-    /// Process an incoming gRPC request. This is typically a P4Runtime control plane update.
-    grpc::Status Write(grpc::ServerContext * /*context*/, const p4::v1::WriteRequest *request,
-                       p4::v1::WriteResponse * /*response*/) override;
+    /// @returns true once the server has started shutting down.
+    [[nodiscard]] bool isShuttingDown() const;
+
+    /// @returns a channel to the running server which does not go through the network stack.
+    [[nodiscard]] std::shared_ptr<grpc::Channel> inProcessChannel() const;
+
+    /// @returns the throughput and latency counters of the write path.
+    [[nodiscard]] WriteBatchStatistics writeBatchStatistics() const;
+
+    /// Queue the updates of @param request. @param onComplete is invoked once the request has been
+    /// applied, or immediately if the request is rejected.
+    void write(const p4::v1::WriteRequest &request,
+               const std::function<void(const grpc::Status &)> &onComplete);
+
+    /// Answer @param request from the entity mirror.
+    grpc::Status read(const p4::v1::ReadRequest &request, p4::v1::ReadResponse &response) const;
+
+    /// Verify or commit the config in @param request.
+    grpc::Status setForwardingPipelineConfig(
+        const p4::v1::SetForwardingPipelineConfigRequest &request);
+
+    /// Report the config of the analysed program.
+    grpc::Status getForwardingPipelineConfig(
+        const p4::v1::GetForwardingPipelineConfigRequest &request,
+        p4::v1::GetForwardingPipelineConfigResponse &response) const;
+
+    /// Handle the arbitration update in @param request, which arrived on @param stream.
+    /// @returns the response to send on the stream, if any.
+    std::optional<p4::v1::StreamMessageResponse> handleStreamMessage(
+        const p4::v1::StreamMessageRequest &request, const RpcCall &stream);
+
+    /// Register @param stream, which has been opened with @param context.
+    void openStream(const RpcCall &stream, grpc::ServerContext &context);
+
+    /// Forget @param stream and its election id once the stream has been closed.
+    void closeStream(const RpcCall &stream);
 };
 
 }  // namespace P4::P4Tools::Flay
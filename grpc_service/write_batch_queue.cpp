@@ -0,0 +1,183 @@
+#include "backends/p4tools/modules/flay/grpc_service/write_batch_queue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <future>
+#include <iterator>
+#include <utility>
+
+#include "backends/p4tools/common/lib/logging.h"
+#include "lib/log.h"
+
+namespace P4::P4Tools::Flay {
+
+namespace {
+
+/// @returns the @param percentile of the sorted @param samples.
+double computePercentile(const std::vector<double> &samples, double percentile) {
+    if (samples.empty()) {
+        return 0;
+    }
+    auto rank = static_cast<size_t>(std::ceil(percentile / 100.0 * samples.size()));
+    return samples.at(std::clamp<size_t>(rank, 1, samples.size()) - 1);
+}
+
+}  // namespace
+
+WriteBatchQueue::WriteBatchQueue(WriteBatchOptions options) : _options(options) {
+    _options.maxWrites = std::max<size_t>(_options.maxWrites, 1);
+    _options.maxPendingWrites = std::max<size_t>(_options.maxPendingWrites, 1);
+}
+
+WriteBatchQueue::SubmitResult WriteBatchQueue::trySubmit(
+    std::vector<const ControlPlaneUpdate *> updates, CompletionFunction onComplete) {
+    auto pendingWrite = std::make_unique<PendingWrite>(
+        PendingWrite{std::move(updates), Clock::now(), std::move(onComplete)});
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_closed) {
+            return SubmitResult::kClosed;
+        }
+        if (_pending.size() >= _options.maxPendingWrites) {
+            _rejectedWrites++;
+            return SubmitResult::kQueueFull;
+        }
+        if (!_firstQueueTime.has_value()) {
+            _firstQueueTime = pendingWrite->queueTime;
+        }
+        _pending.push_back(std::move(pendingWrite));
+    }
+    _condition.notify_one();
+    return SubmitResult::kQueued;
+}
+
+int WriteBatchQueue::submit(std::vector<const ControlPlaneUpdate *> updates) {
+    std::promise<int> result;
+    auto pendingWrite = std::make_unique<PendingWrite>(
+        PendingWrite{std::move(updates), Clock::now(),
+                     [&result](int batchResult, const std::vector<int> &updateResults) {
+                         auto isRejected = std::any_of(updateResults.begin(), updateResults.end(),
+                                                       [](int code) { return code != 0; });
+                         result.set_value(isRejected ? EXIT_FAILURE : batchResult);
+                     }});
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _spaceCondition.wait(
+            lock, [this]() { return _closed || _pending.size() < _options.maxPendingWrites; });
+        if (_closed) {
+            return EXIT_FAILURE;
+        }
+        if (!_firstQueueTime.has_value()) {
+            _firstQueueTime = pendingWrite->queueTime;
+        }
+        _pending.push_back(std::move(pendingWrite));
+    }
+    _condition.notify_one();
+    return result.get_future().get();
+}
+
+bool WriteBatchQueue::processNextBatch(const ProcessFunction &process) {
+    std::vector<std::unique_ptr<PendingWrite>> batch;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait(lock, [this]() { return _closed || !_pending.empty(); });
+        if (_pending.empty()) {
+            return false;
+        }
+        // Give other writers the chance to join the batch, unless it is already full.
+        auto deadline = _pending.front()->queueTime + _options.window;
+        _condition.wait_until(lock, deadline, [this]() {
+            return _closed || _pending.size() >= _options.maxWrites;
+        });
+        auto batchSize = std::min(_pending.size(), _options.maxWrites);
+        auto batchEnd = _pending.begin() + static_cast<ptrdiff_t>(batchSize);
+        batch.assign(std::make_move_iterator(_pending.begin()), std::make_move_iterator(batchEnd));
+        _pending.erase(_pending.begin(), batchEnd);
+    }
+    _spaceCondition.notify_all();
+
+    std::vector<const ControlPlaneUpdate *> updates;
+    for (const auto &pendingWrite : batch) {
+        updates.insert(updates.end(), pendingWrite->updates.begin(), pendingWrite->updates.end());
+    }
+    std::vector<int> updateResults(updates.size(), 0);
+    auto result = process(updates, updateResults);
+
+    auto completionTime = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _batches++;
+        _writes += batch.size();
+        _updates += updates.size();
+        _lastCompletionTime = completionTime;
+        for (const auto &pendingWrite : batch) {
+            auto latency = std::chrono::duration<double, std::micro>(completionTime -
+                                                                     pendingWrite->queueTime);
+            if (_latencies.size() < kMaxLatencySamples) {
+                _latencies.push_back(latency.count());
+            } else {
+                _latencies.at(_nextLatencySlot) = latency.count();
+                _nextLatencySlot = (_nextLatencySlot + 1) % kMaxLatencySamples;
+            }
+        }
+    }
+    // Acknowledge the writes. The updates may refer to the requests of their writers, which can
+    // be released as soon as the write has been acknowledged.
+    auto writeResultsBegin = updateResults.begin();
+    for (const auto &pendingWrite : batch) {
+        auto writeResultsEnd =
+            writeResultsBegin + static_cast<ptrdiff_t>(pendingWrite->updates.size());
+        pendingWrite->onComplete(result, std::vector<int>(writeResultsBegin, writeResultsEnd));
+        writeResultsBegin = writeResultsEnd;
+    }
+    return true;
+}
+
+void WriteBatchQueue::close() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+    }
+    _condition.notify_all();
+    _spaceCondition.notify_all();
+}
+
+WriteBatchStatistics WriteBatchQueue::statistics() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    WriteBatchStatistics statistics;
+    statistics.writes = _writes;
+    statistics.updates = _updates;
+    statistics.batches = _batches;
+    statistics.rejectedWrites = _rejectedWrites;
+    if (_firstQueueTime.has_value() && _batches > 0) {
+        auto elapsed =
+            std::chrono::duration<double>(_lastCompletionTime - _firstQueueTime.value()).count();
+        if (elapsed > 0) {
+            statistics.updatesPerSecond = static_cast<double>(_updates) / elapsed;
+        }
+    }
+    auto latencies = _latencies;
+    std::sort(latencies.begin(), latencies.end());
+    statistics.latencyP50 = computePercentile(latencies, 50);
+    statistics.latencyP90 = computePercentile(latencies, 90);
+    statistics.latencyP99 = computePercentile(latencies, 99);
+    return statistics;
+}
+
+void WriteBatchQueue::printStatistics() const {
+    // Do not emit a report if performance logging is not enabled.
+    if (!Log::fileLogLevelIsAtLeast("performance", 4)) {
+        return;
+    }
+    auto statistics = this->statistics();
+    printFeature("performance", 4, "============ Write Batching ============");
+    printFeature("performance", 4, "Writes: %1% Updates: %2% Batches: %3%", statistics.writes,
+                 statistics.updates, statistics.batches);
+    printFeature("performance", 4, "Rejected writes: %1%", statistics.rejectedWrites);
+    printFeature("performance", 4, "Throughput: %1% updates/s", statistics.updatesPerSecond);
+    printFeature("performance", 4, "Latency p50: %1%us p90: %2%us p99: %3%us",
+                 statistics.latencyP50, statistics.latencyP90, statistics.latencyP99);
+}
+
+}  // namespace P4::P4Tools::Flay
@@ -0,0 +1,156 @@
+#ifndef BACKENDS_P4TOOLS_MODULES_FLAY_GRPC_SERVICE_WRITE_BATCH_QUEUE_H_
+#define BACKENDS_P4TOOLS_MODULES_FLAY_GRPC_SERVICE_WRITE_BATCH_QUEUE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "backends/p4tools/modules/flay/core/lib/incremental_analysis.h"
+
+namespace P4::P4Tools::Flay {
+
+/// Determines when queued write requests are processed as one batch.
+struct WriteBatchOptions {
+    /// How long to wait for more writes after the first write of a batch has been queued.
+    std::chrono::microseconds window = std::chrono::microseconds(1000);
+
+    /// The maximum number of write requests in a batch. A batch is processed immediately once it
+    /// reaches this size.
+    size_t maxWrites = 1024;
+
+    /// The maximum number of write requests waiting to be processed. Further writes are rejected
+    /// or block until the processing thread has caught up.
+    size_t maxPendingWrites = 4096;
+};
+
+/// Throughput and latency counters of the write batch queue.
+struct WriteBatchStatistics {
+    /// The number of write requests which have been applied.
+    uint64_t writes = 0;
+
+    /// The number of control plane updates contained in these writes.
+    uint64_t updates = 0;
+
+    /// The number of batches which have been processed.
+    uint64_t batches = 0;
+
+    /// The number of write requests which were rejected because the queue was full.
+    uint64_t rejectedWrites = 0;
+
+    /// Applied control plane updates per second since the first write was queued.
+    double updatesPerSecond = 0;
+
+    /// Latency percentiles from queuing a write until it is acknowledged, in microseconds.
+    double latencyP50 = 0;
+    double latencyP90 = 0;
+    double latencyP99 = 0;
+};
+
+/// Collects write requests arriving on arbitrary threads and hands them to a single processing
+/// thread in batches. Every batch is processed with one call, which unions the affected symbols
+/// of all writes and specializes the program once. Updates are rejected individually, so an
+/// invalid write does not affect the other writes of its batch. Each write is acknowledged once
+/// the batch containing it has been applied. The queue is bounded, so a slow analysis pushes back
+/// on the writers instead of accumulating an unbounded backlog.
+class WriteBatchQueue {
+ public:
+    /// Processes all control plane updates of a batch. The second argument holds one result code
+    /// per update, which is initially 0. The function sets a nonzero code for every update it
+    /// rejects. Returns EXIT_FAILURE if the batch could not be processed at all.
+    using ProcessFunction =
+        std::function<int(const std::vector<const ControlPlaneUpdate *> &, std::vector<int> &)>;
+
+    /// Called on the processing thread with the result of the batch which contained the write
+    /// and the result codes of the updates of the write.
+    using CompletionFunction = std::function<void(int, const std::vector<int> &)>;
+
+    /// The outcome of trySubmit.
+    enum class SubmitResult { kQueued, kQueueFull, kClosed };
+
+ private:
+    using Clock = std::chrono::steady_clock;
+
+    /// A write request waiting to be applied.
+    struct PendingWrite {
+        /// The control plane updates of the write.
+        std::vector<const ControlPlaneUpdate *> updates;
+
+        /// When the write was queued.
+        Clock::time_point queueTime;
+
+        /// Acknowledges the write.
+        CompletionFunction onComplete;
+    };
+
+    /// The maximum number of latency samples kept to compute percentiles.
+    static constexpr size_t kMaxLatencySamples = 1 << 16;
+
+    /// The batching options.
+    WriteBatchOptions _options;
+
+    /// Guards all members below.
+    mutable std::mutex _mutex;
+
+    /// Signals the processing thread that writes were queued or the queue was closed.
+    std::condition_variable _condition;
+
+    /// Signals blocked writers that the processing thread has taken writes off the queue.
+    std::condition_variable _spaceCondition;
+
+    /// The queued writes in arrival order.
+    std::deque<std::unique_ptr<PendingWrite>> _pending;
+
+    /// Whether the queue accepts new writes.
+    bool _closed = false;
+
+    /// Counters for the statistics.
+    uint64_t _writes = 0;
+    uint64_t _updates = 0;
+    uint64_t _batches = 0;
+    uint64_t _rejectedWrites = 0;
+    std::optional<Clock::time_point> _firstQueueTime;
+    Clock::time_point _lastCompletionTime;
+
+    /// A ring buffer of the most recent write latencies in microseconds.
+    std::vector<double> _latencies;
+    size_t _nextLatencySlot = 0;
+
+ public:
+    explicit WriteBatchQueue(WriteBatchOptions options);
+
+    /// Queue a write consisting of @param updates without blocking. @param onComplete is invoked
+    /// on the processing thread once the write has been applied. It is not invoked if the write
+    /// was not queued because the queue is full or closed.
+    SubmitResult trySubmit(std::vector<const ControlPlaneUpdate *> updates,
+                           CompletionFunction onComplete);
+
+    /// Queue a write consisting of @param updates and block until it has been applied. Waits
+    /// for space if the queue is full.
+    /// @returns the result of the batch which contained the write, or EXIT_FAILURE if an update of
+    /// the write was rejected or the queue has been closed.
+    int submit(std::vector<const ControlPlaneUpdate *> updates);
+
+    /// Wait for the next batch and process it with @param process.
+    /// @returns false once the queue has been closed and all writes have been processed.
+    bool processNextBatch(const ProcessFunction &process);
+
+    /// Stop accepting writes. Writes which are already queued are still processed.
+    void close();
+
+    /// @returns the current throughput and latency counters.
+    [[nodiscard]] WriteBatchStatistics statistics() const;
+
+    /// Print the statistics if performance logging is enabled.
+    void printStatistics() const;
+};
+
+}  // namespace P4::P4Tools::Flay
+
+#endif  // BACKENDS_P4TOOLS_MODULES_FLAY_GRPC_SERVICE_WRITE_BATCH_QUEUE_H_
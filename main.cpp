@@ -4,6 +4,9 @@
 #include <vector>
 
 #include "backends/p4tools/common/lib/logging.h"
+#include "backends/p4tools/modules/flay/core/lib/memory_usage.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_result_cache.h"
 #include "backends/p4tools/modules/flay/flay.h"
 #include "backends/p4tools/modules/flay/toolname.h"
 #include "lib/crash.h"
@@ -41,5 +44,8 @@ int main(int argc, char **argv) {
         result = EXIT_FAILURE;
     }
     P4::P4Tools::printPerformanceReport();
+    P4::P4Tools::Z3Cache::printStatistics();
+    P4::P4Tools::Z3ResultCache::printStatistics();
+    P4::P4Tools::MemoryUsage::printStatistics();
     return result;
 }
@@ -1,9 +1,12 @@
 #include "backends/p4tools/modules/flay/options.h"
 
+#include <cstdlib>
+
 #include "backends/p4tools/common/compiler/context.h"
 #include "backends/p4tools/common/lib/logging.h"
 #include "backends/p4tools/common/lib/util.h"
 #include "backends/p4tools/common/options.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
 #include "backends/p4tools/modules/flay/toolname.h"
 #include "lib/error.h"
 
@@ -64,6 +67,20 @@ FlayOptions::FlayOptions()
         },
         "A pattern which can either match a single file or a list of files. Primarily used for "
         "testing.");
+    registerOption(
+        "--config-update-trace", "traceFile",
+        [this](const char *arg) {
+            _configUpdateTrace = arg;
+            if (_configUpdateTrace.value() != "-" &&
+                !std::filesystem::exists(_configUpdateTrace.value())) {
+                error("The update trace %1% does not exist.", arg);
+                return false;
+            }
+            return true;
+        },
+        "A file containing length-delimited binary write requests, or - to read them from "
+        "standard input. The write requests are processed as they are read. Traces can be "
+        "created from text update files with flay_update_trace_converter.");
     registerOption(
         "--use-placeholders", nullptr,
         [this](const char *) {
@@ -87,6 +104,21 @@ FlayOptions::FlayOptions()
             return true;
         },
         "The path to the output directory of the optimized P4 program(s).");
+    registerOption(
+        "--optimized-output-interval", "count",
+        [this](const char *arg) {
+            char *end = nullptr;
+            auto interval = std::strtoull(arg, &end, 10);
+            if (end == arg || *end != '\0') {
+                error("Invalid optimized output interval %1%. Expected a number.", arg);
+                return false;
+            }
+            _optimizedOutputInterval = interval;
+            return true;
+        },
+        "Write the optimized program to the output directory after every n-th control plane "
+        "update. Defaults to 0, which only writes the program before the first and after the "
+        "last update.");
     registerOption(
         "--collapse-data-plane-variables", nullptr,
         [this](const char *) {
@@ -152,6 +184,19 @@ FlayOptions::FlayOptions()
             return true;
         },
         "Skip side-effect ordering in the front end.");
+    registerOption(
+        "--z3-cache-capacity", "capacity",
+        [](const char *arg) {
+            auto capacity = std::strtoull(arg, nullptr, 10);
+            if (capacity == 0) {
+                error("Invalid Z3 cache capacity %1%. Expected a positive number.", arg);
+                return false;
+            }
+            Z3Cache::setCapacity(capacity);
+            return true;
+        },
+        "The maximum number of translated expressions kept in the Z3 cache of each thread. Least "
+        "recently used expressions are evicted first.");
     registerOption(
         "--no-symbol-set", "useSymbolSet",
         [this](const char *) {
@@ -159,6 +204,134 @@ FlayOptions::FlayOptions()
             return true;
         },
         "Disable using a symbol set.");
+    registerOption(
+        "--native-simplifier", nullptr,
+        [this](const char *) {
+            _useNativeSimplifier = true;
+            return true;
+        },
+        "Simplify expressions with a native term rewriter instead of a series of compiler passes. "
+        "The rewriter folds Mux conditions, lifts nested Mux conditions, and folds logical "
+        "operators and comparisons of literals.");
+    registerOption(
+        "--write-batch-window", "microseconds",
+        [this](const char *arg) {
+            char *end = nullptr;
+            auto window = std::strtoull(arg, &end, 10);
+            if (end == arg || *end != '\0') {
+                error("Invalid write batch window %1%. Expected a number of microseconds.", arg);
+                return false;
+            }
+            _writeBatchWindow = std::chrono::microseconds(window);
+            return true;
+        },
+        "In server mode, process all write requests which arrive within this window after the "
+        "first queued request as one batch. Defaults to 1000 microseconds.");
+    registerOption(
+        "--write-batch-size", "count",
+        [this](const char *arg) {
+            auto size = std::strtoull(arg, nullptr, 10);
+            if (size == 0) {
+                error("Invalid write batch size %1%. Expected a positive number.", arg);
+                return false;
+            }
+            _writeBatchSize = size;
+            return true;
+        },
+        "In server mode, the maximum number of write requests processed as one batch. Defaults "
+        "to 1024.");
+    registerOption(
+        "--write-queue-capacity", "count",
+        [this](const char *arg) {
+            auto capacity = std::strtoull(arg, nullptr, 10);
+            if (capacity == 0) {
+                error("Invalid write queue capacity %1%. Expected a positive number.", arg);
+                return false;
+            }
+            _writeQueueCapacity = capacity;
+            return true;
+        },
+        "In server mode, the maximum number of write requests waiting to be processed. Further "
+        "writes are rejected with RESOURCE_EXHAUSTED until the queue has drained. Defaults to "
+        "4096.");
+    registerOption(
+        "--save-snapshot", "snapshotFile",
+        [this](const char *arg) {
+            _saveSnapshot = arg;
+            return true;
+        },
+        "Write a snapshot of the compiled program and the result of the data plane analysis to "
+        "the given file. The snapshot can be restored with --load-snapshot.");
+    registerOption(
+        "--load-snapshot", "snapshotFile",
+        [this](const char *arg) {
+            _loadSnapshot = arg;
+            if (!std::filesystem::exists(_loadSnapshot.value())) {
+                error("The snapshot file %1% does not exist.", arg);
+                return false;
+            }
+            return true;
+        },
+        "Restore the compiled program and the result of the data plane analysis from a snapshot "
+        "written with --save-snapshot. Skips the compiler and the data plane analysis.");
+    registerOption(
+        "--z3-result-cache", "cacheFile",
+        [this](const char *arg) {
+            _z3ResultCache = arg;
+            return true;
+        },
+        "Cache the simplified results of substituting control plane assignments into the "
+        "reachability conditions and expressions of the program in the given file. Later runs on "
+        "the same program reuse the cached results instead of solving them again.");
+    registerOption(
+        "--z3-result-cache-capacity", "count",
+        [this](const char *arg) {
+            auto capacity = std::strtoull(arg, nullptr, 10);
+            if (capacity == 0) {
+                error("Invalid Z3 result cache capacity %1%. Expected a positive number.", arg);
+                return false;
+            }
+            _z3ResultCacheCapacity = capacity;
+            return true;
+        },
+        "The maximum number of results kept in the file set with --z3-result-cache. Least "
+        "recently used results are dropped first. Defaults to 1048576.");
+    registerOption(
+        "--statistics-check-interval", "count",
+        [this](const char *arg) {
+            char *end = nullptr;
+            auto interval = std::strtoull(arg, &end, 10);
+            if (end == arg || *end != '\0') {
+                error("Invalid statistics check interval %1%. Expected a number.", arg);
+                return false;
+            }
+            _statisticsCheckInterval = interval;
+            return true;
+        },
+        "Recount the statistics of the optimized program from scratch after every n-th applied "
+        "batch of control plane updates and compare them to the incrementally maintained "
+        "statistics. Defaults to 0, which disables the check.");
+    registerOption(
+        "--stats-file", "statisticsFile",
+        [this](const char *arg) {
+            _statisticsFile = arg;
+            return true;
+        },
+        "Write the program statistics, the performance timers, the Z3 cache counters, and the "
+        "memory peaks to the given file in the format set with --stats-format.");
+    registerOption(
+        "--stats-format", "format",
+        [this](const char *arg) {
+            auto format = StatisticsReport::parseFormat(arg);
+            if (!format.has_value()) {
+                error("Invalid statistics format %1%. Expected \"json\" or \"csv\".", arg);
+                return false;
+            }
+            _statisticsFormat = format.value();
+            return true;
+        },
+        "The format of the file set with --stats-file. One of \"json\" or \"csv\". Defaults to "
+        "\"json\".");
 }
 
 bool FlayOptions::validateOptions() const {
@@ -166,6 +339,16 @@ bool FlayOptions::validateOptions() const {
         error("Both --user-p4info and --generate-p4info are specified. Please specify only one.");
         return false;
     }
+    if (_configUpdatePattern.has_value() && _configUpdateTrace.has_value()) {
+        error(
+            "Both --config-update-pattern and --config-update-trace are specified. Please specify "
+            "only one.");
+        return false;
+    }
+    if (_saveSnapshot.has_value() && _loadSnapshot.has_value()) {
+        error("Both --save-snapshot and --load-snapshot are specified. Please specify only one.");
+        return false;
+    }
     return true;
 }
 
@@ -185,6 +368,10 @@ std::string_view FlayOptions::configurationUpdatePattern() const {
     return _configUpdatePattern.value();
 }
 
+std::optional<std::filesystem::path> FlayOptions::configurationUpdateTrace() const {
+    return _configUpdateTrace;
+}
+
 bool FlayOptions::usePlaceholders() const { return _usePlaceholders; }
 
 bool FlayOptions::isStrict() const { return _strict; }
@@ -193,6 +380,8 @@ std::optional<std::filesystem::path> FlayOptions::optimizedOutputDir() const {
     return _optimizedOutputDir;
 }
 
+size_t FlayOptions::optimizedOutputInterval() const { return _optimizedOutputInterval; }
+
 bool FlayOptions::collapseDataPlaneOperations() const { return _collapseDataPlaneOperations; }
 
 std::optional<std::filesystem::path> FlayOptions::p4InfoFilePath() const { return _p4InfoFilePath; }
@@ -207,6 +396,28 @@ bool FlayOptions::skipSideEffectOrdering() const { return _skipSideEffectOrderin
 
 bool FlayOptions::useSymbolSet() const { return _useSymbolSet; }
 
+bool FlayOptions::useNativeSimplifier() const { return _useNativeSimplifier; }
+
+std::chrono::microseconds FlayOptions::writeBatchWindow() const { return _writeBatchWindow; }
+
+size_t FlayOptions::writeBatchSize() const { return _writeBatchSize; }
+
+size_t FlayOptions::writeQueueCapacity() const { return _writeQueueCapacity; }
+
+std::optional<std::filesystem::path> FlayOptions::saveSnapshot() const { return _saveSnapshot; }
+
+std::optional<std::filesystem::path> FlayOptions::loadSnapshot() const { return _loadSnapshot; }
+
+std::optional<std::filesystem::path> FlayOptions::z3ResultCache() const { return _z3ResultCache; }
+
+size_t FlayOptions::z3ResultCacheCapacity() const { return _z3ResultCacheCapacity; }
+
+size_t FlayOptions::statisticsCheckInterval() const { return _statisticsCheckInterval; }
+
+std::optional<std::filesystem::path> FlayOptions::statisticsFile() const { return _statisticsFile; }
+
+StatisticsFormat FlayOptions::statisticsFormat() const { return _statisticsFormat; }
+
 void FlayOptions::setControlPlaneConfig(const std::filesystem::path &path) {
     _controlPlaneConfig = path;
 }
@@ -219,6 +430,10 @@ void FlayOptions::setConfigurationUpdatePattern(const std::string &pattern) {
     _configUpdatePattern = pattern;
 }
 
+void FlayOptions::setConfigurationUpdateTrace(const std::filesystem::path &path) {
+    _configUpdateTrace = path;
+}
+
 void FlayOptions::setUsePlaceholders() { _usePlaceholders = true; }
 
 void FlayOptions::setStrict() { _strict = true; }
@@ -239,4 +454,12 @@ void FlayOptions::setSkipSideEffectOrdering() { _skipSideEffectOrdering = true;
 
 void FlayOptions::setUseSymbolSet() { _useSymbolSet = true; }
 
+void FlayOptions::setUseNativeSimplifier() { _useNativeSimplifier = true; }
+
+void FlayOptions::setSaveSnapshot(const std::filesystem::path &path) { _saveSnapshot = path; }
+
+void FlayOptions::setLoadSnapshot(const std::filesystem::path &path) { _loadSnapshot = path; }
+
+void FlayOptions::setZ3ResultCache(const std::filesystem::path &path) { _z3ResultCache = path; }
+
 }  // namespace P4::P4Tools::Flay
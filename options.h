@@ -1,10 +1,13 @@
 #ifndef BACKENDS_P4TOOLS_MODULES_FLAY_OPTIONS_H_
 #define BACKENDS_P4TOOLS_MODULES_FLAY_OPTIONS_H_
 
+#include <chrono>
+#include <cstddef>
 #include <filesystem>
 #include <optional>
 
 #include "backends/p4tools/common/options.h"
+#include "backends/p4tools/modules/flay/core/lib/statistics_report.h"
 
 namespace P4::P4Tools::Flay {
 
@@ -40,6 +43,9 @@ class FlayOptions : public AbstractP4cToolOptions {
     /// @returns the configuration update pattern set with --config-update-pattern.
     [[nodiscard]] std::string_view configurationUpdatePattern() const;
 
+    /// @returns the path set with --config-update-trace. "-" denotes standard input.
+    [[nodiscard]] std::optional<std::filesystem::path> configurationUpdateTrace() const;
+
     /// @returns true when the --use-placeholders option has been set.
     [[nodiscard]] bool usePlaceholders() const;
 
@@ -49,6 +55,10 @@ class FlayOptions : public AbstractP4cToolOptions {
     /// @returns the path set with --optimized-output-dir.
     [[nodiscard]] std::optional<std::filesystem::path> optimizedOutputDir() const;
 
+    /// @returns the number of updates between two optimized programs written to the output
+    /// directory, set with --optimized-output-interval. 0 if only the final program is written.
+    [[nodiscard]] size_t optimizedOutputInterval() const;
+
     /// @returns true when --collapse-data-plane-variables has been set.
     [[nodiscard]] bool collapseDataPlaneOperations() const;
 
@@ -70,6 +80,41 @@ class FlayOptions : public AbstractP4cToolOptions {
     /// @returns false when the --no-symbol-set option has been set.
     [[nodiscard]] bool useSymbolSet() const;
 
+    /// @returns true when the --native-simplifier option has been set.
+    [[nodiscard]] bool useNativeSimplifier() const;
+
+    /// @returns the coalescing window for server write requests set with --write-batch-window.
+    [[nodiscard]] std::chrono::microseconds writeBatchWindow() const;
+
+    /// @returns the maximum number of write requests per batch set with --write-batch-size.
+    [[nodiscard]] size_t writeBatchSize() const;
+
+    /// @returns the maximum number of pending server write requests set with
+    /// --write-queue-capacity.
+    [[nodiscard]] size_t writeQueueCapacity() const;
+
+    /// @returns the path set with --save-snapshot.
+    [[nodiscard]] std::optional<std::filesystem::path> saveSnapshot() const;
+
+    /// @returns the path set with --load-snapshot.
+    [[nodiscard]] std::optional<std::filesystem::path> loadSnapshot() const;
+
+    /// @returns the path set with --z3-result-cache.
+    [[nodiscard]] std::optional<std::filesystem::path> z3ResultCache() const;
+
+    /// @returns the maximum number of results set with --z3-result-cache-capacity.
+    [[nodiscard]] size_t z3ResultCacheCapacity() const;
+
+    /// @returns the number of applied update batches between two full recounts of the program
+    /// statistics, set with --statistics-check-interval. 0 if the statistics are never recounted.
+    [[nodiscard]] size_t statisticsCheckInterval() const;
+
+    /// @returns the path set with --stats-file.
+    [[nodiscard]] std::optional<std::filesystem::path> statisticsFile() const;
+
+    /// @returns the format set with --stats-format.
+    [[nodiscard]] StatisticsFormat statisticsFormat() const;
+
     /// Sets the path to the initial control plane configuration file.
     void setControlPlaneConfig(const std::filesystem::path &path);
 
@@ -82,6 +127,9 @@ class FlayOptions : public AbstractP4cToolOptions {
     /// Sets the configuration update pattern.
     void setConfigurationUpdatePattern(const std::string &pattern);
 
+    /// Sets the file length-delimited binary write requests are streamed from.
+    void setConfigurationUpdateTrace(const std::filesystem::path &path);
+
     /// Sets the use of placeholders.
     void setUsePlaceholders();
 
@@ -110,6 +158,18 @@ class FlayOptions : public AbstractP4cToolOptions {
     /// Set whether to use the symbol set.
     void setUseSymbolSet();
 
+    /// Set whether to simplify expressions with the native simplifier.
+    void setUseNativeSimplifier();
+
+    /// Sets the path the snapshot of the analysis is written to.
+    void setSaveSnapshot(const std::filesystem::path &path);
+
+    /// Sets the path of the snapshot the analysis is restored from.
+    void setLoadSnapshot(const std::filesystem::path &path);
+
+    /// Sets the file the simplified substitution results are cached in.
+    void setZ3ResultCache(const std::filesystem::path &path);
+
  private:
     /// Path to the initial control plane configuration file.
     std::optional<std::filesystem::path> _controlPlaneConfig = std::nullopt;
@@ -126,6 +186,10 @@ class FlayOptions : public AbstractP4cToolOptions {
     /// Used for testing.
     std::optional<std::string> _configUpdatePattern;
 
+    /// A file of length-delimited binary write requests. The requests are processed one at a time
+    /// as they are read, so the trace is never held in memory.
+    std::optional<std::filesystem::path> _configUpdateTrace;
+
     /// Toggle use of placeholder variables to model recirculated or cloned packets.
     bool _usePlaceholders = false;
 
@@ -136,6 +200,9 @@ class FlayOptions : public AbstractP4cToolOptions {
     /// The path to the output file of the optimized P4 program.
     std::optional<std::filesystem::path> _optimizedOutputDir = std::nullopt;
 
+    /// The number of updates between two optimized programs written to the output directory.
+    size_t _optimizedOutputInterval = 0;
+
     /// Collapse arithmetic operations on data plane variables.
     bool _collapseDataPlaneOperations = false;
 
@@ -156,6 +223,41 @@ class FlayOptions : public AbstractP4cToolOptions {
 
     /// If useSymbolSet is true, we only check whether the symbols in the set have changed.
     bool _useSymbolSet = true;
+
+    /// Simplify expressions with the native term rewriter instead of the compiler passes.
+    bool _useNativeSimplifier = false;
+
+    /// In server mode, write requests arriving within this window are processed as one batch.
+    std::chrono::microseconds _writeBatchWindow = std::chrono::microseconds(1000);
+
+    /// In server mode, the maximum number of write requests which are processed as one batch.
+    size_t _writeBatchSize = 1024;
+
+    /// In server mode, the maximum number of write requests waiting to be processed.
+    size_t _writeQueueCapacity = 4096;
+
+    /// Write a snapshot of the compiled program and the data plane analysis to this file.
+    std::optional<std::filesystem::path> _saveSnapshot = std::nullopt;
+
+    /// Restore the compiled program and the data plane analysis from this snapshot file instead
+    /// of running the compiler and the data plane analysis.
+    std::optional<std::filesystem::path> _loadSnapshot = std::nullopt;
+
+    /// Cache the simplified results of substituting control plane assignments in this file, so
+    /// later runs on the same program do not have to solve them again.
+    std::optional<std::filesystem::path> _z3ResultCache = std::nullopt;
+
+    /// The maximum number of results kept in the result cache.
+    size_t _z3ResultCacheCapacity = 1 << 20;
+
+    /// The number of applied update batches between two full recounts of the program statistics.
+    size_t _statisticsCheckInterval = 0;
+
+    /// Write the machine-readable statistics to this file.
+    std::optional<std::filesystem::path> _statisticsFile = std::nullopt;
+
+    /// The format of the statistics file.
+    StatisticsFormat _statisticsFormat = StatisticsFormat::kJson;
 };
 
 }  // namespace P4::P4Tools::Flay
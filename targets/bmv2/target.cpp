@@ -130,6 +130,12 @@ FlayStepper &V1ModelFlayTarget::getStepperImpl(const ProgramInfo &programInfo,
                                    executionState);
 }
 
+std::optional<ControlPlaneConstraints>
+V1ModelFlayTarget::generateDefaultControlPlaneConstraintsImpl(
+    const IR::P4Program &program) const {
+    return Bmv2ControlPlaneInitializer().generateInitialControlPlaneConstraints(&program);
+}
+
 CompilerResultOrError V1ModelFlayTarget::runCompilerImpl(const CompilerOptions &options,
                                                          const IR::P4Program *program) const {
     program = runFrontend(options, program);
@@ -165,8 +171,7 @@ CompilerResultOrError V1ModelFlayTarget::runCompilerImpl(const CompilerOptions &
     program = program->apply(mkPrivateMidEnd(options, &refMap, &typeMap));
 
     ASSIGN_OR_RETURN(auto initialControlPlaneState,
-                     Bmv2ControlPlaneInitializer().generateInitialControlPlaneConstraints(program),
-                     std::nullopt);
+                     generateDefaultControlPlaneConstraintsImpl(*program), std::nullopt);
 
     return {*new FlayCompilerResult{CompilerResult(*program), *originalProgram,
                                     p4runtimeApi.value(), initialControlPlaneState}};
@@ -30,6 +30,9 @@ class V1ModelFlayTarget : public FlayTarget {
                                               ControlPlaneConstraints &constraints,
                                               ExecutionState &executionState) const override;
 
+    [[nodiscard]] std::optional<ControlPlaneConstraints> generateDefaultControlPlaneConstraintsImpl(
+        const IR::P4Program &program) const final;
+
  private:
     CompilerResultOrError runCompilerImpl(const CompilerOptions &options,
                                           const IR::P4Program *program) const final;
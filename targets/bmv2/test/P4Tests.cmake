@@ -45,6 +45,8 @@ p4tools_add_tests(
 )
 
 include(${CMAKE_CURRENT_LIST_DIR}/ConfigTests.cmake)
+include(${CMAKE_CURRENT_LIST_DIR}/SnapshotTests.cmake)
+include(${CMAKE_CURRENT_LIST_DIR}/TraceTests.cmake)
 
 # Include the list of failing tests.
 include(${CMAKE_CURRENT_LIST_DIR}/BMv2V1ModelXfail.cmake)
@@ -0,0 +1,75 @@
+# Snapshot round-trip tests. Each test runs Flay twice on the same program. The first run applies
+# the control plane updates and writes a snapshot, the second run restores the program, the
+# analysis, and the applied entities from this snapshot without any updates. Both runs must
+# produce the specialization results of the reference file.
+function(p4tools_add_snapshot_test)
+  # Parse arguments.
+  set(options)
+  set(oneValueArgs TAG DRIVER ALIAS P4TEST TARGET ARCH CONTROL_PLANE_UPDATES)
+  set(multiValueArgs TEST_ARGS)
+  cmake_parse_arguments(
+    TOOLS_FLAY_SNAPSHOT_TESTS "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN}
+  )
+  # Set some lowercase variables for convenience.
+  set(tag ${TOOLS_FLAY_SNAPSHOT_TESTS_TAG})
+  set(driver ${TOOLS_FLAY_SNAPSHOT_TESTS_DRIVER})
+  set(alias ${TOOLS_FLAY_SNAPSHOT_TESTS_ALIAS})
+  set(p4test ${TOOLS_FLAY_SNAPSHOT_TESTS_P4TEST})
+  set(target ${TOOLS_FLAY_SNAPSHOT_TESTS_TARGET})
+  set(arch ${TOOLS_FLAY_SNAPSHOT_TESTS_ARCH})
+  set(test_args ${TOOLS_FLAY_SNAPSHOT_TESTS_TEST_ARGS})
+  set(control_plane_updates ${TOOLS_FLAY_SNAPSHOT_TESTS_CONTROL_PLANE_UPDATES})
+
+  p4c_test_set_name(__testname ${tag} ${alias})
+  string(REGEX REPLACE ".p4" "" aliasname ${alias})
+  set(__testfile "${FLAY_DIR}/${tag}/${alias}.test")
+  set(__testfolder "${FLAY_DIR}/${tag}/${aliasname}.out")
+  set(__snapshot "${__testfolder}/${aliasname}.snapshot")
+  file(WRITE ${__testfile} "#! /usr/bin/env bash\n")
+  file(APPEND ${__testfile} "# Generated file, modify with care\n\n")
+  file(APPEND ${__testfile} "set -e\n")
+  file(APPEND ${__testfile} "cd ${P4C_BINARY_DIR}\n")
+  file(APPEND ${__testfile} "mkdir -p ${__testfolder}\n")
+
+  set(save_args "")
+  if (control_plane_updates)
+    set(save_args "--config-update-pattern \"${control_plane_updates}\"")
+  endif()
+
+  file(APPEND ${__testfile} "${driver} --target ${target} --arch ${arch} "
+                            "${test_args} ${save_args} \"$@\" --file ${p4test} "
+                            "--save-snapshot ${__snapshot}\n")
+  file(APPEND ${__testfile} "${driver} --target ${target} --arch ${arch} "
+                            "${test_args} \"$@\" --file ${p4test} --load-snapshot ${__snapshot}\n")
+
+  execute_process(COMMAND chmod +x ${__testfile})
+  add_test(NAME ${__testname} COMMAND ${tag}/${alias}.test WORKING_DIRECTORY ${FLAY_DIR})
+  if(NOT DEFINED ${tag}_timeout)
+    set(${tag}_timeout 420)
+  endif()
+  set_tests_properties(${__testname} PROPERTIES LABELS ${tag} TIMEOUT ${${tag}_timeout})
+endfunction(p4tools_add_snapshot_test)
+
+p4tools_add_snapshot_test(
+  P4TEST "${CMAKE_CURRENT_LIST_DIR}/programs/v1model_simple_example.p4"
+  TAG "flay-bmv2-v1model-snapshot" ALIAS "v1model_simple_example.p4" DRIVER ${FLAY_REFERENCE_DRIVER}
+  TARGET "bmv2" ARCH "v1model" CONTROL_PLANE_UPDATES "${CMAKE_CURRENT_LIST_DIR}/protos/v1model_simple_example/update*.txtpb" TEST_ARGS "-I${P4C_BINARY_DIR}/p4include ${CONFIG_EXTRA_OPTS}"
+)
+
+p4tools_add_snapshot_test(
+  P4TEST "${P4C_SOURCE_DIR}/testdata/p4_16_samples/basic_routing-bmv2.p4"
+  TAG "flay-bmv2-v1model-snapshot" ALIAS "basic_routing-bmv2.p4" DRIVER ${FLAY_REFERENCE_DRIVER}
+  TARGET "bmv2" ARCH "v1model" CONTROL_PLANE_UPDATES "${CMAKE_CURRENT_LIST_DIR}/protos/basic_routing/update*.txtpb" TEST_ARGS "-I${P4C_BINARY_DIR}/p4include ${CONFIG_EXTRA_OPTS}"
+)
+
+p4tools_add_snapshot_test(
+  P4TEST "${CMAKE_CURRENT_LIST_DIR}/programs/v1model_entries_table.p4"
+  TAG "flay-bmv2-v1model-snapshot" ALIAS "v1model_entries_table.p4" DRIVER ${FLAY_REFERENCE_DRIVER}
+  TARGET "bmv2" ARCH "v1model" CONTROL_PLANE_UPDATES "${CMAKE_CURRENT_LIST_DIR}/protos/v1model_entries_table/update*.txtpb" TEST_ARGS "-I${P4C_BINARY_DIR}/p4include ${CONFIG_EXTRA_OPTS}"
+)
+
+p4tools_add_snapshot_test(
+  P4TEST "${CMAKE_CURRENT_LIST_DIR}/programs/v1model_parser_value_set.p4"
+  TAG "flay-bmv2-v1model-snapshot" ALIAS "v1model_parser_value_set.p4" DRIVER ${FLAY_REFERENCE_DRIVER}
+  TARGET "bmv2" ARCH "v1model" CONTROL_PLANE_UPDATES "${CMAKE_CURRENT_LIST_DIR}/protos/v1model_parser_value_set/update*.txtpb" TEST_ARGS "-I${P4C_BINARY_DIR}/p4include ${CONFIG_EXTRA_OPTS}"
+)
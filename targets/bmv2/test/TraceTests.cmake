@@ -0,0 +1,62 @@
+# Update trace tests. Each test converts the text control plane updates of a program into a binary
+# update trace and replays the trace with --config-update-trace. The results must match the
+# reference file of the text updates.
+function(p4tools_add_trace_test)
+  # Parse arguments.
+  set(options STDIN)
+  set(oneValueArgs TAG DRIVER ALIAS P4TEST TARGET ARCH CONTROL_PLANE_UPDATES)
+  set(multiValueArgs TEST_ARGS)
+  cmake_parse_arguments(
+    TOOLS_FLAY_TRACE_TESTS "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN}
+  )
+  # Set some lowercase variables for convenience.
+  set(tag ${TOOLS_FLAY_TRACE_TESTS_TAG})
+  set(driver ${TOOLS_FLAY_TRACE_TESTS_DRIVER})
+  set(alias ${TOOLS_FLAY_TRACE_TESTS_ALIAS})
+  set(p4test ${TOOLS_FLAY_TRACE_TESTS_P4TEST})
+  set(target ${TOOLS_FLAY_TRACE_TESTS_TARGET})
+  set(arch ${TOOLS_FLAY_TRACE_TESTS_ARCH})
+  set(test_args ${TOOLS_FLAY_TRACE_TESTS_TEST_ARGS})
+  set(control_plane_updates ${TOOLS_FLAY_TRACE_TESTS_CONTROL_PLANE_UPDATES})
+  set(read_from_stdin ${TOOLS_FLAY_TRACE_TESTS_STDIN})
+
+  p4c_test_set_name(__testname ${tag} ${alias})
+  string(REGEX REPLACE ".p4" "" aliasname ${alias})
+  set(__testfile "${FLAY_DIR}/${tag}/${alias}.test")
+  set(__testfolder "${FLAY_DIR}/${tag}/${aliasname}.out")
+  set(__trace "${__testfolder}/${aliasname}.binpb")
+  file(WRITE ${__testfile} "#! /usr/bin/env bash\n")
+  file(APPEND ${__testfile} "# Generated file, modify with care\n\n")
+  file(APPEND ${__testfile} "set -e\n")
+  file(APPEND ${__testfile} "cd ${P4C_BINARY_DIR}\n")
+  file(APPEND ${__testfile} "mkdir -p ${__testfolder}\n")
+  file(APPEND ${__testfile} "${FLAY_UPDATE_TRACE_CONVERTER} --output ${__trace} "
+                            "\"${control_plane_updates}\"\n")
+
+  if (read_from_stdin)
+    file(APPEND ${__testfile} "${driver} --target ${target} --arch ${arch} ${test_args} \"$@\" "
+                              "--file ${p4test} --config-update-trace - < ${__trace}\n")
+  else()
+    file(APPEND ${__testfile} "${driver} --target ${target} --arch ${arch} ${test_args} \"$@\" "
+                              "--file ${p4test} --config-update-trace ${__trace}\n")
+  endif()
+
+  execute_process(COMMAND chmod +x ${__testfile})
+  add_test(NAME ${__testname} COMMAND ${tag}/${alias}.test WORKING_DIRECTORY ${FLAY_DIR})
+  if(NOT DEFINED ${tag}_timeout)
+    set(${tag}_timeout 420)
+  endif()
+  set_tests_properties(${__testname} PROPERTIES LABELS ${tag} TIMEOUT ${${tag}_timeout})
+endfunction(p4tools_add_trace_test)
+
+p4tools_add_trace_test(
+  P4TEST "${CMAKE_CURRENT_LIST_DIR}/programs/v1model_simple_example.p4"
+  TAG "flay-bmv2-v1model-trace" ALIAS "v1model_simple_example.p4" DRIVER ${FLAY_REFERENCE_DRIVER}
+  TARGET "bmv2" ARCH "v1model" CONTROL_PLANE_UPDATES "${CMAKE_CURRENT_LIST_DIR}/protos/v1model_simple_example/update*.txtpb" TEST_ARGS "-I${P4C_BINARY_DIR}/p4include ${CONFIG_EXTRA_OPTS}"
+)
+
+p4tools_add_trace_test(
+  P4TEST "${CMAKE_CURRENT_LIST_DIR}/programs/v1model_entries_table.p4" STDIN
+  TAG "flay-bmv2-v1model-trace" ALIAS "v1model_entries_table.p4" DRIVER ${FLAY_REFERENCE_DRIVER}
+  TARGET "bmv2" ARCH "v1model" CONTROL_PLANE_UPDATES "${CMAKE_CURRENT_LIST_DIR}/protos/v1model_entries_table/update*.txtpb" TEST_ARGS "-I${P4C_BINARY_DIR}/p4include ${CONFIG_EXTRA_OPTS}"
+)
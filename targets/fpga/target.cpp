@@ -32,6 +32,12 @@ using namespace ::P4::literals;
 FpgaBaseFlayTarget::FpgaBaseFlayTarget(const std::string &deviceName, const std::string &archName)
     : FlayTarget(deviceName, archName){};
 
+std::optional<ControlPlaneConstraints>
+FpgaBaseFlayTarget::generateDefaultControlPlaneConstraintsImpl(
+    const IR::P4Program &program) const {
+    return FpgaControlPlaneInitializer().generateInitialControlPlaneConstraints(&program);
+}
+
 CompilerResultOrError FpgaBaseFlayTarget::runCompilerImpl(const CompilerOptions &options,
                                                           const IR::P4Program *program) const {
     program = runFrontend(options, program);
@@ -67,8 +73,7 @@ CompilerResultOrError FpgaBaseFlayTarget::runCompilerImpl(const CompilerOptions
     P4::TypeMap typeMap;
     program = program->apply(mkPrivateMidEnd(options, &refMap, &typeMap));
     ASSIGN_OR_RETURN(auto initialControlPlaneState,
-                     FpgaControlPlaneInitializer().generateInitialControlPlaneConstraints(program),
-                     std::nullopt);
+                     generateDefaultControlPlaneConstraintsImpl(*program), std::nullopt);
 
     return {*new FlayCompilerResult{CompilerResult(*program), *originalProgram,
                                     p4runtimeApi.value(), initialControlPlaneState}};
@@ -16,6 +16,9 @@ class NikssBaseFlayTarget : public FlayTarget {
 
     CompilerResultOrError runCompilerImpl(const CompilerOptions &options,
                                           const IR::P4Program *program) const override;
+
+    [[nodiscard]] std::optional<ControlPlaneConstraints> generateDefaultControlPlaneConstraintsImpl(
+        const IR::P4Program &program) const override;
 };
 
 class PsaFlayTarget : public NikssBaseFlayTarget {
@@ -35,6 +35,12 @@ TofinoBaseFlayTarget::TofinoBaseFlayTarget(const std::string &deviceName,
                                            const std::string &archName)
     : FlayTarget(deviceName, archName){};
 
+std::optional<ControlPlaneConstraints>
+TofinoBaseFlayTarget::generateDefaultControlPlaneConstraintsImpl(
+    const IR::P4Program &program) const {
+    return TofinoControlPlaneInitializer().generateInitialControlPlaneConstraints(&program);
+}
+
 CompilerResultOrError TofinoBaseFlayTarget::runCompilerImpl(const CompilerOptions &options,
                                                             const IR::P4Program *program) const {
     program = runFrontend(options, program);
@@ -77,10 +83,8 @@ CompilerResultOrError TofinoBaseFlayTarget::runCompilerImpl(const CompilerOption
     P4::TypeMap typeMap;
     program = program->apply(mkPrivateMidEnd(options, &refMap, &typeMap));
 
-    ASSIGN_OR_RETURN(
-        auto initialControlPlaneState,
-        TofinoControlPlaneInitializer().generateInitialControlPlaneConstraints(program),
-        std::nullopt);
+    ASSIGN_OR_RETURN(auto initialControlPlaneState,
+                     generateDefaultControlPlaneConstraintsImpl(*program), std::nullopt);
 
     return {*new FlayCompilerResult{CompilerResult(*program), *originalProgram,
                                     p4runtimeApi.value(), initialControlPlaneState}};
@@ -0,0 +1,150 @@
+#include "backends/p4tools/modules/flay/core/control_plane/control_plane_objects.h"
+
+#include <gtest/gtest.h>
+
+#include <z3++.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "backends/p4tools/common/control_plane/symbolic_variables.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+using P4::P4Tools::Flay::ActionProfile;
+using P4::P4Tools::Flay::ActionProfileMember;
+using P4::P4Tools::Flay::ActionProfileReference;
+using P4::P4Tools::Flay::ActionProfileTableMatchEntry;
+using P4::P4Tools::Flay::ControlPlaneAssignmentSet;
+using P4::P4Tools::Flay::ControlPlaneConstraints;
+using P4::P4Tools::Flay::SymbolSet;
+using P4::P4Tools::Flay::TableConfiguration;
+using P4::P4Tools::Flay::TableDefaultAction;
+
+const auto *const PARAM_TYPE = IR::Type_Bits::get(8);
+
+/// Create a member executing @param action with argument @param argument.
+ActionProfileMember createMember(cstring action, int argument) {
+    return {IR::StringLiteral::get(action), {{"p"_cs, IR::Constant::get(PARAM_TYPE, argument)}}};
+}
+
+/// @returns the action chosen by @param assignments if the selector picks member @param idx.
+z3::expr chosenAction(const ControlPlaneAssignmentSet &assignments, int idx) {
+    const auto &action = assignments.at(*ControlPlaneState::getTableActionChoice("t"_cs)).get();
+    z3::expr_vector from(Z3Cache::context());
+    z3::expr_vector to(Z3Cache::context());
+    const auto *selectorChoice = ControlPlaneState::getActionSelectorChoice("t"_cs);
+    from.push_back(Z3Cache::set(selectorChoice));
+    to.push_back(Z3Cache::set(IR::Constant::get(selectorChoice->type, idx)));
+    return Z3Cache::set(&action).substitute(from, to).simplify();
+}
+
+// Groups leave the choice among their members to the selector.
+TEST_F(P4FlayTest, ActionProfile01) {
+    ActionProfile profile("p"_cs, {"t"_cs});
+    ASSERT_EQ(profile.addMember(1, createMember("a1"_cs, 1), false), EXIT_SUCCESS);
+    ASSERT_EQ(profile.addMember(2, createMember("a2"_cs, 2), false), EXIT_SUCCESS);
+    EXPECT_EQ(profile.addMember(2, createMember("a2"_cs, 3), false), EXIT_FAILURE);
+    EXPECT_EQ(profile.addGroup(10, {1, 3}, false), EXIT_FAILURE);
+    ASSERT_EQ(profile.addGroup(10, {1, 2}, false), EXIT_SUCCESS);
+
+    auto memberAssignment =
+        profile.computeActionAssignment("t"_cs, {ActionProfileReference::Kind::kMember, 1});
+    ASSERT_TRUE(memberAssignment.has_value());
+    EXPECT_EQ(memberAssignment->size(), 2U);
+    EXPECT_FALSE(
+        profile.computeActionAssignment("t"_cs, {ActionProfileReference::Kind::kGroup, 11})
+            .has_value());
+
+    auto groupAssignment =
+        profile.computeActionAssignment("t"_cs, {ActionProfileReference::Kind::kGroup, 10});
+    ASSERT_TRUE(groupAssignment.has_value());
+    EXPECT_EQ(groupAssignment->size(), 3U);
+    EXPECT_TRUE(
+        z3::eq(chosenAction(*groupAssignment, 0), Z3Cache::set(IR::StringLiteral::get("a1"_cs))));
+    EXPECT_TRUE(
+        z3::eq(chosenAction(*groupAssignment, 1), Z3Cache::set(IR::StringLiteral::get("a2"_cs))));
+}
+
+// Changing a member updates only the entries which refer to it.
+TEST_F(P4FlayTest, ActionProfile02) {
+    auto &profile = *new ActionProfile("p"_cs, {"t"_cs});
+    ASSERT_EQ(profile.addMember(1, createMember("a1"_cs, 1), false), EXIT_SUCCESS);
+    ASSERT_EQ(profile.addMember(2, createMember("a2"_cs, 2), false), EXIT_SUCCESS);
+
+    ControlPlaneAssignmentSet defaultAction;
+    defaultAction.emplace(*ControlPlaneState::getTableActionChoice("t"_cs),
+                          *IR::StringLiteral::get("*NONE*"_cs));
+    auto &table = *new TableConfiguration("t"_cs, TableDefaultAction(defaultAction), {});
+    const auto *keySymbol = ControlPlaneState::getTableKey("t"_cs, "k"_cs, PARAM_TYPE);
+    std::vector<std::reference_wrapper<ActionProfileTableMatchEntry>> entries;
+    for (uint32_t memberId = 1; memberId <= 2; ++memberId) {
+        ActionProfileReference reference{ActionProfileReference::Kind::kMember, memberId};
+        auto &entry = *new ActionProfileTableMatchEntry(
+            reference, profile.computeActionAssignment("t"_cs, reference).value(), 0,
+            {{*keySymbol, *IR::Constant::get(PARAM_TYPE, static_cast<int>(memberId))}});
+        ASSERT_EQ(table.addTableEntry(entry, false), EXIT_SUCCESS);
+        entries.emplace_back(entry);
+    }
+    ControlPlaneConstraints constraints{{"t"_cs, table}, {"p"_cs, profile}};
+
+    ASSERT_EQ(profile.addMember(1, createMember("a2"_cs, 3), true), EXIT_SUCCESS);
+    SymbolSet symbolSet;
+    ASSERT_EQ(profile.updateAssociatedTables(constraints, profile.referencesToMember(1), symbolSet),
+              EXIT_SUCCESS);
+    // The action choice and the arguments of the previous and the new action.
+    EXPECT_EQ(symbolSet.size(), 3U);
+    const auto *actionArgument =
+        ControlPlaneState::getTableActionArgument("t"_cs, "a2"_cs, "p"_cs, PARAM_TYPE);
+    auto firstArgument = entries[0].get().z3ActionAssignment().get(*actionArgument);
+    ASSERT_TRUE(firstArgument.has_value());
+    EXPECT_EQ(firstArgument->get_numeral_uint64(), 3U);
+    auto secondArgument = entries[1].get().z3ActionAssignment().get(*actionArgument);
+    ASSERT_TRUE(secondArgument.has_value());
+    EXPECT_EQ(secondArgument->get_numeral_uint64(), 2U);
+
+    EXPECT_TRUE(profile.isReferenced(constraints, profile.referencesToMember(2)));
+    ASSERT_EQ(table.deleteTableEntry(entries[1].get()), 1U);
+    EXPECT_FALSE(profile.isReferenced(constraints, profile.referencesToMember(2)));
+}
+
+// Modifying only the argument of a member marks the argument as changed.
+TEST_F(P4FlayTest, ActionProfile03) {
+    auto &profile = *new ActionProfile("p"_cs, {"t"_cs});
+    ASSERT_EQ(profile.addMember(1, createMember("a1"_cs, 1), false), EXIT_SUCCESS);
+
+    ControlPlaneAssignmentSet defaultAction;
+    defaultAction.emplace(*ControlPlaneState::getTableActionChoice("t"_cs),
+                          *IR::StringLiteral::get("*NONE*"_cs));
+    auto &table = *new TableConfiguration("t"_cs, TableDefaultAction(defaultAction), {});
+    const auto *keySymbol = ControlPlaneState::getTableKey("t"_cs, "k"_cs, PARAM_TYPE);
+    ActionProfileReference reference{ActionProfileReference::Kind::kMember, 1};
+    auto &entry = *new ActionProfileTableMatchEntry(
+        reference, profile.computeActionAssignment("t"_cs, reference).value(), 0,
+        {{*keySymbol, *IR::Constant::get(PARAM_TYPE, 1)}});
+    ASSERT_EQ(table.addTableEntry(entry, false), EXIT_SUCCESS);
+    ControlPlaneConstraints constraints{{"t"_cs, table}, {"p"_cs, profile}};
+
+    ASSERT_EQ(profile.addMember(1, createMember("a1"_cs, 5), true), EXIT_SUCCESS);
+    SymbolSet symbolSet;
+    ASSERT_EQ(profile.updateAssociatedTables(constraints, profile.referencesToMember(1), symbolSet),
+              EXIT_SUCCESS);
+    const auto *actionArgument =
+        ControlPlaneState::getTableActionArgument("t"_cs, "a1"_cs, "p"_cs, PARAM_TYPE);
+    EXPECT_EQ(symbolSet.count(*actionArgument), 1U);
+    auto argument = entry.z3ActionAssignment().get(*actionArgument);
+    ASSERT_TRUE(argument.has_value());
+    EXPECT_EQ(argument->get_numeral_uint64(), 5U);
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
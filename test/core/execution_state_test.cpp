@@ -0,0 +1,75 @@
+#include "backends/p4tools/modules/flay/core/interpreter/execution_state.h"
+
+#include <gtest/gtest.h>
+
+#include "backends/p4tools/common/lib/variables.h"
+#include "backends/p4tools/modules/flay/core/lib/simplify_expression.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+using P4::P4Tools::Flay::ExecutionState;
+
+const auto *const FIELD_TYPE = IR::Type_Bits::get(8);
+
+IR::StateVariable getField(cstring name) {
+    return IR::StateVariable(new IR::Member(FIELD_TYPE, new IR::PathExpression("hdr"), name));
+}
+
+/// @returns the value of field @param name in @param state or -1 if the value is not constant.
+int getValue(const ExecutionState &state, cstring name) {
+    const auto *constant = state.get(getField(name))->to<IR::Constant>();
+    return constant != nullptr ? constant->asInt() : -1;
+}
+
+// Merging a clone back merges the variables written in either state since the clone was taken.
+TEST_F(P4FlayTest, ExecutionState01) {
+    auto &state = ExecutionState::create(new IR::P4Program());
+    state.set(getField("a"_cs), IR::Constant::get(FIELD_TYPE, 1));
+    state.set(getField("b"_cs), IR::Constant::get(FIELD_TYPE, 2));
+    state.set(getField("c"_cs), IR::Constant::get(FIELD_TYPE, 3));
+    const auto *cond = ToolsVariables::getSymbolicVariable(IR::Type_Boolean::get(), "cond"_cs);
+
+    auto &branchState = state.clone();
+    branchState.pushExecutionCondition(cond);
+    branchState.set(getField("a"_cs), IR::Constant::get(FIELD_TYPE, 4));
+    // The state is written after the clone was taken, the clone must not see this write.
+    state.set(getField("b"_cs), IR::Constant::get(FIELD_TYPE, 5));
+    EXPECT_EQ(getValue(branchState, "b"_cs), 2);
+
+    state.merge(branchState);
+    EXPECT_TRUE(state.get(getField("a"_cs))
+                    ->equiv(*SimplifyExpression::produceSimplifiedMux(
+                        cond, IR::Constant::get(FIELD_TYPE, 4), IR::Constant::get(FIELD_TYPE, 1))));
+    EXPECT_TRUE(state.get(getField("b"_cs))
+                    ->equiv(*SimplifyExpression::produceSimplifiedMux(
+                        cond, IR::Constant::get(FIELD_TYPE, 2), IR::Constant::get(FIELD_TYPE, 5))));
+    EXPECT_EQ(getValue(state, "c"_cs), 3);
+}
+
+// Clones share the annotations which existed at the time of the clone.
+TEST_F(P4FlayTest, ExecutionState02) {
+    auto &state = ExecutionState::create(new IR::P4Program());
+    const auto *first = new IR::Constant(1);
+    const auto *second = new IR::Constant(2);
+    const auto *third = new IR::Constant(3);
+    state.addReachabilityMapping(first, IR::BoolLiteral::get(true));
+
+    auto &branchState = state.clone();
+    branchState.addReachabilityMapping(second, IR::BoolLiteral::get(true));
+    state.addReachabilityMapping(third, IR::BoolLiteral::get(true));
+    EXPECT_EQ(branchState.nodeAnnotationMap().reachabilityMap().size(), 2U);
+    EXPECT_EQ(branchState.nodeAnnotationMap().reachabilityMap().count(third), 0U);
+
+    state.merge(branchState);
+    EXPECT_EQ(state.nodeAnnotationMap().reachabilityMap().size(), 3U);
+    EXPECT_EQ(branchState.nodeAnnotationMap().reachabilityMap().size(), 2U);
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
@@ -0,0 +1,73 @@
+#include "backends/p4tools/modules/flay/core/lib/expression_interner.h"
+
+#include <gtest/gtest.h>
+
+#include "backends/p4tools/common/lib/variables.h"
+#include "backends/p4tools/modules/flay/core/lib/simplify_expression.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+
+const auto *const VALUE_TYPE = IR::Type_Bits::get(8);
+
+const IR::Expression *getCondition(cstring name) {
+    return ToolsVariables::getSymbolicVariable(IR::Type_Boolean::get(), name);
+}
+
+const IR::Expression *getValue(cstring name) {
+    return ToolsVariables::getSymbolicVariable(VALUE_TYPE, name);
+}
+
+// Structurally equal expressions which were built independently share one node.
+TEST_F(P4FlayTest, ExpressionInterner01) {
+    ExpressionInterner::clear();
+    auto buildMux = [](int value) {
+        return new IR::Mux(VALUE_TYPE, new IR::LAnd(getCondition("x"_cs), getCondition("y"_cs)),
+                           new IR::Add(getValue("a"_cs), IR::Constant::get(VALUE_TYPE, value)),
+                           getValue("b"_cs));
+    };
+    const auto *first = ExpressionInterner::intern(buildMux(1));
+    const auto *second = ExpressionInterner::intern(buildMux(1));
+    const auto *third = ExpressionInterner::intern(buildMux(2));
+    EXPECT_EQ(first, second);
+    EXPECT_NE(first, third);
+    EXPECT_TRUE(first->equiv(*buildMux(1)));
+
+    // Sub-expressions are shared as well.
+    const auto *firstMux = first->checkedTo<IR::Mux>();
+    const auto *thirdMux = third->checkedTo<IR::Mux>();
+    EXPECT_EQ(firstMux->e0, thirdMux->e0);
+    EXPECT_EQ(firstMux->e2, thirdMux->e2);
+    EXPECT_NE(firstMux->e1, thirdMux->e1);
+
+    // Members with different names are different expressions.
+    const auto *path = new IR::PathExpression("hdr");
+    EXPECT_NE(ExpressionInterner::intern(new IR::Member(VALUE_TYPE, path, "f1")),
+              ExpressionInterner::intern(new IR::Member(VALUE_TYPE, path, "f2")));
+}
+
+// Simplifications are memoized per interned expression.
+TEST_F(P4FlayTest, ExpressionInterner02) {
+    ExpressionInterner::clear();
+    auto buildMux = []() {
+        const auto *cond = getCondition("x"_cs);
+        return new IR::Mux(VALUE_TYPE, cond,
+                           new IR::Mux(VALUE_TYPE, cond, getValue("a"_cs), getValue("b"_cs)),
+                           getValue("b"_cs));
+    };
+    const auto *first = SimplifyExpression::simplifyInterned(buildMux());
+    EXPECT_EQ(ExpressionInterner::statistics().simplificationHits, 0U);
+    const auto *second = SimplifyExpression::simplifyInterned(buildMux());
+    EXPECT_EQ(ExpressionInterner::statistics().simplificationHits, 1U);
+    EXPECT_EQ(first, second);
+    EXPECT_TRUE(first->equiv(*SimplifyExpression::simplify(buildMux())));
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
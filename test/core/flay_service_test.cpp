@@ -0,0 +1,172 @@
+#include "backends/p4tools/modules/flay/core/specialization/flay_service.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "backends/p4tools/common/compiler/compiler_result.h"
+#include "backends/p4tools/modules/flay/core/interpreter/compiler_result.h"
+#include "backends/p4tools/modules/flay/core/interpreter/program_info.h"
+#include "backends/p4tools/modules/flay/core/lib/incremental_analysis.h"
+#include "backends/p4tools/modules/flay/options.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "control-plane/p4RuntimeSerializer.h"
+#include "ir/ir.h"
+#include "lib/error.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+using P4::P4Tools::Flay::ControlPlaneUpdate;
+using P4::P4Tools::Flay::FlayCompilerResult;
+using P4::P4Tools::Flay::FlayOptions;
+using P4::P4Tools::Flay::FlayServiceBase;
+using P4::P4Tools::Flay::FlayServiceStatistics;
+using P4::P4Tools::Flay::IncrementalAnalysisMap;
+using P4::P4Tools::Flay::P4RuntimeControlPlaneUpdate;
+using P4::P4Tools::Flay::ProgramInfo;
+
+/// @returns a program with an unchanged header declaration and an action named "a" containing
+/// @param statementCount assignments.
+const IR::P4Program *createProgram(size_t statementCount) {
+    static const auto *header = new IR::Type_Header(
+        "h"_cs, IR::IndexedVector<IR::StructField>(
+                    {new IR::StructField("f"_cs, IR::Type_Bits::get(8))}));
+    IR::IndexedVector<IR::StatOrDecl> components;
+    for (size_t idx = 0; idx < statementCount; idx++) {
+        const auto *value = IR::Constant::get(IR::Type_Bits::get(8), idx);
+        components.push_back(
+            new IR::AssignmentStatement(new IR::PathExpression(new IR::Path("x"_cs)), value));
+    }
+    const auto *action =
+        new IR::P4Action("a"_cs, new IR::ParameterList(), new IR::BlockStatement(components));
+    return new IR::P4Program(IR::Vector<IR::Node>({header, action}));
+}
+
+/// @returns an analysis which starts with @param statementCount statements and removes one
+/// statement from the program with every specialization.
+std::unique_ptr<TestAnalysis> createShrinkingAnalysis(const FlayCompilerResult &compilerResult,
+                                                      const ProgramInfo &programInfo,
+                                                      size_t statementCount) {
+    auto analysis =
+        std::make_unique<TestAnalysis>(FlayOptions::get(), compilerResult, programInfo, true);
+    analysis->setSpecialization([statementCount](const IR::P4Program & /*program*/) mutable {
+        if (statementCount > 0) {
+            statementCount--;
+        }
+        return createProgram(statementCount);
+    });
+    return analysis;
+}
+
+// With a check interval of 1, the statistics are recounted after every applied batch of updates.
+// The recount agrees with the incremental count, which only recounts the changed action.
+TEST_F(P4FlayTest, FlayService01) {
+    const auto *program = createProgram(5);
+    FlayCompilerResult compilerResult(
+        CompilerResult(*program), *program,
+        P4::P4RuntimeAPI{new p4::config::v1::P4Info(), new p4::v1::WriteRequest()}, {});
+    TestProgramInfo programInfo(compilerResult);
+    IncrementalAnalysisMap analysisMap;
+    analysisMap.emplace("shrinking", createShrinkingAnalysis(compilerResult, programInfo, 5));
+    FlayServiceBase service(compilerResult, std::move(analysisMap));
+    service.setStatisticsCheckInterval(1);
+
+    p4::v1::Update update;
+    P4RuntimeControlPlaneUpdate controlPlaneUpdate(update);
+    std::vector<const ControlPlaneUpdate *> controlPlaneUpdates = {&controlPlaneUpdate,
+                                                                   &controlPlaneUpdate};
+    ASSERT_EQ(service.processControlPlaneUpdate(controlPlaneUpdate), EXIT_SUCCESS);
+    ASSERT_EQ(service.processControlPlaneUpdate(controlPlaneUpdates), EXIT_SUCCESS);
+    ASSERT_EQ(service.processControlPlaneUpdate(controlPlaneUpdate), EXIT_SUCCESS);
+
+    // The initial specialization removed one statement and every batch removed another one.
+    auto statisticsMap = service.computeFlayServiceStatistics();
+    const auto &statistics = statisticsMap.at("main")->checkedTo<FlayServiceStatistics>();
+    EXPECT_EQ(statistics.statementCountBefore, 5U);
+    EXPECT_EQ(statistics.statementCountAfter, 1U);
+    EXPECT_EQ(statistics.numUpdatesProcessed, 4U);
+    EXPECT_EQ(statistics.updateLatencies.size(), 3U);
+}
+
+// A rejected update is skipped. The other updates of its batch are applied with a single
+// specialization.
+TEST_F(P4FlayTest, FlayService02) {
+    const auto *program = createProgram(5);
+    FlayCompilerResult compilerResult(
+        CompilerResult(*program), *program,
+        P4::P4RuntimeAPI{new p4::config::v1::P4Info(), new p4::v1::WriteRequest()}, {});
+    TestProgramInfo programInfo(compilerResult);
+    IncrementalAnalysisMap analysisMap;
+    analysisMap.emplace("shrinking", createShrinkingAnalysis(compilerResult, programInfo, 5));
+    FlayServiceBase service(compilerResult, std::move(analysisMap));
+
+    p4::v1::Update modify;
+    modify.set_type(p4::v1::Update::MODIFY);
+    p4::v1::Update deletion;
+    deletion.set_type(p4::v1::Update::DELETE);
+    P4RuntimeControlPlaneUpdate modifyUpdate(modify);
+    P4RuntimeControlPlaneUpdate deleteUpdate(deletion);
+    std::vector<const ControlPlaneUpdate *> controlPlaneUpdates = {&modifyUpdate, &deleteUpdate,
+                                                                   &modifyUpdate};
+    std::set<size_t> rejectedUpdates;
+    ASSERT_EQ(service.processControlPlaneUpdate(controlPlaneUpdates, rejectedUpdates),
+              EXIT_SUCCESS);
+    EXPECT_EQ(rejectedUpdates, std::set<size_t>({1}));
+
+    // Without a list of rejected updates, the rejection fails the batch.
+    std::vector<const ControlPlaneUpdate *> deleteUpdates = {&deleteUpdate};
+    EXPECT_EQ(service.processControlPlaneUpdate(deleteUpdates), EXIT_FAILURE);
+    // The rejections are reported, but do not count against the context of the service.
+    EXPECT_EQ(errorCount(), 0U);
+
+    auto statisticsMap = service.computeFlayServiceStatistics();
+    const auto &statistics = statisticsMap.at("main")->checkedTo<FlayServiceStatistics>();
+    EXPECT_EQ(statistics.statementCountAfter, 3U);
+    EXPECT_EQ(statistics.numUpdatesProcessed, 2U);
+}
+
+// Only the latencies of the most recent batches are kept. The sum and the maximum cover all
+// batches.
+TEST_F(P4FlayTest, FlayService03) {
+    const auto *program = createProgram(1);
+    FlayCompilerResult compilerResult(
+        CompilerResult(*program), *program,
+        P4::P4RuntimeAPI{new p4::config::v1::P4Info(), new p4::v1::WriteRequest()}, {});
+    TestProgramInfo programInfo(compilerResult);
+    IncrementalAnalysisMap analysisMap;
+    analysisMap.emplace("unchanged", std::make_unique<TestAnalysis>(
+                                         FlayOptions::get(), compilerResult, programInfo, false));
+    FlayServiceBase service(compilerResult, std::move(analysisMap));
+
+    p4::v1::Update update;
+    P4RuntimeControlPlaneUpdate controlPlaneUpdate(update);
+    std::vector<const ControlPlaneUpdate *> controlPlaneUpdates = {&controlPlaneUpdate};
+    auto batchCount = FlayServiceBase::kUpdateLatencyWindow + 2;
+    for (size_t idx = 0; idx < batchCount; ++idx) {
+        ASSERT_EQ(service.processControlPlaneUpdate(controlPlaneUpdates), EXIT_SUCCESS);
+    }
+
+    auto statisticsMap = service.computeFlayServiceStatistics();
+    const auto &statistics = statisticsMap.at("main")->checkedTo<FlayServiceStatistics>();
+    EXPECT_EQ(statistics.numUpdateBatches, batchCount);
+    ASSERT_EQ(statistics.updateLatencies.size(), FlayServiceBase::kUpdateLatencyWindow);
+    uint64_t recentLatency = 0;
+    for (auto latency : statistics.updateLatencies) {
+        EXPECT_LE(latency, statistics.maxUpdateLatency);
+        recentLatency += latency;
+    }
+    EXPECT_LE(recentLatency, statistics.totalUpdateLatency);
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
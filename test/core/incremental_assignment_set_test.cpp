@@ -0,0 +1,141 @@
+#include "backends/p4tools/modules/flay/core/specialization/z3/incremental_assignment_set.h"
+
+#include <gtest/gtest.h>
+
+#include <z3++.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "backends/p4tools/common/lib/variables.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "ir/ir.h"
+#include "lib/error.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+using P4::P4Tools::Flay::ControlPlaneAssignmentSet;
+using P4::P4Tools::Flay::ControlPlaneConstraints;
+using P4::P4Tools::Flay::ControlPlaneItem;
+using P4::P4Tools::Flay::IncrementalZ3AssignmentSet;
+using P4::P4Tools::Flay::SymbolSet;
+using P4::P4Tools::Flay::Z3ControlPlaneAssignmentSet;
+using P4::P4Tools::Flay::Z3ControlPlaneItem;
+
+const IR::SymbolicVariable &getVariable(cstring name) {
+    return *ToolsVariables::getSymbolicVariable(IR::Type_Bits::get(8), name);
+}
+
+/// A control plane item which assigns fixed values to variables.
+class FixedAssignments : public Z3ControlPlaneItem {
+    std::vector<std::pair<cstring, int>> _assignments;
+
+ public:
+    explicit FixedAssignments(std::vector<std::pair<cstring, int>> assignments)
+        : _assignments(std::move(assignments)) {}
+
+    /// Replace the assigned values with @param assignments.
+    void setAssignments(std::vector<std::pair<cstring, int>> assignments) {
+        _assignments = std::move(assignments);
+    }
+
+    bool operator<(const ControlPlaneItem &other) const override { return this < &other; }
+
+    [[nodiscard]] ControlPlaneAssignmentSet computeControlPlaneAssignments() const override {
+        return {};
+    }
+
+    [[nodiscard]] Z3ControlPlaneAssignmentSet computeZ3ControlPlaneAssignments() const override {
+        Z3ControlPlaneAssignmentSet assignmentSet;
+        for (const auto &[name, value] : _assignments) {
+            assignmentSet.set(getVariable(name),
+                              Z3Cache::set(IR::Constant::get(IR::Type_Bits::get(8), value)));
+        }
+        return assignmentSet;
+    }
+
+    DECLARE_TYPEINFO(FixedAssignments);
+};
+
+/// @returns the value assigned to @param name in @param assignmentSet.
+uint64_t getValue(const Z3ControlPlaneAssignmentSet &assignmentSet, cstring name) {
+    auto assignment = assignmentSet.get(getVariable(name));
+    EXPECT_TRUE(assignment.has_value());
+    return assignment.has_value() ? assignment.value().get_numeral_uint64() : 0;
+}
+
+/// Checks that @param assignmentSet has the same assignments as a full rebuild from
+/// @param constraints.
+void expectEqualToRebuild(const Z3ControlPlaneAssignmentSet &assignmentSet,
+                          const ControlPlaneConstraints &constraints) {
+    IncrementalZ3AssignmentSet rebuiltSet;
+    const auto &expected = rebuiltSet.rebuild(constraints);
+    EXPECT_EQ(assignmentSet.size(), expected.size());
+    expected.forEach([&assignmentSet](const IR::SymbolicVariable &symbol,
+                                      const z3::expr &assignment) {
+        auto actual = assignmentSet.get(symbol);
+        ASSERT_TRUE(actual.has_value());
+        EXPECT_TRUE(z3::eq(actual.value(), assignment));
+    });
+}
+
+// Updating, adding, and removing constraints yields the same set as a rebuild.
+TEST_F(P4FlayTest, IncrementalAssignmentSet01) {
+    FixedAssignments first({{"a"_cs, 1}, {"x"_cs, 10}});
+    FixedAssignments second({{"b"_cs, 2}});
+    ControlPlaneConstraints constraints{{"first"_cs, first}, {"second"_cs, second}};
+
+    IncrementalZ3AssignmentSet assignmentSet;
+    assignmentSet.rebuild(constraints);
+    expectEqualToRebuild(assignmentSet.assignmentSet(), constraints);
+
+    // Only the second constraint is recomputed. The assignments of the first one are kept.
+    second.setAssignments({{"b"_cs, 3}, {"y"_cs, 4}});
+    SymbolSet changedSymbols{getVariable("b"_cs)};
+    assignmentSet.update(changedSymbols, constraints);
+    EXPECT_EQ(getValue(assignmentSet.assignmentSet(), "x"_cs), 10U);
+    EXPECT_EQ(getValue(assignmentSet.assignmentSet(), "b"_cs), 3U);
+    expectEqualToRebuild(assignmentSet.assignmentSet(), constraints);
+
+    // A new constraint is merged, a removed constraint loses all of its assignments.
+    FixedAssignments third({{"c"_cs, 5}});
+    constraints.emplace("third"_cs, third);
+    constraints.erase("first"_cs);
+    changedSymbols = {getVariable("a"_cs)};
+    const auto &result = assignmentSet.update(changedSymbols, constraints);
+    EXPECT_FALSE(result.contains(getVariable("a"_cs)));
+    EXPECT_FALSE(result.contains(getVariable("x"_cs)));
+    EXPECT_EQ(getValue(result, "c"_cs), 5U);
+    expectEqualToRebuild(result, constraints);
+    EXPECT_EQ(errorCount(), 0U);
+}
+
+// A variable assigned by two constraints is an error, both in a rebuild and in an update.
+TEST_F(P4FlayTest, IncrementalAssignmentSet02) {
+    FixedAssignments first({{"a"_cs, 1}});
+    FixedAssignments second({{"b"_cs, 2}});
+    ControlPlaneConstraints constraints{{"first"_cs, first}, {"second"_cs, second}};
+
+    IncrementalZ3AssignmentSet assignmentSet;
+    assignmentSet.rebuild(constraints);
+    EXPECT_EQ(errorCount(), 0U);
+
+    second.setAssignments({{"a"_cs, 2}});
+    SymbolSet changedSymbols{getVariable("b"_cs)};
+    assignmentSet.update(changedSymbols, constraints);
+    EXPECT_EQ(errorCount(), 1U);
+    // The variable stays with the constraint which assigned it first.
+    EXPECT_EQ(getValue(assignmentSet.assignmentSet(), "a"_cs), 1U);
+
+    assignmentSet.rebuild(constraints);
+    EXPECT_EQ(errorCount(), 2U);
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
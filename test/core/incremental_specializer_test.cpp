@@ -0,0 +1,161 @@
+#include "backends/p4tools/modules/flay/core/specialization/incremental_specializer.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#include "backends/p4tools/modules/flay/core/specialization/passes/specializer.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/toP4/toP4.h"
+#include "frontends/parsers/parserDriver.h"
+#include "ir/ir.h"
+#include "lib/error.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+using P4::P4Tools::Flay::AbstractReachabilityMap;
+using P4::P4Tools::Flay::AbstractSubstitutionMap;
+using P4::P4Tools::Flay::ControlPlaneConstraints;
+using P4::P4Tools::Flay::ExpressionSet;
+using P4::P4Tools::Flay::FlaySpecializer;
+using P4::P4Tools::Flay::IncrementalSpecializer;
+using P4::P4Tools::Flay::NodeSet;
+using P4::P4Tools::Flay::SourceIdCmp;
+using P4::P4Tools::Flay::SymbolSet;
+
+/// A reachability map whose results are set by the test.
+class FixedReachabilityMap : public AbstractReachabilityMap {
+    std::map<const IR::Node *, bool, SourceIdCmp> _reachability;
+
+ public:
+    /// Set the reachability of @param node to @param isReachable.
+    void setReachability(const IR::Node *node, bool isReachable) {
+        _reachability.insert_or_assign(node, isReachable);
+        recordChange(node);
+    }
+
+    std::optional<bool> recomputeReachability(
+        const ControlPlaneConstraints & /*controlPlaneConstraints*/) override {
+        return false;
+    }
+
+    std::optional<bool> recomputeReachability(
+        const SymbolSet & /*symbolSet*/,
+        const ControlPlaneConstraints & /*controlPlaneConstraints*/) override {
+        return false;
+    }
+
+    std::optional<bool> recomputeReachability(
+        const NodeSet & /*targetNodes*/,
+        const ControlPlaneConstraints & /*controlPlaneConstraints*/) override {
+        return false;
+    }
+
+    std::optional<bool> isNodeReachable(const IR::Node *node) const override {
+        auto it = _reachability.find(node);
+        if (it == _reachability.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+};
+
+/// A substitution map which never replaces an expression.
+class EmptySubstitutionMap : public AbstractSubstitutionMap {
+ public:
+    std::optional<bool> recomputeSubstitution(
+        const ControlPlaneConstraints & /*controlPlaneConstraints*/) override {
+        return false;
+    }
+
+    std::optional<bool> recomputeSubstitution(
+        const SymbolSet & /*symbolSet*/,
+        const ControlPlaneConstraints & /*controlPlaneConstraints*/) override {
+        return false;
+    }
+
+    std::optional<bool> recomputeSubstitution(
+        const ExpressionSet & /*targetExpressions*/,
+        const ControlPlaneConstraints & /*controlPlaneConstraints*/) override {
+        return false;
+    }
+
+    std::optional<const IR::Literal *> isExpressionConstant(
+        const IR::Expression * /*expression*/) const override {
+        return std::nullopt;
+    }
+};
+
+/// Two actions with a conditional each.
+constexpr const char *kProgram = R"(
+action a(inout bit<8> x) {
+    if (x == 1) { x = 2; } else { x = 3; }
+}
+action c(inout bit<8> y) {
+    if (y == 4) { y = 5; }
+}
+)";
+
+/// @returns the ToP4 output for the whole @param program.
+std::string printProgram(const IR::P4Program &program) {
+    std::stringstream output;
+    P4::ToP4 toP4(&output, false);
+    program.apply(toP4);
+    return output.str();
+}
+
+/// @returns the if statement in the body of @param action.
+const IR::IfStatement *getIfStatement(const IR::P4Action &action) {
+    return action.body->components.at(0)->checkedTo<IR::IfStatement>();
+}
+
+// After every change, respecializing the affected declarations yields the same program as
+// specializing the whole program. This includes code which is shared between declarations.
+TEST_F(P4FlayTest, IncrementalSpecializer01) {
+    const auto *parsedProgram =
+        P4::parseP4String(kProgram, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_NE(parsedProgram, nullptr);
+    ASSERT_EQ(parsedProgram->objects.size(), 2U);
+    const auto *actionA = parsedProgram->objects.at(0)->checkedTo<IR::P4Action>();
+    const auto *actionC = parsedProgram->objects.at(1)->checkedTo<IR::P4Action>();
+    // A copy of action "a" shares its body and therefore the source information of its nodes.
+    auto *actionB = actionA->clone();
+    actionB->name = IR::ID("b"_cs);
+    const auto *program = new IR::P4Program(parsedProgram->srcInfo,
+                                            IR::Vector<IR::Node>({actionA, actionB, actionC}));
+
+    P4::ReferenceMap refMap;
+    FixedReachabilityMap reachabilityMap;
+    EmptySubstitutionMap substitutionMap;
+    IncrementalSpecializer specializer(refMap, reachabilityMap, substitutionMap);
+    specializer.specialize(*program);
+
+    auto expectFullSpecialization = [&]() {
+        const auto *respecializedProgram =
+            specializer.respecialize(*program, reachabilityMap.takeChangedNodes());
+        FlaySpecializer flaySpecializer(refMap, reachabilityMap, substitutionMap);
+        const auto *fullProgram = program->apply(flaySpecializer);
+        ASSERT_NE(fullProgram, nullptr);
+        EXPECT_EQ(printProgram(*respecializedProgram),
+                  printProgram(*fullProgram->checkedTo<IR::P4Program>()));
+    };
+
+    reachabilityMap.setReachability(getIfStatement(*actionA), true);
+    expectFullSpecialization();
+    reachabilityMap.setReachability(getIfStatement(*actionC), false);
+    expectFullSpecialization();
+    reachabilityMap.setReachability(getIfStatement(*actionA), false);
+    expectFullSpecialization();
+    EXPECT_EQ(errorCount(), 0U);
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
@@ -0,0 +1,145 @@
+#include "backends/p4tools/modules/flay/core/lib/native_simplifier.h"
+
+#include <gtest/gtest.h>
+
+#include <z3++.h>
+
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "backends/p4tools/common/lib/variables.h"
+#include "backends/p4tools/modules/flay/core/lib/simplify_expression.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+
+const auto *const VALUE_TYPE = IR::Type_Bits::get(8);
+
+const IR::Expression *getBool(cstring name) {
+    return ToolsVariables::getSymbolicVariable(IR::Type_Boolean::get(), name);
+}
+
+const IR::Expression *getValue(cstring name) {
+    return ToolsVariables::getSymbolicVariable(VALUE_TYPE, name);
+}
+
+std::string print(const IR::Expression *expression) {
+    std::stringstream stringResult;
+    expression->dbprint(stringResult);
+    return stringResult.str();
+}
+
+/// Generates random expressions over a few boolean and bit<8> variables.
+class ExpressionGenerator {
+    std::mt19937 _rng;
+
+    size_t choose(size_t bound) {
+        return std::uniform_int_distribution<size_t>(0, bound - 1)(_rng);
+    }
+
+ public:
+    explicit ExpressionGenerator(uint32_t seed) : _rng(seed) {}
+
+    const IR::Expression *generateBool(size_t depth) {
+        if (depth == 0 || choose(4) == 0) {
+            if (choose(4) == 0) {
+                return IR::BoolLiteral::get(choose(2) == 0);
+            }
+            return getBool(std::vector<cstring>{"X"_cs, "Y"_cs, "Z"_cs}[choose(3)]);
+        }
+        switch (choose(6)) {
+            case 0:
+                return new IR::LAnd(generateBool(depth - 1), generateBool(depth - 1));
+            case 1:
+                return new IR::LOr(generateBool(depth - 1), generateBool(depth - 1));
+            case 2:
+                return new IR::LNot(generateBool(depth - 1));
+            case 3:
+                return new IR::Equ(generateValue(depth - 1), generateValue(depth - 1));
+            case 4:
+                return new IR::Neq(generateBool(depth - 1), generateBool(depth - 1));
+            default:
+                return new IR::Mux(IR::Type_Boolean::get(), generateBool(depth - 1),
+                                   generateBool(depth - 1), generateBool(depth - 1));
+        }
+    }
+
+    const IR::Expression *generateValue(size_t depth) {
+        if (depth == 0 || choose(3) == 0) {
+            if (choose(3) == 0) {
+                return IR::Constant::get(VALUE_TYPE, static_cast<int>(choose(3)));
+            }
+            return getValue(std::vector<cstring>{"A"_cs, "B"_cs}[choose(2)]);
+        }
+        if (choose(4) == 0) {
+            return new IR::Add(VALUE_TYPE, generateValue(depth - 1), generateValue(depth - 1));
+        }
+        return new IR::Mux(VALUE_TYPE, generateBool(depth - 1), generateValue(depth - 1),
+                           generateValue(depth - 1));
+    }
+};
+
+/// @returns true if @param left and @param right are equivalent for all variable assignments.
+bool isEquivalent(const IR::Expression *left, const IR::Expression *right) {
+    z3::solver solver(Z3Cache::context());
+    solver.add(Z3Cache::set(left) != Z3Cache::set(right));
+    return solver.check() == z3::unsat;
+}
+
+// The native simplifier produces the same results as the compiler passes on the Mux rewrites.
+TEST_F(P4FlayTest, NativeSimplifier01) {
+    const auto *xVar = getBool("X"_cs);
+    const auto *yVar = getBool("Y"_cs);
+    const auto *aVar = getValue("A"_cs);
+    const auto *bVar = getValue("B"_cs);
+
+    const std::vector<const IR::Expression *> expressions = {
+        new IR::Mux(xVar, new IR::Mux(xVar, aVar, bVar), bVar),
+        new IR::Mux(xVar, new IR::Mux(new IR::LNot(xVar), aVar, bVar), bVar),
+        new IR::Mux(xVar, new IR::Mux(new IR::LOr(yVar, xVar), aVar, bVar), bVar),
+        new IR::Mux(xVar, new IR::Mux(yVar, aVar, bVar), bVar),
+        new IR::Mux(xVar, new IR::Mux(yVar, bVar, aVar), bVar),
+        new IR::Mux(xVar, aVar, new IR::Mux(yVar, aVar, bVar)),
+        new IR::Mux(xVar, aVar, new IR::Mux(yVar, bVar, aVar)),
+    };
+    for (const auto *expression : expressions) {
+        EXPECT_EQ(print(NativeSimplifier::simplify(expression)),
+                  print(SimplifyExpression::simplify(expression)));
+    }
+
+    // Logical operators and comparisons of literals are folded.
+    EXPECT_EQ(print(NativeSimplifier::simplify(new IR::LAnd(
+                  xVar, new IR::Equ(IR::Constant::get(VALUE_TYPE, 1),
+                                    IR::Constant::get(VALUE_TYPE, 1))))),
+              print(xVar));
+    EXPECT_EQ(print(NativeSimplifier::simplify(new IR::LOr(new IR::LNot(xVar), xVar))),
+              print(IR::BoolLiteral::get(true)));
+}
+
+// Randomized differential test: the results of both simplifiers are equivalent to the input.
+TEST_F(P4FlayTest, NativeSimplifier02) {
+    ExpressionGenerator generator(42);
+    for (size_t idx = 0; idx < 200; ++idx) {
+        const auto *expression =
+            idx % 2 == 0 ? generator.generateBool(5) : generator.generateValue(5);
+        const auto *native = NativeSimplifier::simplify(expression);
+        const auto *passes = SimplifyExpression::simplify(expression);
+        EXPECT_TRUE(isEquivalent(expression, native))
+            << print(expression) << " simplified to " << print(native);
+        EXPECT_TRUE(isEquivalent(native, passes))
+            << print(native) << " differs from " << print(passes);
+    }
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
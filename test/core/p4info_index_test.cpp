@@ -0,0 +1,86 @@
+#include "backends/p4tools/modules/flay/core/control_plane/p4info_index.h"
+
+#include <google/protobuf/text_format.h>
+#include <gtest/gtest.h>
+
+#include "backends/p4tools/common/control_plane/symbolic_variables.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+using P4::P4Tools::Flay::P4InfoIndex;
+
+constexpr const char *P4INFO = R"(
+tables {
+  preamble { id: 100 name: "ingress.t" }
+  match_fields { id: 1 name: "hdr.eth.dst" bitwidth: 48 match_type: EXACT }
+  match_fields { id: 2 name: "hdr.ipv4.dst" bitwidth: 32 match_type: LPM }
+  match_fields { id: 3 name: "meta.flags" bitwidth: 8 match_type: TERNARY }
+  action_refs { id: 200 }
+}
+actions {
+  preamble { id: 200 name: "ingress.forward" }
+  params { id: 1 name: "port" bitwidth: 9 }
+  params { id: 2 name: "mac" bitwidth: 48 }
+}
+action_profiles { preamble { id: 300 name: "ingress.profile" } }
+externs {
+  extern_type_name: "ActionSelector"
+  instances { preamble { id: 400 name: "ingress.selector" } }
+}
+)";
+
+p4::config::v1::P4Info &parseP4Info() {
+    auto *p4Info = new p4::config::v1::P4Info();
+    EXPECT_TRUE(google::protobuf::TextFormat::ParseFromString(P4INFO, p4Info));
+    return *p4Info;
+}
+
+/// Tables are found by id and name and their key layout follows the P4Info order.
+TEST_F(P4FlayTest, P4InfoIndex01) {
+    P4InfoIndex index(parseP4Info());
+
+    const auto *table = index.findTable(100);
+    ASSERT_NE(table, nullptr);
+    EXPECT_EQ(table, index.findTable("ingress.t"_cs));
+    EXPECT_EQ(table->name, "ingress.t"_cs);
+    EXPECT_EQ(index.findTable(101), nullptr);
+    EXPECT_EQ(index.findTable("ingress.u"_cs), nullptr);
+
+    ASSERT_EQ(table->keyLayout.size(), 3U);
+    const auto &lpmField = table->keyLayout[1];
+    EXPECT_EQ(lpmField.name, "hdr.ipv4.dst"_cs);
+    EXPECT_EQ(lpmField.matchType, p4::config::v1::MatchField::LPM);
+    EXPECT_EQ(lpmField.type, IR::Type_Bits::get(32));
+    EXPECT_TRUE(lpmField.keySymbol->equiv(*ControlPlaneState::getTableKey(
+        "ingress.t"_cs, "hdr.ipv4.dst"_cs, IR::Type_Bits::get(32))));
+    EXPECT_EQ(table->findMatchFieldPosition(3), 2U);
+    EXPECT_EQ(table->findMatchFieldPosition(4), std::nullopt);
+}
+
+/// Actions, parameters, and the action profiles and selectors are found by id.
+TEST_F(P4FlayTest, P4InfoIndex02) {
+    P4InfoIndex index(parseP4Info());
+
+    const auto *action = index.findAction(200);
+    ASSERT_NE(action, nullptr);
+    EXPECT_EQ(action->name, "ingress.forward"_cs);
+    EXPECT_EQ(index.findAction(201), nullptr);
+    const auto *param = action->findParam(1);
+    ASSERT_NE(param, nullptr);
+    EXPECT_EQ(param->name, "port"_cs);
+    EXPECT_EQ(param->type, IR::Type_Bits::get(9));
+    EXPECT_EQ(action->findParam(3), nullptr);
+
+    EXPECT_EQ(index.findActionProfileName(300), "ingress.profile"_cs);
+    EXPECT_EQ(index.findActionSelectorName(400), "ingress.selector"_cs);
+    EXPECT_EQ(index.findActionProfileName(400), std::nullopt);
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
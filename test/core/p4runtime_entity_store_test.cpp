@@ -0,0 +1,136 @@
+#include "backends/p4tools/modules/flay/core/control_plane/p4runtime/entity_store.h"
+
+#include <google/protobuf/text_format.h>
+#include <google/protobuf/util/message_differencer.h>
+#include <gtest/gtest.h>
+
+#include "backends/p4tools/modules/flay/test/helpers.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using P4::P4Tools::Flay::P4Runtime::EntityStore;
+
+p4::v1::Update parseUpdate(const char *text) {
+    p4::v1::Update update;
+    EXPECT_TRUE(google::protobuf::TextFormat::ParseFromString(text, &update));
+    return update;
+}
+
+p4::v1::Entity parseEntity(const char *text) {
+    p4::v1::Entity entity;
+    EXPECT_TRUE(google::protobuf::TextFormat::ParseFromString(text, &entity));
+    return entity;
+}
+
+// Entries are identified independently of the order of their match fields and reads follow the
+// P4Runtime wildcard semantics.
+TEST_F(P4FlayTest, P4RuntimeEntityStore01) {
+    EntityStore store;
+    store.apply(parseUpdate(R"(
+type: INSERT
+entity { table_entry {
+  table_id: 100
+  match { field_id: 1 exact { value: "\x01" } }
+  match { field_id: 2 lpm { value: "\x0a\x00\x00\x00" prefix_len: 8 } }
+  action { action { action_id: 200 } }
+} })"));
+    store.apply(parseUpdate(R"(
+type: INSERT
+entity { table_entry {
+  table_id: 101
+  match { field_id: 1 exact { value: "\x02" } }
+  action { action { action_id: 200 } }
+} })"));
+    store.apply(parseUpdate(R"(
+type: INSERT
+entity { action_profile_member { action_profile_id: 300 member_id: 1 } })"));
+    store.apply(parseUpdate(R"(
+type: INSERT
+entity { action_profile_member { action_profile_id: 300 member_id: 2 } })"));
+    ASSERT_EQ(store.size(), 4U);
+
+    // The same entry with reordered match fields overwrites the stored entry.
+    auto modifiedEntry = parseUpdate(R"(
+type: MODIFY
+entity { table_entry {
+  table_id: 100
+  match { field_id: 2 lpm { value: "\x0a\x00\x00\x00" prefix_len: 8 } }
+  match { field_id: 1 exact { value: "\x01" } }
+  action { action { action_id: 201 } }
+} })");
+    store.apply(modifiedEntry);
+    EXPECT_EQ(store.size(), 4U);
+    auto entries = store.read(parseEntity("table_entry { table_id: 100 }"));
+    ASSERT_EQ(entries.size(), 1U);
+    EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(entries[0],
+                                                                   modifiedEntry.entity()));
+
+    EXPECT_EQ(store.read(parseEntity("table_entry {}")).size(), 2U);
+    EXPECT_EQ(store.read(parseEntity("action_profile_member { action_profile_id: 300 }")).size(),
+              2U);
+    EXPECT_EQ(store.read(parseEntity("action_profile_member {}")).size(), 2U);
+    EXPECT_TRUE(store.read(parseEntity("action_profile_group {}")).empty());
+
+    store.apply(parseUpdate(R"(
+type: DELETE
+entity { action_profile_member { action_profile_id: 300 member_id: 1 } })"));
+    auto members = store.read(
+        parseEntity("action_profile_member { action_profile_id: 300 member_id: 2 }"));
+    ASSERT_EQ(members.size(), 1U);
+    EXPECT_EQ(members[0].action_profile_member().member_id(), 2U);
+    EXPECT_EQ(store.size(), 3U);
+}
+
+// The write request of a store deletes the initial entries which were deleted and restores the
+// written entities, members first.
+TEST_F(P4FlayTest, P4RuntimeEntityStore02) {
+    EntityStore store;
+    store.apply(parseUpdate(R"(
+type: INSERT
+entity { table_entry {
+  table_id: 100
+  match { field_id: 1 exact { value: "\x01" } }
+  action { action_profile_member_id: 1 }
+} })"));
+    store.apply(parseUpdate(R"(
+type: INSERT
+entity { action_profile_member { action_profile_id: 300 member_id: 1 } })"));
+    store.apply(parseUpdate(R"(
+type: INSERT
+entity { action_profile_member { action_profile_id: 300 member_id: 2 } })"));
+    store.apply(parseUpdate(R"(
+type: DELETE
+entity { action_profile_member { action_profile_id: 300 member_id: 2 } })"));
+    // The entry was not written before, so it has been installed by the program.
+    auto initialEntry = parseUpdate(R"(
+type: DELETE
+entity { table_entry {
+  table_id: 100
+  match { field_id: 1 exact { value: "\x02" } }
+} })");
+    store.apply(initialEntry);
+    ASSERT_EQ(store.size(), 2U);
+
+    auto request = store.toWriteRequest();
+    ASSERT_EQ(request.updates_size(), 3);
+    EXPECT_EQ(request.updates(0).type(), p4::v1::Update::DELETE);
+    EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(request.updates(0).entity(),
+                                                                   initialEntry.entity()));
+    EXPECT_EQ(request.updates(1).type(), p4::v1::Update::MODIFY);
+    EXPECT_EQ(request.updates(1).entity().action_profile_member().member_id(), 1U);
+    EXPECT_EQ(request.updates(2).type(), p4::v1::Update::MODIFY);
+    EXPECT_EQ(request.updates(2).entity().table_entry().table_id(), 100U);
+
+    // Replaying the request into an empty store restores the written entities.
+    EntityStore restoredStore;
+    for (const auto &update : request.updates()) {
+        restoredStore.apply(update);
+    }
+    EXPECT_EQ(restoredStore.size(), 2U);
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
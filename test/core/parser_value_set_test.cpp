@@ -0,0 +1,103 @@
+#include "backends/p4tools/modules/flay/core/control_plane/control_plane_objects.h"
+
+#include <gtest/gtest.h>
+
+#include <z3++.h>
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "backends/p4tools/common/lib/variables.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+using P4::P4Tools::Flay::ParserValueSet;
+using P4::P4Tools::Flay::ParserValueSetMember;
+
+const auto *const KEY_TYPE = IR::Type_Bits::get(8);
+
+/// @returns the membership test of @param key for the configured @param members.
+z3::expr computeMembership(const IR::Expression *key,
+                           const std::vector<ParserValueSetMember> &members) {
+    auto membership = Z3Cache::context().bool_val(false);
+    for (const auto &member : members) {
+        const auto *maskedKey = new IR::BAnd(key, IR::Constant::get(KEY_TYPE, member.mask));
+        const auto *value = IR::Constant::get(KEY_TYPE, member.value);
+        membership = membership || Z3Cache::set(new IR::Equ(maskedKey, value));
+    }
+    return membership;
+}
+
+// Ranges are split into prefixes and members are merged into canonical ternary form.
+TEST_F(P4FlayTest, ParserValueSet01) {
+    auto range = ParserValueSet::convertRange(1, 6, 3);
+    ASSERT_EQ(range.size(), 4U);
+    EXPECT_EQ(range[1].value, 2);
+    EXPECT_EQ(range[1].mask, 6);
+
+    ParserValueSet parserValueSet("pvs"_cs);
+    parserValueSet.addMembers({{0, 0xFF}, {1, 0xFF}, {2, 0xFF}, {3, 0xFF}, {0x12, 0xFF}});
+    parserValueSet.addMembers({{0x10, 0xF0}});
+    auto members = parserValueSet.computeCanonicalMembers();
+    ASSERT_EQ(members.size(), 2U);
+    EXPECT_EQ(members[0].value, 0);
+    EXPECT_EQ(members[0].mask, 0xFC);
+    EXPECT_EQ(members[1].value, 0x10);
+    EXPECT_EQ(members[1].mask, 0xF0);
+
+    EXPECT_EQ(parserValueSet.deleteMembers({{0x10, 0xF0}, {0x10, 0xF0}}), EXIT_FAILURE);
+    EXPECT_EQ(parserValueSet.deleteMembers({{0x10, 0xF0}}), EXIT_SUCCESS);
+    EXPECT_EQ(parserValueSet.computeCanonicalMembers().size(), 2U);
+
+    // The canonical members are cached until the members change.
+    parserValueSet.clear();
+    EXPECT_TRUE(parserValueSet.computeCanonicalMembers().empty());
+    std::vector<ParserValueSetMember> allValues;
+    for (int value = 0; value <= 0xFF; ++value) {
+        allValues.push_back({value, 0xFF});
+    }
+    parserValueSet.addMembers(allValues);
+    ASSERT_EQ(parserValueSet.computeCanonicalMembers().size(), 1U);
+    EXPECT_EQ(parserValueSet.computeCanonicalMembers()[0].mask, 0);
+
+    auto concatenated = ParserValueSet::concatenate({{{1, 0xF}}, range}, {4, 3});
+    ASSERT_EQ(concatenated.size(), 4U);
+    EXPECT_EQ(concatenated[1].value, 0xA);
+    EXPECT_EQ(concatenated[1].mask, 0x7E);
+}
+
+// The membership test of the canonical members is equivalent to the configured members.
+TEST_F(P4FlayTest, ParserValueSet02) {
+    const auto *key = ToolsVariables::getSymbolicVariable(KEY_TYPE, "pvs_key"_cs);
+    std::mt19937 generator(42);  // NOLINT
+    std::uniform_int_distribution<int> byte(0, 0xFF);
+    for (int round = 0; round < 20; ++round) {
+        ParserValueSet parserValueSet("pvs"_cs);
+        const auto *match = parserValueSet.addSelectKey(key);
+        std::vector<ParserValueSetMember> members;
+        for (int idx = 0; idx < 16; ++idx) {
+            // Prefer dense masks, which create many mergeable members.
+            int mask = byte(generator) | 0xF0;
+            members.push_back({byte(generator) & mask, mask});
+        }
+        parserValueSet.addMembers(members);
+
+        auto assignments = parserValueSet.computeZ3ControlPlaneAssignments();
+        auto membership = assignments.get(*match);
+        ASSERT_TRUE(membership.has_value());
+        z3::solver solver(Z3Cache::context());
+        solver.add(membership.value() != computeMembership(key, members));
+        EXPECT_EQ(solver.check(), z3::unsat);
+    }
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
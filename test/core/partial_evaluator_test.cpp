@@ -0,0 +1,185 @@
+#include "backends/p4tools/modules/flay/core/interpreter/partial_evaluator.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "backends/p4tools/common/compiler/compiler_target.h"
+#include "backends/p4tools/modules/flay/core/control_plane/p4info_index.h"
+#include "backends/p4tools/modules/flay/core/interpreter/compiler_result.h"
+#include "backends/p4tools/modules/flay/core/interpreter/target.h"
+#include "backends/p4tools/modules/flay/core/lib/incremental_analysis.h"
+#include "backends/p4tools/modules/flay/options.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "backends/p4tools/modules/flay/toolname.h"
+#include "lib/error.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using P4::P4Tools::Flay::ControlPlaneUpdate;
+using P4::P4Tools::Flay::FlayCompilerResult;
+using P4::P4Tools::Flay::FlayOptions;
+using P4::P4Tools::Flay::FlayTarget;
+using P4::P4Tools::Flay::P4InfoIndex;
+using P4::P4Tools::Flay::P4RuntimeControlPlaneUpdate;
+using P4::P4Tools::Flay::PartialEvaluation;
+using P4::P4Tools::Flay::PartialEvaluationOptions;
+
+/// A program whose action "check" only becomes reachable once table "toggle_check" has an entry.
+constexpr const char *kProgram = R"(
+#include <v1model.p4>
+
+header ethernet_t {
+    bit<48> dst_addr;
+    bit<48> src_addr;
+    bit<16> ether_type;
+}
+
+struct local_metadata_t {}
+
+struct Headers {
+    ethernet_t ethernet;
+}
+
+parser p(packet_in pkt, out Headers h, inout local_metadata_t local_metadata,
+         inout standard_metadata_t stdmeta) {
+    state start {
+        pkt.extract(h.ethernet);
+        transition accept;
+    }
+}
+
+control vrfy(inout Headers h, inout local_metadata_t local_metadata) {
+    apply {}
+}
+
+control ingress(inout Headers h, inout local_metadata_t local_metadata,
+                inout standard_metadata_t s) {
+    action check() {
+        h.ethernet.ether_type = 0x800;
+    }
+
+    table toggle_check {
+        key = {
+            h.ethernet.dst_addr : ternary @name("dst_eth");
+        }
+        actions = {
+            check();
+            NoAction();
+        }
+        default_action = NoAction();
+    }
+
+    apply {
+        toggle_check.apply();
+    }
+}
+
+control egress(inout Headers h, inout local_metadata_t local_metadata,
+               inout standard_metadata_t s) {
+    apply {}
+}
+
+control update(inout Headers h, inout local_metadata_t local_metadata) {
+    apply {}
+}
+
+control deparser(packet_out pkt, in Headers h) {
+    apply {
+        pkt.emit(h);
+    }
+}
+
+V1Switch(p(), vrfy(), ingress(), egress(), update(), deparser()) main;
+)";
+
+/// @returns an update of type @param type for an entry of table "toggle_check" which matches the
+/// destination address 1 and executes action "check".
+p4::v1::Update createTableUpdate(const P4InfoIndex &p4InfoIndex, p4::v1::Update::Type type) {
+    const auto *p4InfoTable = p4InfoIndex.findTable(cstring("ingress.toggle_check"));
+    EXPECT_NE(p4InfoTable, nullptr);
+    p4::v1::Update update;
+    update.set_type(type);
+    auto *tableEntry = update.mutable_entity()->mutable_table_entry();
+    tableEntry->set_table_id(p4InfoTable->table.get().preamble().id());
+    tableEntry->set_priority(1);
+    auto *match = tableEntry->add_match();
+    match->set_field_id(p4InfoTable->keyLayout.front().matchField.get().id());
+    match->mutable_ternary()->set_value(std::string("\x01", 1));
+    match->mutable_ternary()->set_mask(std::string(6, '\xff'));
+    for (const auto &action : p4InfoIndex.p4Info().actions()) {
+        if (action.preamble().name() == "ingress.check") {
+            tableEntry->mutable_action()->mutable_action()->set_action_id(action.preamble().id());
+        }
+    }
+    return update;
+}
+
+/// A batch which is rejected as a whole must neither poison the error count of the session nor
+/// change the control plane state, so the next valid batch is still specialized.
+TEST_F(P4FlayTest, PartialEvaluation01) {
+    auto context = P4FlayTest::SetUp("bmv2", "v1model");
+    ASSERT_TRUE(context.has_value());
+    const auto &flayOptions = FlayOptions::get();
+    auto compilerResult =
+        P4Tools::CompilerTarget::runCompiler(flayOptions, Flay::TOOL_NAME, std::string(kProgram));
+    ASSERT_TRUE(compilerResult.has_value());
+    const auto *flayCompilerResult = compilerResult.value().get().to<FlayCompilerResult>();
+    ASSERT_NE(flayCompilerResult, nullptr);
+    const auto *programInfo = FlayTarget::produceProgramInfo(*flayCompilerResult);
+    ASSERT_NE(programInfo, nullptr);
+
+    PartialEvaluationOptions partialEvaluationOptions;
+    PartialEvaluation partialEvaluation(flayOptions, *flayCompilerResult, *programInfo,
+                                        partialEvaluationOptions);
+    ASSERT_EQ(partialEvaluation.initialize(), EXIT_SUCCESS);
+    const auto &program = flayCompilerResult->getProgram();
+    const auto &p4InfoIndex = flayCompilerResult->getP4InfoIndex();
+
+    // Deleting an entry which does not exist is rejected.
+    auto deleteUpdate = createTableUpdate(p4InfoIndex, p4::v1::Update::DELETE);
+    P4RuntimeControlPlaneUpdate deleteControlPlaneUpdate(deleteUpdate);
+    std::vector<const ControlPlaneUpdate *> deleteBatch{&deleteControlPlaneUpdate};
+    std::set<size_t> rejectedUpdates;
+    auto result =
+        partialEvaluation.processControlPlaneUpdate(program, deleteBatch, rejectedUpdates);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value(), nullptr);
+    EXPECT_EQ(rejectedUpdates, std::set<size_t>{0});
+    EXPECT_EQ(errorCount(), 0U);
+
+    // Inserting the entry makes action "check" reachable and still specializes the program.
+    auto insertUpdate = createTableUpdate(p4InfoIndex, p4::v1::Update::INSERT);
+    P4RuntimeControlPlaneUpdate insertControlPlaneUpdate(insertUpdate);
+    std::vector<const ControlPlaneUpdate *> insertBatch{&insertControlPlaneUpdate};
+    rejectedUpdates.clear();
+    result = partialEvaluation.processControlPlaneUpdate(program, insertBatch, rejectedUpdates);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_NE(result.value(), nullptr);
+    EXPECT_TRUE(rejectedUpdates.empty());
+    EXPECT_EQ(errorCount(), 0U);
+
+    // Inserting the same entry again is rejected and leaves the entry in place, so deleting it
+    // afterwards succeeds.
+    rejectedUpdates.clear();
+    result = partialEvaluation.processControlPlaneUpdate(program, insertBatch, rejectedUpdates);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(rejectedUpdates, std::set<size_t>{0});
+    rejectedUpdates.clear();
+    result = partialEvaluation.processControlPlaneUpdate(program, deleteBatch, rejectedUpdates);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_NE(result.value(), nullptr);
+    EXPECT_TRUE(rejectedUpdates.empty());
+    EXPECT_EQ(errorCount(), 0U);
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
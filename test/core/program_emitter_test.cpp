@@ -0,0 +1,73 @@
+#include "backends/p4tools/modules/flay/core/specialization/program_emitter.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "frontends/p4/toP4/toP4.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+using P4::P4Tools::Flay::ProgramEmitter;
+
+/// @returns the ToP4 output for the whole @param program.
+std::string printProgram(const IR::P4Program &program) {
+    std::stringstream output;
+    P4::ToP4 toP4(&output, false);
+    program.apply(toP4);
+    return output.str();
+}
+
+/// @returns an action named "a" containing @param statementCount assignments.
+const IR::P4Action *createAction(size_t statementCount) {
+    IR::IndexedVector<IR::StatOrDecl> components;
+    for (size_t idx = 0; idx < statementCount; idx++) {
+        const auto *value = IR::Constant::get(IR::Type_Bits::get(8), idx);
+        components.push_back(
+            new IR::AssignmentStatement(new IR::PathExpression(new IR::Path("x"_cs)), value));
+    }
+    return new IR::P4Action("a"_cs, new IR::ParameterList(), new IR::BlockStatement(components));
+}
+
+// The emitted program matches ToP4 and only changed declarations are rendered again.
+TEST_F(P4FlayTest, ProgramEmitter01) {
+    IR::IndexedVector<IR::StructField> fields;
+    fields.push_back(new IR::StructField("f"_cs, IR::Type_Bits::get(8)));
+    const auto *header = new IR::Type_Header("h_t"_cs, fields);
+
+    IR::Vector<IR::Node> objects;
+    objects.push_back(header);
+    objects.push_back(createAction(2));
+    const auto *program = new IR::P4Program(objects);
+
+    ProgramEmitter emitter;
+    std::stringstream output;
+    emitter.emit(*program, output);
+    EXPECT_EQ(output.str(), printProgram(*program));
+    EXPECT_EQ(emitter.measureSize(*program), output.str().size());
+    EXPECT_EQ(emitter.countStatements(*program), 2U);
+    EXPECT_EQ(emitter.statistics().renderedDeclarations, 2U);
+    EXPECT_EQ(emitter.statistics().reusedDeclarations, 2U);
+
+    // Replace the action, as specialization does, and keep the header.
+    IR::Vector<IR::Node> specializedObjects;
+    specializedObjects.push_back(header);
+    specializedObjects.push_back(createAction(0));
+    const auto *specializedProgram = new IR::P4Program(specializedObjects);
+    std::stringstream specializedOutput;
+    emitter.emit(*specializedProgram, specializedOutput);
+    EXPECT_EQ(specializedOutput.str(), printProgram(*specializedProgram));
+    EXPECT_EQ(emitter.countStatements(*specializedProgram), 0U);
+    EXPECT_EQ(emitter.statistics().renderedDeclarations, 3U);
+    EXPECT_EQ(emitter.statistics().reusedDeclarations, 3U);
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
@@ -0,0 +1,57 @@
+#include "backends/p4tools/modules/flay/core/lib/statistics_report.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#include "backends/p4tools/modules/flay/test/helpers.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using P4::P4Tools::StatisticsFormat;
+using P4::P4Tools::StatisticsReport;
+
+/// @returns @param report written in @param format.
+std::string writeReport(const StatisticsReport &report, StatisticsFormat format) {
+    std::stringstream output;
+    report.write(output, format);
+    return output.str();
+}
+
+// Single values and series are written in insertion order, with strings escaped.
+TEST_F(P4FlayTest, StatisticsReport01) {
+    EXPECT_EQ(StatisticsReport::parseFormat("csv"), StatisticsFormat::kCsv);
+    EXPECT_EQ(StatisticsReport::parseFormat("text"), std::nullopt);
+
+    StatisticsReport report;
+    report.set("main", "statement_count_before", uint64_t{12});
+    report.append("main", "update_latency_us", uint64_t{30});
+    report.append("main", "update_latency_us", uint64_t{20});
+    report.set("timers_ms", "Parse, \"and\" check", 1.5);
+
+    EXPECT_EQ(writeReport(report, StatisticsFormat::kJson),
+              "{\n"
+              "  \"main\": {\n"
+              "    \"statement_count_before\": 12,\n"
+              "    \"update_latency_us\": [30, 20]\n"
+              "  },\n"
+              "  \"timers_ms\": {\n"
+              "    \"Parse, \\\"and\\\" check\": 1.5\n"
+              "  }\n"
+              "}\n");
+    EXPECT_EQ(writeReport(report, StatisticsFormat::kCsv),
+              "section,metric,index,value\n"
+              "main,statement_count_before,,12\n"
+              "main,update_latency_us,0,30\n"
+              "main,update_latency_us,1,20\n"
+              "timers_ms,\"Parse, \"\"and\"\" check\",,1.5\n");
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
@@ -0,0 +1,60 @@
+#include "backends/p4tools/modules/flay/core/control_plane/symbol_dependency_index.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "backends/p4tools/common/lib/variables.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+using P4::P4Tools::Flay::SymbolDependencyIndex;
+using P4::P4Tools::Flay::SymbolSet;
+
+const IR::SymbolicVariable &getSymbol(cstring name) {
+    return *ToolsVariables::getSymbolicVariable(IR::Type_Bits::get(8), name);
+}
+
+// Nodes are found by semantically equal symbols and returned once, in id order.
+TEST_F(P4FlayTest, SymbolDependencyIndex01) {
+    const auto *first = new IR::Constant(1);
+    const auto *second = new IR::Constant(2);
+    const auto *third = new IR::Constant(3);
+
+    SymbolDependencyIndex index;
+    index.addDependency(getSymbol("a"_cs), first);
+    index.addDependency(getSymbol("b"_cs), second);
+    index.addDependencies({getSymbol("a"_cs), getSymbol("b"_cs)}, third);
+    index.addDependency(getSymbol("b"_cs), first);
+    EXPECT_EQ(index.nodeCount(), 3U);
+
+    // Symbols are compared by value and not by pointer.
+    auto ids = index.dependentNodeIds({getSymbol("b"_cs)});
+    ASSERT_EQ(ids.size(), 3U);
+    EXPECT_EQ(index.node(ids[0]), first);
+    EXPECT_EQ(index.node(ids[1]), second);
+    EXPECT_EQ(index.node(ids[2]), third);
+    EXPECT_EQ(index.dependentNodeIds({getSymbol("a"_cs), getSymbol("b"_cs)}).size(), 3U);
+    EXPECT_TRUE(index.dependentNodeIds({getSymbol("c"_cs)}).empty());
+
+    SymbolDependencyIndex other;
+    const auto *fourth = new IR::Constant(4);
+    other.addDependency(getSymbol("c"_cs), fourth);
+    other.addDependency(getSymbol("a"_cs), second);
+    index.merge(other);
+    EXPECT_EQ(index.nodeCount(), 4U);
+    EXPECT_EQ(index.dependentNodeIds({getSymbol("a"_cs)}),
+              (std::vector<SymbolDependencyIndex::NodeId>{index.nodeId(first).value(),
+                                                          index.nodeId(second).value(),
+                                                          index.nodeId(third).value()}));
+    EXPECT_EQ(index.dependentNodes({getSymbol("c"_cs)}).size(), 1U);
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
@@ -0,0 +1,212 @@
+#include "backends/p4tools/modules/flay/core/control_plane/table_encoding.h"
+
+#include <gtest/gtest.h>
+
+#include <z3++.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "backends/p4tools/common/control_plane/symbolic_variables.h"
+#include "backends/p4tools/common/lib/variables.h"
+#include "backends/p4tools/modules/flay/core/control_plane/control_plane_objects.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "ir/ir.h"
+#include "ir/irutils.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+using P4::P4Tools::Flay::ControlPlaneAssignmentSet;
+using P4::P4Tools::Flay::ExactTableMatchKey;
+using P4::P4Tools::Flay::LpmTableMatchKey;
+using P4::P4Tools::Flay::RangeTableMatchKey;
+using P4::P4Tools::Flay::TableConfiguration;
+using P4::P4Tools::Flay::TableDefaultAction;
+using P4::P4Tools::Flay::TableEncodingStrategy;
+using P4::P4Tools::Flay::TableEntrySet;
+using P4::P4Tools::Flay::TableMatchEntry;
+using P4::P4Tools::Flay::Z3ControlPlaneAssignmentSet;
+
+const auto *const KEY_TYPE = IR::Type_Bits::get(8);
+
+/// Create a table configuration for table "t" whose default action is not configured.
+TableConfiguration &createTable(TableEntrySet entries = {}) {
+    ControlPlaneAssignmentSet defaultAction;
+    defaultAction.emplace(*ControlPlaneState::getTableActionChoice("t"_cs),
+                          *IR::StringLiteral::get("*NONE*"_cs));
+    return *new TableConfiguration("t"_cs, TableDefaultAction(defaultAction), std::move(entries));
+}
+
+/// Create an entry executing @param action with argument @param argument.
+TableMatchEntry &createEntry(cstring action, int argument, ControlPlaneAssignmentSet matches) {
+    ControlPlaneAssignmentSet actionAssignment;
+    actionAssignment.emplace(*ControlPlaneState::getTableActionChoice("t"_cs),
+                             *IR::StringLiteral::get(action));
+    actionAssignment.emplace(
+        *ControlPlaneState::getTableActionArgument("t"_cs, action, "p"_cs, KEY_TYPE),
+        *IR::Constant::get(KEY_TYPE, argument));
+    return *new TableMatchEntry(actionAssignment, 0, std::move(matches));
+}
+
+/// Check that both assignment sets assign equivalent expressions to the same variables.
+void expectEquivalent(const Z3ControlPlaneAssignmentSet &expected,
+                      const Z3ControlPlaneAssignmentSet &actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    expected.forEach([&actual](const IR::SymbolicVariable &var, const z3::expr &expectedExpr) {
+        auto actualExpr = actual.get(var);
+        ASSERT_TRUE(actualExpr.has_value());
+        z3::solver solver(Z3Cache::context());
+        solver.add(expectedExpr != actualExpr.value());
+        EXPECT_EQ(solver.check(), z3::unsat);
+    });
+}
+
+/// @returns the action chosen by the @param assignments when the key is @param keyValue.
+z3::expr chosenAction(const Z3ControlPlaneAssignmentSet &assignments,
+                      const IR::SymbolicVariable *keyExpression, int keyValue) {
+    auto action = assignments.get(*ControlPlaneState::getTableActionChoice("t"_cs)).value();
+    z3::expr_vector from(Z3Cache::context());
+    z3::expr_vector to(Z3Cache::context());
+    from.push_back(Z3Cache::set(keyExpression));
+    to.push_back(Z3Cache::set(IR::Constant::get(KEY_TYPE, keyValue)));
+    return action.substitute(from, to).simplify();
+}
+
+// The exact partition encoding is equivalent to the ite chain on small tables.
+TEST_F(P4FlayTest, TableEncoding01) {
+    const auto *keyExpression = ToolsVariables::getSymbolicVariable(KEY_TYPE, "exact_key"_cs);
+    const auto *keySymbol = ControlPlaneState::getTableKey("t"_cs, "k"_cs, KEY_TYPE);
+    auto &table = createTable();
+    table.setTableKeyMatch({new ExactTableMatchKey("t"_cs, "k"_cs, keyExpression)});
+    for (int idx = 0; idx < 20; ++idx) {
+        auto action = idx % 2 == 0 ? "a1"_cs : "a2"_cs;
+        table.addTableEntry(
+            createEntry(action, idx % 3, {{*keySymbol, *IR::Constant::get(KEY_TYPE, idx)}}), false);
+    }
+
+    expectEquivalent(table.encodeZ3ControlPlaneAssignments(TableEncodingStrategy::kIteChain),
+                     table.encodeZ3ControlPlaneAssignments(TableEncodingStrategy::kExactPartition));
+}
+
+// The LPM trie encoding is equivalent to the ite chain if prefixes do not overlap.
+TEST_F(P4FlayTest, TableEncoding02) {
+    const auto *keyExpression = ToolsVariables::getSymbolicVariable(KEY_TYPE, "lpm_key"_cs);
+    const auto *keySymbol = ControlPlaneState::getTableKey("t"_cs, "k"_cs, KEY_TYPE);
+    const auto *prefixSymbol = ControlPlaneState::getTableMatchLpmPrefix("t"_cs, "k"_cs, KEY_TYPE);
+    auto &table = createTable();
+    table.setTableKeyMatch({new LpmTableMatchKey("t"_cs, "k"_cs, keyExpression)});
+    auto addEntry = [&](cstring action, int argument, int value, int prefix) {
+        table.addTableEntry(createEntry(action, argument,
+                                        {{*keySymbol, *IR::Constant::get(KEY_TYPE, value)},
+                                         {*prefixSymbol, *IR::Constant::get(KEY_TYPE, prefix)}}),
+                            false);
+    };
+    addEntry("a1"_cs, 1, 0x10, 4);
+    addEntry("a2"_cs, 2, 0x20, 4);
+    addEntry("a1"_cs, 3, 0x35, 0);
+    addEntry("a2"_cs, 1, 0x36, 0);
+
+    expectEquivalent(table.encodeZ3ControlPlaneAssignments(TableEncodingStrategy::kIteChain),
+                     table.encodeZ3ControlPlaneAssignments(TableEncodingStrategy::kLpmTrie));
+}
+
+// With overlapping prefixes, the entry with the longest matching prefix is executed.
+TEST_F(P4FlayTest, TableEncoding03) {
+    const auto *keyExpression = ToolsVariables::getSymbolicVariable(KEY_TYPE, "lpm_key"_cs);
+    const auto *keySymbol = ControlPlaneState::getTableKey("t"_cs, "k"_cs, KEY_TYPE);
+    const auto *prefixSymbol = ControlPlaneState::getTableMatchLpmPrefix("t"_cs, "k"_cs, KEY_TYPE);
+    auto &table = createTable();
+    table.setTableKeyMatch({new LpmTableMatchKey("t"_cs, "k"_cs, keyExpression)});
+    table.addTableEntry(createEntry("a1"_cs, 1,
+                                    {{*keySymbol, *IR::Constant::get(KEY_TYPE, 0x10)},
+                                     {*prefixSymbol, *IR::Constant::get(KEY_TYPE, 4)}}),
+                        false);
+    table.addTableEntry(createEntry("a2"_cs, 2,
+                                    {{*keySymbol, *IR::Constant::get(KEY_TYPE, 0x15)},
+                                     {*prefixSymbol, *IR::Constant::get(KEY_TYPE, 0)}}),
+                        false);
+
+    auto assignments = table.encodeZ3ControlPlaneAssignments(TableEncodingStrategy::kLpmTrie);
+    auto actionA1 = Z3Cache::set(IR::StringLiteral::get("a1"_cs));
+    auto actionA2 = Z3Cache::set(IR::StringLiteral::get("a2"_cs));
+    EXPECT_TRUE(z3::eq(chosenAction(assignments, keyExpression, 0x15), actionA2));
+    EXPECT_TRUE(z3::eq(chosenAction(assignments, keyExpression, 0x16), actionA1));
+}
+
+// The trie is patched on insertion and removal and stays equivalent to a rebuilt trie.
+TEST_F(P4FlayTest, TableEncoding04) {
+    const auto *keyExpression = ToolsVariables::getSymbolicVariable(KEY_TYPE, "lpm_key"_cs);
+    const auto *keySymbol = ControlPlaneState::getTableKey("t"_cs, "k"_cs, KEY_TYPE);
+    const auto *prefixSymbol = ControlPlaneState::getTableMatchLpmPrefix("t"_cs, "k"_cs, KEY_TYPE);
+    const auto *key = new LpmTableMatchKey("t"_cs, "k"_cs, keyExpression);
+    auto &table = createTable();
+    table.setTableKeyMatch({key});
+    std::vector<TableMatchEntry *> entries;
+    auto addEntry = [&](cstring action, int argument, int value, int prefix) -> auto & {
+        auto &entry = createEntry(action, argument,
+                                  {{*keySymbol, *IR::Constant::get(KEY_TYPE, value)},
+                                   {*prefixSymbol, *IR::Constant::get(KEY_TYPE, prefix)}});
+        table.addTableEntry(entry, false);
+        entries.push_back(&entry);
+        return entry;
+    };
+    auto deleteEntry = [&](TableMatchEntry &entry) {
+        EXPECT_EQ(table.deleteTableEntry(entry), 1U);
+        entries.erase(std::find(entries.begin(), entries.end(), &entry));
+    };
+    auto expectRebuiltEquivalent = [&]() {
+        TableEntrySet entrySet;
+        for (auto *entry : entries) {
+            entrySet.emplace(*entry);
+        }
+        auto &rebuilt = createTable(entrySet);
+        rebuilt.setTableKeyMatch({key});
+        expectEquivalent(rebuilt.encodeZ3ControlPlaneAssignments(TableEncodingStrategy::kLpmTrie),
+                         table.encodeZ3ControlPlaneAssignments(TableEncodingStrategy::kLpmTrie));
+    };
+
+    addEntry("a2"_cs, 3, 0x15, 0);
+    auto &shortPrefix = addEntry("a1"_cs, 1, 0x10, 4);
+    // The new entry is linked between the existing entries.
+    auto &longPrefix = addEntry("a2"_cs, 2, 0x14, 2);
+    addEntry("a1"_cs, 2, 0x80, 7);
+    expectRebuiltEquivalent();
+
+    // The children of a removed entry are relinked to its parent.
+    deleteEntry(longPrefix);
+    expectRebuiltEquivalent();
+    deleteEntry(shortPrefix);
+    expectRebuiltEquivalent();
+}
+
+// The range partition encoding is equivalent to the ite chain with overlapping ranges.
+TEST_F(P4FlayTest, TableEncoding05) {
+    const auto *keyExpression = ToolsVariables::getSymbolicVariable(KEY_TYPE, "range_key"_cs);
+    const auto *key = new RangeTableMatchKey("t"_cs, "k"_cs, keyExpression);
+    auto &table = createTable();
+    table.setTableKeyMatch({key});
+    auto addEntry = [&](cstring action, int argument, int minValue, int maxValue) {
+        table.addTableEntry(createEntry(action, argument,
+                                        {{*key->minKey(), *IR::Constant::get(KEY_TYPE, minValue)},
+                                         {*key->maxKey(), *IR::Constant::get(KEY_TYPE, maxValue)}}),
+                            false);
+    };
+    addEntry("a1"_cs, 1, 0, 100);
+    addEntry("a2"_cs, 2, 50, 60);
+    addEntry("a1"_cs, 3, 55, 255);
+    addEntry("a2"_cs, 1, 200, 210);
+    // An empty range never matches.
+    addEntry("a2"_cs, 2, 70, 70);
+
+    expectEquivalent(table.encodeZ3ControlPlaneAssignments(TableEncodingStrategy::kIteChain),
+                     table.encodeZ3ControlPlaneAssignments(TableEncodingStrategy::kRangePartition));
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
@@ -0,0 +1,86 @@
+#include "backends/p4tools/modules/flay/core/control_plane/z3_control_plane_assignment.h"
+
+#include <gtest/gtest.h>
+
+#include <z3++.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "backends/p4tools/common/lib/variables.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+using P4::P4Tools::Flay::Z3ControlPlaneAssignmentSet;
+
+const auto *const VALUE_TYPE = IR::Type_Bits::get(8);
+
+const IR::SymbolicVariable &getVariable(cstring name) {
+    return *ToolsVariables::getSymbolicVariable(VALUE_TYPE, name);
+}
+
+z3::expr getValue(int value) { return Z3Cache::set(IR::Constant::get(VALUE_TYPE, value)); }
+
+/// @returns the numeric value of @param expression after substituting the @param assignments.
+uint64_t substitute(const Z3ControlPlaneAssignmentSet &assignments, z3::expr expression) {
+    auto result = assignments.substitute(expression);
+    EXPECT_TRUE(result.is_numeral());
+    return result.get_numeral_uint64();
+}
+
+// Updates and removals patch the substitution vectors in place.
+TEST_F(P4FlayTest, Z3ControlPlaneAssignment01) {
+    Z3ControlPlaneAssignmentSet assignments;
+    auto sum = Z3Cache::set(&getVariable("a"_cs)) + Z3Cache::set(&getVariable("b"_cs)) +
+               Z3Cache::set(&getVariable("c"_cs));
+    ASSERT_TRUE(assignments.add(getVariable("a"_cs), getValue(1)));
+    ASSERT_TRUE(assignments.add(getVariable("b"_cs), getValue(2)));
+    ASSERT_TRUE(assignments.add(getVariable("c"_cs), getValue(4)));
+    EXPECT_EQ(substitute(assignments, sum), 7U);
+
+    auto version = assignments.version();
+    assignments.set(getVariable("b"_cs), getValue(8));
+    EXPECT_GT(assignments.version(), version);
+    EXPECT_EQ(substitute(assignments, sum), 13U);
+
+    // Removing the first variable moves the last one into its position.
+    ASSERT_TRUE(assignments.remove(getVariable("a"_cs)));
+    EXPECT_FALSE(assignments.remove(getVariable("a"_cs)));
+    EXPECT_EQ(assignments.size(), 2U);
+    assignments.set(getVariable("c"_cs), getValue(16));
+    assignments.set(getVariable("a"_cs), getValue(32));
+    EXPECT_EQ(substitute(assignments, sum), 56U);
+
+    auto results = assignments.substitute(std::vector<z3::expr>{
+        Z3Cache::set(&getVariable("a"_cs)), Z3Cache::set(&getVariable("c"_cs))});
+    ASSERT_EQ(results.size(), 2U);
+    EXPECT_EQ(results[0].get_numeral_uint64(), 32U);
+    EXPECT_EQ(results[1].get_numeral_uint64(), 16U);
+}
+
+// Copies do not share their substitution vectors.
+TEST_F(P4FlayTest, Z3ControlPlaneAssignment02) {
+    Z3ControlPlaneAssignmentSet assignments;
+    auto variable = Z3Cache::set(&getVariable("a"_cs));
+    assignments.set(getVariable("a"_cs), getValue(1));
+    auto copy = assignments;
+    copy.set(getVariable("a"_cs), getValue(2));
+    EXPECT_EQ(substitute(assignments, variable), 1U);
+    EXPECT_EQ(substitute(copy, variable), 2U);
+
+    auto moved = std::move(copy);
+    EXPECT_EQ(substitute(moved, variable), 2U);
+    moved.remove(getVariable("a"_cs));
+    EXPECT_EQ(substitute(assignments, variable), 1U);
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
@@ -0,0 +1,92 @@
+#include "backends/p4tools/modules/flay/core/lib/z3_result_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <z3++.h>
+
+#include <cstdlib>
+#include <filesystem>
+
+#include "backends/p4tools/common/lib/variables.h"
+#include "backends/p4tools/modules/flay/core/control_plane/z3_control_plane_assignment.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
+#include "backends/p4tools/modules/flay/core/specialization/z3/cached_substitution.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "ir/ir.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using namespace P4::literals;
+using P4::P4Tools::Flay::substituteWithResultCache;
+using P4::P4Tools::Flay::Z3ControlPlaneAssignmentSet;
+using P4::P4Tools::Flay::Z3ResultFingerprint;
+
+const auto *const VALUE_TYPE = IR::Type_Bits::get(8);
+
+const IR::SymbolicVariable &getVariable(cstring name) {
+    return *ToolsVariables::getSymbolicVariable(VALUE_TYPE, name);
+}
+
+z3::expr getValue(int value) { return Z3Cache::set(IR::Constant::get(VALUE_TYPE, value)); }
+
+// Results are keyed by the relevant assignments and survive reopening the cache file.
+TEST_F(P4FlayTest, Z3ResultCache01) {
+    auto cachePath = std::filesystem::temp_directory_path() / "flay_z3_result_cache_01.cache";
+    auto otherPath = std::filesystem::temp_directory_path() / "flay_z3_result_cache_02.cache";
+    std::filesystem::remove(cachePath);
+    std::filesystem::remove(otherPath);
+    ASSERT_EQ(Z3ResultCache::open(cachePath, 1), EXIT_SUCCESS);
+
+    const auto *sum = new IR::Add(&getVariable("a"_cs), &getVariable("b"_cs));
+    auto z3Sum = Z3Cache::set(sum);
+    Z3ResultFingerprint fingerprint(*sum, z3Sum);
+    Z3ControlPlaneAssignmentSet assignments;
+    ASSERT_TRUE(assignments.add(getVariable("a"_cs), getValue(1)));
+    ASSERT_TRUE(assignments.add(getVariable("b"_cs), getValue(2)));
+    auto results = substituteWithResultCache(assignments, {z3Sum}, {&fingerprint});
+    EXPECT_EQ(results[0].get_numeral_uint64(), 3U);
+    EXPECT_EQ(Z3ResultCache::statistics().misses, 1U);
+
+    // Assignments to symbols which do not occur in the expression do not change the key.
+    ASSERT_TRUE(assignments.add(getVariable("c"_cs), getValue(4)));
+    results = substituteWithResultCache(assignments, {z3Sum}, {&fingerprint});
+    EXPECT_EQ(results[0].get_numeral_uint64(), 3U);
+    EXPECT_EQ(Z3ResultCache::statistics().hits, 1U);
+
+    assignments.set(getVariable("b"_cs), getValue(8));
+    results = substituteWithResultCache(assignments, {z3Sum}, {&fingerprint});
+    EXPECT_EQ(results[0].get_numeral_uint64(), 9U);
+    EXPECT_EQ(Z3ResultCache::statistics().misses, 2U);
+
+    // Symbolic results are not cached.
+    const auto *partialSum = new IR::Add(&getVariable("a"_cs), &getVariable("d"_cs));
+    auto z3PartialSum = Z3Cache::set(partialSum);
+    Z3ResultFingerprint partialFingerprint(*partialSum, z3PartialSum);
+    results = substituteWithResultCache(assignments, {z3PartialSum}, {&partialFingerprint});
+    EXPECT_FALSE(results[0].is_numeral());
+    EXPECT_EQ(Z3ResultCache::statistics().size, 2U);
+    ASSERT_EQ(Z3ResultCache::save(), EXIT_SUCCESS);
+
+    // Reloading the file restores the results of the same program only.
+    ASSERT_EQ(Z3ResultCache::open(otherPath, 1), EXIT_SUCCESS);
+    ASSERT_EQ(Z3ResultCache::open(cachePath, 1), EXIT_SUCCESS);
+    EXPECT_EQ(Z3ResultCache::statistics().loaded, 2U);
+    Z3ResultFingerprint::AssignmentHashMap assignmentHashes;
+    auto key = fingerprint.computeKey(assignments, assignmentHashes);
+    auto cachedResult = Z3ResultCache::lookup(key);
+    ASSERT_TRUE(cachedResult.has_value());
+    auto cachedExpression = cachedResult.value().toExpression(z3Sum);
+    ASSERT_TRUE(cachedExpression.has_value());
+    EXPECT_EQ(cachedExpression.value().get_numeral_uint64(), 9U);
+
+    ASSERT_EQ(Z3ResultCache::open(cachePath, 2), EXIT_SUCCESS);
+    EXPECT_EQ(Z3ResultCache::statistics().size, 0U);
+    std::filesystem::remove(cachePath);
+    std::filesystem::remove(otherPath);
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
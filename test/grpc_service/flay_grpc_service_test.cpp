@@ -0,0 +1,196 @@
+#include "backends/p4tools/modules/flay/grpc_service/flay_grpc_service.h"
+
+#include <grpcpp/grpcpp.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "backends/p4tools/common/compiler/compiler_result.h"
+#include "backends/p4tools/modules/flay/core/interpreter/compiler_result.h"
+#include "backends/p4tools/modules/flay/core/specialization/flay_session.h"
+#include "backends/p4tools/modules/flay/options.h"
+#include "backends/p4tools/modules/flay/test/helpers.h"
+#include "control-plane/p4RuntimeSerializer.h"
+#include "ir/ir.h"
+#include "lib/error.h"
+
+namespace P4::P4Tools::Test {
+
+namespace {
+
+using P4::P4Tools::Flay::FlayCompilerResult;
+using P4::P4Tools::Flay::FlayOptions;
+using P4::P4Tools::Flay::FlayService;
+using P4::P4Tools::Flay::FlayServiceOptions;
+using P4::P4Tools::Flay::FlaySession;
+using P4::P4Tools::Flay::IncrementalAnalysisMap;
+
+/// Blocks the processing thread while it is closed, so the test can fill the write queue.
+class Gate {
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _isOpen = true;
+    bool _hasWaiter = false;
+
+ public:
+    /// Wait until the gate is open.
+    void pass() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _hasWaiter = !_isOpen;
+        _condition.notify_all();
+        _condition.wait(lock, [this]() { return _isOpen; });
+    }
+
+    /// Wait until a thread is blocked by the closed gate.
+    void waitForWaiter() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait(lock, [this]() { return _hasWaiter; });
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isOpen = false;
+        _hasWaiter = false;
+    }
+
+    void open() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _isOpen = true;
+        }
+        _condition.notify_all();
+    }
+};
+
+/// @returns a write request with a single update of @param type of an entry of table 1.
+p4::v1::WriteRequest createWrite(p4::v1::Update::Type type, int value, uint64_t electionId = 0) {
+    p4::v1::WriteRequest request;
+    request.mutable_election_id()->set_low(electionId);
+    auto *update = request.add_updates();
+    update->set_type(type);
+    auto *tableEntry = update->mutable_entity()->mutable_table_entry();
+    tableEntry->set_table_id(1);
+    auto *match = tableEntry->add_match();
+    match->set_field_id(1);
+    match->mutable_exact()->set_value(std::string(1, static_cast<char>(value)));
+    return request;
+}
+
+/// @returns the status of writing @param request with @param stub.
+grpc::Status sendWrite(p4::v1::P4Runtime::Stub &stub, const p4::v1::WriteRequest &request) {
+    grpc::ClientContext context;
+    p4::v1::WriteResponse response;
+    return stub.Write(&context, request, &response);
+}
+
+/// @returns the number of table entries the service reports.
+size_t readTableEntryCount(p4::v1::P4Runtime::Stub &stub) {
+    grpc::ClientContext context;
+    p4::v1::ReadRequest request;
+    request.add_entities()->mutable_table_entry();
+    auto reader = stub.Read(&context, request);
+    size_t entityCount = 0;
+    p4::v1::ReadResponse response;
+    while (reader->Read(&response)) {
+        entityCount += response.entities_size();
+    }
+    EXPECT_TRUE(reader->Finish().ok());
+    return entityCount;
+}
+
+// Writes are applied and mirrored, rejected writes and writes of non-primary clients fail with
+// the respective status, a full queue pushes back, and shutting down does not wait for open
+// streams.
+TEST_F(P4FlayTest, FlayGrpcService01) {
+    const auto *program = new IR::P4Program();
+    FlayCompilerResult compilerResult(
+        CompilerResult(*program), *program,
+        P4::P4RuntimeAPI{new p4::config::v1::P4Info(), new p4::v1::WriteRequest()}, {});
+    TestProgramInfo programInfo(compilerResult);
+    Gate gate;
+    IncrementalAnalysisMap analysisMap;
+    auto analysis =
+        std::make_unique<TestAnalysis>(FlayOptions::get(), compilerResult, programInfo, false);
+    analysis->setConversionHook([&gate]() { gate.pass(); });
+    analysisMap.emplace("gated", std::move(analysis));
+    FlaySession session(compilerResult, std::move(analysisMap));
+
+    FlayServiceOptions serviceOptions;
+    serviceOptions.writeBatchOptions.window = std::chrono::microseconds(0);
+    serviceOptions.writeBatchOptions.maxWrites = 1;
+    serviceOptions.writeBatchOptions.maxPendingWrites = 1;
+    FlayService service(session, serviceOptions);
+    ASSERT_TRUE(service.start(""));
+    std::thread processingThread([&service]() { service.run(); });
+    auto stub = p4::v1::P4Runtime::NewStub(service.inProcessChannel());
+
+    // Clients read their own writes.
+    EXPECT_TRUE(sendWrite(*stub, createWrite(p4::v1::Update::INSERT, 1)).ok());
+    EXPECT_EQ(readTableEntryCount(*stub), 1U);
+
+    // Deleting an entry which was never written only rejects this write.
+    EXPECT_EQ(sendWrite(*stub, createWrite(p4::v1::Update::DELETE, 2)).error_code(),
+              grpc::StatusCode::NOT_FOUND);
+    EXPECT_EQ(readTableEntryCount(*stub), 1U);
+    EXPECT_EQ(errorCount(), 0U);
+
+    // While the processing thread is blocked, one write fits into the queue and the next one is
+    // rejected.
+    gate.close();
+    auto blockedWrite = std::async(std::launch::async, [&stub]() {
+        return sendWrite(*stub, createWrite(p4::v1::Update::INSERT, 3));
+    });
+    gate.waitForWaiter();
+    auto firstWrite = std::async(std::launch::async, [&stub]() {
+        return sendWrite(*stub, createWrite(p4::v1::Update::INSERT, 4));
+    });
+    auto secondWrite = std::async(std::launch::async, [&stub]() {
+        return sendWrite(*stub, createWrite(p4::v1::Update::INSERT, 5));
+    });
+    // The rejected write completes without waiting for the processing thread.
+    auto firstIsReady = firstWrite.wait_for(std::chrono::seconds(10));
+    auto secondIsReady = secondWrite.wait_for(std::chrono::seconds(10));
+    EXPECT_TRUE(firstIsReady == std::future_status::ready ||
+                secondIsReady == std::future_status::ready);
+    gate.open();
+    EXPECT_TRUE(blockedWrite.get().ok());
+    auto firstStatus = firstWrite.get();
+    auto secondStatus = secondWrite.get();
+    EXPECT_NE(firstStatus.ok(), secondStatus.ok());
+    EXPECT_EQ((firstStatus.ok() ? secondStatus : firstStatus).error_code(),
+              grpc::StatusCode::RESOURCE_EXHAUSTED);
+    EXPECT_EQ(readTableEntryCount(*stub), 3U);
+
+    // Once a client has become primary, other clients may not write.
+    grpc::ClientContext streamContext;
+    auto stream = stub->StreamChannel(&streamContext);
+    p4::v1::StreamMessageRequest arbitration;
+    arbitration.mutable_arbitration()->mutable_election_id()->set_low(2);
+    EXPECT_TRUE(stream->Write(arbitration));
+    p4::v1::StreamMessageResponse arbitrationResponse;
+    EXPECT_TRUE(stream->Read(&arbitrationResponse));
+    EXPECT_EQ(arbitrationResponse.arbitration().status().code(), grpc::StatusCode::OK);
+    EXPECT_EQ(sendWrite(*stub, createWrite(p4::v1::Update::INSERT, 6, 1)).error_code(),
+              grpc::StatusCode::PERMISSION_DENIED);
+    EXPECT_TRUE(sendWrite(*stub, createWrite(p4::v1::Update::INSERT, 6, 2)).ok());
+
+    // Shutting down cancels the stream, which the client keeps open.
+    service.requestExit();
+    processingThread.join();
+    EXPECT_FALSE(stream->Read(&arbitrationResponse));
+    EXPECT_FALSE(stream->Finish().ok());
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Test
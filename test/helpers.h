@@ -3,11 +3,22 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdlib>
+#include <functional>
+#include <optional>
+#include <utility>
+
 #include "backends/p4tools/common/compiler/context.h"
+#include "backends/p4tools/modules/flay/core/interpreter/compiler_result.h"
+#include "backends/p4tools/modules/flay/core/interpreter/program_info.h"
 #include "backends/p4tools/modules/flay/core/interpreter/target.h"
+#include "backends/p4tools/modules/flay/core/lib/incremental_analysis.h"
+#include "backends/p4tools/modules/flay/options.h"
 #include "backends/p4tools/modules/flay/register.h"
 #include "backends/p4tools/modules/flay/toolname.h"
+#include "ir/ir.h"
 #include "lib/compile_context.h"
+#include "lib/error.h"
 
 namespace P4::P4Tools {
 
@@ -35,6 +46,88 @@ class P4FlayTest : public testing::Test {
     }
 };
 
+/// A program info object without any target-specific state.
+class TestProgramInfo : public Flay::ProgramInfo {
+ public:
+    explicit TestProgramInfo(const Flay::FlayCompilerResult &compilerResult)
+        : ProgramInfo(compilerResult) {}
+
+    DECLARE_TYPEINFO(TestProgramInfo, ProgramInfo);
+};
+
+/// An analysis for testing the services. Deletions are rejected with an error, like a real
+/// analysis rejects the deletion of an entry which does not exist. All other updates are accepted.
+class TestAnalysis : public Flay::IncrementalAnalysis {
+ public:
+    /// Produces the result of a specialization of the given program.
+    using Specialization = std::function<const IR::P4Program *(const IR::P4Program &)>;
+
+ private:
+    /// Whether the semantics checks report a change.
+    bool _reportsChange;
+
+    /// Invoked before every conversion of an update.
+    std::function<void()> _conversionHook;
+
+    /// Produces the specialized program. Returns the input program if unset.
+    Specialization _specialization;
+
+ protected:
+    std::optional<bool> checkForSemanticsChange() override { return _reportsChange; }
+
+    std::optional<bool> checkForSemanticsChange(const Flay::SymbolSet & /*symbolSet*/) override {
+        return _reportsChange;
+    }
+
+    std::optional<Flay::SymbolSet> convertControlPlaneUpdate(
+        const Flay::ControlPlaneUpdate &controlPlaneUpdate) override {
+        if (_conversionHook) {
+            _conversionHook();
+        }
+        const auto *p4RuntimeUpdate = controlPlaneUpdate.to<Flay::P4RuntimeControlPlaneUpdate>();
+        if (p4RuntimeUpdate != nullptr &&
+            p4RuntimeUpdate->update.type() == p4::v1::Update::DELETE) {
+            error("Entity %1% not found and can not be deleted.",
+                  p4RuntimeUpdate->update.entity().ShortDebugString());
+            return std::nullopt;
+        }
+        return Flay::SymbolSet();
+    }
+
+ public:
+    TestAnalysis(const Flay::FlayOptions &flayOptions,
+                 const Flay::FlayCompilerResult &compilerResult,
+                 const Flay::ProgramInfo &programInfo, bool reportsChange)
+        : IncrementalAnalysis(flayOptions, compilerResult, programInfo),
+          _reportsChange(reportsChange) {}
+
+    /// Invoke @param conversionHook before every conversion of an update.
+    void setConversionHook(std::function<void()> conversionHook) {
+        _conversionHook = std::move(conversionHook);
+    }
+
+    /// Produce the result of every specialization with @param specialization.
+    void setSpecialization(Specialization specialization) {
+        _specialization = std::move(specialization);
+    }
+
+    int initialize() override { return EXIT_SUCCESS; }
+
+    [[nodiscard]] std::optional<const IR::P4Program *> specializeProgram(
+        const IR::P4Program &program) override {
+        if (_specialization) {
+            return _specialization(program);
+        }
+        return &program;
+    }
+
+    [[nodiscard]] Flay::AnalysisStatistics *computeAnalysisStatistics() const override {
+        return nullptr;
+    }
+
+    DECLARE_TYPEINFO(TestAnalysis, IncrementalAnalysis);
+};
+
 }  // namespace P4::P4Tools
 
 #endif /* BACKENDS_P4TOOLS_MODULES_FLAY_TEST_HELPERS_H_ */
@@ -4,7 +4,10 @@
 #include <sstream>
 
 #include "backends/p4tools/common/lib/logging.h"
+#include "backends/p4tools/modules/flay/core/lib/memory_usage.h"
 #include "backends/p4tools/modules/flay/core/lib/return_macros.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_cache.h"
+#include "backends/p4tools/modules/flay/core/lib/z3_result_cache.h"
 #include "backends/p4tools/modules/flay/flay.h"
 #include "backends/p4tools/modules/flay/register.h"
 #include "frontends/common/parser_options.h"
@@ -223,6 +226,9 @@ int run(const ReferenceCheckerOptions &options, const FlayOptions &flayOptions)
             return EXIT_FAILURE;
         }
         printPerformanceReport(referencePath);
+        Z3Cache::printStatistics(referencePath);
+        Z3ResultCache::printStatistics();
+        MemoryUsage::printStatistics(referencePath);
     }
 
     std::stringstream flayOptimizationOutput;
@@ -0,0 +1,167 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "backends/p4tools/common/lib/logging.h"
+#include "backends/p4tools/modules/flay/core/control_plane/protobuf_utils.h"
+#include "backends/p4tools/modules/flay/core/specialization/service_wrapper.h"
+#include "lib/compile_context.h"
+#include "lib/error.h"
+#include "lib/exceptions.h"
+#include "lib/options.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include "backends/p4tools/common/control_plane/bfruntime/bfruntime.pb.h"
+#include "p4/v1/p4runtime.pb.h"
+#pragma GCC diagnostic pop
+
+namespace P4::P4Tools::Flay {
+
+namespace {
+
+class UpdateTraceConverterOptions : protected Util::Options {
+    /// The control plane API of the write requests.
+    std::string _controlPlaneApi = "P4RUNTIME";
+
+    /// The trace file to write. "-" denotes standard output.
+    std::filesystem::path _outputFile = "-";
+
+    /// The patterns of the text update files to convert.
+    std::vector<std::string> _patterns;
+
+ public:
+    UpdateTraceConverterOptions()
+        : Options(
+              "Converts text Protobuf write requests into a trace of length-delimited binary "
+              "write requests, which can be replayed with --config-update-trace.\n"
+              "Usage: flay_update_trace_converter [options] PATTERN...") {
+        registerOption(
+            "--help", nullptr,
+            [this](const char *) {
+                usage();
+                exit(0);
+                return false;
+            },
+            "Shows this help message and exits");
+        registerOption(
+            "--control-plane", "controlPlaneApi",
+            [this](const char *arg) {
+                _controlPlaneApi = arg;
+                if (_controlPlaneApi != "P4RUNTIME" && _controlPlaneApi != "BFRUNTIME") {
+                    error("Unsupported control plane API %1%.", arg);
+                    return false;
+                }
+                return true;
+            },
+            "The control plane API of the write requests, either P4RUNTIME or BFRUNTIME. "
+            "Defaults to P4RUNTIME.");
+        registerOption(
+            "--output", "traceFile",
+            [this](const char *arg) {
+                _outputFile = arg;
+                return true;
+            },
+            "The trace file to write. Defaults to standard output.");
+    }
+
+    const char *getIncludePath() const override {
+        P4C_UNIMPLEMENTED("getIncludePath not implemented for the update trace converter.");
+    }
+
+    /// Process the options and collect the file patterns.
+    /// @returns EXIT_FAILURE if an error occurred.
+    int processOptions(int argc, char *const argv[]) {
+        auto *patterns = process(argc, argv);
+        if (patterns == nullptr) {
+            return EXIT_FAILURE;
+        }
+        if (patterns->empty()) {
+            error("No update file pattern specified.");
+            return EXIT_FAILURE;
+        }
+        for (const auto *pattern : *patterns) {
+            _patterns.emplace_back(pattern);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    [[nodiscard]] std::string_view controlPlaneApi() const { return _controlPlaneApi; }
+
+    [[nodiscard]] const std::filesystem::path &outputFile() const { return _outputFile; }
+
+    [[nodiscard]] const std::vector<std::string> &patterns() const { return _patterns; }
+};
+
+/// Append the write requests in the files matching @param patterns to @param output, in the order
+/// in which the service wrappers process them.
+template <class T>
+int convertUpdateFiles(const std::vector<std::string> &patterns,
+                       google::protobuf::io::ZeroCopyOutputStream &output) {
+    for (const auto &pattern : patterns) {
+        auto files = FlayServiceWrapper::findFiles(pattern);
+        if (files.empty()) {
+            warning("No update files match the pattern %1%.", pattern);
+        }
+        for (const auto &file : files) {
+            printInfo("Converting control plane update: %1%", file);
+            auto writeRequest = Protobuf::deserializeObjectFromFile<T>(file);
+            if (!writeRequest.has_value()) {
+                return EXIT_FAILURE;
+            }
+            if (Protobuf::serializeDelimitedObjectToStream(writeRequest.value(), output) !=
+                EXIT_SUCCESS) {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int run(const UpdateTraceConverterOptions &options) {
+    const auto &outputFile = options.outputFile();
+    bool writeToStdout = outputFile == "-";
+    int fd = writeToStdout ? STDOUT_FILENO
+                           : open(outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                                  0644);  // NOLINT, we are forced to use open here.
+    if (fd < 0) {
+        error("Failed to open file %1%", outputFile.c_str());
+        return EXIT_FAILURE;
+    }
+    google::protobuf::io::FileOutputStream output(fd);
+    output.SetCloseOnDelete(!writeToStdout);
+
+    auto result = options.controlPlaneApi() == "BFRUNTIME"
+                      ? convertUpdateFiles<bfrt_proto::WriteRequest>(options.patterns(), output)
+                      : convertUpdateFiles<p4::v1::WriteRequest>(options.patterns(), output);
+    if (!output.Flush()) {
+        error("Failed to write file %1%", outputFile.c_str());
+        return EXIT_FAILURE;
+    }
+    return result;
+}
+
+}  // namespace
+
+}  // namespace P4::P4Tools::Flay
+
+int main(int argc, char *argv[]) {
+    P4::AutoCompileContext autoContext(new P4::BaseCompileContext());
+    P4::P4Tools::Flay::UpdateTraceConverterOptions options;
+    if (options.processOptions(argc, argv) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    auto result = P4::P4Tools::Flay::run(options);
+    if (result == EXIT_FAILURE) {
+        return EXIT_FAILURE;
+    }
+    return P4::errorCount() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}